@@ -202,9 +202,30 @@ void AutoType::performGlobalAutoType(const QList<Database*>& dbList)
     QList<Entry*> entryList;
     QHash<Entry*, QString> sequenceHash;
 
+    const bool matchTitle = config()->get("AutoTypeEntryTitleMatch").toBool();
+    const bool matchUrl = config()->get("AutoTypeEntryURLMatch").toBool();
+
     for (Database* db : dbList) {
-        const QList<Entry*> dbEntries = db->rootGroup()->entriesRecursive();
-        for (Entry* entry : dbEntries) {
+        // only the candidates of the index are resolved and matched in full
+        const QSet<Entry*> candidates = db->autoTypeCandidates(windowTitle, matchTitle, matchUrl);
+        if (candidates.isEmpty()) {
+            continue;
+        }
+
+        // keep the candidates in tree order
+        QList<Entry*> dbEntries;
+        if (candidates.size() == 1) {
+            dbEntries = candidates.toList();
+        } else {
+            const QList<Entry*> allEntries = db->rootGroup()->entriesRecursive();
+            for (Entry* entry : allEntries) {
+                if (candidates.contains(entry)) {
+                    dbEntries << entry;
+                }
+            }
+        }
+
+        for (Entry* entry : asConst(dbEntries)) {
             QString sequence = autoTypeSequence(entry, windowTitle);
             if (!sequence.isEmpty()) {
                 entryList << entry;
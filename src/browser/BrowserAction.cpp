@@ -44,9 +44,8 @@ QJsonObject BrowserAction::readResponse(const QJsonObject& json)
         return QJsonObject();
     }
 
-    QMutexLocker locker(&m_mutex);
     if (action.compare("change-public-keys", Qt::CaseSensitive) != 0 && !m_browserService.isDatabaseOpened()) {
-        if (m_clientPublicKey.isEmpty()) {
+        if (clientPublicKey().isEmpty()) {
             return getErrorReply(action, ERROR_KEEPASS_CLIENT_PUBLIC_KEY_NOT_RECEIVED);
         } else if (!m_browserService.openDatabase()) {
             return getErrorReply(action, ERROR_KEEPASS_DATABASE_NOT_OPENED);
@@ -77,6 +76,8 @@ QJsonObject BrowserAction::handleAction(const QJsonObject& json)
         return  handleTestAssociate(json, action);
     } else if (action.compare("get-logins", Qt::CaseSensitive) == 0) {
         return handleGetLogins(json, action);
+    } else if (action.compare("get-logins-batch", Qt::CaseSensitive) == 0) {
+        return handleGetLoginsBatch(json, action);
     } else if (action.compare("generate-password", Qt::CaseSensitive) == 0) {
         return handleGeneratePassword(json, action);
     } else if (action.compare("set-login", Qt::CaseSensitive) == 0) {
@@ -159,14 +160,13 @@ QJsonObject BrowserAction::handleAssociate(const QJsonObject& json, const QStrin
         return getErrorReply(action, ERROR_KEEPASS_ASSOCIATION_FAILED);
     }
 
-    QMutexLocker locker(&m_mutex);
-    if (key.compare(m_clientPublicKey, Qt::CaseSensitive) == 0) {
+    if (key.compare(clientPublicKey(), Qt::CaseSensitive) == 0) {
         const QString id = m_browserService.storeKey(key);
         if (id.isEmpty()) {
             return getErrorReply(action, ERROR_KEEPASS_ACTION_CANCELLED_OR_DENIED);
         }
 
-        m_associated = true;
+        setAssociated();
         const QString newNonce = incrementNonce(nonce);
 
         QJsonObject message = buildMessage(newNonce);
@@ -195,13 +195,12 @@ QJsonObject BrowserAction::handleTestAssociate(const QJsonObject& json, const QS
         return getErrorReply(action, ERROR_KEEPASS_DATABASE_NOT_OPENED);
     }
 
-    QMutexLocker locker(&m_mutex);
     const QString key = m_browserService.getKey(id);
     if (key.isEmpty() || key.compare(responseKey, Qt::CaseSensitive) != 0) {
         return getErrorReply(action, ERROR_KEEPASS_ASSOCIATION_FAILED);
     }
 
-    m_associated = true;
+    setAssociated();
     const QString newNonce = incrementNonce(nonce);
 
     QJsonObject message = buildMessage(newNonce);
@@ -217,8 +216,7 @@ QJsonObject BrowserAction::handleGetLogins(const QJsonObject& json, const QStrin
     const QString nonce = json.value("nonce").toString();
     const QString encrypted = json.value("message").toString();
 
-    QMutexLocker locker(&m_mutex);
-    if (!m_associated) {
+    if (!isAssociated()) {
         return getErrorReply(action, ERROR_KEEPASS_ASSOCIATION_FAILED);
     }
 
@@ -251,6 +249,59 @@ QJsonObject BrowserAction::handleGetLogins(const QJsonObject& json, const QStrin
     return buildResponse(action, message, newNonce);
 }
 
+QJsonObject BrowserAction::handleGetLoginsBatch(const QJsonObject& json, const QString& action)
+{
+    const QString hash = getDatabaseHash();
+    const QString nonce = json.value("nonce").toString();
+    const QString encrypted = json.value("message").toString();
+
+    if (!isAssociated()) {
+        return getErrorReply(action, ERROR_KEEPASS_ASSOCIATION_FAILED);
+    }
+
+    const QJsonObject decrypted = decryptMessage(encrypted, nonce, action);
+    if (decrypted.isEmpty()) {
+        return getErrorReply(action, ERROR_KEEPASS_CANNOT_DECRYPT_MESSAGE);
+    }
+
+    // Each key is an object with the url and submitUrl of one login form
+    const QJsonArray keys = decrypted.value("keys").toArray();
+    QList<QPair<QString, QString>> urls;
+    for (const QJsonValue& key : keys) {
+        const QString url = key.toObject().value("url").toString();
+        if (url.isEmpty()) {
+            return getErrorReply(action, ERROR_KEEPASS_NO_URL_PROVIDED);
+        }
+        urls << qMakePair(url, key.toObject().value("submitUrl").toString());
+    }
+
+    if (urls.isEmpty()) {
+        return getErrorReply(action, ERROR_KEEPASS_NO_URL_PROVIDED);
+    }
+
+    const QString id = decrypted.value("id").toString();
+    const QList<QJsonArray> users = m_browserService.findMatchingEntries(id, urls, "");
+
+    QJsonArray results;
+    for (int i = 0; i < urls.size(); ++i) {
+        QJsonObject result;
+        result["url"] = urls[i].first;
+        result["submitUrl"] = urls[i].second;
+        result["count"] = users[i].count();
+        result["entries"] = users[i];
+        results << result;
+    }
+
+    const QString newNonce = incrementNonce(nonce);
+
+    QJsonObject message = buildMessage(newNonce);
+    message["results"] = results;
+    message["hash"] = hash;
+    message["id"] = id;
+
+    return buildResponse(action, message, newNonce);
+}
+
 QJsonObject BrowserAction::handleGeneratePassword(const QJsonObject& json, const QString& action)
 {
     const QString nonce = json.value("nonce").toString();
@@ -281,8 +332,7 @@ QJsonObject BrowserAction::handleSetLogin(const QJsonObject& json, const QString
     const QString nonce = json.value("nonce").toString();
     const QString encrypted = json.value("message").toString();
 
-    QMutexLocker locker(&m_mutex);
-    if (!m_associated) {
+    if (!isAssociated()) {
         return getErrorReply(action, ERROR_KEEPASS_ASSOCIATION_FAILED);
     }
 
@@ -337,7 +387,6 @@ QJsonObject BrowserAction::handleLockDatabase(const QJsonObject& json, const QSt
 
     QString command = decrypted.value("action").toString();
     if (!command.isEmpty() && command.compare("lock-database", Qt::CaseSensitive) == 0) {
-        QMutexLocker locker(&m_mutex);
         m_browserService.lockDatabase();
 
         const QString newNonce = incrementNonce(nonce);
@@ -399,7 +448,6 @@ QString BrowserAction::getErrorMessage(const int errorCode) const
 
 QString BrowserAction::getDatabaseHash()
 {
-    QMutexLocker locker(&m_mutex);
     QByteArray hash = QCryptographicHash::hash(
         (m_browserService.getDatabaseRootUuid() + m_browserService.getDatabaseRecycleBinUuid()).toUtf8(),
          QCryptographicHash::Sha256).toHex();
@@ -437,10 +485,12 @@ QJsonObject BrowserAction::decryptMessage(const QString& message, const QString&
 QString BrowserAction::encrypt(const QString plaintext, const QString nonce)
 {
     QMutexLocker locker(&m_mutex);
-    const QByteArray ma = plaintext.toUtf8();
-    const QByteArray na = base64Decode(nonce);
     const QByteArray ca = base64Decode(m_clientPublicKey);
     const QByteArray sa = base64Decode(m_secretKey);
+    locker.unlock();
+
+    const QByteArray ma = plaintext.toUtf8();
+    const QByteArray na = base64Decode(nonce);
 
     std::vector<unsigned char> m(ma.cbegin(), ma.cend());
     std::vector<unsigned char> n(na.cbegin(), na.cend());
@@ -465,10 +515,12 @@ QString BrowserAction::encrypt(const QString plaintext, const QString nonce)
 QByteArray BrowserAction::decrypt(const QString encrypted, const QString nonce)
 {
     QMutexLocker locker(&m_mutex);
-    const QByteArray ma = base64Decode(encrypted);
-    const QByteArray na = base64Decode(nonce);
     const QByteArray ca = base64Decode(m_clientPublicKey);
     const QByteArray sa = base64Decode(m_secretKey);
+    locker.unlock();
+
+    const QByteArray ma = base64Decode(encrypted);
+    const QByteArray na = base64Decode(nonce);
 
     std::vector<unsigned char> m(ma.cbegin(), ma.cend());
     std::vector<unsigned char> n(na.cbegin(), na.cend());
@@ -489,6 +541,24 @@ QByteArray BrowserAction::decrypt(const QString encrypted, const QString nonce)
     return QByteArray();
 }
 
+QString BrowserAction::clientPublicKey()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_clientPublicKey;
+}
+
+bool BrowserAction::isAssociated()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_associated;
+}
+
+void BrowserAction::setAssociated()
+{
+    QMutexLocker locker(&m_mutex);
+    m_associated = true;
+}
+
 QString BrowserAction::getBase64FromKey(const uchar* array, const uint len)
 {
     return getQByteArray(array, len).toBase64();
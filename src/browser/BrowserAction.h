@@ -63,6 +63,7 @@ private:
     QJsonObject handleAssociate(const QJsonObject& json, const QString& action);
     QJsonObject handleTestAssociate(const QJsonObject& json, const QString& action);
     QJsonObject handleGetLogins(const QJsonObject& json, const QString& action);
+    QJsonObject handleGetLoginsBatch(const QJsonObject& json, const QString& action);
     QJsonObject handleGeneratePassword(const QJsonObject& json, const QString& action);
     QJsonObject handleSetLogin(const QJsonObject& json, const QString& action);
     QJsonObject handleLockDatabase(const QJsonObject& json, const QString& action);
@@ -72,6 +73,9 @@ private:
     QJsonObject getErrorReply(const QString& action, const int errorCode) const;
     QString     getErrorMessage(const int errorCode) const;
     QString     getDatabaseHash();
+    QString     clientPublicKey();
+    bool        isAssociated();
+    void        setAssociated();
 
     QString     encryptMessage(const QJsonObject& message, const QString& nonce);
     QJsonObject decryptMessage(const QString& message, const QString& nonce, const QString& action = QString());
@@ -86,6 +90,7 @@ private:
     QString     incrementNonce(const QString& nonce);
 
 private:
+    // guards the keys and the association, the requests of several connections may run in parallel
     QMutex              m_mutex;
     BrowserService&     m_browserService;
     QString             m_clientPublicKey;
@@ -21,13 +21,13 @@
 #include <QInputDialog>
 #include <QProgressDialog>
 #include <QMessageBox>
+#include <QtConcurrent>
 #include "BrowserService.h"
 #include "BrowserSettings.h"
 #include "BrowserEntryConfig.h"
 #include "BrowserAccessControlDialog.h"
 #include "core/Database.h"
 #include "core/Group.h"
-#include "core/EntrySearcher.h"
 #include "core/Metadata.h"
 #include "core/Uuid.h"
 #include "core/PasswordGenerator.h"
@@ -53,8 +53,15 @@ BrowserService::BrowserService(DatabaseTabWidget* parent) :
     connect(m_dbTabWidget, SIGNAL(activateDatabaseChanged(DatabaseWidget*)), this, SLOT(activateDatabaseChanged(DatabaseWidget*)));
 }
 
-bool BrowserService::isDatabaseOpened() const
+bool BrowserService::isDatabaseOpened()
 {
+    if (thread() != QThread::currentThread()) {
+        bool result = false;
+        QMetaObject::invokeMethod(this, "isDatabaseOpened", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, result));
+        return result;
+    }
+
     DatabaseWidget* dbWidget = m_dbTabWidget->currentDatabaseWidget();
     if (!dbWidget) {
         return false;
@@ -69,6 +76,13 @@ bool BrowserService::isDatabaseOpened() const
 
 bool BrowserService::openDatabase()
 {
+    if (thread() != QThread::currentThread()) {
+        bool result = false;
+        QMetaObject::invokeMethod(this, "openDatabase", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, result));
+        return result;
+    }
+
     if (!BrowserSettings::unlockDatabase()) {
         return false;
     }
@@ -90,6 +104,7 @@ void BrowserService::lockDatabase()
 {
     if (thread() != QThread::currentThread()) {
         QMetaObject::invokeMethod(this, "lockDatabase", Qt::BlockingQueuedConnection);
+        return;
     }
 
     DatabaseWidget* dbWidget = m_dbTabWidget->currentDatabaseWidget();
@@ -104,7 +119,7 @@ void BrowserService::lockDatabase()
 
 QString BrowserService::getDatabaseRootUuid()
 {
-    Database* db = getDatabase();
+    QSharedPointer<Database> db = getDatabaseSnapshots(false).value(0);
     if (!db) {
         return QString();
     }
@@ -119,7 +134,7 @@ QString BrowserService::getDatabaseRootUuid()
 
 QString BrowserService::getDatabaseRecycleBinUuid()
 {
-    Database* db = getDatabase();
+    QSharedPointer<Database> db = getDatabaseSnapshots(false).value(0);
     if (!db) {
         return QString();
     }
@@ -132,9 +147,13 @@ QString BrowserService::getDatabaseRecycleBinUuid()
 }
 
 Entry* BrowserService::getConfigEntry(bool create)
+{
+    return getConfigEntry(getDatabase(), create);
+}
+
+Entry* BrowserService::getConfigEntry(Database* db, bool create)
 {
     Entry* entry = nullptr;
-    Database* db = getDatabase();
     if (!db) {
         return nullptr;
     }
@@ -205,7 +224,8 @@ QString BrowserService::storeKey(const QString& key)
 
 QString BrowserService::getKey(const QString& id)
 {
-    Entry* config = getConfigEntry();
+    QSharedPointer<Database> db = getDatabaseSnapshots(false).value(0);
+    Entry* config = getConfigEntry(db.data(), false);
     if (!config) {
         return QString();
     }
@@ -216,48 +236,103 @@ QString BrowserService::getKey(const QString& id)
 // No need to use KeepassHttpProtocol. Just return a JSON array.
 QJsonArray BrowserService::findMatchingEntries(const QString& id, const QString& url, const QString& submitUrl, const QString& realm)
 {
-    QJsonArray result;
-    if (thread() != QThread::currentThread()) {
-        QMetaObject::invokeMethod(this, "findMatchingEntries", Qt::BlockingQueuedConnection,
-                                  Q_RETURN_ARG(QJsonArray, result),
-                                  Q_ARG(const QString&, id),
-                                  Q_ARG(const QString&, url),
-                                  Q_ARG(const QString&, submitUrl),
-                                  Q_ARG(const QString&, realm));
-        return result;
-    }
+    QList<QPair<QString, QString>> urls;
+    urls << qMakePair(url, submitUrl);
+    return findMatchingEntries(id, urls, realm).first();
+}
 
+QList<QJsonArray> BrowserService::findMatchingEntries(const QString&, const QList<QPair<QString, QString>>& urls, const QString& realm)
+{
+    // Search snapshots of the databases, the GUI thread is only needed to confirm access
+    const QList<QSharedPointer<Database>> databases = getDatabaseSnapshots(BrowserSettings::searchInAllDatabases());
     const bool alwaysAllowAccess = BrowserSettings::alwaysAllowAccess();
-    const QString host = QUrl(url).host();
-    const QString submitHost = QUrl(submitUrl).host();
 
-    // Check entries for authorization
+    // Urls of the same host share the search, repeated urls the whole result
+    QHash<QString, QList<Entry*>> hostEntries;
+    QHash<QPair<QString, QString>, QList<Entry*>> allowedEntries;
+    QHash<QPair<QString, QString>, QList<Entry*>> unknownEntries;
+
+    // Entries of all urls are confirmed at once, each with the hosts it was asked for
+    QString confirmUrl;
     QList<Entry*> pwEntriesToConfirm;
-    QList<Entry*> pwEntries;
-    for (Entry* entry : searchEntries(url)) {
-        switch (checkAccess(entry, host, submitHost, realm)) {
-        case Denied:
+    QHash<Entry*, QStringList> confirmHosts;
+
+    for (const QPair<QString, QString>& url : urls) {
+        if (allowedEntries.contains(url)) {
             continue;
+        }
 
-        case Unknown:
-            if (alwaysAllowAccess) {
-                pwEntries.append(entry);
-            } else {
-                pwEntriesToConfirm.append(entry);
-            }
-            break;
+        const QString host = QUrl(url.first).host();
+        const QString submitHost = QUrl(url.second).host();
+        if (!hostEntries.contains(host)) {
+            hostEntries.insert(host, searchEntries(databases, url.first));
+        }
 
-        case Allowed:
-            pwEntries.append(entry);
-            break;
+        // Check entries for authorization
+        QList<Entry*>& allowed = allowedEntries[url];
+        QList<Entry*>& unknown = unknownEntries[url];
+        for (Entry* entry : hostEntries.value(host)) {
+            switch (checkAccess(entry, host, submitHost, realm)) {
+            case Denied:
+                continue;
+
+            case Unknown:
+                if (alwaysAllowAccess) {
+                    allowed.append(entry);
+                } else {
+                    unknown.append(entry);
+                    if (confirmUrl.isEmpty()) {
+                        confirmUrl = url.first;
+                    }
+                    if (!confirmHosts.contains(entry)) {
+                        pwEntriesToConfirm.append(entry);
+                    }
+                    QStringList& hosts = confirmHosts[entry];
+                    if (!hosts.contains(host)) {
+                        hosts.append(host);
+                    }
+                    if (!submitHost.isEmpty() && !hosts.contains(submitHost)) {
+                        hosts.append(submitHost);
+                    }
+                }
+                break;
+
+            case Allowed:
+                allowed.append(entry);
+                break;
+            }
         }
     }
 
     // Confirm entries
-    if (confirmEntries(pwEntriesToConfirm, url, host, submitHost, realm)) {
-        pwEntries.append(pwEntriesToConfirm);
+    bool confirmed = false;
+    if (!pwEntriesToConfirm.isEmpty()) {
+        QList<QStringList> hostsToConfirm;
+        for (Entry* entry : pwEntriesToConfirm) {
+            hostsToConfirm << confirmHosts.value(entry);
+        }
+        confirmed = confirmEntries(pwEntriesToConfirm, confirmUrl, hostsToConfirm, realm);
     }
 
+    QHash<QPair<QString, QString>, QJsonArray> urlEntries;
+    QList<QJsonArray> results;
+    results.reserve(urls.size());
+    for (const QPair<QString, QString>& url : urls) {
+        if (!urlEntries.contains(url)) {
+            QList<Entry*> pwEntries = allowedEntries.value(url);
+            if (confirmed) {
+                pwEntries.append(unknownEntries.value(url));
+            }
+            urlEntries.insert(url, prepareEntries(pwEntries, QUrl(url.first).host(), url.second));
+        }
+        results << urlEntries.value(url);
+    }
+
+    return results;
+}
+
+QJsonArray BrowserService::prepareEntries(QList<Entry*> pwEntries, const QString& host, const QString& submitUrl)
+{
     if (pwEntries.isEmpty()) {
         return QJsonArray();
     }
@@ -266,6 +341,7 @@ QJsonArray BrowserService::findMatchingEntries(const QString& id, const QString&
     pwEntries = sortEntries(pwEntries, host, submitUrl);
 
     // Fill the list
+    QJsonArray result;
     for (Entry* entry : pwEntries) {
         result << prepareEntry(entry);
     }
@@ -273,8 +349,19 @@ QJsonArray BrowserService::findMatchingEntries(const QString& id, const QString&
     return result;
 }
 
-void BrowserService::addEntry(const QString&, const QString& login, const QString& password, const QString& url, const QString& submitUrl, const QString& realm)
+void BrowserService::addEntry(const QString& id, const QString& login, const QString& password, const QString& url, const QString& submitUrl, const QString& realm)
 {
+    if (thread() != QThread::currentThread()) {
+        QMetaObject::invokeMethod(this, "addEntry", Qt::BlockingQueuedConnection,
+                                  Q_ARG(const QString&, id),
+                                  Q_ARG(const QString&, login),
+                                  Q_ARG(const QString&, password),
+                                  Q_ARG(const QString&, url),
+                                  Q_ARG(const QString&, submitUrl),
+                                  Q_ARG(const QString&, realm));
+        return;
+    }
+
     Group* group = findCreateAddEntryGroup();
     if (!group) {
         return;
@@ -312,6 +399,7 @@ void BrowserService::updateEntry(const QString& id, const QString& uuid, const Q
                                   Q_ARG(const QString&, login),
                                   Q_ARG(const QString&, password),
                                   Q_ARG(const QString&, url));
+        return;
     }
 
     Database* db = getDatabase();
@@ -349,53 +437,31 @@ void BrowserService::updateEntry(const QString& id, const QString& uuid, const Q
 
 QList<Entry*> BrowserService::searchEntries(Database* db, const QString& hostname)
 {
-    QList<Entry*> entries;
-    Group* rootGroup = db->rootGroup();
-    if (!rootGroup) {
-        return entries;
-    }
-
-    for (Entry* entry : EntrySearcher().search(hostname, rootGroup, Qt::CaseInsensitive)) {
-        QString title = entry->title();
-        QString url = entry->url();
-
-        // Filter to match hostname in Title and Url fields
-        if ((!title.isEmpty() && hostname.contains(title))
-            || (!url.isEmpty() && hostname.contains(url))
-            || (matchUrlScheme(title) && hostname.endsWith(QUrl(title).host()))
-            || (matchUrlScheme(url) && hostname.endsWith(QUrl(url).host())) ) {
-                entries.append(entry);
-        }
-    }
-
-    return entries;
+    return db->entriesForHost(hostname);
 }
 
-QList<Entry*> BrowserService::searchEntries(const QString& text)
+QList<Entry*> BrowserService::searchEntries(const QList<QSharedPointer<Database>>& databases, const QString& text)
 {
-    // Get the list of databases to search
-    QList<Database*> databases;
-    if (BrowserSettings::searchInAllDatabases()) {
-        const int count = m_dbTabWidget->count();
-        for (int i = 0; i < count; ++i) {
-            if (DatabaseWidget* dbWidget = qobject_cast<DatabaseWidget*>(m_dbTabWidget->widget(i))) {
-                if (Database* db = dbWidget->database()) {
-                    databases << db;
-                }
-            }
-        }
-    } else if (Database* db = getDatabase()) {
-        databases << db;
-    }
-
-    // Search entries matching the hostname
-    QString hostname = QUrl(text).host();
+    // Search entries matching the hostname, or the most specific parent domain with matches
+    const QStringList hostnames = UrlIndex::hostKeys(QUrl(text).host());
     QList<Entry*> entries;
-    do {
-        for (Database* db : databases) {
-            entries << searchEntries(db, hostname);
+    for (const QString& hostname : hostnames) {
+        // one task per database, the first lookup of each also builds its URL index.
+        // The results are collected in tab order
+        QList<QFuture<QList<Entry*>>> futures;
+        for (const QSharedPointer<Database>& db : databases) {
+            Database* database = db.data();
+            futures << QtConcurrent::run([this, database, hostname]() {
+                return searchEntries(database, hostname);
+            });
         }
-    } while (entries.isEmpty() && removeFirstDomain(hostname));
+        for (QFuture<QList<Entry*>>& future : futures) {
+            entries << future.result();
+        }
+        if (!entries.isEmpty()) {
+            break;
+        }
+    }
 
     return entries;
 }
@@ -519,8 +585,19 @@ QList<Entry*> BrowserService::sortEntries(QList<Entry*>& pwEntries, const QStrin
     return pwEntries;
 }
 
-bool BrowserService::confirmEntries(QList<Entry*>& pwEntriesToConfirm, const QString& url, const QString& host, const QString& submitHost, const QString& realm)
+bool BrowserService::confirmEntries(const QList<Entry*>& pwEntriesToConfirm, const QString& url, const QList<QStringList>& hosts, const QString& realm)
 {
+    if (thread() != QThread::currentThread()) {
+        bool result = false;
+        QMetaObject::invokeMethod(this, "confirmEntries", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, result),
+                                  Q_ARG(const QList<Entry*>&, pwEntriesToConfirm),
+                                  Q_ARG(const QString&, url),
+                                  Q_ARG(const QList<QStringList>&, hosts),
+                                  Q_ARG(const QString&, realm));
+        return result;
+    }
+
     if (pwEntriesToConfirm.isEmpty() || m_dialogActive) {
         return false;
     }
@@ -532,17 +609,20 @@ bool BrowserService::confirmEntries(QList<Entry*>& pwEntriesToConfirm, const QSt
 
     int res = accessControlDialog.exec();
     if (accessControlDialog.remember()) {
-        for (Entry* entry : pwEntriesToConfirm) {
+        for (int i = 0; i < pwEntriesToConfirm.size(); ++i) {
+            // the permissions are stored in the database the entry was found in a snapshot of
+            Entry* entry = getSourceEntry(pwEntriesToConfirm[i]);
+            if (!entry) {
+                continue;
+            }
+
             BrowserEntryConfig config;
             config.load(entry);
-            if (res == QDialog::Accepted) {
-                config.allow(host);
-                if (!submitHost.isEmpty() && host != submitHost)
-                    config.allow(submitHost);
-            } else if (res == QDialog::Rejected) {
-                config.deny(host);
-                if (!submitHost.isEmpty() && host != submitHost) {
-                    config.deny(submitHost);
+            for (const QString& host : hosts.value(i)) {
+                if (res == QDialog::Accepted) {
+                    config.allow(host);
+                } else if (res == QDialog::Rejected) {
+                    config.deny(host);
                 }
             }
             if (!realm.isEmpty()) {
@@ -631,12 +711,10 @@ Group* BrowserService::findCreateAddEntryGroup()
 
 int BrowserService::sortPriority(const Entry* entry, const QString& host, const QString& submitUrl, const QString& baseSubmitUrl) const
 {
-    QUrl url(entry->url());
-    if (url.scheme().isEmpty()) {
-        url.setScheme("http");
-    }
-    const QString entryURL = url.toString(QUrl::StripTrailingSlash);
-    const QString baseEntryURL = url.toString(QUrl::StripTrailingSlash | QUrl::RemovePath | QUrl::RemoveQuery | QUrl::RemoveFragment);
+    const Database* db = entry->group() ? entry->group()->database() : nullptr;
+    const UrlIndex::EntryUrl url = db ? db->indexedUrl(entry) : UrlIndex::parseUrl(entry->url());
+    const QString& entryURL = url.url;
+    const QString& baseEntryURL = url.baseUrl;
 
     if (submitUrl == entryURL) {
         return 100;
@@ -674,37 +752,47 @@ int BrowserService::sortPriority(const Entry* entry, const QString& host, const
     return 0;
 }
 
-bool BrowserService::matchUrlScheme(const QString& url)
+Database* BrowserService::getDatabase()
 {
-    QUrl address(url);
-    return !address.scheme().isEmpty();
+    if (DatabaseWidget* dbWidget = m_dbTabWidget->currentDatabaseWidget()) {
+        if (Database* db = dbWidget->database()) {
+            return db;
+        }
+    }
+    return nullptr;
 }
 
-bool BrowserService::removeFirstDomain(QString& hostname)
+QList<QSharedPointer<Database>> BrowserService::getDatabaseSnapshots(bool allDatabases)
 {
-    int pos = hostname.indexOf(".");
-    if (pos < 0) {
-        return false;
+    QList<QSharedPointer<Database>> snapshots;
+    if (thread() != QThread::currentThread()) {
+        QMetaObject::invokeMethod(this, "getDatabaseSnapshots", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(QList<QSharedPointer<Database>>, snapshots),
+                                  Q_ARG(bool, allDatabases));
+        return snapshots;
     }
 
-    // Don't remove the second-level domain if it's the only one
-    if (hostname.count(".") > 1) {
-        hostname = hostname.mid(pos + 1);
-        return !hostname.isEmpty();
+    if (allDatabases) {
+        const int count = m_dbTabWidget->count();
+        for (int i = 0; i < count; ++i) {
+            if (DatabaseWidget* dbWidget = qobject_cast<DatabaseWidget*>(m_dbTabWidget->widget(i))) {
+                if (Database* db = dbWidget->database()) {
+                    snapshots << db->readSnapshot();
+                }
+            }
+        }
+    } else if (Database* db = getDatabase()) {
+        snapshots << db->readSnapshot();
     }
 
-    // Nothing removed
-    return false;
+    return snapshots;
 }
 
-Database* BrowserService::getDatabase()
+Entry* BrowserService::getSourceEntry(Entry* entry)
 {
-    if (DatabaseWidget* dbWidget = m_dbTabWidget->currentDatabaseWidget()) {
-        if (Database* db = dbWidget->database()) {
-            return db;
-        }
-    }
-    return nullptr;
+    Database* snapshot = entry->group() ? entry->group()->database() : nullptr;
+    Database* db = snapshot ? snapshot->snapshotSource() : nullptr;
+    return db ? db->resolveEntry(entry->uuid()) : nullptr;
 }
 
 void BrowserService::databaseLocked(DatabaseWidget* dbWidget)
@@ -23,6 +23,7 @@
 #include <QtCore>
 #include <QObject>
 #include "gui/DatabaseTabWidget.h"
+#include "core/Database.h"
 #include "core/Entry.h"
 
 enum { max_length = 16*1024 };
@@ -34,21 +35,23 @@ class BrowserService : public QObject
 public:
     explicit        BrowserService(DatabaseTabWidget* parent);
 
-    bool            isDatabaseOpened() const;
-    bool            openDatabase();
     QString         getDatabaseRootUuid();
     QString         getDatabaseRecycleBinUuid();
     Entry*          getConfigEntry(bool create = false);
     QString         getKey(const QString& id);
-    void            addEntry(const QString& id, const QString& login, const QString& password, const QString& url, const QString& submitUrl, const QString& realm);
     QList<Entry*>   searchEntries(Database* db, const QString& hostname);
-    QList<Entry*>   searchEntries(const QString& text);
+    QList<Entry*>   searchEntries(const QList<QSharedPointer<Database>>& databases, const QString& text);
     void            removeSharedEncryptionKeys();
     void            removeStoredPermissions();
 
 public slots:
+    bool            isDatabaseOpened();
+    bool            openDatabase();
     QJsonArray      findMatchingEntries(const QString& id, const QString& url, const QString& submitUrl, const QString& realm);
+    // Takes pairs of url and submitUrl, returns the matches of each pair in the same order
+    QList<QJsonArray> findMatchingEntries(const QString& id, const QList<QPair<QString, QString>>& urls, const QString& realm);
     QString         storeKey(const QString& key);
+    void            addEntry(const QString& id, const QString& login, const QString& password, const QString& url, const QString& submitUrl, const QString& realm);
     void            updateEntry(const QString& id, const QString& uuid, const QString& login, const QString& password, const QString& url);
     void            databaseLocked(DatabaseWidget* dbWidget);
     void            databaseUnlocked(DatabaseWidget* dbWidget);
@@ -63,16 +66,21 @@ signals:
 private:
     enum Access     { Denied, Unknown, Allowed};
 
+private slots:
+    QList<QSharedPointer<Database>> getDatabaseSnapshots(bool allDatabases);
+    // hosts holds the hosts each of the entries is confirmed for
+    bool            confirmEntries(const QList<Entry*>& pwEntriesToConfirm, const QString& url, const QList<QStringList>& hosts, const QString& realm);
+
 private:
+    QJsonArray      prepareEntries(QList<Entry*> pwEntries, const QString& host, const QString& submitUrl);
     QList<Entry*>   sortEntries(QList<Entry*>& pwEntries, const QString& host, const QString& submitUrl);
-    bool            confirmEntries(QList<Entry*>& pwEntriesToConfirm, const QString& url, const QString& host, const QString& submitHost, const QString& realm);
     QJsonObject     prepareEntry(const Entry* entry);
     Access          checkAccess(const Entry* entry, const QString& host, const QString& submitHost, const QString& realm);
     Group*          findCreateAddEntryGroup();
     int             sortPriority(const Entry* entry, const QString &host, const QString& submitUrl, const QString& baseSubmitUrl) const;
-    bool            matchUrlScheme(const QString& url);
-    bool            removeFirstDomain(QString& hostname);
     Database*       getDatabase();
+    Entry*          getConfigEntry(Database* db, bool create);
+    Entry*          getSourceEntry(Entry* entry);
 
 private:
     DatabaseTabWidget* const    m_dbTabWidget;
@@ -18,18 +18,8 @@
 
 #include "NativeMessagingBase.h"
 #include <QStandardPaths>
-
-#if defined(Q_OS_UNIX) && !defined(Q_OS_LINUX)
-#include <sys/types.h>
-#include <sys/event.h>
-#include <sys/time.h>
-#include <unistd.h>
-#endif
-
-#ifdef Q_OS_LINUX
-#include <sys/epoll.h>
-#include <unistd.h>
-#endif
+#include <cerrno>
+#include <cstring>
 
 #ifdef Q_OS_WIN
 #include <fcntl.h>
@@ -49,63 +39,95 @@ NativeMessagingBase::NativeMessagingBase()
 
 void NativeMessagingBase::newNativeMessage()
 {
-#if defined(Q_OS_UNIX) && !defined(Q_OS_LINUX)
-    struct kevent ev[1];
-    struct timespec ts = { 5, 0 };
-
-    int fd = kqueue();
-    if (fd == -1) {
-        m_notifier->setEnabled(false);
+#ifndef Q_OS_WIN
+    // the notifier only fires when data is available, so this doesn't block
+    char buffer[16 * 1024];
+    ssize_t bytesRead = ::read(fileno(stdin), buffer, sizeof(buffer));
+    if (bytesRead < 0 && errno == EINTR) {
         return;
     }
-
-    EV_SET(ev, fileno(stdin), EVFILT_READ, EV_ADD, 0, 0, nullptr);
-    if (kevent(fd, ev, 1, nullptr, 0, &ts) == -1) {
+    if (bytesRead <= 0) {
         m_notifier->setEnabled(false);
+        nativeInputClosed();
         return;
     }
+    m_stdinBuffer.append(buffer, static_cast<int>(bytesRead));
 
-    int ret = kevent(fd, NULL, 0, ev, 1, &ts);
-    if (ret < 1) {
+    QList<QByteArray> messages;
+    if (!takeFramedMessages(m_stdinBuffer, &messages)) {
         m_notifier->setEnabled(false);
-        ::close(fd);
-        return;
-    }
-#elif defined(Q_OS_LINUX)
-    int fd = epoll_create(5);
-    struct epoll_event event;
-    event.events = EPOLLIN;
-    event.data.fd = 0;
-    if (epoll_ctl(fd, EPOLL_CTL_ADD, 0, &event) != 0) {
-        m_notifier->setEnabled(false);
-        return;
+        nativeInputClosed();
     }
 
-    if (epoll_wait(fd, &event, 1, 5000) < 1) {
-        m_notifier->setEnabled(false);
-        ::close(fd);
-        return;
+    for (const QByteArray& message : messages) {
+        handleNativeMessage(message);
     }
-#endif
-    readLength();
-#ifndef Q_OS_WIN
-    ::close(fd);
 #endif
 }
 
+void NativeMessagingBase::nativeInputClosed()
+{
+}
+
 void NativeMessagingBase::readNativeMessages()
 {
 #ifdef Q_OS_WIN
-    quint32 length = 0;
-    while (m_running.load() && !std::cin.eof()) {
-        length = 0;
-        std::cin.read(reinterpret_cast<char*>(&length), 4);
-        readStdIn(length);
-        QThread::msleep(1);
+    while (m_running.load()) {
+        quint32 length = 0;
+        std::cin.read(reinterpret_cast<char*>(&length), sizeof(length));
+        if (std::cin.eof() || length > MaxMessageLength) {
+            break;
+        }
+
+        if (length > 0) {
+            QByteArray message(static_cast<int>(length), '\0');
+            std::cin.read(message.data(), length);
+            if (std::cin.gcount() != static_cast<std::streamsize>(length)) {
+                break;
+            }
+            handleNativeMessage(message);
+        }
     }
+    nativeInputClosed();
 #endif
 }
 
+QByteArray NativeMessagingBase::frameMessage(const QByteArray& message)
+{
+    quint32 length = static_cast<quint32>(message.size());
+    QByteArray frame;
+    frame.reserve(sizeof(length) + message.size());
+    frame.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    frame.append(message);
+    return frame;
+}
+
+bool NativeMessagingBase::takeFramedMessages(QByteArray& buffer, QList<QByteArray>* messages)
+{
+    int pos = 0;
+    while (buffer.size() - pos >= static_cast<int>(sizeof(quint32))) {
+        quint32 length;
+        memcpy(&length, buffer.constData() + pos, sizeof(length));
+        if (length > MaxMessageLength) {
+            buffer.clear();
+            return false;
+        }
+
+        if (static_cast<quint32>(buffer.size() - pos) - sizeof(length) < length) {
+            break;
+        }
+
+        pos += sizeof(length);
+        if (length > 0) {
+            messages->append(buffer.mid(pos, static_cast<int>(length)));
+        }
+        pos += static_cast<int>(length);
+    }
+
+    buffer.remove(0, pos);
+    return true;
+}
+
 QString NativeMessagingBase::jsonToString(const QJsonObject& json) const
 {
     return QString(QJsonDocument(json).toJson(QJsonDocument::Compact));
@@ -119,11 +141,18 @@ void NativeMessagingBase::sendReply(const QJsonObject& json)
 }
 
 void NativeMessagingBase::sendReply(const QString& reply)
+{
+    // the length counts the bytes sent, not the characters
+    sendReply(reply.toUtf8());
+}
+
+void NativeMessagingBase::sendReply(const QByteArray& reply)
 {
     if (!reply.isEmpty()) {
-    uint len = reply.length();
-        std::cout << char(((len>>0) & 0xFF)) << char(((len>>8) & 0xFF)) << char(((len>>16) & 0xFF)) << char(((len>>24) & 0xFF));
-        std::cout << reply.toStdString() << std::flush;
+        QByteArray frame = frameMessage(reply);
+        QMutexLocker locker(&m_stdoutMutex);
+        std::cout.write(frame.constData(), frame.size());
+        std::cout.flush();
     }
 }
 
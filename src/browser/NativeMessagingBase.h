@@ -40,22 +40,42 @@ public:
     explicit NativeMessagingBase();
     ~NativeMessagingBase() = default;
 
+    /**
+     * Prepends the length in native byte order, the framing used by the browser
+     * on stdin/stdout and by keepassxc-proxy on the local socket.
+     */
+    static QByteArray frameMessage(const QByteArray& message);
+    /**
+     * Moves all complete messages from the front of buffer to messages. A
+     * partial message stays in buffer until the rest of it arrives. Returns
+     * false if the buffer doesn't hold a valid frame.
+     */
+    static bool takeFramedMessages(QByteArray& buffer, QList<QByteArray>* messages);
+
+    static const quint32 MaxMessageLength = 64 * 1024 * 1024;
+
 protected slots:
     void            newNativeMessage();
 
 protected:
-    virtual void    readLength() = 0;
-    virtual void    readStdIn(const quint32 length) = 0;
+    virtual void    handleNativeMessage(const QByteArray& message) = 0;
+    virtual void    nativeInputClosed();
     void            readNativeMessages();
     QString         jsonToString(const QJsonObject& json) const;
     void            sendReply(const QJsonObject& json);
     void            sendReply(const QString& reply);
+    void            sendReply(const QByteArray& reply);
     QString         getLocalServerPath() const;
 
 protected:
     QAtomicInteger<quint8>          m_running;
     QSharedPointer<QSocketNotifier> m_notifier;
     QFuture<void>                   m_future;
+
+private:
+    QByteArray                      m_stdinBuffer;
+    // replies may be sent from several threads
+    QMutex                          m_stdoutMutex;
 };
 
 #endif  // NATIVEMESSAGINGBASE_H
@@ -17,6 +17,7 @@
 */
 
 #include <QMutexLocker>
+#include <QPointer>
 #include <QtNetwork>
 #include <iostream>
 #include "sodium.h"
@@ -44,6 +45,7 @@ NativeMessagingHost::NativeMessagingHost(DatabaseTabWidget* parent) :
 NativeMessagingHost::~NativeMessagingHost()
 {
     stop();
+    m_executor.waitForDone();
 }
 
 int NativeMessagingHost::init()
@@ -84,36 +86,20 @@ void NativeMessagingHost::stop()
     databaseLocked();
     QMutexLocker locker(&m_mutex);
     m_socketList.clear();
+    m_socketBuffers.clear();
     m_running.testAndSetOrdered(true, false);
     m_future.waitForFinished();
     m_localServer->close();
 }
 
-void NativeMessagingHost::readLength()
+void NativeMessagingHost::handleNativeMessage(const QByteArray& message)
 {
-    quint32 length = 0;
-    std::cin.read(reinterpret_cast<char*>(&length), 4);
-    if (!std::cin.eof() && length > 0)
-    {
-        readStdIn(length);
-    }
-}
-
-void NativeMessagingHost::readStdIn(const quint32 length)
-{
-    if (length > 0) {
-        QByteArray arr;
-        arr.reserve(length);
-
-        for (quint32 i = 0; i < length; ++i) {
-            arr.append(getchar());
-        }
-
-        if (arr.length() > 0) {
-            QMutexLocker locker(&m_mutex);
-            sendReply(m_browserClients.readResponse(arr));
-        }
-    }
+    m_executor.submit(this, [this, message]() {
+        const QJsonObject json = m_browserClients.readResponse(message);
+        return json.isEmpty() ? QByteArray() : jsonToString(json).toUtf8();
+    }, [this](const QByteArray& reply) {
+        sendReply(reply);
+    });
 }
 
 void NativeMessagingHost::newLocalConnection()
@@ -131,32 +117,44 @@ void NativeMessagingHost::newLocalMessage()
         return;
     }
 
-    QByteArray arr = socket->readAll();
-    if (arr.isEmpty()) {
-        return;
-    }
-
     QMutexLocker locker(&m_mutex);
     if (!m_socketList.contains(socket)) {
         m_socketList.push_back(socket);
     }
 
-    QString reply = jsonToString(m_browserClients.readResponse(arr));
-    if (socket && socket->isValid() && socket->state() == QLocalSocket::ConnectedState) {
-        QByteArray arr = reply.toUtf8();
-        socket->write(arr.constData(), arr.length());
-        socket->flush();
+    // a read may contain several requests or only part of one, clients
+    // don't have to wait for a reply before sending the next request
+    QByteArray buffer = m_socketBuffers.take(socket);
+    buffer.append(socket->readAll());
+
+    QList<QByteArray> messages;
+    if (takeFramedMessages(buffer, &messages)) {
+        m_socketBuffers.insert(socket, buffer);
+    } else {
+        socket->disconnectFromServer();
+    }
+
+    // the replies are written in the order of the requests once they're ready
+    QPointer<QLocalSocket> target(socket);
+    for (const QByteArray& message : messages) {
+        m_executor.submit(socket, [this, message]() {
+            return jsonToString(m_browserClients.readResponse(message)).toUtf8();
+        }, [target](const QByteArray& reply) {
+            if (target && target->isValid() && target->state() == QLocalSocket::ConnectedState) {
+                target->write(frameMessage(reply));
+                target->flush();
+            }
+        });
     }
 }
 
 void NativeMessagingHost::sendReplyToAllClients(const QJsonObject& json)
 {
-    QString reply = jsonToString(json);
+    QByteArray frame = frameMessage(jsonToString(json).toUtf8());
     QMutexLocker locker(&m_mutex);
     for (const auto socket : m_socketList) {
         if (socket && socket->isValid() && socket->state() == QLocalSocket::ConnectedState) {
-            QByteArray arr = reply.toUtf8();
-            socket->write(arr.constData(), arr.length());
+            socket->write(frame);
             socket->flush();
         }
     }
@@ -166,11 +164,9 @@ void NativeMessagingHost::disconnectSocket()
 {
     QLocalSocket* socket(qobject_cast<QLocalSocket*>(QObject::sender()));
     QMutexLocker locker(&m_mutex);
-    for (auto s : m_socketList) {
-        if (s == socket) {
-            m_socketList.removeOne(s);
-        }
-    }
+    m_socketList.removeAll(socket);
+    m_socketBuffers.remove(socket);
+    m_executor.cancel(socket);
 }
 
 void NativeMessagingHost::removeSharedEncryptionKeys()
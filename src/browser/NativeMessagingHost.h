@@ -22,6 +22,7 @@
 #include "NativeMessagingBase.h"
 #include "BrowserClients.h"
 #include "BrowserService.h"
+#include "core/RequestExecutor.h"
 #include "gui/DatabaseTabWidget.h"
 
 class NativeMessagingHost : public NativeMessagingBase
@@ -45,8 +46,7 @@ signals:
     void        quit();
 
 private:
-    void        readLength();
-    void        readStdIn(const quint32 length);
+    void        handleNativeMessage(const QByteArray& message) override;
     void        sendReplyToAllClients(const QJsonObject& json);
 
 private slots:
@@ -62,6 +62,10 @@ private:
     BrowserService                  m_browserService;
     QSharedPointer<QLocalServer>    m_localServer;
     SocketList                      m_socketList;
+    // partial requests per client
+    QHash<QLocalSocket*, QByteArray> m_socketBuffers;
+    // runs the requests of stdin and of each socket off the GUI thread
+    RequestExecutor                 m_executor;
 };
 
 #endif // NATIVEMESSAGINGHOST_H
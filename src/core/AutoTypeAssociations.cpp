@@ -45,6 +45,13 @@ void AutoTypeAssociations::copyDataFrom(const AutoTypeAssociations* other)
     emit modified();
 }
 
+void AutoTypeAssociations::shareDataWith(const AutoTypeAssociations* other)
+{
+    if (m_associations == other->m_associations) {
+        m_associations = other->m_associations;
+    }
+}
+
 void AutoTypeAssociations::add(const AutoTypeAssociations::Association& association)
 {
     int index = m_associations.size();
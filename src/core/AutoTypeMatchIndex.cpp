@@ -0,0 +1,297 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AutoTypeMatchIndex.h"
+
+#include <QUrl>
+
+#include "core/AutoTypeAssociations.h"
+#include "core/Entry.h"
+#include "core/Global.h"
+
+namespace
+{
+    const QChar Wildcard = '*';
+
+    bool hasPlaceholders(const QString& text)
+    {
+        return text.contains('{');
+    }
+}
+
+AutoTypeMatchIndex::AutoTypeMatchIndex()
+    : m_built(false)
+{
+}
+
+bool AutoTypeMatchIndex::isBuilt() const
+{
+    return m_built;
+}
+
+void AutoTypeMatchIndex::build(const QList<Entry*>& entries)
+{
+    clear();
+
+    for (Entry* entry : entries) {
+        indexEntry(entry);
+    }
+
+    m_built = true;
+}
+
+void AutoTypeMatchIndex::clear()
+{
+    m_built = false;
+    m_entries.clear();
+    m_exact.clear();
+    m_prefixes.clear();
+    m_suffixes.clear();
+    m_floating.clear();
+    m_regExps.clear();
+    m_titles.clear();
+    m_urls.clear();
+    m_dynamicWindows.clear();
+    m_dynamicTitles.clear();
+    m_dynamicUrls.clear();
+    m_dirtyEntries.clear();
+}
+
+void AutoTypeMatchIndex::updateEntry(Entry* entry)
+{
+    if (m_built) {
+        m_dirtyEntries.insert(entry);
+    }
+}
+
+void AutoTypeMatchIndex::removeEntry(Entry* entry)
+{
+    if (m_built) {
+        m_dirtyEntries.remove(entry);
+        unindexEntry(entry);
+    }
+}
+
+QSet<Entry*> AutoTypeMatchIndex::candidates(const QString& windowTitle, bool matchTitle, bool matchUrl)
+{
+    Q_ASSERT(m_built);
+
+    indexDirtyEntries();
+
+    const QString text = windowTitle.toCaseFolded();
+    QSet<Entry*> result = m_dynamicWindows;
+    result.unite(m_exact.value(text));
+
+    // a pattern's literal prefix is one of the prefixes of the title, the same for suffixes
+    for (int length = 1; length <= text.size(); ++length) {
+        QHash<QString, QSet<Entry*>>::const_iterator i = m_prefixes.constFind(text.left(length));
+        if (i != m_prefixes.constEnd()) {
+            addWildcardCandidates(i.value(), text, result);
+        }
+        i = m_suffixes.constFind(text.right(length));
+        if (i != m_suffixes.constEnd()) {
+            addWildcardCandidates(i.value(), text, result);
+        }
+    }
+    addWildcardCandidates(m_floating, text, result);
+
+    for (Entry* entry : asConst(m_regExps)) {
+        if (result.contains(entry)) {
+            continue;
+        }
+        QList<QRegExp>& regExps = m_entries[entry].regExps;
+        for (QRegExp& regExp : regExps) {
+            if (regExp.indexIn(windowTitle) != -1) {
+                result.insert(entry);
+                break;
+            }
+        }
+    }
+
+    // titles and URLs match anywhere in the window title
+    if (matchTitle) {
+        result.unite(m_dynamicTitles);
+        for (QHash<QString, QSet<Entry*>>::const_iterator i = m_titles.constBegin(); i != m_titles.constEnd(); ++i) {
+            if (text.contains(i.key())) {
+                result.unite(i.value());
+            }
+        }
+    }
+
+    if (matchUrl) {
+        result.unite(m_dynamicUrls);
+        for (QHash<QString, QSet<Entry*>>::const_iterator i = m_urls.constBegin(); i != m_urls.constEnd(); ++i) {
+            if (text.contains(i.key())) {
+                result.unite(i.value());
+            }
+        }
+    }
+
+    return result;
+}
+
+void AutoTypeMatchIndex::indexEntry(Entry* entry)
+{
+    // disabled entries never match, their groups are checked on the candidates
+    if (!entry->autoTypeEnabled()) {
+        return;
+    }
+
+    IndexedEntry& indexed = m_entries[entry];
+
+    const QList<AutoTypeAssociations::Association> assocList = entry->autoTypeAssociations()->getAll();
+    for (const AutoTypeAssociations::Association& assoc : assocList) {
+        addWindowPattern(entry, indexed, assoc.window);
+    }
+
+    const QString title = entry->title();
+    if (hasPlaceholders(title)) {
+        m_dynamicTitles.insert(entry);
+    } else if (!title.isEmpty()) {
+        insertKey(m_titles, indexed.titleKeys, title.toCaseFolded(), entry);
+    }
+
+    const QString url = entry->url();
+    if (hasPlaceholders(url)) {
+        m_dynamicUrls.insert(entry);
+    } else if (!url.isEmpty()) {
+        insertKey(m_urls, indexed.urlKeys, url.toCaseFolded(), entry);
+        QUrl parsedUrl(url);
+        if (parsedUrl.isValid() && !parsedUrl.host().isEmpty()) {
+            insertKey(m_urls, indexed.urlKeys, parsedUrl.host().toCaseFolded(), entry);
+        }
+    }
+}
+
+void AutoTypeMatchIndex::unindexEntry(Entry* entry)
+{
+    QHash<Entry*, IndexedEntry>::iterator i = m_entries.find(entry);
+    if (i == m_entries.end()) {
+        return;
+    }
+
+    const IndexedEntry& indexed = i.value();
+    removeKeys(m_exact, indexed.exactKeys, entry);
+    removeKeys(m_prefixes, indexed.prefixKeys, entry);
+    removeKeys(m_suffixes, indexed.suffixKeys, entry);
+    removeKeys(m_titles, indexed.titleKeys, entry);
+    removeKeys(m_urls, indexed.urlKeys, entry);
+    m_entries.erase(i);
+
+    m_floating.remove(entry);
+    m_regExps.remove(entry);
+    m_dynamicWindows.remove(entry);
+    m_dynamicTitles.remove(entry);
+    m_dynamicUrls.remove(entry);
+}
+
+void AutoTypeMatchIndex::indexDirtyEntries()
+{
+    for (Entry* entry : asConst(m_dirtyEntries)) {
+        unindexEntry(entry);
+        indexEntry(entry);
+    }
+    m_dirtyEntries.clear();
+}
+
+void AutoTypeMatchIndex::addWindowPattern(Entry* entry, IndexedEntry& indexed, const QString& pattern)
+{
+    if (hasPlaceholders(pattern)) {
+        m_dynamicWindows.insert(entry);
+        return;
+    }
+
+    if (pattern.startsWith("//") && pattern.endsWith("//") && pattern.size() >= 4) {
+        indexed.regExps.append(QRegExp(pattern.mid(2, pattern.size() - 4), Qt::CaseInsensitive, QRegExp::RegExp2));
+        m_regExps.insert(entry);
+        return;
+    }
+
+    const QString folded = pattern.toCaseFolded();
+    if (!folded.contains(Wildcard)) {
+        insertKey(m_exact, indexed.exactKeys, folded, entry);
+        return;
+    }
+
+    const QStringList parts = folded.split(Wildcard, QString::KeepEmptyParts);
+    indexed.wildcards.append(parts);
+    if (!parts.first().isEmpty()) {
+        insertKey(m_prefixes, indexed.prefixKeys, parts.first(), entry);
+    } else if (!parts.last().isEmpty()) {
+        insertKey(m_suffixes, indexed.suffixKeys, parts.last(), entry);
+    } else {
+        m_floating.insert(entry);
+    }
+}
+
+void AutoTypeMatchIndex::addWildcardCandidates(const QSet<Entry*>& entries, const QString& text,
+                                               QSet<Entry*>& result) const
+{
+    for (Entry* entry : entries) {
+        if (result.contains(entry)) {
+            continue;
+        }
+        const QList<QStringList>& wildcards = m_entries.constFind(entry).value().wildcards;
+        for (const QStringList& parts : wildcards) {
+            if (wildcardMatches(text, parts)) {
+                result.insert(entry);
+                break;
+            }
+        }
+    }
+}
+
+void AutoTypeMatchIndex::insertKey(QHash<QString, QSet<Entry*>>& keys, QStringList& entryKeys, const QString& key,
+                                   Entry* entry)
+{
+    if (!entryKeys.contains(key)) {
+        entryKeys.append(key);
+        keys[key].insert(entry);
+    }
+}
+
+void AutoTypeMatchIndex::removeKeys(QHash<QString, QSet<Entry*>>& keys, const QStringList& entryKeys, Entry* entry)
+{
+    for (const QString& key : entryKeys) {
+        QHash<QString, QSet<Entry*>>::iterator i = keys.find(key);
+        if (i != keys.end()) {
+            i.value().remove(entry);
+            if (i.value().isEmpty()) {
+                keys.erase(i);
+            }
+        }
+    }
+}
+
+bool AutoTypeMatchIndex::wildcardMatches(const QString& text, const QStringList& parts)
+{
+    // same as WildcardMatcher, on case folded text
+    if (!text.startsWith(parts.first()) || !text.endsWith(parts.last())) {
+        return false;
+    }
+
+    int index = 0;
+    for (const QString& part : parts) {
+        int matchIndex = text.indexOf(part, index);
+        if (matchIndex == -1) {
+            return false;
+        }
+        index = matchIndex + part.length();
+    }
+
+    return true;
+}
@@ -0,0 +1,101 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_AUTOTYPEMATCHINDEX_H
+#define KEEPASSX_AUTOTYPEMATCHINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QRegExp>
+#include <QSet>
+#include <QStringList>
+
+class Entry;
+
+/**
+ * Index of the window patterns, titles and URLs global Auto-Type matches
+ * the active window against.
+ *
+ * Patterns are compiled once when an entry changes. Patterns without
+ * wildcards are looked up by their text, wildcard patterns by their literal
+ * prefix or suffix. Values using placeholders can only be resolved at the
+ * time of the query, their entries are always returned.
+ */
+class AutoTypeMatchIndex
+{
+public:
+    AutoTypeMatchIndex();
+
+    bool isBuilt() const;
+    void build(const QList<Entry*>& entries);
+    void clear();
+
+    /**
+     * Queues an added or modified entry, it is indexed again on the next query.
+     */
+    void updateEntry(Entry* entry);
+    void removeEntry(Entry* entry);
+
+    /**
+     * Returns the entries that may match windowTitle, in no particular order.
+     * Every matching entry is included, but the candidates still have to be
+     * checked, e.g. for Auto-Type being disabled by their group.
+     */
+    QSet<Entry*> candidates(const QString& windowTitle, bool matchTitle, bool matchUrl);
+
+private:
+    struct IndexedEntry
+    {
+        // case folded literals between the wildcards of each wildcard pattern
+        QList<QStringList> wildcards;
+        QList<QRegExp> regExps;
+        QStringList exactKeys;
+        QStringList prefixKeys;
+        QStringList suffixKeys;
+        QStringList titleKeys;
+        QStringList urlKeys;
+    };
+
+    void indexEntry(Entry* entry);
+    void unindexEntry(Entry* entry);
+    void indexDirtyEntries();
+    void addWindowPattern(Entry* entry, IndexedEntry& indexed, const QString& pattern);
+    void addWildcardCandidates(const QSet<Entry*>& entries, const QString& text, QSet<Entry*>& result) const;
+
+    static void insertKey(QHash<QString, QSet<Entry*>>& keys, QStringList& entryKeys, const QString& key,
+                          Entry* entry);
+    static void removeKeys(QHash<QString, QSet<Entry*>>& keys, const QStringList& entryKeys, Entry* entry);
+    static bool wildcardMatches(const QString& text, const QStringList& parts);
+
+    bool m_built;
+    QHash<Entry*, IndexedEntry> m_entries;
+    QHash<QString, QSet<Entry*>> m_exact;
+    QHash<QString, QSet<Entry*>> m_prefixes;
+    // wildcard patterns starting with a wildcard
+    QHash<QString, QSet<Entry*>> m_suffixes;
+    // wildcard patterns starting and ending with a wildcard
+    QSet<Entry*> m_floating;
+    QSet<Entry*> m_regExps;
+    QHash<QString, QSet<Entry*>> m_titles;
+    QHash<QString, QSet<Entry*>> m_urls;
+    QSet<Entry*> m_dynamicWindows;
+    QSet<Entry*> m_dynamicTitles;
+    QSet<Entry*> m_dynamicUrls;
+    QSet<Entry*> m_dirtyEntries;
+};
+
+#endif // KEEPASSX_AUTOTYPEMATCHINDEX_H
@@ -20,6 +20,7 @@
 
 #include <QCoreApplication>
 #include <QDir>
+#include <QMutexLocker>
 #include <QSettings>
 #include <QStandardPaths>
 #include <QTemporaryFile>
@@ -28,11 +29,13 @@ Config* Config::m_instance(nullptr);
 
 QVariant Config::get(const QString& key)
 {
+    QMutexLocker locker(&m_mutex);
     return m_settings->value(key, m_defaults.value(key));
 }
 
 QVariant Config::get(const QString& key, const QVariant& defaultValue)
 {
+    QMutexLocker locker(&m_mutex);
     return m_settings->value(key, defaultValue);
 }
 
@@ -48,6 +51,7 @@ QString Config::getFileName()
 
 void Config::set(const QString& key, const QVariant& value)
 {
+    QMutexLocker locker(&m_mutex);
     m_settings->setValue(key, value);
 }
 
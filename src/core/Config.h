@@ -19,6 +19,7 @@
 #ifndef KEEPASSX_CONFIG_H
 #define KEEPASSX_CONFIG_H
 
+#include <QMutex>
 #include <QScopedPointer>
 #include <QVariant>
 
@@ -49,6 +50,8 @@ private:
 
     QScopedPointer<QSettings> m_settings;
     QHash<QString, QVariant> m_defaults;
+    // the browser integrations read settings on their request workers
+    QMutex m_mutex;
 
     Q_DISABLE_COPY(Config)
 };
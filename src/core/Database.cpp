@@ -19,15 +19,22 @@
 #include "Database.h"
 
 #include <QFile>
+#include <QMutexLocker>
 #include <QSaveFile>
 #include <QTextStream>
+#include <QThread>
 #include <QTimer>
 #include <QXmlStreamReader>
 
 #include "cli/Utils.h"
+#include "core/AutoTypeMatchIndex.h"
+#include "core/Entry.h"
+#include "core/Global.h"
 #include "core/Group.h"
 #include "core/Metadata.h"
+#include "core/SearchIndex.h"
 #include "crypto/Random.h"
+#include "crypto/kdf/AesKdf.h"
 #include "format/KeePass2.h"
 #include "format/KeePass2Reader.h"
 #include "format/KeePass2Writer.h"
@@ -36,24 +43,123 @@
 #include "keys/CompositeKey.h"
 
 QHash<Uuid, Database*> Database::m_uuidMap;
+QMutex Database::m_uuidMapMutex;
+
+namespace {
+    // KDBX has no field for the zlib level, it's kept in the custom data of the metadata
+    const QString CompressionLevelField("KPXC_COMPRESSION_LEVEL");
+
+    // Group::clone() updates the location time stamps while it assembles the
+    // tree, restore them along with the references it doesn't carry over
+    void restoreSnapshotState(const Group* group, Group* snapshot)
+    {
+        snapshot->setTimeInfo(group->timeInfo());
+
+        const QList<Entry*>& entries = group->entries();
+        const QList<Entry*>& snapshotEntries = snapshot->entries();
+        Q_ASSERT(entries.size() == snapshotEntries.size());
+        for (int i = 0; i < entries.size(); ++i) {
+            snapshotEntries[i]->setTimeInfo(entries[i]->timeInfo());
+            if (entries[i] == group->lastTopVisibleEntry()) {
+                snapshot->setLastTopVisibleEntry(snapshotEntries[i]);
+            }
+        }
+
+        const QList<Group*>& children = group->children();
+        const QList<Group*>& snapshotChildren = snapshot->children();
+        Q_ASSERT(children.size() == snapshotChildren.size());
+        for (int i = 0; i < children.size(); ++i) {
+            restoreSnapshotState(children[i], snapshotChildren[i]);
+        }
+    }
+
+    // the groups from the root down to group
+    QList<const Group*> groupPath(const Group* group)
+    {
+        QList<const Group*> path;
+        for (; group; group = group->parentGroup()) {
+            path.prepend(group);
+        }
+        return path;
+    }
+
+    bool isBelow(const Group* group, const Group* ancestor)
+    {
+        for (; group; group = group->parentGroup()) {
+            if (group == ancestor) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // the order the recursive searches visit the tree in: a group comes before
+    // its children, which follow in the order they're stored
+    bool groupPrecedes(const Group* group, const Group* other)
+    {
+        const QList<const Group*> path = groupPath(group);
+        const QList<const Group*> otherPath = groupPath(other);
+        int depth = 0;
+        while (depth < path.size() && depth < otherPath.size() && path.at(depth) == otherPath.at(depth)) {
+            ++depth;
+        }
+        if (depth == path.size() || depth == otherPath.size()) {
+            return path.size() < otherPath.size();
+        }
+        if (depth == 0) {
+            return false;
+        }
+
+        const QList<Group*>& children = path.at(depth - 1)->children();
+        return children.indexOf(const_cast<Group*>(path.at(depth)))
+               < children.indexOf(const_cast<Group*>(otherPath.at(depth)));
+    }
+
+    // the entries of a group are visited before its children
+    bool entryPrecedes(const Entry* entry, const Entry* other)
+    {
+        if (entry->group() == other->group()) {
+            const QList<Entry*>& entries = entry->group()->entries();
+            return entries.indexOf(const_cast<Entry*>(entry)) < entries.indexOf(const_cast<Entry*>(other));
+        }
+        return groupPrecedes(entry->group(), other->group());
+    }
+}
 
 Database::Database()
     : m_metadata(new Metadata(this))
     , m_timer(new QTimer(this))
     , m_emitModified(false)
+    , m_bulkChangeDepth(0)
+    , m_bulkChangeModified(false)
+    , m_searchIndex(new SearchIndex())
+    , m_urlIndex(new UrlIndex())
+    , m_autoTypeIndex(new AutoTypeMatchIndex())
+    , m_attachmentPoolPruneSize(0)
     , m_uuid(Uuid::random())
 {
     m_data.cipher = KeePass2::CIPHER_AES;
     m_data.compressionAlgo = CompressionGZip;
-    m_data.transformRounds = 100000;
+    m_data.kdf = QSharedPointer<AesKdf>::create();
+    m_data.formatVersion = KeePass2::FILE_VERSION_3;
     m_data.hasKey = false;
 
     setRootGroup(new Group());
     rootGroup()->setUuid(Uuid::random());
     m_timer->setSingleShot(true);
 
-    m_uuidMap.insert(m_uuid, this);
+    {
+        QMutexLocker locker(&m_uuidMapMutex);
+        m_uuidMap.insert(m_uuid, this);
+    }
 
+    // groups forward entryAdded()/entryRemoved() to the index slots themselves
+    connect(this, SIGNAL(groupAboutToAdd(Group*,int)), SLOT(indexGroup(Group*)));
+    connect(this, SIGNAL(groupAboutToRemove(Group*)), SLOT(unindexGroup(Group*)));
+    // every change to an entry or the tree ends up in modifiedImmediate()
+    connect(this, SIGNAL(modifiedImmediate()), SLOT(invalidateFieldIndexes()));
+    connect(this, SIGNAL(modifiedImmediate()), SLOT(invalidateTreeDependentPlaceholders()));
+    connect(this, SIGNAL(modifiedImmediate()), SLOT(dropReadSnapshot()));
     connect(m_metadata, SIGNAL(modified()), this, SIGNAL(modifiedImmediate()));
     connect(m_metadata, SIGNAL(nameTextChanged()), this, SIGNAL(nameTextChanged()));
     connect(this, SIGNAL(modifiedImmediate()), this, SLOT(startModifiedTimer()));
@@ -62,6 +168,7 @@ Database::Database()
 
 Database::~Database()
 {
+    QMutexLocker locker(&m_uuidMapMutex);
     m_uuidMap.remove(m_uuid);
 }
 
@@ -81,6 +188,8 @@ void Database::setRootGroup(Group* group)
 
     m_rootGroup = group;
     m_rootGroup->setParent(this);
+    rebuildIndex();
+    dropReadSnapshot();
 }
 
 Metadata* Database::metadata()
@@ -95,32 +204,203 @@ const Metadata* Database::metadata() const
 
 Entry* Database::resolveEntry(const Uuid& uuid)
 {
-    return findEntryRecursive(uuid, m_rootGroup);
+    return resolveEntryBelow(uuid, m_rootGroup);
+}
+
+Entry* Database::resolveEntryBelow(const Uuid& uuid, const Group* ancestor) const
+{
+    Entry* result = nullptr;
+    QMultiHash<Uuid, Entry*>::const_iterator i = m_entryIndex.constFind(uuid);
+    for (; i != m_entryIndex.constEnd() && i.key() == uuid; ++i) {
+        Entry* entry = i.value();
+        if (isBelow(entry->group(), ancestor) && (!result || entryPrecedes(entry, result))) {
+            result = entry;
+        }
+    }
+    return result;
 }
 
 Entry* Database::resolveEntry(const QString& text, EntryReferenceType referenceType)
 {
-    return findEntryRecursive(text, referenceType, m_rootGroup);
+    switch (referenceType) {
+    case EntryReferenceType::Uuid:
+        return Uuid::isUuid(text) ? resolveEntry(Uuid::fromHex(text)) : nullptr;
+    case EntryReferenceType::Title:
+    case EntryReferenceType::UserName:
+    case EntryReferenceType::Url: {
+        QMutexLocker locker(&m_fieldIndexMutex);
+        int key = static_cast<int>(referenceType);
+        if (!m_fieldIndexes.contains(key)) {
+            buildFieldIndex(m_fieldIndexes[key], referenceType, m_rootGroup);
+        }
+        return m_fieldIndexes[key].value(text, nullptr);
+    }
+    default:
+        return findEntryRecursive(text, referenceType, m_rootGroup);
+    }
 }
 
-Entry* Database::findEntryRecursive(const Uuid& uuid, Group* group)
+void Database::buildFieldIndex(QHash<QString, Entry*>& index, EntryReferenceType referenceType, Group* group)
 {
+    // same order as findEntryRecursive() so the first match wins
     const QList<Entry*> entryList = group->entries();
     for (Entry* entry : entryList) {
-        if (entry->uuid() == uuid) {
-            return entry;
+        QString value;
+        switch (referenceType) {
+        case EntryReferenceType::Title:
+            value = entry->title();
+            break;
+        case EntryReferenceType::UserName:
+            value = entry->username();
+            break;
+        case EntryReferenceType::Url:
+            value = entry->url();
+            break;
+        default:
+            Q_ASSERT(false);
+            break;
+        }
+
+        if (!index.contains(value)) {
+            index.insert(value, entry);
         }
     }
 
     const QList<Group*> children = group->children();
     for (Group* child : children) {
-        Entry* result = findEntryRecursive(uuid, child);
-        if (result) {
-            return result;
+        buildFieldIndex(index, referenceType, child);
+    }
+}
+
+void Database::invalidateFieldIndexes()
+{
+    QMutexLocker locker(&m_fieldIndexMutex);
+    m_fieldIndexes.clear();
+}
+
+bool Database::cachedPlaceholders(const Entry* entry, const QString& str, QString* result)
+{
+    QMutexLocker locker(&m_placeholderCacheMutex);
+    QHash<const Entry*, QHash<QString, QString>>::const_iterator i = m_placeholderCache.constFind(entry);
+    if (i == m_placeholderCache.constEnd()) {
+        return false;
+    }
+
+    QHash<QString, QString>::const_iterator j = i.value().constFind(str);
+    if (j == i.value().constEnd()) {
+        return false;
+    }
+
+    *result = j.value();
+    return true;
+}
+
+void Database::cachePlaceholders(const Entry* entry, const QString& str, const QString& result,
+                                 const QSet<const Entry*>& dependencies, bool dependsOnTree)
+{
+    QMutexLocker locker(&m_placeholderCacheMutex);
+    m_placeholderCache[entry].insert(str, result);
+
+    for (const Entry* dependency : dependencies) {
+        if (dependency != entry) {
+            m_placeholderDependents[dependency].insert(entry);
         }
     }
 
-    return nullptr;
+    if (dependsOnTree) {
+        m_treeDependents.insert(entry);
+    }
+}
+
+void Database::invalidatePlaceholders(const Entry* entry)
+{
+    QMutexLocker locker(&m_placeholderCacheMutex);
+    m_placeholderCache.remove(entry);
+    m_treeDependents.remove(entry);
+
+    const QSet<const Entry*> dependents = m_placeholderDependents.take(entry);
+    for (const Entry* dependent : dependents) {
+        m_placeholderCache.remove(dependent);
+    }
+}
+
+void Database::updateSearchIndex(Entry* entry)
+{
+    {
+        QMutexLocker locker(&m_searchIndexMutex);
+        m_searchIndex->updateEntry(entry);
+    }
+
+    {
+        QMutexLocker locker(&m_urlIndexMutex);
+        m_urlIndex->updateEntry(entry);
+    }
+
+    QMutexLocker locker(&m_autoTypeIndexMutex);
+    m_autoTypeIndex->updateEntry(entry);
+}
+
+bool Database::searchCandidates(const QStringList& words, QSet<const Entry*>* candidates) const
+{
+    QMutexLocker locker(&m_searchIndexMutex);
+    if (!m_searchIndex->isBuilt()) {
+        m_searchIndex->build(m_rootGroup->entriesRecursive());
+    }
+    return m_searchIndex->candidates(words, candidates);
+}
+
+QList<Entry*> Database::entriesForHost(const QString& host)
+{
+    QList<Entry*> entries;
+    {
+        QMutexLocker locker(&m_urlIndexMutex);
+        if (!m_urlIndex->isBuilt()) {
+            m_urlIndex->build(m_rootGroup->entriesRecursive());
+        }
+        entries = m_urlIndex->entries(host);
+    }
+
+    QMutableListIterator<Entry*> i(entries);
+    while (i.hasNext()) {
+        Group* group = i.next()->group();
+        if (!group || !group->resolveSearchingEnabled()) {
+            i.remove();
+        }
+    }
+
+    return entries;
+}
+
+UrlIndex::EntryUrl Database::indexedUrl(const Entry* entry) const
+{
+    QMutexLocker locker(&m_urlIndexMutex);
+    return m_urlIndex->entryUrl(entry);
+}
+
+QSet<Entry*> Database::autoTypeCandidates(const QString& windowTitle, bool matchTitle, bool matchUrl)
+{
+    QMutexLocker locker(&m_autoTypeIndexMutex);
+    if (!m_autoTypeIndex->isBuilt()) {
+        m_autoTypeIndex->build(m_rootGroup->entriesRecursive());
+    }
+    return m_autoTypeIndex->candidates(windowTitle, matchTitle, matchUrl);
+}
+
+void Database::invalidateTreeDependentPlaceholders()
+{
+    QMutexLocker locker(&m_placeholderCacheMutex);
+    for (const Entry* entry : asConst(m_treeDependents)) {
+        m_placeholderCache.remove(entry);
+    }
+    m_treeDependents.clear();
+}
+
+void Database::clearPlaceholderCache()
+{
+    QMutexLocker locker(&m_placeholderCacheMutex);
+    m_placeholderCache.clear();
+    m_placeholderDependents.clear();
+    m_treeDependents.clear();
 }
 
 Entry* Database::findEntryRecursive(const QString& text, EntryReferenceType referenceType, Group* group)
@@ -175,24 +455,181 @@ Entry* Database::findEntryRecursive(const QString& text, EntryReferenceType refe
 
 Group* Database::resolveGroup(const Uuid& uuid)
 {
-    return findGroupRecursive(uuid, m_rootGroup);
+    return resolveGroupBelow(uuid, m_rootGroup);
 }
 
-Group* Database::findGroupRecursive(const Uuid& uuid, Group* group)
+Group* Database::resolveGroupBelow(const Uuid& uuid, const Group* ancestor) const
 {
-    if (group->uuid() == uuid) {
-        return group;
+    Group* result = nullptr;
+    QMultiHash<Uuid, Group*>::const_iterator i = m_groupIndex.constFind(uuid);
+    for (; i != m_groupIndex.constEnd() && i.key() == uuid; ++i) {
+        Group* group = i.value();
+        if (isBelow(group, ancestor) && (!result || groupPrecedes(group, result))) {
+            result = group;
+        }
     }
+    return result;
+}
 
-    const QList<Group*> children = group->children();
-    for (Group* child : children) {
-        Group* result = findGroupRecursive(uuid, child);
-        if (result) {
-            return result;
+void Database::indexEntry(Entry* entry)
+{
+    if (!m_entryIndex.contains(entry->uuid(), entry)) {
+        m_entryIndex.insert(entry->uuid(), entry);
+    }
+    updateSearchIndex(entry);
+
+    poolAttachments(entry->attachments());
+    const QList<Entry*> historyItems = entry->historyItems();
+    for (Entry* historyItem : historyItems) {
+        poolAttachments(historyItem->attachments());
+    }
+}
+
+void Database::unindexEntry(Entry* entry)
+{
+    m_entryIndex.remove(entry->uuid(), entry);
+    invalidatePlaceholders(entry);
+
+    {
+        QMutexLocker locker(&m_searchIndexMutex);
+        m_searchIndex->removeEntry(entry);
+    }
+
+    {
+        QMutexLocker locker(&m_urlIndexMutex);
+        m_urlIndex->removeEntry(entry);
+    }
+
+    QMutexLocker locker(&m_autoTypeIndexMutex);
+    m_autoTypeIndex->removeEntry(entry);
+}
+
+void Database::indexGroup(Group* group)
+{
+    // the group brings its whole subtree along
+    const QList<Group*> groups = group->groupsRecursive(true);
+    for (Group* child : groups) {
+        if (!m_groupIndex.contains(child->uuid(), child)) {
+            m_groupIndex.insert(child->uuid(), child);
+        }
+        const QList<Entry*> entries = child->entries();
+        for (Entry* entry : entries) {
+            indexEntry(entry);
         }
     }
+}
 
-    return nullptr;
+void Database::unindexGroup(Group* group)
+{
+    const QList<Group*> groups = group->groupsRecursive(true);
+    for (Group* child : groups) {
+        m_groupIndex.remove(child->uuid(), child);
+        const QList<Entry*> entries = child->entries();
+        for (Entry* entry : entries) {
+            unindexEntry(entry);
+        }
+    }
+}
+
+void Database::rebuildIndex()
+{
+    m_entryIndex.clear();
+    m_groupIndex.clear();
+    {
+        // built again on the first search
+        QMutexLocker locker(&m_searchIndexMutex);
+        m_searchIndex->clear();
+    }
+    {
+        QMutexLocker locker(&m_urlIndexMutex);
+        m_urlIndex->clear();
+    }
+    {
+        QMutexLocker locker(&m_autoTypeIndexMutex);
+        m_autoTypeIndex->clear();
+    }
+    m_attachmentPool.clear();
+    m_attachmentPoolHashes.clear();
+    m_attachmentPoolPruneSize = 0;
+    indexGroup(m_rootGroup);
+    invalidateFieldIndexes();
+    clearPlaceholderCache();
+}
+
+void Database::poolAttachments(EntryAttachments* attachments)
+{
+    const QList<QString> keys = attachments->keys();
+    for (const QString& key : keys) {
+        // lazy attachments are shared already and would have to be decoded
+        if (attachments->lazyValue(key)) {
+            continue;
+        }
+
+        QByteArray data = attachments->value(key);
+        if (data.isEmpty()) {
+            continue;
+        }
+
+        QHash<const char*, QByteArray>::const_iterator pooled = m_attachmentPoolHashes.constFind(data.constData());
+        if (pooled != m_attachmentPoolHashes.constEnd()) {
+            attachments->setPooled(key, data, pooled.value());
+            continue;
+        }
+
+        QByteArray hash = attachments->hash(key);
+        QHash<QByteArray, QByteArray>::const_iterator pooledData = m_attachmentPool.constFind(hash);
+        if (pooledData != m_attachmentPool.constEnd()) {
+            attachments->setPooled(key, pooledData.value(), hash);
+        } else {
+            m_attachmentPool.insert(hash, data);
+            m_attachmentPoolHashes.insert(data.constData(), hash);
+        }
+    }
+
+    // drop data nobody refers to anymore once the pool doubled in size
+    if (m_attachmentPool.size() > 2 * qMax(m_attachmentPoolPruneSize, 16)) {
+        pruneAttachmentPool();
+    }
+}
+
+void Database::pruneAttachmentPool()
+{
+    QSet<const char*> usedData;
+    const QList<Entry*> entries = m_rootGroup->entriesRecursive(true);
+    for (const Entry* entry : entries) {
+        const EntryAttachments* attachments = entry->attachments();
+        const QList<QString> keys = attachments->keys();
+        for (const QString& key : keys) {
+            if (!attachments->lazyValue(key)) {
+                usedData.insert(attachments->value(key).constData());
+            }
+        }
+    }
+
+    QMutableHashIterator<const char*, QByteArray> i(m_attachmentPoolHashes);
+    while (i.hasNext()) {
+        i.next();
+        if (!usedData.contains(i.key())) {
+            m_attachmentPool.remove(i.value());
+            i.remove();
+        }
+    }
+
+    m_attachmentPoolPruneSize = m_attachmentPool.size();
+}
+
+void Database::updateEntryUuid(Entry* entry, const Uuid& oldUuid)
+{
+    if (m_entryIndex.remove(oldUuid, entry) > 0) {
+        m_entryIndex.insert(entry->uuid(), entry);
+    }
+}
+
+void Database::updateGroupUuid(Group* group, const Uuid& oldUuid)
+{
+    if (m_groupIndex.remove(oldUuid, group) > 0) {
+        m_groupIndex.insert(group->uuid(), group);
+    }
 }
 
 QList<DeletedObject> Database::deletedObjects()
@@ -225,14 +662,35 @@ Database::CompressionAlgorithm Database::compressionAlgo() const
     return m_data.compressionAlgo;
 }
 
+int Database::compressionLevel() const
+{
+    bool ok;
+    int level = m_metadata->customFields().value(CompressionLevelField).toInt(&ok);
+    if (!ok || level < 1 || level > 9) {
+        return DefaultCompressionLevel;
+    }
+
+    return level;
+}
+
+QSharedPointer<Kdf> Database::kdf() const
+{
+    return m_data.kdf;
+}
+
+quint32 Database::formatVersion() const
+{
+    return m_data.formatVersion;
+}
+
 QByteArray Database::transformSeed() const
 {
-    return m_data.transformSeed;
+    return m_data.kdf->seed();
 }
 
 quint64 Database::transformRounds() const
 {
-    return m_data.transformRounds;
+    return m_data.kdf->rounds();
 }
 
 QByteArray Database::transformedMasterKey() const
@@ -265,16 +723,48 @@ void Database::setCompressionAlgo(Database::CompressionAlgorithm algo)
     m_data.compressionAlgo = algo;
 }
 
+void Database::setCompressionLevel(int level)
+{
+    Q_ASSERT(level >= 1 && level <= 9);
+
+    if (level == compressionLevel()) {
+        return;
+    }
+
+    if (m_metadata->customFields().contains(CompressionLevelField)) {
+        m_metadata->removeCustomField(CompressionLevelField);
+    }
+    if (level != DefaultCompressionLevel) {
+        m_metadata->addCustomField(CompressionLevelField, QString::number(level));
+    }
+}
+
+void Database::setKdf(QSharedPointer<Kdf> kdf)
+{
+    Q_ASSERT(kdf);
+
+    m_data.kdf = kdf;
+}
+
+void Database::setFormatVersion(quint32 version)
+{
+    m_data.formatVersion = version;
+}
+
 bool Database::setTransformRounds(quint64 rounds)
 {
-    if (m_data.transformRounds != rounds) {
-        quint64 oldRounds = m_data.transformRounds;
+    if (m_data.kdf->rounds() != rounds) {
+        QSharedPointer<Kdf> oldKdf = m_data.kdf;
 
-        m_data.transformRounds = rounds;
+        m_data.kdf = oldKdf->clone();
+        if (!m_data.kdf->setRounds(rounds)) {
+            m_data.kdf = oldKdf;
+            return false;
+        }
 
         if (m_data.hasKey) {
             if (!setKey(m_data.key)) {
-                m_data.transformRounds = oldRounds;
+                m_data.kdf = oldKdf;
                 return false;
             }
         }
@@ -285,16 +775,18 @@ bool Database::setTransformRounds(quint64 rounds)
 
 bool Database::setKey(const CompositeKey& key, const QByteArray& transformSeed, bool updateChangedTime)
 {
-    bool ok;
-    QString errorString;
+    QSharedPointer<Kdf> kdf = m_data.kdf->clone();
+    if (!kdf->setSeed(transformSeed)) {
+        return false;
+    }
 
-    QByteArray transformedMasterKey = key.transform(transformSeed, transformRounds(), &ok, &errorString);
-    if (!ok) {
+    QByteArray transformedMasterKey;
+    if (!key.transform(*kdf, transformedMasterKey)) {
         return false;
     }
 
     m_data.key = key;
-    m_data.transformSeed = transformSeed;
+    m_data.kdf = kdf;
     m_data.transformedMasterKey = transformedMasterKey;
     m_data.hasKey = true;
     if (updateChangedTime) {
@@ -307,7 +799,7 @@ bool Database::setKey(const CompositeKey& key, const QByteArray& transformSeed,
 
 bool Database::setKey(const CompositeKey& key)
 {
-    return setKey(key, randomGen()->randomArray(32));
+    return setKey(key, randomGen()->randomArray(m_data.kdf->seed().size()));
 }
 
 bool Database::hasKey() const
@@ -319,17 +811,35 @@ bool Database::transformKeyWithSeed(const QByteArray& transformSeed)
 {
     Q_ASSERT(hasKey());
 
-    bool ok;
-    QString errorString;
+    QSharedPointer<Kdf> kdf = m_data.kdf->clone();
+    if (!kdf->setSeed(transformSeed)) {
+        return false;
+    }
+
+    QByteArray transformedMasterKey;
+    if (!m_data.key.transform(*kdf, transformedMasterKey)) {
+        return false;
+    }
 
-    QByteArray transformedMasterKey =
-            m_data.key.transform(transformSeed, transformRounds(), &ok, &errorString);
-    if (!ok) {
+    m_data.kdf = kdf;
+    m_data.transformedMasterKey = transformedMasterKey;
+
+    return true;
+}
+
+bool Database::changeKdf(QSharedPointer<Kdf> kdf)
+{
+    Q_ASSERT(hasKey());
+
+    kdf->randomizeSeed();
+    QByteArray transformedMasterKey;
+    if (!m_data.key.transform(*kdf, transformedMasterKey)) {
         return false;
     }
 
-    m_data.transformSeed = transformSeed;
+    m_data.kdf = kdf;
     m_data.transformedMasterKey = transformedMasterKey;
+    emit modifiedImmediate();
 
     return true;
 }
@@ -389,6 +899,8 @@ void Database::recycleGroup(Group* group)
 void Database::emptyRecycleBin()
 {
     if (m_metadata->recycleBinEnabled() && m_metadata->recycleBin()) {
+        beginBulkChange();
+
         // destroying direct entries of the recycle bin
         QList<Entry*> subEntries = m_metadata->recycleBin()->entries();
         for (Entry* entry : subEntries) {
@@ -399,11 +911,14 @@ void Database::emptyRecycleBin()
         for (Group* group : subGroups) {
             delete group;
         }
+
+        endBulkChange();
     }
 }
 
 void Database::merge(const Database* other)
 {
+    beginBulkChange();
     m_rootGroup->merge(other->rootGroup());
 
     for (Uuid customIconId : other->metadata()->customIcons().keys()) {
@@ -413,6 +928,7 @@ void Database::merge(const Database* other)
             this->metadata()->addCustomIcon(customIconId, customIcon);
         }
     }
+    endBulkChange();
 
     emit modified();
 }
@@ -426,9 +942,35 @@ void Database::setEmitModified(bool value)
     m_emitModified = value;
 }
 
+void Database::beginBulkChange()
+{
+    if (m_bulkChangeDepth++ == 0) {
+        m_bulkChangeModified = false;
+        emit bulkChangeStarted();
+    }
+}
+
+void Database::endBulkChange()
+{
+    Q_ASSERT(m_bulkChangeDepth > 0);
+
+    if (--m_bulkChangeDepth == 0) {
+        emit bulkChangeFinished();
+        if (m_bulkChangeModified) {
+            startModifiedTimer();
+        }
+    }
+}
+
+bool Database::isBulkChange() const
+{
+    return m_bulkChangeDepth > 0;
+}
+
 void Database::copyAttributesFrom(const Database* other)
 {
     m_data = other->m_data;
+    m_data.kdf = other->m_data.kdf->clone();
     m_metadata->copyAttributesFrom(other->m_metadata);
 }
 
@@ -439,6 +981,7 @@ Uuid Database::uuid()
 
 Database* Database::databaseByUuid(const Uuid& uuid)
 {
+    QMutexLocker locker(&m_uuidMapMutex);
     return m_uuidMap.value(uuid, 0);
 }
 
@@ -448,6 +991,11 @@ void Database::startModifiedTimer()
         return;
     }
 
+    if (m_bulkChangeDepth > 0) {
+        m_bulkChangeModified = true;
+        return;
+    }
+
     if (m_timer->isActive()) {
         m_timer->stop();
     }
@@ -467,13 +1015,10 @@ Database* Database::openDatabaseFile(QString fileName, CompositeKey key)
         qCritical("File %s does not exist.", qPrintable(fileName));
         return nullptr;
     }
-    if (!dbFile.open(QIODevice::ReadOnly)) {
-        qCritical("Unable to open file %s.", qPrintable(fileName));
-        return nullptr;
-    }
 
     KeePass2Reader reader;
-    Database* db = reader.readDatabase(&dbFile, key);
+    reader.setMemoryMapped(true);
+    Database* db = reader.readDatabase(fileName, key);
 
     if (reader.hasError()) {
         qCritical("Error while parsing the database: %s", qPrintable(reader.errorString()));
@@ -511,6 +1056,46 @@ Database* Database::unlockFromStdin(QString databaseFilename, QString keyFilenam
     return Database::openDatabaseFile(databaseFilename, compositeKey);
 }
 
+Database* Database::snapshot() const
+{
+    Database* db = new Database();
+    db->m_data = m_data;
+    db->m_data.kdf = m_data.kdf->clone();
+    db->m_deletedObjects = m_deletedObjects;
+
+    Group* oldRoot = db->m_rootGroup;
+    db->setRootGroup(m_rootGroup->clone(Entry::CloneIncludeHistory, Group::CloneIncludeEntries));
+    delete oldRoot;
+    restoreSnapshotState(m_rootGroup, db->m_rootGroup);
+
+    db->m_metadata->copySnapshotFrom(m_metadata, db->m_rootGroup);
+
+    return db;
+}
+
+QSharedPointer<Database> Database::readSnapshot()
+{
+    Q_ASSERT(thread() == QThread::currentThread());
+
+    if (!m_readSnapshot) {
+        // the last reader may be a worker thread, the snapshot is deleted on this one
+        m_readSnapshot = QSharedPointer<Database>(snapshot(), &QObject::deleteLater);
+        m_readSnapshot->m_snapshotSource = this;
+    }
+
+    return m_readSnapshot;
+}
+
+Database* Database::snapshotSource() const
+{
+    return m_snapshotSource.data();
+}
+
+void Database::dropReadSnapshot()
+{
+    m_readSnapshot.reset();
+}
+
 QString Database::saveToFile(QString filePath)
 {
     KeePass2Writer writer;
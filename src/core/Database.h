@@ -21,16 +21,27 @@
 
 #include <QDateTime>
 #include <QHash>
+#include <QMutex>
 #include <QObject>
+#include <QPointer>
+#include <QScopedPointer>
+#include <QSet>
+#include <QSharedPointer>
+#include <QStringList>
 
+#include "core/UrlIndex.h"
 #include "core/Uuid.h"
+#include "crypto/kdf/Kdf.h"
 #include "keys/CompositeKey.h"
 
+class AutoTypeMatchIndex;
 class Entry;
+class EntryAttachments;
 enum class EntryReferenceType;
 class Group;
 class Metadata;
 class QTimer;
+class SearchIndex;
 
 struct DeletedObject
 {
@@ -51,13 +62,14 @@ public:
         CompressionGZip = 1
     };
     static const quint32 CompressionAlgorithmMax = CompressionGZip;
+    static const int DefaultCompressionLevel = 6;
 
     struct DatabaseData
     {
         Uuid cipher;
         CompressionAlgorithm compressionAlgo;
-        QByteArray transformSeed;
-        quint64 transformRounds;
+        QSharedPointer<Kdf> kdf;
+        quint32 formatVersion;
         QByteArray transformedMasterKey;
         CompositeKey key;
         bool hasKey;
@@ -81,15 +93,42 @@ public:
 
     Metadata* metadata();
     const Metadata* metadata() const;
+    /**
+     * Looks up an entry or group of the tree in constant time. History
+     * items aren't part of the tree and can't be found.
+     */
     Entry* resolveEntry(const Uuid& uuid);
     Entry* resolveEntry(const QString& text, EntryReferenceType referenceType);
     Group* resolveGroup(const Uuid& uuid);
+    /**
+     * Narrows a search for entries containing all of the words down to the
+     * entries that might match, see SearchIndex::candidates().
+     */
+    bool searchCandidates(const QStringList& words, QSet<const Entry*>* candidates) const;
+    /**
+     * Returns the entries whose title or URL refers to exactly host, see
+     * UrlIndex::hostKeys() for the parent domains to try when there are none.
+     * Entries in groups excluded from searches are left out.
+     */
+    QList<Entry*> entriesForHost(const QString& host);
+    /**
+     * Returns the URL of entry as prepared by the URL index for ranking matches.
+     */
+    UrlIndex::EntryUrl indexedUrl(const Entry* entry) const;
+    /**
+     * Narrows global Auto-Type down to the entries that may match windowTitle,
+     * see AutoTypeMatchIndex::candidates().
+     */
+    QSet<Entry*> autoTypeCandidates(const QString& windowTitle, bool matchTitle, bool matchUrl);
     QList<DeletedObject> deletedObjects();
     void addDeletedObject(const DeletedObject& delObj);
     void addDeletedObject(const Uuid& uuid);
 
     Uuid cipher() const;
     Database::CompressionAlgorithm compressionAlgo() const;
+    int compressionLevel() const;
+    QSharedPointer<Kdf> kdf() const;
+    quint32 formatVersion() const;
     QByteArray transformSeed() const;
     quint64 transformRounds() const;
     QByteArray transformedMasterKey() const;
@@ -99,6 +138,23 @@ public:
 
     void setCipher(const Uuid& cipher);
     void setCompressionAlgo(Database::CompressionAlgorithm algo);
+    /**
+     * Sets the zlib level (1-9) used when writing with CompressionGZip.
+     * KDBX has no field for it, it's saved in the custom data of the metadata.
+     */
+    void setCompressionLevel(int level);
+
+    /**
+     * Sets the key derivation function without transforming the key,
+     * used by the readers before the key is set.
+     */
+    void setKdf(QSharedPointer<Kdf> kdf);
+    /**
+     * Sets the oldest KDBX version the database may be written in, e.g. the
+     * version it was read from. A newer version is still used when the cipher
+     * or the key derivation function needs it.
+     */
+    void setFormatVersion(quint32 version);
     bool setTransformRounds(quint64 rounds);
     bool setKey(const CompositeKey& key, const QByteArray& transformSeed,
                 bool updateChangedTime = true);
@@ -109,13 +165,44 @@ public:
     bool setKey(const CompositeKey& key);
     bool hasKey() const;
     bool transformKeyWithSeed(const QByteArray& transformSeed);
+
+    /**
+     * Switches to a different key derivation function with a fresh seed
+     * and transforms the current key with it.
+     */
+    bool changeKdf(QSharedPointer<Kdf> kdf);
     bool verifyKey(const CompositeKey& key) const;
     void recycleEntry(Entry* entry);
     void recycleGroup(Group* group);
     void emptyRecycleBin();
     void setEmitModified(bool value);
+    /**
+     * Defers the notifications of models while many entries or groups are
+     * changed. Models are reset once when the outermost bulk change ends,
+     * which also starts the modified timer only once. Calls can be nested.
+     */
+    void beginBulkChange();
+    void endBulkChange();
+    bool isBulkChange() const;
     void copyAttributesFrom(const Database* other);
     void merge(const Database* other);
+    /**
+     * Returns a deep copy of the database that shares no objects with it,
+     * so it can be written on another thread while this one is edited.
+     * Strings and attachments are implicitly shared, which keeps it cheap.
+     */
+    Database* snapshot() const;
+    /**
+     * Returns a snapshot for lookups on worker threads. It's taken on first
+     * use after a change and shared by all readers until the next change.
+     * Must be called on the thread of the database.
+     */
+    QSharedPointer<Database> readSnapshot();
+    /**
+     * Returns the database a read snapshot was taken of, or nullptr if this
+     * isn't a read snapshot or the database is gone.
+     */
+    Database* snapshotSource() const;
     QString saveToFile(QString filePath);
 
     /**
@@ -138,14 +225,35 @@ signals:
     void nameTextChanged();
     void modified();
     void modifiedImmediate();
+    void bulkChangeStarted();
+    void bulkChangeFinished();
 
 private slots:
     void startModifiedTimer();
+    void invalidateFieldIndexes();
+    void invalidateTreeDependentPlaceholders();
+    void dropReadSnapshot();
+    void indexEntry(Entry* entry);
+    void unindexEntry(Entry* entry);
+    void indexGroup(Group* group);
+    void unindexGroup(Group* group);
 
 private:
-    Entry* findEntryRecursive(const Uuid& uuid, Group* group);
+    Entry* resolveEntryBelow(const Uuid& uuid, const Group* ancestor) const;
+    Group* resolveGroupBelow(const Uuid& uuid, const Group* ancestor) const;
     Entry* findEntryRecursive(const QString& text, EntryReferenceType referenceType, Group* group);
-    Group* findGroupRecursive(const Uuid& uuid, Group* group);
+    void buildFieldIndex(QHash<QString, Entry*>& index, EntryReferenceType referenceType, Group* group);
+    void rebuildIndex();
+    void updateEntryUuid(Entry* entry, const Uuid& oldUuid);
+    void updateGroupUuid(Group* group, const Uuid& oldUuid);
+    bool cachedPlaceholders(const Entry* entry, const QString& str, QString* result);
+    void cachePlaceholders(const Entry* entry, const QString& str, const QString& result,
+                           const QSet<const Entry*>& dependencies, bool dependsOnTree);
+    void invalidatePlaceholders(const Entry* entry);
+    void updateSearchIndex(Entry* entry);
+    void clearPlaceholderCache();
+    void poolAttachments(EntryAttachments* attachments);
+    void pruneAttachmentPool();
 
     void createRecycleBin();
 
@@ -155,9 +263,44 @@ private:
     QTimer* m_timer;
     DatabaseData m_data;
     bool m_emitModified;
+    int m_bulkChangeDepth;
+    bool m_bulkChangeModified;
+    // a multi hash so broken files with duplicate uuids stay consistent,
+    // those resolve to the first object in tree order
+    QMultiHash<Uuid, Entry*> m_entryIndex;
+    QMultiHash<Uuid, Group*> m_groupIndex;
+    // field value lookups for references, built on first use and dropped on any change
+    QHash<int, QHash<QString, Entry*>> m_fieldIndexes;
+    QMutex m_fieldIndexMutex;
+    // resolved placeholders per entry and input string, with the entries
+    // each result was taken from so changes to them drop it again
+    QHash<const Entry*, QHash<QString, QString>> m_placeholderCache;
+    QHash<const Entry*, QSet<const Entry*>> m_placeholderDependents;
+    QSet<const Entry*> m_treeDependents;
+    QMutex m_placeholderCacheMutex;
+    QScopedPointer<SearchIndex> m_searchIndex;
+    mutable QMutex m_searchIndexMutex;
+    QScopedPointer<UrlIndex> m_urlIndex;
+    mutable QMutex m_urlIndexMutex;
+    QScopedPointer<AutoTypeMatchIndex> m_autoTypeIndex;
+    QMutex m_autoTypeIndexMutex;
+    // attachment data by SHA-256 hash, entries and history items with equal
+    // attachments all point to the data in here
+    QHash<QByteArray, QByteArray> m_attachmentPool;
+    // hashes of the pooled data by address, so pooled attachments are recognized without hashing them
+    QHash<const char*, QByteArray> m_attachmentPoolHashes;
+    int m_attachmentPoolPruneSize;
+    QSharedPointer<Database> m_readSnapshot;
+    QPointer<Database> m_snapshotSource;
 
     Uuid m_uuid;
     static QHash<Uuid, Database*> m_uuidMap;
+    // databases may be created while loading on a worker thread
+    static QMutex m_uuidMapMutex;
+
+    // update the index when uuids change and share the placeholder cache
+    friend class Entry;
+    friend class Group;
 };
 
 #endif // KEEPASSX_DATABASE_H
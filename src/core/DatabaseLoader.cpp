@@ -0,0 +1,112 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DatabaseLoader.h"
+
+#include <QThread>
+#include <QtConcurrent>
+
+#include "core/Database.h"
+#include "core/Entry.h"
+#include "core/Group.h"
+#include "format/KeePass2Reader.h"
+
+DatabaseLoader::DatabaseLoader(QObject* parent)
+    : QObject(parent)
+    , m_cancelled(false)
+{
+    connect(&m_watcher, SIGNAL(finished()), SLOT(loadFinished()));
+}
+
+DatabaseLoader::~DatabaseLoader()
+{
+    if (m_watcher.isRunning()) {
+        m_watcher.waitForFinished();
+        delete m_watcher.result();
+    }
+}
+
+void DatabaseLoader::load(const QString& filename, const CompositeKey& key)
+{
+    Q_ASSERT(!isRunning());
+
+    m_errorStr.clear();
+    m_cancelled = false;
+
+    QThread* targetThread = thread();
+    m_watcher.setFuture(QtConcurrent::run([this, filename, key, targetThread]() {
+        return loadDatabase(filename, key, targetThread);
+    }));
+}
+
+void DatabaseLoader::cancel()
+{
+    m_cancelled = true;
+}
+
+bool DatabaseLoader::isRunning() const
+{
+    return m_watcher.isRunning();
+}
+
+QString DatabaseLoader::errorString() const
+{
+    return m_errorStr;
+}
+
+void DatabaseLoader::loadFinished()
+{
+    Database* db = m_watcher.result();
+
+    if (m_cancelled) {
+        delete db;
+        return;
+    }
+
+    emit finished(db);
+}
+
+Database* DatabaseLoader::loadDatabase(const QString& filename, const CompositeKey& key,
+                                       QThread* targetThread)
+{
+    KeePass2Reader reader;
+    reader.setMemoryMapped(true);
+    reader.setLazyAttachments(true);
+    reader.setProgressCallback([this](KeePass2Reader::Stage stage, int percent) {
+        emit progress(stage, percent);
+    });
+
+    Database* db = reader.readDatabase(filename, key);
+    if (!db) {
+        m_errorStr = reader.errorString();
+        return nullptr;
+    }
+
+    // objects can only be pushed to another thread by the thread owning them,
+    // history items have no QObject parent and need to be moved one by one
+    db->moveToThread(targetThread);
+    const QList<Entry*> entries = db->rootGroup()->entriesRecursive(true);
+    for (Entry* entry : entries) {
+        if (entry->thread() != targetThread) {
+            entry->moveToThread(targetThread);
+        }
+    }
+
+    emit progress(KeePass2Reader::ModelBuildStage, 100);
+
+    return db;
+}
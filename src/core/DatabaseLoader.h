@@ -0,0 +1,72 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_DATABASELOADER_H
+#define KEEPASSX_DATABASELOADER_H
+
+#include <QFutureWatcher>
+#include <QObject>
+
+#include "keys/CompositeKey.h"
+
+class Database;
+class QThread;
+
+/**
+ * Runs the whole KeePass2Reader pipeline on a worker thread. The database is
+ * only handed out once it is completely built and owned by the thread the
+ * loader lives in.
+ */
+class DatabaseLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DatabaseLoader(QObject* parent = nullptr);
+    ~DatabaseLoader();
+
+    void load(const QString& filename, const CompositeKey& key);
+    /**
+     * Drop the result of the running load, finished() is not emitted for it.
+     * The key derivation can't be interrupted, so the worker still runs to the end.
+     */
+    void cancel();
+    bool isRunning() const;
+    QString errorString() const;
+
+signals:
+    /**
+     * @param stage a KeePass2Reader::Stage
+     */
+    void progress(int stage, int percent);
+    /**
+     * The receiver takes ownership of @p db, which is nullptr if loading failed.
+     */
+    void finished(Database* db);
+
+private slots:
+    void loadFinished();
+
+private:
+    Database* loadDatabase(const QString& filename, const CompositeKey& key, QThread* targetThread);
+
+    QFutureWatcher<Database*> m_watcher;
+    QString m_errorStr;
+    bool m_cancelled;
+};
+
+#endif // KEEPASSX_DATABASELOADER_H
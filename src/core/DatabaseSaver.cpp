@@ -0,0 +1,117 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DatabaseSaver.h"
+
+#include <QtConcurrent>
+
+#include "core/Database.h"
+
+DatabaseSaver::DatabaseSaver(QObject* parent)
+    : QObject(parent)
+    , m_snapshot(nullptr)
+{
+    connect(&m_watcher, SIGNAL(finished()), SLOT(writeFinished()));
+}
+
+DatabaseSaver::~DatabaseSaver()
+{
+    m_watcher.waitForFinished();
+    delete m_snapshot;
+}
+
+void DatabaseSaver::saveInBackground(Database* db, const QString& filePath)
+{
+    if (m_snapshot) {
+        // only the latest state is written once the running write is done
+        m_pendingDb = db;
+        m_pendingFilePath = filePath;
+        return;
+    }
+
+    startWrite(db, filePath);
+}
+
+QString DatabaseSaver::save(Database* db, const QString& filePath)
+{
+    // the pending state is older than db, writing it would be wasted
+    m_pendingDb.clear();
+    m_watcher.waitForFinished();
+    finishWrite();
+
+    return db->saveToFile(filePath);
+}
+
+void DatabaseSaver::waitForFinished()
+{
+    m_watcher.waitForFinished();
+    finishWrite();
+
+    if (m_pendingDb) {
+        Database* db = m_pendingDb;
+        m_pendingDb.clear();
+        QString errorString = db->saveToFile(m_pendingFilePath);
+        emit saved(m_pendingFilePath, errorString);
+    }
+}
+
+bool DatabaseSaver::isRunning() const
+{
+    return m_snapshot || m_pendingDb;
+}
+
+void DatabaseSaver::writeFinished()
+{
+    // the write may have been completed by waitForFinished() already
+    if (!m_snapshot || m_watcher.isRunning()) {
+        return;
+    }
+
+    finishWrite();
+
+    if (m_pendingDb) {
+        Database* db = m_pendingDb;
+        m_pendingDb.clear();
+        startWrite(db, m_pendingFilePath);
+    }
+}
+
+void DatabaseSaver::startWrite(Database* db, const QString& filePath)
+{
+    Q_ASSERT(!m_snapshot);
+
+    // the snapshot is owned by this thread and only read by the worker
+    m_snapshot = db->snapshot();
+    m_filePath = filePath;
+
+    Database* snapshot = m_snapshot;
+    m_watcher.setFuture(QtConcurrent::run([snapshot, filePath]() {
+        return snapshot->saveToFile(filePath);
+    }));
+}
+
+void DatabaseSaver::finishWrite()
+{
+    if (!m_snapshot) {
+        return;
+    }
+
+    delete m_snapshot;
+    m_snapshot = nullptr;
+
+    emit saved(m_filePath, m_watcher.result());
+}
@@ -0,0 +1,68 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_DATABASESAVER_H
+#define KEEPASSX_DATABASESAVER_H
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QPointer>
+
+class Database;
+
+/**
+ * Writes snapshots of a database on a worker thread. Saves requested while a
+ * write is running are coalesced into one write of the latest state.
+ */
+class DatabaseSaver : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DatabaseSaver(QObject* parent = nullptr);
+    ~DatabaseSaver();
+
+    void saveInBackground(Database* db, const QString& filePath);
+    /**
+     * Write the database right away, once the background writes are done.
+     * @return the error message or an empty string on success
+     */
+    QString save(Database* db, const QString& filePath);
+    /**
+     * Block until the running write and a coalesced one have finished.
+     */
+    void waitForFinished();
+    bool isRunning() const;
+
+signals:
+    void saved(const QString& filePath, const QString& errorString);
+
+private slots:
+    void writeFinished();
+
+private:
+    void startWrite(Database* db, const QString& filePath);
+    void finishWrite();
+
+    QFutureWatcher<QString> m_watcher;
+    Database* m_snapshot;
+    QString m_filePath;
+    QPointer<Database> m_pendingDb;
+    QString m_pendingFilePath;
+};
+
+#endif // KEEPASSX_DATABASESAVER_H
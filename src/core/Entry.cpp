@@ -48,10 +48,13 @@ Entry::Entry()
     connect(m_attributes, SIGNAL(modified()), this, SIGNAL(modified()));
     connect(m_attributes, SIGNAL(defaultKeyModified()), SLOT(emitDataChanged()));
     connect(m_attachments, SIGNAL(modified()), this, SIGNAL(modified()));
+    connect(m_attachments, SIGNAL(modified()), SLOT(poolAttachments()));
     connect(m_autoTypeAssociations, SIGNAL(modified()), SIGNAL(modified()));
 
     connect(this, SIGNAL(modified()), SLOT(updateTimeinfo()));
     connect(this, SIGNAL(modified()), SLOT(updateModifiedSinceBegin()));
+    connect(this, SIGNAL(modified()), SLOT(invalidatePlaceholderCache()));
+    connect(this, SIGNAL(modified()), SLOT(updateSearchIndex()));
 }
 
 Entry::~Entry()
@@ -421,7 +424,10 @@ quint8 Entry::totpDigits() const
 void Entry::setUuid(const Uuid& uuid)
 {
     Q_ASSERT(!uuid.isNull());
-    set(m_uuid, uuid);
+    Uuid oldUuid = m_uuid;
+    if (set(m_uuid, uuid) && m_group && m_group->database()) {
+        m_group->database()->updateEntryUuid(this, oldUuid);
+    }
 }
 
 void Entry::setIcon(int iconNumber)
@@ -551,10 +557,27 @@ void Entry::addHistoryItem(Entry* entry)
 {
     Q_ASSERT(!entry->parent());
 
+    // revisions mostly differ in a few fields, let them share the rest with
+    // the previous revision and the current entry instead of keeping copies
+    if (!m_history.isEmpty()) {
+        entry->shareDataWith(m_history.last());
+    }
+    entry->shareDataWith(this);
+
     m_history.append(entry);
+    if (m_group && m_group->database()) {
+        m_group->database()->poolAttachments(entry->attachments());
+    }
     emit modified();
 }
 
+void Entry::shareDataWith(const Entry* other)
+{
+    m_attributes->shareDataWith(other->m_attributes);
+    m_attachments->shareDataWith(other->m_attachments);
+    m_autoTypeAssociations->shareDataWith(other->m_autoTypeAssociations);
+}
+
 void Entry::removeHistoryItems(const QList<Entry*>& historyEntries)
 {
     if (historyEntries.isEmpty()) {
@@ -599,7 +622,12 @@ void Entry::truncateHistory()
     int histMaxSize = db->metadata()->historyMaxSize();
     if (histMaxSize > -1) {
         int size = 0;
-        QSet<QByteArray> foundAttachments = attachments()->values().toSet();
+        // attachments are identified by their hash, which is computed only once per attachment
+        QSet<QByteArray> foundAttachments;
+        const QList<QString> keys = attachments()->keys();
+        for (const QString& key : keys) {
+            foundAttachments.insert(attachments()->hash(key));
+        }
 
         QMutableListIterator<Entry*> i(m_history);
         i.toBack();
@@ -610,11 +638,15 @@ void Entry::truncateHistory()
             if (size <= histMaxSize) {
                 size += historyItem->attributes()->attributesSize();
 
-                const QSet<QByteArray> newAttachments = historyItem->attachments()->values().toSet() - foundAttachments;
-                for (const QByteArray& attachment : newAttachments) {
-                    size += attachment.size();
+                const EntryAttachments* historyAttachments = historyItem->attachments();
+                const QList<QString> historyKeys = historyAttachments->keys();
+                for (const QString& key : historyKeys) {
+                    QByteArray hash = historyAttachments->hash(key);
+                    if (!foundAttachments.contains(hash)) {
+                        size += historyAttachments->value(key).size();
+                        foundAttachments.insert(hash);
+                    }
                 }
-                foundAttachments += newAttachments;
             }
 
             if (size > histMaxSize) {
@@ -722,7 +754,35 @@ void Entry::updateModifiedSinceBegin()
     m_modifiedSinceBegin = true;
 }
 
-QString Entry::resolveMultiplePlaceholdersRecursive(const QString& str, int maxDepth) const
+Entry::PlaceholderDependencies::PlaceholderDependencies()
+    : allEntries(false)
+    , cacheable(true)
+{
+}
+
+void Entry::invalidatePlaceholderCache()
+{
+    if (m_group && m_group->database()) {
+        m_group->database()->invalidatePlaceholders(this);
+    }
+}
+
+void Entry::updateSearchIndex()
+{
+    if (m_group && m_group->database()) {
+        m_group->database()->updateSearchIndex(this);
+    }
+}
+
+void Entry::poolAttachments()
+{
+    if (m_group && m_group->database()) {
+        m_group->database()->poolAttachments(m_attachments);
+    }
+}
+
+QString Entry::resolveMultiplePlaceholdersRecursive(const QString& str, int maxDepth,
+                                                    PlaceholderDependencies* dependencies) const
 {
     if (maxDepth <= 0) {
         qWarning("Maximum depth of replacement has been reached. Entry uuid: %s", qPrintable(uuid().toHex()));
@@ -735,18 +795,19 @@ QString Entry::resolveMultiplePlaceholdersRecursive(const QString& str, int maxD
     int pos = 0;
     while ((pos = placeholderRegEx.indexIn(str, pos)) != -1) {
         const QString found = placeholderRegEx.cap(1);
-        result.replace(found, resolvePlaceholderRecursive(found, maxDepth - 1));
+        result.replace(found, resolvePlaceholderRecursive(found, maxDepth - 1, dependencies));
         pos += placeholderRegEx.matchedLength();
     }
 
     if (result != str) {
-        result = resolveMultiplePlaceholdersRecursive(result, maxDepth - 1);
+        result = resolveMultiplePlaceholdersRecursive(result, maxDepth - 1, dependencies);
     }
 
     return result;
 }
 
-QString Entry::resolvePlaceholderRecursive(const QString& placeholder, int maxDepth) const
+QString Entry::resolvePlaceholderRecursive(const QString& placeholder, int maxDepth,
+                                           PlaceholderDependencies* dependencies) const
 {
     const PlaceholderType typeOfPlaceholder = placeholderType(placeholder);
     switch (typeOfPlaceholder) {
@@ -762,6 +823,9 @@ QString Entry::resolvePlaceholderRecursive(const QString& placeholder, int maxDe
     case PlaceholderType::Notes:
         return notes();
     case PlaceholderType::Totp:
+        if (dependencies) {
+            dependencies->cacheable = false;
+        }
         return totp();
     case PlaceholderType::Url:
         return url();
@@ -775,7 +839,7 @@ QString Entry::resolvePlaceholderRecursive(const QString& placeholder, int maxDe
     case PlaceholderType::UrlUserInfo:
     case PlaceholderType::UrlUserName:
     case PlaceholderType::UrlPassword: {
-        const QString strUrl = resolveMultiplePlaceholdersRecursive(url(), maxDepth - 1);
+        const QString strUrl = resolveMultiplePlaceholdersRecursive(url(), maxDepth - 1, dependencies);
         return resolveUrlPlaceholder(strUrl, typeOfPlaceholder);
     }
     case PlaceholderType::CustomAttribute: {
@@ -783,13 +847,14 @@ QString Entry::resolvePlaceholderRecursive(const QString& placeholder, int maxDe
         return attributes()->hasKey(key) ? attributes()->value(key) : QString();
     }
     case PlaceholderType::Reference:
-        return resolveReferencePlaceholderRecursive(placeholder, maxDepth);
+        return resolveReferencePlaceholderRecursive(placeholder, maxDepth, dependencies);
     }
 
     return placeholder;
 }
 
-QString Entry::resolveReferencePlaceholderRecursive(const QString& placeholder, int maxDepth) const
+QString Entry::resolveReferencePlaceholderRecursive(const QString& placeholder, int maxDepth,
+                                                    PlaceholderDependencies* dependencies) const
 {
     // resolving references in format: {REF:<WantedField>@<SearchIn>:<SearchText>}
     // using format from http://keepass.info/help/base/fieldrefs.html at the time of writing
@@ -806,6 +871,16 @@ QString Entry::resolveReferencePlaceholderRecursive(const QString& placeholder,
     const EntryReferenceType searchInType = Entry::referenceType(searchIn);
     const Entry* refEntry = m_group->database()->resolveEntry(searchText, searchInType);
 
+    if (dependencies) {
+        // a uuid keeps pointing to the same entry, other fields may match a different one later
+        if (!refEntry || searchInType != EntryReferenceType::Uuid) {
+            dependencies->allEntries = true;
+        }
+        if (refEntry) {
+            dependencies->entries.insert(refEntry);
+        }
+    }
+
     if (refEntry) {
         const QString wantedField = match.captured(EntryAttributes::WantedFieldGroupName);
         result = refEntry->referenceFieldValue(Entry::referenceType(wantedField));
@@ -813,7 +888,7 @@ QString Entry::resolveReferencePlaceholderRecursive(const QString& placeholder,
         // Referencing fields of other entries only works with standard fields, not with custom user strings.
         // If you want to reference a custom user string, you need to place a redirection in a standard field
         // of the entry with the custom string, using {S:<Name>}, and reference the standard field.
-        result = refEntry->resolveMultiplePlaceholdersRecursive(result, maxDepth - 1);
+        result = refEntry->resolveMultiplePlaceholdersRecursive(result, maxDepth - 1, dependencies);
     }
 
     return result;
@@ -906,12 +981,30 @@ QString Entry::maskPasswordPlaceholders(const QString& str) const
 
 QString Entry::resolveMultiplePlaceholders(const QString& str) const
 {
-    return resolveMultiplePlaceholdersRecursive(str, ResolveMaximumDepth);
+    // most values don't contain any placeholder
+    if (!str.contains('{')) {
+        return str;
+    }
+
+    Database* db = m_group ? m_group->database() : nullptr;
+    QString result;
+    if (db && db->cachedPlaceholders(this, str, &result)) {
+        return result;
+    }
+
+    PlaceholderDependencies dependencies;
+    result = resolveMultiplePlaceholdersRecursive(str, ResolveMaximumDepth, &dependencies);
+
+    if (db && dependencies.cacheable) {
+        db->cachePlaceholders(this, str, result, dependencies.entries, dependencies.allEntries);
+    }
+
+    return result;
 }
 
 QString Entry::resolvePlaceholder(const QString& placeholder) const
 {
-    return resolvePlaceholderRecursive(placeholder, ResolveMaximumDepth);
+    return resolvePlaceholderRecursive(placeholder, ResolveMaximumDepth, nullptr);
 }
 
 QString Entry::resolveUrlPlaceholder(const QString& str, Entry::PlaceholderType placeholderType) const
@@ -210,16 +210,35 @@ private slots:
     void emitDataChanged();
     void updateTimeinfo();
     void updateModifiedSinceBegin();
+    void invalidatePlaceholderCache();
+    void updateSearchIndex();
+    void poolAttachments();
 
 private:
-    QString resolveMultiplePlaceholdersRecursive(const QString& str, int maxDepth) const;
-    QString resolvePlaceholderRecursive(const QString& placeholder, int maxDepth) const;
-    QString resolveReferencePlaceholderRecursive(const QString& placeholder, int maxDepth) const;
+    /**
+     * What a resolved value depends on besides the entry itself.
+     */
+    struct PlaceholderDependencies
+    {
+        PlaceholderDependencies();
+
+        QSet<const Entry*> entries;
+        bool allEntries; // a reference was looked up by field value or not found
+        bool cacheable; // false for time dependent values like {TOTP}
+    };
+
+    QString resolveMultiplePlaceholdersRecursive(const QString& str, int maxDepth,
+                                                 PlaceholderDependencies* dependencies) const;
+    QString resolvePlaceholderRecursive(const QString& placeholder, int maxDepth,
+                                        PlaceholderDependencies* dependencies) const;
+    QString resolveReferencePlaceholderRecursive(const QString& placeholder, int maxDepth,
+                                                 PlaceholderDependencies* dependencies) const;
     QString referenceFieldValue(EntryReferenceType referenceType) const;
 
     static EntryReferenceType referenceType(const QString& referenceStr);
 
     const Database* database() const;
+    void shareDataWith(const Entry* other);
     template <class T> bool set(T& property, const T& value);
 
     Uuid m_uuid;
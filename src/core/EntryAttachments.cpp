@@ -19,6 +19,8 @@
 
 #include <QStringList>
 
+#include "crypto/CryptoHash.h"
+
 EntryAttachments::EntryAttachments(QObject* parent)
     : QObject(parent)
 {
@@ -36,14 +38,58 @@ bool EntryAttachments::hasKey(const QString& key) const
 
 QList<QByteArray> EntryAttachments::values() const
 {
-    return m_attachments.values();
+    if (m_lazyAttachments.isEmpty()) {
+        return m_attachments.values();
+    }
+
+    QList<QByteArray> values;
+    QMap<QString, QByteArray>::const_iterator i;
+    for (i = m_attachments.constBegin(); i != m_attachments.constEnd(); ++i) {
+        values.append(value(i.key()));
+    }
+    return values;
 }
 
 QByteArray EntryAttachments::value(const QString& key) const
 {
+    QSharedPointer<LazyAttachment> attachment = m_lazyAttachments.value(key);
+    if (attachment) {
+        return attachment->data();
+    }
+
     return m_attachments.value(key);
 }
 
+QSharedPointer<LazyAttachment> EntryAttachments::lazyValue(const QString& key) const
+{
+    return m_lazyAttachments.value(key);
+}
+
+QByteArray EntryAttachments::hash(const QString& key) const
+{
+    QMap<QString, QByteArray>::const_iterator i = m_hashes.constFind(key);
+    if (i != m_hashes.constEnd()) {
+        return i.value();
+    }
+
+    QByteArray hash = CryptoHash::hash(value(key), CryptoHash::Sha256);
+    m_hashes.insert(key, hash);
+    return hash;
+}
+
+void EntryAttachments::setPooled(const QString& key, const QByteArray& value, const QByteArray& hash)
+{
+    Q_ASSERT(m_attachments.contains(key) && !m_lazyAttachments.contains(key));
+    Q_ASSERT(m_attachments.value(key).size() == value.size());
+
+    if (m_attachments.value(key).constData() != value.constData()) {
+        m_attachments.insert(key, value);
+    }
+    if (!m_hashes.contains(key)) {
+        m_hashes.insert(key, hash);
+    }
+}
+
 void EntryAttachments::set(const QString& key, const QByteArray& value)
 {
     bool emitModified = false;
@@ -53,7 +99,9 @@ void EntryAttachments::set(const QString& key, const QByteArray& value)
         emit aboutToBeAdded(key);
     }
 
-    if (addAttachment || m_attachments.value(key) != value) {
+    if (addAttachment || this->value(key) != value) {
+        m_lazyAttachments.remove(key);
+        m_hashes.remove(key);
         m_attachments.insert(key, value);
         emitModified = true;
     }
@@ -70,6 +118,29 @@ void EntryAttachments::set(const QString& key, const QByteArray& value)
     }
 }
 
+void EntryAttachments::setLazy(const QString& key, QSharedPointer<LazyAttachment> attachment)
+{
+    Q_ASSERT(attachment);
+
+    bool addAttachment = !m_attachments.contains(key);
+
+    if (addAttachment) {
+        emit aboutToBeAdded(key);
+    }
+
+    m_attachments.insert(key, QByteArray());
+    m_lazyAttachments.insert(key, attachment);
+    m_hashes.remove(key);
+
+    if (addAttachment) {
+        emit added(key);
+    } else {
+        emit keyModified(key);
+    }
+
+    emit modified();
+}
+
 void EntryAttachments::remove(const QString& key)
 {
     if (!m_attachments.contains(key)) {
@@ -81,6 +152,8 @@ void EntryAttachments::remove(const QString& key)
     emit aboutToBeRemoved(key);
 
     m_attachments.remove(key);
+    m_lazyAttachments.remove(key);
+    m_hashes.remove(key);
 
     emit removed(key);
     emit modified();
@@ -103,6 +176,8 @@ void EntryAttachments::remove(const QStringList& keys)
         isModified = true;
         emit aboutToBeRemoved(key);
         m_attachments.remove(key);
+        m_lazyAttachments.remove(key);
+        m_hashes.remove(key);
         emit removed(key);
     }
 
@@ -125,6 +200,8 @@ void EntryAttachments::clear()
     emit aboutToBeReset();
 
     m_attachments.clear();
+    m_lazyAttachments.clear();
+    m_hashes.clear();
 
     emit reset();
     emit modified();
@@ -136,18 +213,71 @@ void EntryAttachments::copyDataFrom(const EntryAttachments* other)
         emit aboutToBeReset();
 
         m_attachments = other->m_attachments;
+        m_lazyAttachments = other->m_lazyAttachments;
+        m_hashes = other->m_hashes;
 
         emit reset();
         emit modified();
     }
 }
 
+void EntryAttachments::shareDataWith(const EntryAttachments* other)
+{
+    // lazy attachments are equal if they point to the same undecoded data
+    if (m_lazyAttachments == other->m_lazyAttachments && m_attachments == other->m_attachments) {
+        m_attachments = other->m_attachments;
+        m_lazyAttachments = other->m_lazyAttachments;
+        if (m_hashes.size() < other->m_hashes.size()) {
+            m_hashes = other->m_hashes;
+        }
+        return;
+    }
+
+    QMap<QString, QByteArray>::iterator i;
+    for (i = m_attachments.begin(); i != m_attachments.end(); ++i) {
+        const QString& key = i.key();
+        // don't decode lazy attachments just to compare them
+        if (!other->m_attachments.contains(key) || m_lazyAttachments.contains(key)
+                || other->m_lazyAttachments.contains(key)) {
+            continue;
+        }
+
+        const QByteArray otherValue = other->m_attachments.value(key);
+        if (otherValue.constData() != i.value().constData() && otherValue == i.value()) {
+            i.value() = otherValue;
+            if (other->m_hashes.contains(key)) {
+                m_hashes.insert(key, other->m_hashes.value(key));
+            }
+        }
+    }
+}
+
 bool EntryAttachments::operator==(const EntryAttachments& other) const
 {
-    return m_attachments == other.m_attachments;
+    if (m_lazyAttachments.isEmpty() && other.m_lazyAttachments.isEmpty()) {
+        return m_attachments == other.m_attachments;
+    }
+
+    if (m_attachments.keys() != other.m_attachments.keys()) {
+        return false;
+    }
+
+    QMap<QString, QByteArray>::const_iterator i;
+    for (i = m_attachments.constBegin(); i != m_attachments.constEnd(); ++i) {
+        // copies of a lazy attachment are equal without decoding them
+        QSharedPointer<LazyAttachment> attachment = m_lazyAttachments.value(i.key());
+        if (attachment && attachment == other.m_lazyAttachments.value(i.key())) {
+            continue;
+        }
+        if (value(i.key()) != other.value(i.key())) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 bool EntryAttachments::operator!=(const EntryAttachments& other) const
 {
-    return m_attachments != other.m_attachments;
+    return !(*this == other);
 }
@@ -20,6 +20,9 @@
 
 #include <QMap>
 #include <QObject>
+#include <QSharedPointer>
+
+#include "core/LazyAttachment.h"
 
 class QStringList;
 
@@ -34,11 +37,35 @@ public:
     QList<QByteArray> values() const;
     QByteArray value(const QString& key) const;
     void set(const QString& key, const QByteArray& value);
+    /**
+     * Sets an attachment that is decoded when value() is first called for it.
+     */
+    void setLazy(const QString& key, QSharedPointer<LazyAttachment> attachment);
+    /**
+     * Returns the undecoded attachment if key was set with setLazy(), otherwise null.
+     */
+    QSharedPointer<LazyAttachment> lazyValue(const QString& key) const;
+    /**
+     * Returns the SHA-256 hash of the attachment content. It's computed on
+     * first use and travels along with copies of the attachments.
+     */
+    QByteArray hash(const QString& key) const;
+    /**
+     * Replaces the data of an attachment with equal data from the attachment
+     * pool of the database. The content doesn't change, so no signals are emitted.
+     */
+    void setPooled(const QString& key, const QByteArray& value, const QByteArray& hash);
     void remove(const QString& key);
     void remove(const QStringList& keys);
     bool isEmpty() const;
     void clear();
     void copyDataFrom(const EntryAttachments* other);
+    /**
+     * Makes attachments that are equal to the ones of other point to the same
+     * implicitly shared data. The attachments don't change, so no signals
+     * are emitted.
+     */
+    void shareDataWith(const EntryAttachments* other);
     bool operator==(const EntryAttachments& other) const;
     bool operator!=(const EntryAttachments& other) const;
 
@@ -53,7 +80,10 @@ signals:
     void reset();
 
 private:
+    // lazy attachments keep an empty placeholder in m_attachments
     QMap<QString, QByteArray> m_attachments;
+    QMap<QString, QSharedPointer<LazyAttachment>> m_lazyAttachments;
+    mutable QMap<QString, QByteArray> m_hashes;
 };
 
 #endif // KEEPASSX_ENTRYATTACHMENTS_H
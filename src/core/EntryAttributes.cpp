@@ -247,6 +247,27 @@ void EntryAttributes::copyDataFrom(const EntryAttributes* other)
     }
 }
 
+void EntryAttributes::shareDataWith(const EntryAttributes* other)
+{
+    if (m_protectedAttributes == other->m_protectedAttributes) {
+        m_protectedAttributes = other->m_protectedAttributes;
+    }
+
+    if (m_attributes == other->m_attributes) {
+        m_attributes = other->m_attributes;
+        return;
+    }
+
+    QMap<QString, QString>::iterator i;
+    for (i = m_attributes.begin(); i != m_attributes.end(); ++i) {
+        QMap<QString, QString>::const_iterator otherValue = other->m_attributes.constFind(i.key());
+        if (otherValue != other->m_attributes.constEnd() && otherValue.value().constData() != i.value().constData()
+                && otherValue.value() == i.value()) {
+            i.value() = otherValue.value();
+        }
+    }
+}
+
 bool EntryAttributes::operator==(const EntryAttributes& other) const
 {
     return (m_attributes == other.m_attributes
@@ -47,6 +47,12 @@ public:
     void clear();
     int attributesSize();
     void copyDataFrom(const EntryAttributes* other);
+    /**
+     * Makes values that are equal to the ones of other point to the same
+     * implicitly shared data. The attributes don't change, so no signals
+     * are emitted.
+     */
+    void shareDataWith(const EntryAttributes* other);
     bool operator==(const EntryAttributes& other) const;
     bool operator!=(const EntryAttributes& other) const;
 
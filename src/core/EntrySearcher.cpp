@@ -18,8 +18,32 @@
 
 #include "EntrySearcher.h"
 
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+
+#include "core/Database.h"
+#include "core/Global.h"
 #include "core/Group.h"
 
+namespace {
+    // entries matched by one task of a parallel search
+    const int ParallelChunkSize = 4096;
+
+    QString fieldValue(const Entry* entry, const QString& value)
+    {
+        // only fields consisting of a placeholder need to be resolved
+        return value.startsWith('{') ? entry->resolvePlaceholder(value) : value;
+    }
+}
+
+EntrySearcher::EntrySearcher()
+    : m_caseSensitivity(Qt::CaseInsensitive)
+    , m_matchGroups(true)
+    , m_useCandidates(false)
+{
+}
+
 QList<Entry*> EntrySearcher::search(const QString& searchTerm, const Group* group,
                                     Qt::CaseSensitivity caseSensitivity)
 {
@@ -27,68 +51,283 @@ QList<Entry*> EntrySearcher::search(const QString& searchTerm, const Group* grou
         return QList<Entry*>();
     }
 
-    return searchEntries(searchTerm, group, caseSensitivity);
+    m_caseSensitivity = caseSensitivity;
+    m_terms = parseSearchTerms(searchTerm, caseSensitivity);
+
+    // cheap and selective terms first so most entries are ruled out early
+    std::stable_sort(m_terms.begin(), m_terms.end(), [](const SearchTerm& left, const SearchTerm& right) {
+        int leftCost = termCost(left);
+        int rightCost = termCost(right);
+        if (leftCost != rightCost) {
+            return leftCost < rightCost;
+        }
+        return left.word.size() > right.word.size();
+    });
+
+    m_matchGroups = true;
+    QStringList indexWords;
+    for (const SearchTerm& term : asConst(m_terms)) {
+        bool plainWord = term.field == Field::Undefined && !term.exclude && term.regex.pattern().isEmpty();
+        m_matchGroups = m_matchGroups && plainWord;
+
+        // the database index covers substrings of the default fields
+        bool indexed = term.field == Field::Undefined || term.field == Field::Title
+                || term.field == Field::Username || term.field == Field::Url || term.field == Field::Notes;
+        if (indexed && !term.exclude && term.regex.pattern().isEmpty() && !term.word.contains('\n')) {
+            indexWords.append(term.word);
+        }
+    }
+
+    // let the index of the database skip the groups without any candidate
+    const Database* db = group->database();
+    m_candidates.clear();
+    m_candidateGroups.clear();
+    m_useCandidates = db && db->searchCandidates(indexWords, &m_candidates);
+    if (m_useCandidates) {
+        for (const Entry* entry : asConst(m_candidates)) {
+            m_candidateGroups.insert(entry->group());
+        }
+    }
+
+    QVector<Candidate> candidates;
+    collectCandidates(group, candidates);
+
+    QList<Entry*> searchResult;
+    if (candidates.size() < 2 * ParallelChunkSize || QThreadPool::globalInstance()->maxThreadCount() < 2) {
+        searchResult = matchCandidates(candidates, 0, candidates.size());
+    } else {
+        QList<QFuture<QList<Entry*>>> futures;
+        for (int begin = 0; begin < candidates.size(); begin += ParallelChunkSize) {
+            int end = qMin(begin + ParallelChunkSize, candidates.size());
+            futures.append(QtConcurrent::run([this, &candidates, begin, end]() {
+                return matchCandidates(candidates, begin, end);
+            }));
+        }
+        // merge in chunk order, the same order a serial search has
+        for (QFuture<QList<Entry*>>& future : futures) {
+            searchResult.append(future.result());
+        }
+    }
+
+    m_terms.clear();
+    m_candidates.clear();
+    m_candidateGroups.clear();
+    return searchResult;
 }
 
-QList<Entry*> EntrySearcher::searchEntries(const QString& searchTerm, const Group* group,
-                                           Qt::CaseSensitivity caseSensitivity)
+QList<EntrySearcher::SearchTerm> EntrySearcher::parseSearchTerms(const QString& searchTerm,
+                                                                 Qt::CaseSensitivity caseSensitivity)
 {
-    QList<Entry*> searchResult;
+    static const QRegularExpression termRegex(
+        "(?<exclude>-)?(?:(?<field>\\w+):)?(?:\"(?<phrase>[^\"]*)\"?|(?<word>[^\\s\"]+))",
+        QRegularExpression::UseUnicodePropertiesOption);
+
+    QList<SearchTerm> terms;
+
+    QRegularExpressionMatchIterator i = termRegex.globalMatch(searchTerm);
+    while (i.hasNext()) {
+        QRegularExpressionMatch match = i.next();
+
+        SearchTerm term;
+        term.field = Field::Undefined;
+        term.exclude = !match.captured("exclude").isEmpty();
+
+        const bool isPhrase = match.capturedStart("phrase") != -1;
+        term.word = isPhrase ? match.captured("phrase") : match.captured("word");
+
+        const QString fieldName = match.captured("field");
+        if (!fieldName.isEmpty()) {
+            term.field = fieldByName(fieldName, term.word);
+            if (term.field == Field::Undefined) {
+                // not a field, e.g. a URL with a scheme
+                term.word = match.captured(0).mid(term.exclude ? 1 : 0);
+            }
+        }
+
+        if (!isPhrase && term.field != Field::Expired && term.field != Field::Totp
+                && term.word.contains('*')) {
+            QStringList parts = term.word.split('*');
+            for (QString& part : parts) {
+                part = QRegularExpression::escape(part);
+            }
+            QRegularExpression::PatternOptions options = QRegularExpression::UseUnicodePropertiesOption;
+            if (caseSensitivity == Qt::CaseInsensitive) {
+                options |= QRegularExpression::CaseInsensitiveOption;
+            }
+            term.regex = QRegularExpression("^" + parts.join(".*") + "$", options);
+        }
+
+        if (!term.word.isEmpty()) {
+            terms.append(term);
+        }
+    }
+
+    return terms;
+}
+
+EntrySearcher::Field EntrySearcher::fieldByName(const QString& name, const QString& value)
+{
+    const QString field = name.toLower();
+    if (field == "title") {
+        return Field::Title;
+    }
+    if (field == "user" || field == "username") {
+        return Field::Username;
+    }
+    if (field == "pw" || field == "password") {
+        return Field::Password;
+    }
+    if (field == "url") {
+        return Field::Url;
+    }
+    if (field == "notes") {
+        return Field::Notes;
+    }
+    if (field == "tags") {
+        return Field::Tags;
+    }
+    if (field == "group") {
+        return Field::Group;
+    }
+    if (field == "is" && value.compare("expired", Qt::CaseInsensitive) == 0) {
+        return Field::Expired;
+    }
+    if (field == "has" && value.compare("totp", Qt::CaseInsensitive) == 0) {
+        return Field::Totp;
+    }
+
+    return Field::Undefined;
+}
+
+int EntrySearcher::termCost(const SearchTerm& term)
+{
+    int cost;
+    switch (term.field) {
+    case Field::Expired:
+    case Field::Totp:
+        cost = 0;
+        break;
+    case Field::Undefined:
+        cost = 4;
+        break;
+    default:
+        cost = 1;
+        break;
+    }
+
+    if (!term.regex.pattern().isEmpty()) {
+        cost += 2;
+    }
 
-    const QList<Entry*> entryList = group->entries();
-    for (Entry* entry : entryList) {
-       searchResult.append(matchEntry(searchTerm, entry, caseSensitivity));
+    // negated terms rarely rule out an entry
+    if (term.exclude) {
+        cost += 10;
+    }
+
+    return cost;
+}
+
+void EntrySearcher::collectCandidates(const Group* group, QVector<Candidate>& candidates)
+{
+    if (!m_useCandidates || m_candidateGroups.contains(group)) {
+        const QList<Entry*> entryList = group->entries();
+        for (Entry* entry : entryList) {
+            if (!m_useCandidates || m_candidates.contains(entry)) {
+                Candidate candidate = { entry, false };
+                candidates.append(candidate);
+            }
+        }
     }
 
     const QList<Group*> children = group->children();
     for (Group* childGroup : children) {
         if (childGroup->searchingEnabled() != Group::Disable) {
-            if (matchGroup(searchTerm, childGroup, caseSensitivity)) {
-                searchResult.append(childGroup->entriesRecursive());
+            if (matchGroup(childGroup)) {
+                const QList<Entry*> entryList = childGroup->entriesRecursive();
+                for (Entry* entry : entryList) {
+                    Candidate candidate = { entry, true };
+                    candidates.append(candidate);
+                }
             } else {
-                searchResult.append(searchEntries(searchTerm, childGroup, caseSensitivity));
+                collectCandidates(childGroup, candidates);
             }
         }
     }
+}
 
-    return searchResult;
+QList<Entry*> EntrySearcher::matchCandidates(const QVector<Candidate>& candidates, int begin, int end) const
+{
+    QList<Entry*> result;
+    for (int i = begin; i < end; ++i) {
+        if (candidates[i].matched || matchEntry(candidates[i].entry)) {
+            result.append(candidates[i].entry);
+        }
+    }
+    return result;
 }
 
-QList<Entry*> EntrySearcher::matchEntry(const QString& searchTerm, Entry* entry,
-                                        Qt::CaseSensitivity caseSensitivity)
+bool EntrySearcher::matchEntry(const Entry* entry) const
 {
-    const QStringList wordList = searchTerm.split(QRegExp("\\s"), QString::SkipEmptyParts);
-    for (const QString& word : wordList) {
-        if (!wordMatch(word, entry, caseSensitivity)) {
-            return QList<Entry*>();
+    for (const SearchTerm& term : asConst(m_terms)) {
+        if (termMatch(term, entry) == term.exclude) {
+            return false;
         }
     }
 
-    return QList<Entry*>() << entry;
+    return true;
 }
 
-bool EntrySearcher::wordMatch(const QString& word, Entry* entry, Qt::CaseSensitivity caseSensitivity)
+bool EntrySearcher::termMatch(const SearchTerm& term, const Entry* entry) const
 {
-    return entry->resolvePlaceholder(entry->title()).contains(word, caseSensitivity) ||
-            entry->resolvePlaceholder(entry->username()).contains(word, caseSensitivity) ||
-            entry->resolvePlaceholder(entry->url()).contains(word, caseSensitivity) ||
-            entry->resolvePlaceholder(entry->notes()).contains(word, caseSensitivity);
+    switch (term.field) {
+    case Field::Title:
+        return wordMatch(term, fieldValue(entry, entry->title()));
+    case Field::Username:
+        return wordMatch(term, fieldValue(entry, entry->username()));
+    case Field::Password:
+        return wordMatch(term, fieldValue(entry, entry->password()));
+    case Field::Url:
+        return wordMatch(term, fieldValue(entry, entry->url()));
+    case Field::Notes:
+        return wordMatch(term, fieldValue(entry, entry->notes()));
+    case Field::Tags:
+        return wordMatch(term, entry->tags());
+    case Field::Group:
+        return entry->group() && wordMatch(term, entry->group()->name());
+    case Field::Expired:
+        return entry->isExpired();
+    case Field::Totp:
+        return entry->hasTotp();
+    case Field::Undefined:
+        return wordMatch(term, fieldValue(entry, entry->title()))
+                || wordMatch(term, fieldValue(entry, entry->username()))
+                || wordMatch(term, fieldValue(entry, entry->url()))
+                || wordMatch(term, fieldValue(entry, entry->notes()));
+    }
+
+    return false;
 }
 
-bool EntrySearcher::matchGroup(const QString& searchTerm, const Group* group, Qt::CaseSensitivity caseSensitivity)
+bool EntrySearcher::wordMatch(const SearchTerm& term, const QString& text) const
 {
-    const QStringList wordList = searchTerm.split(QRegExp("\\s"), QString::SkipEmptyParts);
-    for (const QString& word : wordList) {
-        if (!wordMatch(word, group, caseSensitivity)) {
-            return false;
-        }
+    if (!term.regex.pattern().isEmpty()) {
+        return term.regex.match(text).hasMatch();
     }
 
-    return true;
+    return text.contains(term.word, m_caseSensitivity);
 }
 
-bool EntrySearcher::wordMatch(const QString& word, const Group* group, Qt::CaseSensitivity caseSensitivity)
+bool EntrySearcher::matchGroup(const Group* group) const
 {
-    return group->name().contains(word, caseSensitivity) ||
-            group->notes().contains(word, caseSensitivity);
+    if (!m_matchGroups) {
+        return false;
+    }
+
+    for (const SearchTerm& term : asConst(m_terms)) {
+        if (!wordMatch(term, group->name()) && !wordMatch(term, group->notes())) {
+            return false;
+        }
+    }
+
+    return true;
 }
@@ -19,23 +19,87 @@
 #ifndef KEEPASSX_ENTRYSEARCHER_H
 #define KEEPASSX_ENTRYSEARCHER_H
 
+#include <QRegularExpression>
+#include <QSet>
 #include <QString>
+#include <QStringList>
+#include <QVector>
 
 
 class Group;
 class Entry;
 
+/**
+ * Searches the entries of a group tree.
+ *
+ * A search term consists of words and "quoted phrases" which all have to
+ * match. They can be restricted to a field with title:, user:, pw:, url:,
+ * notes:, tags: or group:, negated with a leading '-' and contain '*' as
+ * wildcard, which then has to match the whole field. is:expired and
+ * has:totp match entry properties. Plain words are looked up in the title,
+ * username, URL and notes; if all of them match the name or notes of a
+ * group the whole group matches.
+ *
+ * Large trees are matched in chunks on the global thread pool, the results
+ * keep the order of the tree.
+ */
 class EntrySearcher
 {
 public:
+    EntrySearcher();
+
     QList<Entry*> search(const QString& searchTerm, const Group* group, Qt::CaseSensitivity caseSensitivity);
 
 private:
-    QList<Entry*> searchEntries(const QString& searchTerm, const Group* group, Qt::CaseSensitivity caseSensitivity);
-    QList<Entry*> matchEntry(const QString& searchTerm, Entry* entry, Qt::CaseSensitivity caseSensitivity);
-    bool wordMatch(const QString& word, Entry* entry, Qt::CaseSensitivity caseSensitivity);
-    bool matchGroup(const QString& searchTerm, const Group* group, Qt::CaseSensitivity caseSensitivity);
-    bool wordMatch(const QString& word, const Group* group, Qt::CaseSensitivity caseSensitivity);
+    enum class Field
+    {
+        Undefined,
+        Title,
+        Username,
+        Password,
+        Url,
+        Notes,
+        Tags,
+        Group,
+        Expired,
+        Totp
+    };
+
+    struct SearchTerm
+    {
+        Field field;
+        QString word;
+        // only set for words with wildcards
+        QRegularExpression regex;
+        bool exclude;
+    };
+
+    QList<SearchTerm> parseSearchTerms(const QString& searchTerm, Qt::CaseSensitivity caseSensitivity);
+    static Field fieldByName(const QString& name, const QString& value);
+    static int termCost(const SearchTerm& term);
+    struct Candidate
+    {
+        Entry* entry;
+        // the entry is part of a matching group
+        bool matched;
+    };
+
+    void collectCandidates(const Group* group, QVector<Candidate>& candidates);
+    QList<Entry*> matchCandidates(const QVector<Candidate>& candidates, int begin, int end) const;
+    bool matchEntry(const Entry* entry) const;
+    bool termMatch(const SearchTerm& term, const Entry* entry) const;
+    bool wordMatch(const SearchTerm& term, const QString& text) const;
+    bool matchGroup(const Group* group) const;
+
+    QList<SearchTerm> m_terms;
+    Qt::CaseSensitivity m_caseSensitivity;
+    // plain words only, they can match groups as well
+    bool m_matchGroups;
+
+    // entries the database search index didn't rule out, only used if m_useCandidates is set
+    QSet<const Entry*> m_candidates;
+    QSet<const Group*> m_candidateGroups;
+    bool m_useCandidates;
 };
 
 #endif // KEEPASSX_ENTRYSEARCHER_H
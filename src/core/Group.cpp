@@ -248,7 +248,10 @@ bool Group::isExpired() const
 
 void Group::setUuid(const Uuid& uuid)
 {
-    set(m_uuid, uuid);
+    Uuid oldUuid = m_uuid;
+    if (set(m_uuid, uuid) && m_db) {
+        m_db->updateGroupUuid(this, oldUuid);
+    }
 }
 
 void Group::setName(const QString& name)
@@ -534,12 +537,25 @@ Entry* Group::findEntry(QString entryId)
 Entry* Group::findEntryByUuid(const Uuid& uuid)
 {
     Q_ASSERT(!uuid.isNull());
-    for (Entry* entry : entriesRecursive(false)) {
+
+    if (m_db) {
+        // the index covers the whole database, only accept entries below this group
+        return m_db->resolveEntryBelow(uuid, this);
+    }
+
+    for (Entry* entry : asConst(m_entries)) {
         if (entry->uuid() == uuid) {
             return entry;
         }
     }
 
+    for (Group* group : asConst(m_children)) {
+        Entry* entry = group->findEntryByUuid(uuid);
+        if (entry) {
+            return entry;
+        }
+    }
+
     return nullptr;
 }
 
@@ -674,22 +690,49 @@ QSet<Uuid> Group::customIconsRecursive() const
 
 void Group::merge(const Group* other)
 {
-
     Group* rootGroup = this;
     while (rootGroup->parentGroup()) {
         rootGroup = rootGroup->parentGroup();
     }
 
+    // look up everything in the tree by uuid once instead of searching it for
+    // every incoming item, the first one in tree order wins like with findEntryByUuid()
+    QHash<Uuid, Entry*> existingEntries;
+    const QList<Entry*> entryList = rootGroup->entriesRecursive();
+    for (Entry* entry : entryList) {
+        if (!existingEntries.contains(entry->uuid())) {
+            existingEntries.insert(entry->uuid(), entry);
+        }
+    }
+
+    QHash<Uuid, Group*> existingGroups;
+    const QList<Group*> groupList = rootGroup->groupsRecursive(true);
+    for (Group* group : groupList) {
+        if (!existingGroups.contains(group->uuid())) {
+            existingGroups.insert(group->uuid(), group);
+        }
+    }
+
+    mergeRecursive(other, existingEntries, existingGroups);
+
+    emit modified();
+}
+
+void Group::mergeRecursive(const Group* other, QHash<Uuid, Entry*>& existingEntries,
+                           QHash<Uuid, Group*>& existingGroups)
+{
     // merge entries
     const QList<Entry*> dbEntries = other->entries();
     for (Entry* entry : dbEntries) {
 
-        Entry* existingEntry = rootGroup->findEntryByUuid(entry->uuid());
+        Entry* existingEntry = existingEntries.value(entry->uuid());
 
         if (!existingEntry) {
             // This entry does not exist at all. Create it.
             qDebug("New entry %s detected. Creating it.", qPrintable(entry->title()));
-            entry->clone(Entry::CloneIncludeHistory)->setGroup(this);
+            Entry* newEntry = entry->clone(Entry::CloneIncludeHistory);
+            newEntry->setGroup(this);
+            existingEntries.insert(newEntry->uuid(), newEntry);
         } else {
             // Entry is already present in the database. Update it.
             bool locationChanged = existingEntry->timeInfo().locationChanged() < entry->timeInfo().locationChanged();
@@ -697,7 +740,7 @@ void Group::merge(const Group* other)
                 existingEntry->setGroup(this);
                 qDebug("Location changed for entry %s. Updating it", qPrintable(existingEntry->title()));
             }
-            resolveEntryConflict(existingEntry, entry);
+            existingEntries.insert(entry->uuid(), resolveEntryConflict(existingEntry, entry));
         }
     }
 
@@ -705,13 +748,14 @@ void Group::merge(const Group* other)
     const QList<Group*> dbChildren = other->children();
     for (Group* group : dbChildren) {
 
-        Group* existingGroup = rootGroup->findChildByUuid(group->uuid());
+        Group* existingGroup = existingGroups.value(group->uuid());
 
         if (!existingGroup) {
             qDebug("New group %s detected. Creating it.", qPrintable(group->name()));
             Group* newGroup = group->clone(Entry::CloneNoFlags, Group::CloneNoFlags);
             newGroup->setParent(this);
-            newGroup->merge(group);
+            existingGroups.insert(newGroup->uuid(), newGroup);
+            newGroup->mergeRecursive(group, existingEntries, existingGroups);
         } else {
             bool locationChanged = existingGroup->timeInfo().locationChanged() < group->timeInfo().locationChanged();
             if (locationChanged && existingGroup->parent() != this) {
@@ -719,20 +763,28 @@ void Group::merge(const Group* other)
                 qDebug("Location changed for group %s. Updating it", qPrintable(existingGroup->name()));
             }
             resolveGroupConflict(existingGroup, group);
-            existingGroup->merge(group);
+            existingGroup->mergeRecursive(group, existingEntries, existingGroups);
         }
 
     }
-
-    emit modified();
 }
 
 Group* Group::findChildByUuid(const Uuid& uuid)
 {
     Q_ASSERT(!uuid.isNull());
-    for (Group* group : groupsRecursive(true)) {
-        if (group->uuid() == uuid) {
-            return group;
+
+    if (m_db) {
+        return m_db->resolveGroupBelow(uuid, this);
+    }
+
+    if (m_uuid == uuid) {
+        return this;
+    }
+
+    for (Group* group : asConst(m_children)) {
+        Group* child = group->findChildByUuid(uuid);
+        if (child) {
+            return child;
         }
     }
 
@@ -840,6 +892,8 @@ void Group::recSetDatabase(Database* db)
         disconnect(SIGNAL(aboutToMove(Group*,Group*,int)), m_db);
         disconnect(SIGNAL(moved()), m_db);
         disconnect(SIGNAL(modified()), m_db);
+        disconnect(SIGNAL(entryAdded(Entry*)), m_db);
+        disconnect(SIGNAL(entryRemoved(Entry*)), m_db);
     }
 
     for (Entry* entry : asConst(m_entries)) {
@@ -860,6 +914,8 @@ void Group::recSetDatabase(Database* db)
         connect(this, SIGNAL(aboutToMove(Group*,Group*,int)), db, SIGNAL(groupAboutToMove(Group*,Group*,int)));
         connect(this, SIGNAL(moved()), db, SIGNAL(groupMoved()));
         connect(this, SIGNAL(modified()), db, SIGNAL(modifiedImmediate()));
+        connect(this, SIGNAL(entryAdded(Entry*)), db, SLOT(indexEntry(Entry*)));
+        connect(this, SIGNAL(entryRemoved(Entry*)), db, SLOT(unindexEntry(Entry*)));
     }
 
     m_db = db;
@@ -940,7 +996,7 @@ bool Group::resolveAutoTypeEnabled() const
     }
 }
 
-void Group::resolveEntryConflict(Entry* existingEntry, Entry* otherEntry)
+Entry* Group::resolveEntryConflict(Entry* existingEntry, Entry* otherEntry)
 {
     const QDateTime timeExisting = existingEntry->timeInfo().lastModificationTime();
     const QDateTime timeOther = otherEntry->timeInfo().lastModificationTime();
@@ -966,7 +1022,9 @@ void Group::resolveEntryConflict(Entry* existingEntry, Entry* otherEntry)
             // only if other entry is newer, replace existing one
             Group* currentGroup = existingEntry->group();
             currentGroup->removeEntry(existingEntry);
-            otherEntry->clone(Entry::CloneIncludeHistory)->setGroup(currentGroup);
+            clonedEntry = otherEntry->clone(Entry::CloneIncludeHistory);
+            clonedEntry->setGroup(currentGroup);
+            return clonedEntry;
         }
 
         break;
@@ -976,6 +1034,8 @@ void Group::resolveEntryConflict(Entry* existingEntry, Entry* otherEntry)
         // do nothing
         break;
     }
+
+    return existingEntry;
 }
 
 void Group::resolveGroupConflict(Group* existingGroup, Group* otherGroup)
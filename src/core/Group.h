@@ -170,7 +170,9 @@ private:
     void removeEntry(Entry* entry);
     void setParent(Database* db);
     void markOlderEntry(Entry* entry);
-    void resolveEntryConflict(Entry* existingEntry, Entry* otherEntry);
+    Entry* resolveEntryConflict(Entry* existingEntry, Entry* otherEntry);
+    void mergeRecursive(const Group* other, QHash<Uuid, Entry*>& existingEntries,
+                        QHash<Uuid, Group*>& existingGroups);
     void resolveGroupConflict(Group* existingGroup, Group* otherGroup);
 
     void recSetDatabase(Database* db);
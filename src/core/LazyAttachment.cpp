@@ -0,0 +1,87 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LazyAttachment.h"
+
+#include <QBuffer>
+#include <QMutexLocker>
+
+#include "core/Tools.h"
+#include "streams/QtIOCompressor"
+
+LazyAttachment::LazyAttachment(const QByteArray& encoded, bool compressed)
+    : m_stored(QByteArray::fromBase64(encoded))
+    , m_compressed(compressed)
+    , m_decoded(false)
+    , m_valid(true)
+{
+}
+
+QByteArray LazyAttachment::data() const
+{
+    // attachments are read by the GUI and by background savers alike
+    QMutexLocker locker(&m_mutex);
+
+    if (m_decoded) {
+        return m_data;
+    }
+
+    if (m_compressed) {
+        QBuffer buffer;
+        buffer.setData(m_stored);
+        buffer.open(QIODevice::ReadOnly);
+
+        QtIOCompressor compressor(&buffer);
+        compressor.setStreamFormat(QtIOCompressor::GzipFormat);
+        compressor.open(QIODevice::ReadOnly);
+
+        if (!Tools::readAllFromDevice(&compressor, m_data)) {
+            qWarning("LazyAttachment::data: unable to decompress attachment");
+            m_data.clear();
+            m_valid = false;
+        }
+    } else {
+        m_data = m_stored;
+    }
+
+    m_decoded = true;
+    return m_data;
+}
+
+bool LazyAttachment::isValid() const
+{
+    data();
+
+    QMutexLocker locker(&m_mutex);
+    return m_valid;
+}
+
+QByteArray LazyAttachment::encoded() const
+{
+    return m_stored.toBase64();
+}
+
+bool LazyAttachment::isCompressed() const
+{
+    return m_compressed;
+}
+
+bool LazyAttachment::isDecoded() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_decoded;
+}
@@ -0,0 +1,65 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_LAZYATTACHMENT_H
+#define KEEPASSX_LAZYATTACHMENT_H
+
+#include <QByteArray>
+#include <QMutex>
+
+/**
+ * Attachment data as found in the binary pool of a KDBX 3 file: base64
+ * encoded and optionally gzip compressed. Only the base64 decoding is done
+ * upfront, the stored bytes are decompressed on first access and cached;
+ * writers can copy the stored form as long as nobody replaced the attachment.
+ */
+class LazyAttachment
+{
+public:
+    LazyAttachment(const QByteArray& encoded, bool compressed);
+
+    /**
+     * Returns the decoded data. A corrupted attachment decodes to an empty
+     * array, since it's only detected after the database has been opened.
+     */
+    QByteArray data() const;
+    /**
+     * Returns false if the attachment is corrupted. Writers must not save
+     * the empty data in place of it, only the encoded form can be kept.
+     */
+    bool isValid() const;
+    /**
+     * Returns the stored form encoded as base64 again, it's only built for
+     * the writers, the base64 text itself isn't kept.
+     */
+    QByteArray encoded() const;
+    bool isCompressed() const;
+    bool isDecoded() const;
+
+private:
+    Q_DISABLE_COPY(LazyAttachment)
+
+    // base64 decoded but still compressed, m_data shares it for uncompressed attachments
+    const QByteArray m_stored;
+    const bool m_compressed;
+    mutable QMutex m_mutex;
+    mutable QByteArray m_data;
+    mutable bool m_decoded;
+    mutable bool m_valid;
+};
+
+#endif // KEEPASSX_LAZYATTACHMENT_H
@@ -87,6 +87,28 @@ void Metadata::copyAttributesFrom(const Metadata* other)
     m_data = other->m_data;
 }
 
+void Metadata::copySnapshotFrom(const Metadata* other, Group* rootGroup)
+{
+    m_data = other->m_data;
+
+    m_customIcons = other->m_customIcons;
+    m_customIconsOrder = other->m_customIconsOrder;
+    m_customIconsHashes = other->m_customIconsHashes;
+
+    auto findGroup = [rootGroup](const Group* group) -> Group* {
+        return group ? rootGroup->findChildByUuid(group->uuid()) : nullptr;
+    };
+    m_recycleBin = findGroup(other->m_recycleBin);
+    m_recycleBinChanged = other->m_recycleBinChanged;
+    m_entryTemplatesGroup = findGroup(other->m_entryTemplatesGroup);
+    m_entryTemplatesGroupChanged = other->m_entryTemplatesGroupChanged;
+    m_lastSelectedGroup = findGroup(other->m_lastSelectedGroup);
+    m_lastTopVisibleGroup = findGroup(other->m_lastTopVisibleGroup);
+
+    m_masterKeyChanged = other->m_masterKeyChanged;
+    m_customFields = other->m_customFields;
+}
+
 QString Metadata::generator() const
 {
     return m_data.generator;
@@ -143,6 +143,11 @@ public:
      * - Custom fields
      */
     void copyAttributesFrom(const Metadata* other);
+    /*
+     * Copy all attributes from other, group pointers are resolved
+     * by uuid below rootGroup.
+     */
+    void copySnapshotFrom(const Metadata* other, Group* rootGroup);
 
 signals:
     void nameTextChanged();
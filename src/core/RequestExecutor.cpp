@@ -0,0 +1,161 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RequestExecutor.h"
+
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+
+namespace
+{
+    const int WaitInterval = 10;
+
+    class RequestTask : public QRunnable
+    {
+    public:
+        RequestTask(QObject* executor, uint id, const RequestExecutor::Request& request)
+            : m_executor(executor)
+            , m_id(id)
+            , m_request(request)
+        {
+        }
+
+        void run() override
+        {
+            QByteArray reply = m_request();
+            QMetaObject::invokeMethod(m_executor, "finishRequest", Qt::QueuedConnection,
+                                      Q_ARG(uint, m_id), Q_ARG(QByteArray, reply));
+        }
+
+    private:
+        QObject* const m_executor;
+        const uint m_id;
+        const RequestExecutor::Request m_request;
+    };
+}
+
+RequestExecutor::RequestExecutor(QObject* parent)
+    : QObject(parent)
+    , m_nextId(0)
+{
+}
+
+RequestExecutor::~RequestExecutor()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_pendingRequests.clear();
+        m_clients.clear();
+    }
+
+    // running requests may be waiting for calls to this thread
+    while (!m_pool.waitForDone(WaitInterval)) {
+        QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+    }
+}
+
+void RequestExecutor::submit(const void* client, const Request& request, const ReplyCallback& callback)
+{
+    PendingRequest pending;
+    pending.request = request;
+    pending.callback = callback;
+
+    bool start;
+    {
+        QMutexLocker locker(&m_mutex);
+        pending.id = m_nextId++;
+
+        QQueue<PendingRequest>& pendingRequests = m_pendingRequests[client];
+        pendingRequests.enqueue(pending);
+        m_clients.insert(pending.id, client);
+        start = pendingRequests.size() == 1;
+    }
+
+    if (start) {
+        startRequest(pending);
+    }
+}
+
+void RequestExecutor::cancel(const void* client)
+{
+    QMutexLocker locker(&m_mutex);
+    const QQueue<PendingRequest> pendingRequests = m_pendingRequests.take(client);
+    for (const PendingRequest& pending : pendingRequests) {
+        m_clients.remove(pending.id);
+    }
+}
+
+void RequestExecutor::waitForDone()
+{
+    Q_ASSERT(thread() == QThread::currentThread());
+
+    while (true) {
+        // a request has queued its reply by the time the pool is idle
+        if (m_pool.waitForDone(WaitInterval)) {
+            QMutexLocker locker(&m_mutex);
+            if (m_clients.isEmpty()) {
+                return;
+            }
+        }
+        QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+    }
+}
+
+void RequestExecutor::setMaxThreadCount(int count)
+{
+    m_pool.setMaxThreadCount(count);
+}
+
+void RequestExecutor::startRequest(const PendingRequest& pending)
+{
+    m_pool.start(new RequestTask(this, pending.id, pending.request));
+}
+
+void RequestExecutor::finishRequest(uint id, const QByteArray& reply)
+{
+    ReplyCallback callback;
+    PendingRequest next;
+    bool startNext = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_clients.contains(id)) {
+            // the client was cancelled
+            return;
+        }
+
+        const void* client = m_clients.take(id);
+        QQueue<PendingRequest>& pendingRequests = m_pendingRequests[client];
+        Q_ASSERT(!pendingRequests.isEmpty() && pendingRequests.head().id == id);
+        callback = pendingRequests.dequeue().callback;
+
+        if (pendingRequests.isEmpty()) {
+            m_pendingRequests.remove(client);
+        } else {
+            next = pendingRequests.head();
+            startNext = true;
+        }
+    }
+
+    if (startNext) {
+        startRequest(next);
+    }
+
+    // callbacks may submit further requests
+    callback(reply);
+}
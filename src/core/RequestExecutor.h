@@ -0,0 +1,88 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_REQUESTEXECUTOR_H
+#define KEEPASSX_REQUESTEXECUTOR_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QQueue>
+#include <QThreadPool>
+
+#include <functional>
+
+/**
+ * Runs the requests of the browser integrations on a pool of worker threads,
+ * so a slow client doesn't hold up the others. The requests of one client
+ * run one after another in the order they were submitted, as they may
+ * depend on each other, e.g. on keys exchanged by an earlier request. The
+ * replies are handed to callbacks on the thread of the executor.
+ */
+class RequestExecutor : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<QByteArray()> Request;
+    typedef std::function<void(const QByteArray& reply)> ReplyCallback;
+
+    explicit RequestExecutor(QObject* parent = nullptr);
+    ~RequestExecutor();
+
+    /**
+     * Runs request on a worker thread once the earlier requests of client
+     * are done and passes its reply to callback. May be called from any thread.
+     */
+    void submit(const void* client, const Request& request, const ReplyCallback& callback);
+    /**
+     * Drops the requests of client that haven't run yet and the replies that
+     * haven't been delivered, e.g. when its connection is closed.
+     */
+    void cancel(const void* client);
+    /**
+     * Blocks until all requests have finished and their replies have been
+     * delivered. Calls the requests make to this thread, e.g. to show a
+     * dialog, are processed meanwhile.
+     */
+    void waitForDone();
+    void setMaxThreadCount(int count);
+
+private slots:
+    void finishRequest(uint id, const QByteArray& reply);
+
+private:
+    struct PendingRequest
+    {
+        uint id;
+        Request request;
+        ReplyCallback callback;
+    };
+
+    void startRequest(const PendingRequest& pending);
+
+    QThreadPool m_pool;
+    QMutex m_mutex;
+    uint m_nextId;
+    // requests by client, the first one of each client is running
+    QHash<const void*, QQueue<PendingRequest>> m_pendingRequests;
+    QHash<uint, const void*> m_clients;
+};
+
+#endif // KEEPASSX_REQUESTEXECUTOR_H
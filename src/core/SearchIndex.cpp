@@ -0,0 +1,201 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SearchIndex.h"
+
+#include <algorithm>
+
+#include "core/Entry.h"
+#include "core/Global.h"
+
+namespace {
+    bool isPlaceholder(const QString& text)
+    {
+        return text.startsWith('{') && text.endsWith('}');
+    }
+
+    bool hasSurrogates(const QString& text)
+    {
+        for (const QChar& c : text) {
+            if (c.isSurrogate()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool lessBySize(const QSet<const Entry*>* a, const QSet<const Entry*>* b)
+    {
+        return a->size() < b->size();
+    }
+}
+
+SearchIndex::SearchIndex()
+    : m_built(false)
+{
+}
+
+bool SearchIndex::isBuilt() const
+{
+    return m_built;
+}
+
+void SearchIndex::build(const QList<Entry*>& entries)
+{
+    clear();
+
+    for (const Entry* entry : entries) {
+        indexEntry(entry);
+    }
+
+    m_built = true;
+}
+
+void SearchIndex::clear()
+{
+    m_built = false;
+    m_postings.clear();
+    m_entryTrigrams.clear();
+    m_unindexedEntries.clear();
+    m_dirtyEntries.clear();
+}
+
+void SearchIndex::updateEntry(const Entry* entry)
+{
+    if (m_built) {
+        m_dirtyEntries.insert(entry);
+    }
+}
+
+void SearchIndex::removeEntry(const Entry* entry)
+{
+    if (m_built) {
+        m_dirtyEntries.remove(entry);
+        unindexEntry(entry);
+    }
+}
+
+bool SearchIndex::candidates(const QStringList& words, QSet<const Entry*>* result)
+{
+    Q_ASSERT(m_built);
+
+    indexDirtyEntries();
+
+    QVector<const QSet<const Entry*>*> postings;
+    bool missing = false;
+    for (const QString& word : words) {
+        // supplementary characters are case folded as a pair, which the
+        // trigrams of single code units can't express
+        const QVector<quint64> wordTrigrams = hasSurrogates(word) ? QVector<quint64>() : trigrams(word);
+        for (quint64 trigram : wordTrigrams) {
+            QHash<quint64, QSet<const Entry*>>::const_iterator i = m_postings.constFind(trigram);
+            if (i == m_postings.constEnd()) {
+                missing = true;
+            } else {
+                postings.append(&i.value());
+            }
+        }
+    }
+
+    if (postings.isEmpty() && !missing) {
+        return false;
+    }
+
+    result->clear();
+    if (!missing) {
+        // start with the rarest trigram, intersect() iterates over the left side
+        std::sort(postings.begin(), postings.end(), lessBySize);
+        *result = *postings.first();
+        for (int i = 1; i < postings.size() && !result->isEmpty(); ++i) {
+            result->intersect(*postings[i]);
+        }
+    }
+
+    result->unite(m_unindexedEntries);
+    return true;
+}
+
+void SearchIndex::indexEntry(const Entry* entry)
+{
+    const QString fields[] = { entry->title(), entry->username(), entry->url(), entry->notes() };
+
+    bool hasPlaceholder = false;
+    QString text;
+    for (const QString& field : fields) {
+        hasPlaceholder = hasPlaceholder || isPlaceholder(field);
+        // keep trigrams from spanning two fields, search phrases never contain a line break
+        text.append(field);
+        text.append('\n');
+    }
+
+    if (hasPlaceholder) {
+        m_unindexedEntries.insert(entry);
+        return;
+    }
+
+    const QVector<quint64> entryTrigrams = trigrams(text);
+    for (quint64 trigram : entryTrigrams) {
+        m_postings[trigram].insert(entry);
+    }
+    m_entryTrigrams.insert(entry, entryTrigrams);
+}
+
+void SearchIndex::unindexEntry(const Entry* entry)
+{
+    m_unindexedEntries.remove(entry);
+
+    const QVector<quint64> entryTrigrams = m_entryTrigrams.take(entry);
+    for (quint64 trigram : entryTrigrams) {
+        QHash<quint64, QSet<const Entry*>>::iterator i = m_postings.find(trigram);
+        Q_ASSERT(i != m_postings.end());
+        i.value().remove(entry);
+        if (i.value().isEmpty()) {
+            m_postings.erase(i);
+        }
+    }
+}
+
+void SearchIndex::indexDirtyEntries()
+{
+    for (const Entry* entry : asConst(m_dirtyEntries)) {
+        unindexEntry(entry);
+        indexEntry(entry);
+    }
+    m_dirtyEntries.clear();
+}
+
+QVector<quint64> SearchIndex::trigrams(const QString& text)
+{
+    QSet<quint64> result;
+
+    // QString::contains() folds case per code unit as well, words with
+    // surrogates aren't looked up so trigrams don't need to span them
+    quint64 trigram = 0;
+    int length = 0;
+    for (const QChar& c : text) {
+        if (c.isSurrogate()) {
+            length = 0;
+        } else {
+            trigram = ((trigram << 16) | c.toCaseFolded().unicode()) & Q_UINT64_C(0xFFFFFFFFFFFF);
+            if (++length >= 3) {
+                result.insert(trigram);
+            }
+        }
+    }
+
+    return result.toList().toVector();
+}
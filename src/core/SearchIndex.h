@@ -0,0 +1,72 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_SEARCHINDEX_H
+#define KEEPASSX_SEARCHINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+class Entry;
+
+/**
+ * Trigram inverted index over the fields EntrySearcher matches against.
+ *
+ * The index only narrows a search down to the entries that may contain
+ * the words, the searcher still checks every candidate. Text is case
+ * folded so the same index serves case sensitive and insensitive searches.
+ */
+class SearchIndex
+{
+public:
+    SearchIndex();
+
+    bool isBuilt() const;
+    void build(const QList<Entry*>& entries);
+    void clear();
+
+    /**
+     * Queues an added or modified entry, it is indexed again on the next query.
+     */
+    void updateEntry(const Entry* entry);
+    void removeEntry(const Entry* entry);
+
+    /**
+     * Collects the entries that might contain all of the words. Returns false
+     * if none of the words is long enough to rule out any entry.
+     */
+    bool candidates(const QStringList& words, QSet<const Entry*>* result);
+
+private:
+    void indexEntry(const Entry* entry);
+    void unindexEntry(const Entry* entry);
+    void indexDirtyEntries();
+
+    static QVector<quint64> trigrams(const QString& text);
+
+    bool m_built;
+    QHash<quint64, QSet<const Entry*>> m_postings;
+    QHash<const Entry*, QVector<quint64>> m_entryTrigrams;
+    // fields consisting of a placeholder resolve to text of other entries
+    QSet<const Entry*> m_unindexedEntries;
+    QSet<const Entry*> m_dirtyEntries;
+};
+
+#endif // KEEPASSX_SEARCHINDEX_H
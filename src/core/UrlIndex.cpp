@@ -0,0 +1,217 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UrlIndex.h"
+
+#include <QUrl>
+
+#include "core/Entry.h"
+#include "core/Global.h"
+
+namespace
+{
+    // generic second level labels under country code domains, e.g. co.uk or com.au,
+    // a short list instead of the whole public suffix list
+    const char* const SecondLevelSuffixes[] = {
+        "ac", "co", "com", "edu", "gob", "gov", "govt", "ltd", "me", "mil",
+        "ne", "net", "nhs", "nic", "nom", "or", "org", "plc", "sch"
+    };
+
+    bool isPublicSuffix(const QString& label, const QString& topLevelDomain)
+    {
+        if (topLevelDomain.size() != 2) {
+            return false;
+        }
+
+        for (const char* suffix : SecondLevelSuffixes) {
+            if (label == QLatin1String(suffix)) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+UrlIndex::UrlIndex()
+    : m_built(false)
+{
+}
+
+bool UrlIndex::isBuilt() const
+{
+    return m_built;
+}
+
+void UrlIndex::build(const QList<Entry*>& entries)
+{
+    clear();
+
+    for (Entry* entry : entries) {
+        indexEntry(entry);
+    }
+
+    m_built = true;
+}
+
+void UrlIndex::clear()
+{
+    m_built = false;
+    m_hosts.clear();
+    m_entryHosts.clear();
+    m_entryUrls.clear();
+    m_dirtyEntries.clear();
+    m_dirtyOrder.clear();
+}
+
+void UrlIndex::updateEntry(Entry* entry)
+{
+    if (m_built && !m_dirtyEntries.contains(entry)) {
+        m_dirtyEntries.insert(entry);
+        m_dirtyOrder.append(entry);
+    }
+}
+
+void UrlIndex::removeEntry(Entry* entry)
+{
+    if (m_built) {
+        if (m_dirtyEntries.remove(entry)) {
+            m_dirtyOrder.removeOne(entry);
+        }
+        unindexEntry(entry);
+    }
+}
+
+QList<Entry*> UrlIndex::entries(const QString& host)
+{
+    Q_ASSERT(m_built);
+
+    indexDirtyEntries();
+
+    return m_hosts.value(host.toLower());
+}
+
+UrlIndex::EntryUrl UrlIndex::entryUrl(const Entry* entry)
+{
+    indexDirtyEntries();
+
+    QHash<const Entry*, EntryUrl>::const_iterator i = m_entryUrls.constFind(entry);
+    if (i != m_entryUrls.constEnd()) {
+        return i.value();
+    }
+
+    return parseUrl(entry->url());
+}
+
+UrlIndex::EntryUrl UrlIndex::parseUrl(const QString& url)
+{
+    QUrl parsedUrl(url);
+    if (parsedUrl.scheme().isEmpty()) {
+        parsedUrl.setScheme("http");
+    }
+
+    EntryUrl entryUrl;
+    entryUrl.url = parsedUrl.toString(QUrl::StripTrailingSlash);
+    entryUrl.baseUrl = parsedUrl.toString(QUrl::StripTrailingSlash | QUrl::RemovePath
+                                          | QUrl::RemoveQuery | QUrl::RemoveFragment);
+    return entryUrl;
+}
+
+QString UrlIndex::entryHost(const QString& text)
+{
+    const QString value = text.trimmed();
+    // placeholders refer to other entries, which don't update this one
+    if (value.isEmpty() || value.startsWith('{')) {
+        return QString();
+    }
+
+    // a bare host name like example.com/login has no scheme
+    QUrl url(value.contains("://") ? value : QString("http://").append(value));
+    return url.host().toLower();
+}
+
+QStringList UrlIndex::hostKeys(const QString& host)
+{
+    QString key = host.toLower();
+    QStringList keys;
+    if (key.isEmpty()) {
+        return keys;
+    }
+    keys.append(key);
+
+    // IP addresses have no parent domains
+    bool ok;
+    key.mid(key.lastIndexOf('.') + 1).toInt(&ok);
+    if (ok) {
+        return keys;
+    }
+
+    // parent domains down to the registrable domain, public suffixes like com or
+    // co.uk would match unrelated sites
+    const QStringList labels = key.split('.');
+    int minLabels = 2;
+    if (labels.size() >= 3 && isPublicSuffix(labels.at(labels.size() - 2), labels.last())) {
+        minLabels = 3;
+    }
+    for (int i = 1; labels.size() - i >= minLabels; ++i) {
+        keys.append(QStringList(labels.mid(i)).join('.'));
+    }
+
+    return keys;
+}
+
+void UrlIndex::indexEntry(Entry* entry)
+{
+    QStringList hosts;
+    const QString fields[] = { entry->title(), entry->url() };
+    for (const QString& field : fields) {
+        QString host = entryHost(field);
+        if (!host.isEmpty() && !hosts.contains(host)) {
+            hosts.append(host);
+            m_hosts[host].append(entry);
+        }
+    }
+
+    if (!hosts.isEmpty()) {
+        m_entryHosts.insert(entry, hosts);
+        m_entryUrls.insert(entry, parseUrl(entry->url()));
+    }
+}
+
+void UrlIndex::unindexEntry(Entry* entry)
+{
+    const QStringList hosts = m_entryHosts.take(entry);
+    for (const QString& host : hosts) {
+        QHash<QString, QList<Entry*>>::iterator i = m_hosts.find(host);
+        if (i != m_hosts.end()) {
+            i.value().removeOne(entry);
+            if (i.value().isEmpty()) {
+                m_hosts.erase(i);
+            }
+        }
+    }
+    m_entryUrls.remove(entry);
+}
+
+void UrlIndex::indexDirtyEntries()
+{
+    for (Entry* entry : asConst(m_dirtyOrder)) {
+        unindexEntry(entry);
+        indexEntry(entry);
+    }
+    m_dirtyEntries.clear();
+    m_dirtyOrder.clear();
+}
@@ -0,0 +1,92 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_URLINDEX_H
+#define KEEPASSX_URLINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QStringList>
+
+class Entry;
+
+/**
+ * Index of the hosts entries refer to in their URL or title, used to find
+ * the credentials for a website.
+ *
+ * Titles and URLs are parsed once when an entry changes. Entries are looked
+ * up by their exact host, callers walk the parent domains returned by
+ * hostKeys() and stop at the most specific one with matches, so an entry for
+ * example.com matches login.example.com unless there are entries for
+ * login.example.com itself.
+ */
+class UrlIndex
+{
+public:
+    struct EntryUrl
+    {
+        // the entry URL with http as default scheme and without trailing slash
+        QString url;
+        // the same without path, query and fragment
+        QString baseUrl;
+    };
+
+    UrlIndex();
+
+    bool isBuilt() const;
+    void build(const QList<Entry*>& entries);
+    void clear();
+
+    /**
+     * Queues an added or modified entry, it is indexed again on the next query.
+     */
+    void updateEntry(Entry* entry);
+    void removeEntry(Entry* entry);
+
+    /**
+     * Returns the entries referring to exactly host, in the order they were
+     * indexed: the order of the entries passed to build(), followed by the
+     * entries changed since then in the order of their first change.
+     */
+    QList<Entry*> entries(const QString& host);
+    EntryUrl entryUrl(const Entry* entry);
+
+    static EntryUrl parseUrl(const QString& url);
+    static QString entryHost(const QString& text);
+    /**
+     * Returns host followed by its parent domains down to the registrable
+     * domain, e.g. example.com or example.co.uk. IP addresses have no parent
+     * domains.
+     */
+    static QStringList hostKeys(const QString& host);
+
+private:
+    void indexEntry(Entry* entry);
+    void unindexEntry(Entry* entry);
+    void indexDirtyEntries();
+
+    bool m_built;
+    QHash<QString, QList<Entry*>> m_hosts;
+    QHash<const Entry*, QStringList> m_entryHosts;
+    QHash<const Entry*, EntryUrl> m_entryUrls;
+    QSet<Entry*> m_dirtyEntries;
+    // the dirty entries in the order they were queued, keeps the lookups deterministic
+    QList<Entry*> m_dirtyOrder;
+};
+
+#endif // KEEPASSX_URLINDEX_H
@@ -100,6 +100,11 @@ bool Crypto::checkAlgorithms()
         qWarning("Crypto::checkAlgorithms: %s", qPrintable(m_errorStr));
         return false;
     }
+    if (gcry_md_test_algo(GCRY_MD_SHA512) != 0) {
+        m_errorStr = "GCRY_MD_SHA512 not found.";
+        qWarning("Crypto::checkAlgorithms: %s", qPrintable(m_errorStr));
+        return false;
+    }
 
     return true;
 }
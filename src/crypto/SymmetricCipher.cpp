@@ -18,6 +18,7 @@
 #include "SymmetricCipher.h"
 
 #include "config-keepassx.h"
+#include "crypto/SymmetricCipherAesNi.h"
 #include "crypto/SymmetricCipherGcrypt.h"
 
 SymmetricCipher::SymmetricCipher(SymmetricCipher::Algorithm algo, SymmetricCipher::Mode mode,
@@ -59,8 +60,15 @@ SymmetricCipherBackend* SymmetricCipher::createBackend(SymmetricCipher::Algorith
 {
     switch (algo) {
     case SymmetricCipher::Aes256:
+        if (mode == SymmetricCipher::Ecb && direction == SymmetricCipher::Encrypt
+                && SymmetricCipherAesNi::isSupported()) {
+            return new SymmetricCipherAesNi();
+        }
+        return new SymmetricCipherGcrypt(algo, mode, direction);
+
     case SymmetricCipher::Twofish:
     case SymmetricCipher::Salsa20:
+    case SymmetricCipher::ChaCha20:
         return new SymmetricCipherGcrypt(algo, mode, direction);
 
     default:
@@ -74,6 +82,11 @@ bool SymmetricCipher::reset()
     return m_backend->reset();
 }
 
+bool SymmetricCipher::hasInterleavedAesEcb()
+{
+    return SymmetricCipherAesNi::isSupported();
+}
+
 int SymmetricCipher::keySize() const
 {
     return m_backend->keySize();
@@ -93,6 +106,8 @@ SymmetricCipher::Algorithm SymmetricCipher::cipherToAlgorithm(Uuid cipher)
 {
     if (cipher == KeePass2::CIPHER_AES) {
         return SymmetricCipher::Aes256;
+    } else if (cipher == KeePass2::CIPHER_CHACHA20) {
+        return SymmetricCipher::ChaCha20;
     }
     else {
         return SymmetricCipher::Twofish;
@@ -104,7 +119,32 @@ Uuid SymmetricCipher::algorithmToCipher(SymmetricCipher::Algorithm algo)
     switch (algo) {
     case SymmetricCipher::Aes256:
         return KeePass2::CIPHER_AES;
+    case SymmetricCipher::ChaCha20:
+        return KeePass2::CIPHER_CHACHA20;
     default:
         return KeePass2::CIPHER_TWOFISH;
     }
 }
+
+int SymmetricCipher::algorithmIvSize(SymmetricCipher::Algorithm algo)
+{
+    switch (algo) {
+    case SymmetricCipher::ChaCha20:
+        return 12;
+    case SymmetricCipher::Salsa20:
+        return 8;
+    default:
+        return 16;
+    }
+}
+
+SymmetricCipher::Mode SymmetricCipher::algorithmMode(SymmetricCipher::Algorithm algo)
+{
+    switch (algo) {
+    case SymmetricCipher::ChaCha20:
+    case SymmetricCipher::Salsa20:
+        return SymmetricCipher::Stream;
+    default:
+        return SymmetricCipher::Cbc;
+    }
+}
@@ -32,7 +32,8 @@ public:
     {
         Aes256,
         Twofish,
-        Salsa20
+        Salsa20,
+        ChaCha20
     };
 
     enum Mode
@@ -74,8 +75,16 @@ public:
     int blockSize() const;
     QString errorString() const;
 
+    /**
+     * Whether AES-256 ECB encryption of several blocks in one call is
+     * interleaved in hardware, making it as fast as encrypting a single block.
+     */
+    static bool hasInterleavedAesEcb();
+
     static SymmetricCipher::Algorithm cipherToAlgorithm(Uuid cipher);
     static Uuid algorithmToCipher(SymmetricCipher::Algorithm algo);
+    static int algorithmIvSize(SymmetricCipher::Algorithm algo);
+    static SymmetricCipher::Mode algorithmMode(SymmetricCipher::Algorithm algo);
 
 private:
     static SymmetricCipherBackend* createBackend(SymmetricCipher::Algorithm algo, SymmetricCipher::Mode mode,
@@ -0,0 +1,255 @@
+/*
+*  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 2 or (at your option)
+*  version 3 of the License.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SymmetricCipherAesNi.h"
+
+#include <QObject>
+
+#if (defined(Q_CC_GNU) || defined(Q_CC_CLANG)) && (defined(Q_PROCESSOR_X86_64) || defined(Q_PROCESSOR_X86_32))
+#define KEEPASSX_AESNI_AVAILABLE
+#endif
+
+#ifdef KEEPASSX_AESNI_AVAILABLE
+
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <wmmintrin.h>
+
+#define AESNI_TARGET __attribute__((target("sse2,aes")))
+
+namespace
+{
+    const int RoundKeyCount = 15;
+    const int MaxLanes = 4;
+
+    AESNI_TARGET inline __m128i expandKeyEven(__m128i key, __m128i assist)
+    {
+        assist = _mm_shuffle_epi32(assist, 0xff);
+        key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+        key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+        key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+        return _mm_xor_si128(key, assist);
+    }
+
+    AESNI_TARGET inline __m128i expandKeyOdd(__m128i key, __m128i previous)
+    {
+        __m128i assist = _mm_shuffle_epi32(_mm_aeskeygenassist_si128(previous, 0x00), 0xaa);
+        key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+        key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+        key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+        return _mm_xor_si128(key, assist);
+    }
+
+    AESNI_TARGET void expandKey256(const char* key, __m128i* rk)
+    {
+        rk[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+        rk[1] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 16));
+
+        // _mm_aeskeygenassist_si128 requires the round constant to be an immediate
+        rk[2] = expandKeyEven(rk[0], _mm_aeskeygenassist_si128(rk[1], 0x01));
+        rk[3] = expandKeyOdd(rk[1], rk[2]);
+        rk[4] = expandKeyEven(rk[2], _mm_aeskeygenassist_si128(rk[3], 0x02));
+        rk[5] = expandKeyOdd(rk[3], rk[4]);
+        rk[6] = expandKeyEven(rk[4], _mm_aeskeygenassist_si128(rk[5], 0x04));
+        rk[7] = expandKeyOdd(rk[5], rk[6]);
+        rk[8] = expandKeyEven(rk[6], _mm_aeskeygenassist_si128(rk[7], 0x08));
+        rk[9] = expandKeyOdd(rk[7], rk[8]);
+        rk[10] = expandKeyEven(rk[8], _mm_aeskeygenassist_si128(rk[9], 0x10));
+        rk[11] = expandKeyOdd(rk[9], rk[10]);
+        rk[12] = expandKeyEven(rk[10], _mm_aeskeygenassist_si128(rk[11], 0x20));
+        rk[13] = expandKeyOdd(rk[11], rk[12]);
+        rk[14] = expandKeyEven(rk[12], _mm_aeskeygenassist_si128(rk[13], 0x40));
+    }
+
+    /**
+     * Encrypt Lanes independent blocks rounds times. Each AES round is issued
+     * for all lanes before moving on to the next one so that the latency of
+     * aesenc is hidden behind the other lanes.
+     */
+    template <int Lanes>
+    AESNI_TARGET void encryptLanes(char* data, const __m128i* rk, quint64 rounds)
+    {
+        __m128i b[Lanes];
+        for (int l = 0; l < Lanes; ++l) {
+            b[l] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * l));
+        }
+
+        for (quint64 i = 0; i != rounds; ++i) {
+            for (int l = 0; l < Lanes; ++l) {
+                b[l] = _mm_xor_si128(b[l], rk[0]);
+            }
+            for (int r = 1; r < RoundKeyCount - 1; ++r) {
+                for (int l = 0; l < Lanes; ++l) {
+                    b[l] = _mm_aesenc_si128(b[l], rk[r]);
+                }
+            }
+            for (int l = 0; l < Lanes; ++l) {
+                b[l] = _mm_aesenclast_si128(b[l], rk[RoundKeyCount - 1]);
+            }
+        }
+
+        for (int l = 0; l < Lanes; ++l) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data + 16 * l), b[l]);
+        }
+    }
+
+    AESNI_TARGET void encryptBlocks(char* data, int size, const char* roundKeys, quint64 rounds)
+    {
+        __m128i rk[RoundKeyCount];
+        for (int r = 0; r < RoundKeyCount; ++r) {
+            rk[r] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(roundKeys + 16 * r));
+        }
+
+        int blocks = size / 16;
+        while (blocks >= MaxLanes) {
+            encryptLanes<MaxLanes>(data, rk, rounds);
+            data += 16 * MaxLanes;
+            blocks -= MaxLanes;
+        }
+        if (blocks >= 2) {
+            encryptLanes<2>(data, rk, rounds);
+            data += 16 * 2;
+            blocks -= 2;
+        }
+        if (blocks == 1) {
+            encryptLanes<1>(data, rk, rounds);
+        }
+
+        for (int r = 0; r < RoundKeyCount; ++r) {
+            rk[r] = _mm_setzero_si128();
+        }
+    }
+}
+
+#endif // KEEPASSX_AESNI_AVAILABLE
+
+SymmetricCipherAesNi::SymmetricCipherAesNi()
+{
+}
+
+SymmetricCipherAesNi::~SymmetricCipherAesNi()
+{
+    m_roundKeys.fill('\0');
+}
+
+bool SymmetricCipherAesNi::isSupported()
+{
+#ifdef KEEPASSX_AESNI_AVAILABLE
+    static const bool supported = []() {
+        unsigned int eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+            return false;
+        }
+        return (ecx & bit_AES) && (edx & bit_SSE2);
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+bool SymmetricCipherAesNi::init()
+{
+    if (!isSupported()) {
+        m_errorString = QObject::tr("AES-NI is not supported by this CPU");
+        return false;
+    }
+
+    return true;
+}
+
+bool SymmetricCipherAesNi::setKey(const QByteArray& key)
+{
+    if (key.size() != keySize()) {
+        m_errorString = QObject::tr("Invalid key size");
+        return false;
+    }
+
+#ifdef KEEPASSX_AESNI_AVAILABLE
+    __m128i rk[RoundKeyCount];
+    expandKey256(key.constData(), rk);
+
+    m_roundKeys.resize(RoundKeyCount * 16);
+    for (int r = 0; r < RoundKeyCount; ++r) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(m_roundKeys.data() + 16 * r), rk[r]);
+        rk[r] = _mm_setzero_si128();
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool SymmetricCipherAesNi::setIv(const QByteArray& iv)
+{
+    // ECB doesn't use an IV
+    Q_UNUSED(iv);
+    return true;
+}
+
+QByteArray SymmetricCipherAesNi::process(const QByteArray& data, bool* ok)
+{
+    QByteArray result = data;
+    *ok = processInPlace(result, 1);
+    return result;
+}
+
+bool SymmetricCipherAesNi::processInPlace(QByteArray& data)
+{
+    return processInPlace(data, 1);
+}
+
+bool SymmetricCipherAesNi::processInPlace(QByteArray& data, quint64 rounds)
+{
+    if (m_roundKeys.isEmpty()) {
+        m_errorString = QObject::tr("Cipher key not set");
+        return false;
+    }
+
+    if (data.size() % blockSize() != 0) {
+        m_errorString = QObject::tr("Data size is not a multiple of the block size");
+        return false;
+    }
+
+#ifdef KEEPASSX_AESNI_AVAILABLE
+    encryptBlocks(data.data(), data.size(), m_roundKeys.constData(), rounds);
+    return true;
+#else
+    Q_UNUSED(rounds);
+    return false;
+#endif
+}
+
+bool SymmetricCipherAesNi::reset()
+{
+    return true;
+}
+
+int SymmetricCipherAesNi::keySize() const
+{
+    return 32;
+}
+
+int SymmetricCipherAesNi::blockSize() const
+{
+    return 16;
+}
+
+QString SymmetricCipherAesNi::errorString() const
+{
+    return m_errorString;
+}
@@ -0,0 +1,60 @@
+/*
+*  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 2 or (at your option)
+*  version 3 of the License.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEEPASSX_SYMMETRICCIPHERAESNI_H
+#define KEEPASSX_SYMMETRICCIPHERAESNI_H
+
+#include "crypto/SymmetricCipher.h"
+#include "crypto/SymmetricCipherBackend.h"
+
+/**
+ * AES-256 ECB encryption using the AES-NI instruction set.
+ *
+ * All blocks of a buffer are encrypted in an interleaved loop, so
+ * independent blocks (e.g. the two halves of the AES-KDF key) keep the
+ * AES pipeline of the CPU busy instead of waiting on each other.
+ * Only used when isSupported() returns true, libgcrypt is used otherwise.
+ */
+class SymmetricCipherAesNi : public SymmetricCipherBackend
+{
+public:
+    SymmetricCipherAesNi();
+    ~SymmetricCipherAesNi();
+
+    static bool isSupported();
+
+    bool init();
+    bool setKey(const QByteArray& key);
+    bool setIv(const QByteArray& iv);
+
+    QByteArray process(const QByteArray& data, bool* ok);
+    Q_REQUIRED_RESULT bool processInPlace(QByteArray& data);
+    Q_REQUIRED_RESULT bool processInPlace(QByteArray& data, quint64 rounds);
+
+    bool reset();
+    int keySize() const;
+    int blockSize() const;
+
+    QString errorString() const;
+
+private:
+    // 15 round keys of 16 bytes each
+    QByteArray m_roundKeys;
+    QString m_errorString;
+};
+
+#endif // KEEPASSX_SYMMETRICCIPHERAESNI_H
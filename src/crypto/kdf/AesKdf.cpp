@@ -0,0 +1,140 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AesKdf.h"
+
+#include <QElapsedTimer>
+#include <QtConcurrent>
+
+#include "crypto/CryptoHash.h"
+#include "crypto/SymmetricCipher.h"
+#include "format/KeePass2.h"
+
+AesKdf::AesKdf()
+    : Kdf(KeePass2::KDF_AES_KDBX3)
+{
+    m_rounds = 100000;
+}
+
+bool AesKdf::processParameters(const QVariantMap& p)
+{
+    bool ok;
+    quint64 rounds = p.value(KeePass2::KDFPARAM_AES_ROUNDS).toULongLong(&ok);
+    if (!ok || !setRounds(rounds)) {
+        return false;
+    }
+
+    QByteArray seed = p.value(KeePass2::KDFPARAM_AES_SEED).toByteArray();
+    return setSeed(seed);
+}
+
+QVariantMap AesKdf::writeParameters() const
+{
+    QVariantMap p;
+    p.insert(KeePass2::KDFPARAM_UUID, KeePass2::KDF_AES_KDBX4.toByteArray());
+    p.insert(KeePass2::KDFPARAM_AES_ROUNDS, rounds());
+    p.insert(KeePass2::KDFPARAM_AES_SEED, seed());
+    return p;
+}
+
+bool AesKdf::transform(const QByteArray& raw, QByteArray& result) const
+{
+    QByteArray transformed;
+
+    if (SymmetricCipher::hasInterleavedAesEcb()) {
+        // ECB encrypts both halves independently, so a single pipelined
+        // pass over the whole key yields the same result as two threads
+        if (!transformKeyRaw(raw, m_seed, m_rounds, &transformed)) {
+            return false;
+        }
+
+        result = CryptoHash::hash(transformed, CryptoHash::Sha256);
+        return true;
+    }
+
+    QByteArray resultLeft;
+    QByteArray resultRight;
+
+    QFuture<bool> future = QtConcurrent::run(transformKeyRaw, raw.left(16), m_seed, m_rounds, &resultLeft);
+    bool okRight = transformKeyRaw(raw.right(16), m_seed, m_rounds, &resultRight);
+    bool okLeft = future.result();
+
+    if (!okLeft || !okRight) {
+        return false;
+    }
+
+    transformed.append(resultLeft);
+    transformed.append(resultRight);
+
+    result = CryptoHash::hash(transformed, CryptoHash::Sha256);
+    return true;
+}
+
+bool AesKdf::transformKeyRaw(const QByteArray& key, const QByteArray& seed, quint64 rounds,
+                             QByteArray* result)
+{
+    QByteArray iv(16, 0);
+    SymmetricCipher cipher(SymmetricCipher::Aes256, SymmetricCipher::Ecb,
+                           SymmetricCipher::Encrypt);
+    if (!cipher.init(seed, iv)) {
+        qWarning("AesKdf::transformKeyRaw: error in SymmetricCipher::init: %s", qPrintable(cipher.errorString()));
+        return false;
+    }
+
+    *result = key;
+
+    if (!cipher.processInPlace(*result, rounds)) {
+        qWarning("AesKdf::transformKeyRaw: error in SymmetricCipher::processInPlace: %s",
+                 qPrintable(cipher.errorString()));
+        return false;
+    }
+
+    return true;
+}
+
+QSharedPointer<Kdf> AesKdf::clone() const
+{
+    return QSharedPointer<AesKdf>::create(*this);
+}
+
+int AesKdf::benchmarkImpl(int msec) const
+{
+    // measure both key halves at once where transform() does so, see above
+    int lanes = SymmetricCipher::hasInterleavedAesEcb() ? 2 : 1;
+    QByteArray key = QByteArray(16 * lanes, '\x7E');
+    QByteArray seed = QByteArray(32, '\x4B');
+    QByteArray iv(16, 0);
+
+    SymmetricCipher cipher(SymmetricCipher::Aes256, SymmetricCipher::Ecb,
+                           SymmetricCipher::Encrypt);
+    if (!cipher.init(seed, iv)) {
+        return -1;
+    }
+
+    int rounds = 0;
+    QElapsedTimer t;
+    t.start();
+
+    do {
+        if (!cipher.processInPlace(key, 10000)) {
+            return -1;
+        }
+        rounds += 10000;
+    } while (!t.hasExpired(msec));
+
+    return rounds;
+}
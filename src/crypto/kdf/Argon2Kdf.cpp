@@ -0,0 +1,219 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Argon2Kdf.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+
+#include <argon2.h>
+
+#include "format/KeePass2.h"
+
+Argon2Kdf::Argon2Kdf()
+    : Kdf(KeePass2::KDF_ARGON2)
+    , m_version(ARGON2_VERSION_13)
+    , m_memory(1 << 16)
+    , m_parallelism(static_cast<quint32>(qBound(1, QThread::idealThreadCount(), static_cast<int>(MaxParallelism))))
+{
+    m_rounds = 10;
+}
+
+bool Argon2Kdf::setSeed(const QByteArray& seed)
+{
+    if (seed.size() < ARGON2_MIN_SALT_LENGTH) {
+        return false;
+    }
+
+    m_seed = seed;
+    return true;
+}
+
+quint32 Argon2Kdf::version() const
+{
+    return m_version;
+}
+
+bool Argon2Kdf::setVersion(quint32 version)
+{
+    if (version != ARGON2_VERSION_10 && version != ARGON2_VERSION_13) {
+        return false;
+    }
+
+    m_version = version;
+    return true;
+}
+
+quint64 Argon2Kdf::memory() const
+{
+    return m_memory;
+}
+
+bool Argon2Kdf::setMemory(quint64 kibibytes)
+{
+    // argon2 needs at least eight blocks of 1 KiB per lane
+    if (kibibytes < 8 * m_parallelism || kibibytes > MaxMemory) {
+        return false;
+    }
+
+    m_memory = kibibytes;
+    return true;
+}
+
+quint32 Argon2Kdf::parallelism() const
+{
+    return m_parallelism;
+}
+
+bool Argon2Kdf::setParallelism(quint32 threads)
+{
+    if (threads < ARGON2_MIN_LANES || threads > MaxParallelism) {
+        return false;
+    }
+
+    m_parallelism = threads;
+    return true;
+}
+
+bool Argon2Kdf::exceedsLimits(const QVariantMap& p)
+{
+    if (p.value(KeePass2::KDFPARAM_UUID).toByteArray() != KeePass2::KDF_ARGON2.toByteArray()) {
+        return false;
+    }
+
+    return p.value(KeePass2::KDFPARAM_ARGON2_PARALLELISM).toUInt() > MaxParallelism
+           || p.value(KeePass2::KDFPARAM_ARGON2_MEMORY).toULongLong() / 1024ULL > MaxMemory;
+}
+
+bool Argon2Kdf::processParameters(const QVariantMap& p)
+{
+    QByteArray salt = p.value(KeePass2::KDFPARAM_ARGON2_SALT).toByteArray();
+    if (!setSeed(salt)) {
+        return false;
+    }
+
+    bool ok;
+    quint32 parallelism = p.value(KeePass2::KDFPARAM_ARGON2_PARALLELISM).toUInt(&ok);
+    if (!ok || !setParallelism(parallelism)) {
+        return false;
+    }
+
+    quint64 memory = p.value(KeePass2::KDFPARAM_ARGON2_MEMORY).toULongLong(&ok) / 1024ULL;
+    if (!ok || !setMemory(memory)) {
+        return false;
+    }
+
+    quint64 iterations = p.value(KeePass2::KDFPARAM_ARGON2_ITERATIONS).toULongLong(&ok);
+    if (!ok || iterations > ARGON2_MAX_TIME || !setRounds(iterations)) {
+        return false;
+    }
+
+    quint32 version = p.value(KeePass2::KDFPARAM_ARGON2_VERSION).toUInt(&ok);
+    if (!ok || !setVersion(version)) {
+        return false;
+    }
+
+    m_secret = p.value(KeePass2::KDFPARAM_ARGON2_SECRET).toByteArray();
+    m_assocData = p.value(KeePass2::KDFPARAM_ARGON2_ASSOCDATA).toByteArray();
+
+    return true;
+}
+
+QVariantMap Argon2Kdf::writeParameters() const
+{
+    QVariantMap p;
+    p.insert(KeePass2::KDFPARAM_UUID, KeePass2::KDF_ARGON2.toByteArray());
+    p.insert(KeePass2::KDFPARAM_ARGON2_VERSION, version());
+    p.insert(KeePass2::KDFPARAM_ARGON2_PARALLELISM, parallelism());
+    p.insert(KeePass2::KDFPARAM_ARGON2_MEMORY, memory() * 1024);
+    p.insert(KeePass2::KDFPARAM_ARGON2_ITERATIONS, rounds());
+    p.insert(KeePass2::KDFPARAM_ARGON2_SALT, seed());
+    if (!m_secret.isEmpty()) {
+        p.insert(KeePass2::KDFPARAM_ARGON2_SECRET, m_secret);
+    }
+    if (!m_assocData.isEmpty()) {
+        p.insert(KeePass2::KDFPARAM_ARGON2_ASSOCDATA, m_assocData);
+    }
+    return p;
+}
+
+bool Argon2Kdf::transform(const QByteArray& raw, QByteArray& result) const
+{
+    return transformKeyRaw(raw, m_seed, m_version, m_rounds, m_memory, m_parallelism,
+                           m_secret, m_assocData, result);
+}
+
+bool Argon2Kdf::transformKeyRaw(const QByteArray& key, const QByteArray& seed, quint32 version,
+                                quint64 rounds, quint64 memory, quint32 parallelism,
+                                const QByteArray& secret, const QByteArray& assocData,
+                                QByteArray& result)
+{
+    result.resize(32);
+
+    argon2_context ctx;
+    ctx.out = reinterpret_cast<uint8_t*>(result.data());
+    ctx.outlen = static_cast<uint32_t>(result.size());
+    ctx.pwd = reinterpret_cast<uint8_t*>(const_cast<char*>(key.data()));
+    ctx.pwdlen = static_cast<uint32_t>(key.size());
+    ctx.salt = reinterpret_cast<uint8_t*>(const_cast<char*>(seed.data()));
+    ctx.saltlen = static_cast<uint32_t>(seed.size());
+    ctx.secret = secret.isEmpty() ? nullptr : reinterpret_cast<uint8_t*>(const_cast<char*>(secret.data()));
+    ctx.secretlen = static_cast<uint32_t>(secret.size());
+    ctx.ad = assocData.isEmpty() ? nullptr : reinterpret_cast<uint8_t*>(const_cast<char*>(assocData.data()));
+    ctx.adlen = static_cast<uint32_t>(assocData.size());
+    ctx.t_cost = static_cast<uint32_t>(rounds);
+    ctx.m_cost = static_cast<uint32_t>(memory);
+    // argon2 starts a thread per lane and slice, don't start more than the CPU can run
+    ctx.lanes = parallelism;
+    ctx.threads = static_cast<uint32_t>(qBound(1, QThread::idealThreadCount(), static_cast<int>(parallelism)));
+    ctx.version = version;
+    ctx.allocate_cbk = nullptr;
+    ctx.free_cbk = nullptr;
+    ctx.flags = ARGON2_DEFAULT_FLAGS;
+
+    int rc = argon2_ctx(&ctx, Argon2_d);
+    if (rc != ARGON2_OK) {
+        qWarning("Argon2 error: %s", argon2_error_message(rc));
+        return false;
+    }
+
+    return true;
+}
+
+QSharedPointer<Kdf> Argon2Kdf::clone() const
+{
+    return QSharedPointer<Argon2Kdf>::create(*this);
+}
+
+int Argon2Kdf::benchmarkImpl(int msec) const
+{
+    QByteArray key = QByteArray(32, '\x7E');
+    QByteArray seed = QByteArray(32, '\x4B');
+    QByteArray result;
+
+    // a single pass costs as much as the memory and lanes dictate,
+    // so time one round and scale
+    QElapsedTimer t;
+    t.start();
+
+    if (!transformKeyRaw(key, seed, m_version, 1, m_memory, m_parallelism,
+                         QByteArray(), QByteArray(), result)) {
+        return -1;
+    }
+
+    return qMax(1, static_cast<int>(msec / qMax<qint64>(1, t.elapsed())));
+}
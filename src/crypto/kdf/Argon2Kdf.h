@@ -0,0 +1,71 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_ARGON2KDF_H
+#define KEEPASSX_ARGON2KDF_H
+
+#include "crypto/kdf/Kdf.h"
+
+/**
+ * Argon2d as used by KDBX 4. The rounds of the base class are the
+ * number of iterations, the seed is the salt.
+ */
+class Argon2Kdf : public Kdf
+{
+public:
+    // the parameters come from the unauthenticated header, keep what a file can ask for sane
+    static const quint32 MaxParallelism = 128;
+    static const quint64 MaxMemory = Q_UINT64_C(4) * 1024 * 1024;
+
+    Argon2Kdf();
+
+    bool processParameters(const QVariantMap& p) override;
+    QVariantMap writeParameters() const override;
+    bool transform(const QByteArray& raw, QByteArray& result) const override;
+    QSharedPointer<Kdf> clone() const override;
+    bool setSeed(const QByteArray& seed) override;
+
+    quint32 version() const;
+    bool setVersion(quint32 version);
+    quint64 memory() const;
+    bool setMemory(quint64 kibibytes);
+    quint32 parallelism() const;
+    bool setParallelism(quint32 threads);
+
+    /**
+     * Returns true if the parameters p ask for more memory or lanes than
+     * the limits above, to tell those files apart from invalid ones.
+     */
+    static bool exceedsLimits(const QVariantMap& p);
+
+protected:
+    int benchmarkImpl(int msec) const override;
+
+private:
+    static bool transformKeyRaw(const QByteArray& key, const QByteArray& seed, quint32 version,
+                                quint64 rounds, quint64 memory, quint32 parallelism,
+                                const QByteArray& secret, const QByteArray& assocData,
+                                QByteArray& result);
+
+    quint32 m_version;
+    quint64 m_memory;
+    quint32 m_parallelism;
+    QByteArray m_secret;
+    QByteArray m_assocData;
+};
+
+#endif // KEEPASSX_ARGON2KDF_H
@@ -0,0 +1,99 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Kdf.h"
+#include "Kdf_p.h"
+
+#include "crypto/Random.h"
+
+Kdf::Kdf(const Uuid& uuid)
+    : m_rounds(1)
+    , m_seed(QByteArray(32, 0))
+    , m_uuid(uuid)
+{
+}
+
+Kdf::~Kdf()
+{
+}
+
+Uuid Kdf::uuid() const
+{
+    return m_uuid;
+}
+
+quint64 Kdf::rounds() const
+{
+    return m_rounds;
+}
+
+bool Kdf::setRounds(quint64 rounds)
+{
+    if (rounds < 1) {
+        return false;
+    }
+
+    m_rounds = rounds;
+    return true;
+}
+
+QByteArray Kdf::seed() const
+{
+    return m_seed;
+}
+
+bool Kdf::setSeed(const QByteArray& seed)
+{
+    if (seed.size() != m_seed.size()) {
+        return false;
+    }
+
+    m_seed = seed;
+    return true;
+}
+
+void Kdf::randomizeSeed()
+{
+    setSeed(randomGen()->randomArray(m_seed.size()));
+}
+
+int Kdf::benchmark(int msec) const
+{
+    BenchmarkThread thread(msec, this);
+    thread.start();
+    thread.wait();
+    return thread.rounds();
+}
+
+
+Kdf::BenchmarkThread::BenchmarkThread(int msec, const Kdf* kdf)
+    : m_msec(msec)
+    , m_rounds(0)
+    , m_kdf(kdf)
+{
+    Q_ASSERT(msec > 0);
+}
+
+int Kdf::BenchmarkThread::rounds()
+{
+    return m_rounds;
+}
+
+void Kdf::BenchmarkThread::run()
+{
+    m_rounds = m_kdf->benchmarkImpl(m_msec);
+}
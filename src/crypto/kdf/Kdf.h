@@ -0,0 +1,70 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_KDF_H
+#define KEEPASSX_KDF_H
+
+#include <QSharedPointer>
+#include <QVariantMap>
+
+#include "core/Uuid.h"
+
+/**
+ * Key derivation function that turns the raw composite key into the
+ * transformed master key.
+ */
+class Kdf
+{
+public:
+    explicit Kdf(const Uuid& uuid);
+    virtual ~Kdf();
+
+    Uuid uuid() const;
+
+    quint64 rounds() const;
+    virtual bool setRounds(quint64 rounds);
+    QByteArray seed() const;
+    virtual bool setSeed(const QByteArray& seed);
+    virtual void randomizeSeed();
+
+    /**
+     * Reads the parameters stored in a KDBX 4 header.
+     */
+    virtual bool processParameters(const QVariantMap& p) = 0;
+    virtual QVariantMap writeParameters() const = 0;
+
+    virtual bool transform(const QByteArray& raw, QByteArray& result) const = 0;
+    virtual QSharedPointer<Kdf> clone() const = 0;
+
+    /**
+     * Returns the number of rounds that take about msec milliseconds
+     * with the current parameters or -1 on error.
+     */
+    int benchmark(int msec) const;
+
+protected:
+    virtual int benchmarkImpl(int msec) const = 0;
+
+    quint64 m_rounds;
+    QByteArray m_seed;
+
+private:
+    class BenchmarkThread;
+    const Uuid m_uuid;
+};
+
+#endif // KEEPASSX_KDF_H
@@ -0,0 +1,613 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Kdbx4Reader.h"
+
+#include <limits>
+
+#include <QBuffer>
+#include <QIODevice>
+
+#include "core/Database.h"
+#include "core/Endian.h"
+#include "crypto/CryptoHash.h"
+#include "crypto/kdf/Argon2Kdf.h"
+#include "crypto/kdf/Kdf.h"
+#include "format/KeePass2.h"
+#include "format/KeePass2RandomStream.h"
+#include "format/KeePass2XmlReader.h"
+#include "streams/HmacBlockStream.h"
+#include "streams/QtIOCompressor"
+#include "streams/StoreDataStream.h"
+#include "streams/SymmetricCipherStream.h"
+
+Kdbx4Reader::Kdbx4Reader()
+    : m_device(nullptr)
+    , m_headerStream(nullptr)
+    , m_error(false)
+    , m_headerEnd(false)
+    , m_saveXml(false)
+    , m_lastProgress(-1)
+    , m_db(nullptr)
+{
+}
+
+Database* Kdbx4Reader::readDatabase(QIODevice* device, const CompositeKey& key, bool keepDatabase)
+{
+    QScopedPointer<Database> db(new Database());
+    m_db = db.data();
+    m_device = device;
+    m_error = false;
+    m_errorStr.clear();
+    m_headerEnd = false;
+    m_xmlData.clear();
+    m_masterSeed.clear();
+    m_encryptionIV.clear();
+    m_protectedStreamKey.clear();
+    m_irsAlgo = KeePass2::Salsa20;
+    m_binaryPool.clear();
+    m_kdf.clear();
+    m_lastProgress = -1;
+
+    StoreDataStream headerStream(m_device);
+    headerStream.open(QIODevice::ReadOnly);
+    m_headerStream = &headerStream;
+
+    bool ok;
+
+    quint32 signature1 = Endian::readUInt32(m_headerStream, KeePass2::BYTEORDER, &ok);
+    quint32 signature2 = Endian::readUInt32(m_headerStream, KeePass2::BYTEORDER, &ok);
+    if (!ok || signature1 != KeePass2::SIGNATURE_1 || signature2 != KeePass2::SIGNATURE_2) {
+        raiseError(tr("Not a KeePass database."));
+        return nullptr;
+    }
+
+    quint32 version = Endian::readUInt32(m_headerStream, KeePass2::BYTEORDER, &ok)
+            & KeePass2::FILE_VERSION_CRITICAL_MASK;
+    quint32 expectedVersion = KeePass2::FILE_VERSION_4 & KeePass2::FILE_VERSION_CRITICAL_MASK;
+    if (!ok || version != expectedVersion) {
+        raiseError(tr("Unsupported KeePass database version."));
+        return nullptr;
+    }
+
+    while (readHeaderField() && !hasError()) {
+    }
+
+    headerStream.close();
+
+    if (hasError()) {
+        return nullptr;
+    }
+
+    // check if all required headers were present
+    if (m_masterSeed.isEmpty() || m_encryptionIV.isEmpty() || !m_kdf
+            || m_db->cipher().isNull()) {
+        raiseError("missing database headers");
+        return nullptr;
+    }
+
+    SymmetricCipher::Algorithm cipher = SymmetricCipher::cipherToAlgorithm(m_db->cipher());
+    if (m_encryptionIV.size() != SymmetricCipher::algorithmIvSize(cipher)) {
+        raiseError("Invalid encryption iv size");
+        return nullptr;
+    }
+
+    QByteArray headerData = headerStream.storedData();
+    QByteArray headerSha256 = m_device->read(32);
+    QByteArray headerHmac = m_device->read(32);
+    if (headerSha256.size() != 32 || headerHmac.size() != 32) {
+        raiseError("Invalid header checksum size");
+        return nullptr;
+    }
+    if (headerSha256 != CryptoHash::hash(headerData, CryptoHash::Sha256)) {
+        raiseError("Header SHA256 mismatch");
+        return nullptr;
+    }
+
+    reportProgress(KeePass2Reader::KeyDerivationStage, 0);
+
+    m_db->setKdf(m_kdf);
+    m_db->setFormatVersion(KeePass2::FILE_VERSION_4);
+    if (!m_db->setKey(key, m_kdf->seed(), false)) {
+        raiseError(tr("Unable to calculate master key"));
+        return nullptr;
+    }
+
+    if (m_db->challengeMasterSeed(m_masterSeed) == false) {
+        raiseError(tr("Unable to issue challenge-response."));
+        return nullptr;
+    }
+
+    reportProgress(KeePass2Reader::KeyDerivationStage, 100);
+    reportProgress(KeePass2Reader::ParsingStage, 0);
+
+    CryptoHash hash(CryptoHash::Sha256);
+    hash.addData(m_masterSeed);
+    hash.addData(m_db->challengeResponseKey());
+    hash.addData(m_db->transformedMasterKey());
+    QByteArray finalKey = hash.result();
+
+    // the header HMAC is keyed like a block with the highest index
+    QByteArray hmacKey = KeePass2::hmacKey(m_masterSeed, m_db->transformedMasterKey());
+    if (headerHmac != CryptoHash::hmac(headerData,
+                                       HmacBlockStream::getHmacKey(std::numeric_limits<quint64>::max(), hmacKey),
+                                       CryptoHash::Sha256)) {
+        raiseError(tr("Wrong key or database file is corrupt. (HMAC mismatch)"));
+        return nullptr;
+    }
+
+    HmacBlockStream hmacStream(m_device, hmacKey);
+    if (!hmacStream.open(QIODevice::ReadOnly)) {
+        raiseError(hmacStream.errorString());
+        return nullptr;
+    }
+
+    SymmetricCipherStream cipherStream(&hmacStream, cipher,
+                                       SymmetricCipher::algorithmMode(cipher), SymmetricCipher::Decrypt);
+    if (!cipherStream.init(finalKey, m_encryptionIV)) {
+        raiseError(cipherStream.errorString());
+        return nullptr;
+    }
+    if (!cipherStream.open(QIODevice::ReadOnly)) {
+        raiseError(cipherStream.errorString());
+        return nullptr;
+    }
+
+    QIODevice* xmlDevice;
+    QScopedPointer<QtIOCompressor> ioCompressor;
+
+    if (m_db->compressionAlgo() == Database::CompressionNone) {
+        xmlDevice = &cipherStream;
+    } else {
+        ioCompressor.reset(new QtIOCompressor(&cipherStream, 6, KeePass2::INFLATE_BUFFER_SIZE));
+        ioCompressor->setStreamFormat(QtIOCompressor::GzipFormat);
+        if (!ioCompressor->open(QIODevice::ReadOnly)) {
+            raiseError(ioCompressor->errorString());
+            return nullptr;
+        }
+        xmlDevice = ioCompressor.data();
+    }
+
+    while (readInnerHeaderField(xmlDevice) && !hasError()) {
+    }
+
+    if (hasError()) {
+        return nullptr;
+    }
+
+    if (m_protectedStreamKey.isEmpty()) {
+        raiseError("missing database headers");
+        return nullptr;
+    }
+
+    KeePass2RandomStream randomStream(m_irsAlgo);
+    if (!randomStream.init(m_protectedStreamKey)) {
+        raiseError(randomStream.errorString());
+        return nullptr;
+    }
+
+    QScopedPointer<StoreDataStream> xmlStream;
+
+    if (m_saveXml) {
+        // keep a copy of the XML while it is parsed instead of buffering it up front
+        xmlStream.reset(new StoreDataStream(xmlDevice));
+        xmlStream->open(QIODevice::ReadOnly);
+        xmlDevice = xmlStream.data();
+    }
+
+    KeePass2XmlReader xmlReader;
+    xmlReader.setBinaryPool(m_binaryPool);
+    if (m_progressCallback) {
+        xmlReader.setProgressCallback([this]() { reportParsingProgress(); });
+    }
+    xmlReader.readDatabase(xmlDevice, m_db, &randomStream);
+
+    if (m_saveXml) {
+        xmlStream->storeRemainingData();
+        m_xmlData = xmlStream->storedData();
+    }
+
+    if (xmlReader.hasError()) {
+        raiseError(xmlReader.errorString());
+        if (keepDatabase) {
+            return db.take();
+        } else {
+            return nullptr;
+        }
+    }
+
+    reportProgress(KeePass2Reader::ParsingStage, 100);
+    reportProgress(KeePass2Reader::ModelBuildStage, 0);
+
+    return db.take();
+}
+
+bool Kdbx4Reader::hasError()
+{
+    return m_error;
+}
+
+QString Kdbx4Reader::errorString()
+{
+    return m_errorStr;
+}
+
+void Kdbx4Reader::setSaveXml(bool save)
+{
+    m_saveXml = save;
+}
+
+void Kdbx4Reader::setProgressCallback(const KeePass2Reader::ProgressCallback& callback)
+{
+    m_progressCallback = callback;
+}
+
+QByteArray Kdbx4Reader::xmlData()
+{
+    return m_xmlData;
+}
+
+QByteArray Kdbx4Reader::streamKey()
+{
+    return m_protectedStreamKey;
+}
+
+void Kdbx4Reader::reportProgress(KeePass2Reader::Stage stage, int percent)
+{
+    if (!m_progressCallback) {
+        return;
+    }
+
+    int progress = stage * 1000 + percent;
+    if (progress != m_lastProgress) {
+        m_lastProgress = progress;
+        m_progressCallback(stage, percent);
+    }
+}
+
+void Kdbx4Reader::reportParsingProgress()
+{
+    qint64 size = m_device->size();
+    if (m_device->isSequential() || size <= 0) {
+        return;
+    }
+
+    reportProgress(KeePass2Reader::ParsingStage, static_cast<int>(qMin(m_device->pos(), size) * 99 / size));
+}
+
+void Kdbx4Reader::raiseError(const QString& errorMessage)
+{
+    m_error = true;
+    m_errorStr = errorMessage;
+}
+
+bool Kdbx4Reader::readHeaderField()
+{
+    QByteArray fieldIDArray = m_headerStream->read(1);
+    if (fieldIDArray.size() != 1) {
+        raiseError("Invalid header id size");
+        return false;
+    }
+    quint8 fieldID = fieldIDArray.at(0);
+
+    bool ok;
+    qint32 fieldLen = Endian::readInt32(m_headerStream, KeePass2::BYTEORDER, &ok);
+    if (!ok || fieldLen < 0) {
+        raiseError("Invalid header field length");
+        return false;
+    }
+
+    QByteArray fieldData;
+    if (fieldLen != 0) {
+        fieldData = m_headerStream->read(fieldLen);
+        if (fieldData.size() != fieldLen) {
+            raiseError("Invalid header data length");
+            return false;
+        }
+    }
+
+    switch (fieldID) {
+    case KeePass2::EndOfHeader:
+        m_headerEnd = true;
+        break;
+
+    case KeePass2::CipherID:
+        setCipher(fieldData);
+        break;
+
+    case KeePass2::CompressionFlags:
+        setCompressionFlags(fieldData);
+        break;
+
+    case KeePass2::MasterSeed:
+        setMasterSeed(fieldData);
+        break;
+
+    case KeePass2::EncryptionIV:
+        setEncryptionIV(fieldData);
+        break;
+
+    case KeePass2::KdfParameters:
+        setKdfParameters(fieldData);
+        break;
+
+    case KeePass2::PublicCustomData:
+        // plugin data of KeePass, nothing we could make use of
+        break;
+
+    default:
+        qWarning("Unknown header field read: id=%d", fieldID);
+        break;
+    }
+
+    return !m_headerEnd;
+}
+
+bool Kdbx4Reader::readInnerHeaderField(QIODevice* device)
+{
+    QByteArray fieldIDArray = device->read(1);
+    if (fieldIDArray.size() != 1) {
+        raiseError("Invalid inner header id size");
+        return false;
+    }
+    KeePass2::InnerHeaderFieldID fieldID = static_cast<KeePass2::InnerHeaderFieldID>(fieldIDArray.at(0));
+
+    bool ok;
+    qint32 fieldLen = Endian::readInt32(device, KeePass2::BYTEORDER, &ok);
+    if (!ok || fieldLen < 0) {
+        raiseError("Invalid inner header field length");
+        return false;
+    }
+
+    QByteArray fieldData;
+    if (fieldLen != 0) {
+        fieldData = device->read(fieldLen);
+        if (fieldData.size() != fieldLen) {
+            raiseError("Invalid inner header data length");
+            return false;
+        }
+    }
+
+    switch (fieldID) {
+    case KeePass2::InnerHeaderFieldID::End:
+        return false;
+
+    case KeePass2::InnerHeaderFieldID::InnerRandomStreamID:
+        setInnerRandomStreamID(fieldData);
+        break;
+
+    case KeePass2::InnerHeaderFieldID::InnerRandomStreamKey:
+        setProtectedStreamKey(fieldData);
+        break;
+
+    case KeePass2::InnerHeaderFieldID::Binary:
+        if (fieldData.isEmpty()) {
+            raiseError("Invalid inner header binary size");
+            return false;
+        }
+        // the first byte holds the flags, KeePassXC doesn't protect attachments in memory
+        m_binaryPool.insert(QString::number(m_binaryPool.size()), fieldData.mid(1));
+        break;
+
+    default:
+        qWarning("Unknown inner header field read: id=%d", static_cast<int>(fieldID));
+        break;
+    }
+
+    return true;
+}
+
+QVariantMap Kdbx4Reader::readVariantMap(QIODevice* device)
+{
+    bool ok;
+    quint16 version = Endian::readUInt16(device, KeePass2::BYTEORDER, &ok)
+            & KeePass2::VARIANTMAP_CRITICAL_MASK;
+    quint16 maxVersion = KeePass2::VARIANTMAP_VERSION & KeePass2::VARIANTMAP_CRITICAL_MASK;
+    if (!ok || version > maxVersion) {
+        raiseError("Unsupported variant map version");
+        return QVariantMap();
+    }
+
+    QVariantMap vm;
+    QByteArray fieldTypeArray;
+    KeePass2::VariantMapFieldType fieldType = KeePass2::VariantMapFieldType::End;
+    while (((fieldTypeArray = device->read(1)).size() == 1)
+           && ((fieldType = static_cast<KeePass2::VariantMapFieldType>(fieldTypeArray.at(0)))
+               != KeePass2::VariantMapFieldType::End)) {
+        qint32 nameLen = Endian::readInt32(device, KeePass2::BYTEORDER, &ok);
+        if (!ok || nameLen < 0) {
+            raiseError("Invalid variant map entry name length");
+            return QVariantMap();
+        }
+        QByteArray nameBytes = device->read(nameLen);
+        if (nameBytes.size() != nameLen) {
+            raiseError("Invalid variant map entry name data");
+            return QVariantMap();
+        }
+        QString name = QString::fromUtf8(nameBytes);
+
+        qint32 valueLen = Endian::readInt32(device, KeePass2::BYTEORDER, &ok);
+        if (!ok || valueLen < 0) {
+            raiseError("Invalid variant map entry value length");
+            return QVariantMap();
+        }
+        QByteArray valueBytes = device->read(valueLen);
+        if (valueBytes.size() != valueLen) {
+            raiseError("Invalid variant map entry value data");
+            return QVariantMap();
+        }
+
+        switch (fieldType) {
+        case KeePass2::VariantMapFieldType::Bool:
+            if (valueLen != 1) {
+                raiseError("Invalid variant map Bool entry value length");
+                return QVariantMap();
+            }
+            vm.insert(name, QVariant(valueBytes.at(0) != '\0'));
+            break;
+
+        case KeePass2::VariantMapFieldType::Int32:
+            if (valueLen != 4) {
+                raiseError("Invalid variant map Int32 entry value length");
+                return QVariantMap();
+            }
+            vm.insert(name, QVariant(Endian::bytesToInt32(valueBytes, KeePass2::BYTEORDER)));
+            break;
+
+        case KeePass2::VariantMapFieldType::UInt32:
+            if (valueLen != 4) {
+                raiseError("Invalid variant map UInt32 entry value length");
+                return QVariantMap();
+            }
+            vm.insert(name, QVariant(Endian::bytesToUInt32(valueBytes, KeePass2::BYTEORDER)));
+            break;
+
+        case KeePass2::VariantMapFieldType::Int64:
+            if (valueLen != 8) {
+                raiseError("Invalid variant map Int64 entry value length");
+                return QVariantMap();
+            }
+            vm.insert(name, QVariant(Endian::bytesToInt64(valueBytes, KeePass2::BYTEORDER)));
+            break;
+
+        case KeePass2::VariantMapFieldType::UInt64:
+            if (valueLen != 8) {
+                raiseError("Invalid variant map UInt64 entry value length");
+                return QVariantMap();
+            }
+            vm.insert(name, QVariant(Endian::bytesToUInt64(valueBytes, KeePass2::BYTEORDER)));
+            break;
+
+        case KeePass2::VariantMapFieldType::String:
+            vm.insert(name, QVariant(QString::fromUtf8(valueBytes)));
+            break;
+
+        case KeePass2::VariantMapFieldType::ByteArray:
+            vm.insert(name, QVariant(valueBytes));
+            break;
+
+        default:
+            raiseError("Invalid variant map entry type");
+            return QVariantMap();
+        }
+    }
+
+    if (fieldTypeArray.size() != 1) {
+        raiseError("Invalid variant map field type size");
+        return QVariantMap();
+    }
+
+    return vm;
+}
+
+void Kdbx4Reader::setCipher(const QByteArray& data)
+{
+    if (data.size() != Uuid::Length) {
+        raiseError("Invalid cipher uuid length");
+    } else {
+        Uuid uuid(data);
+
+        if (uuid != KeePass2::CIPHER_AES && uuid != KeePass2::CIPHER_TWOFISH
+                && uuid != KeePass2::CIPHER_CHACHA20) {
+            raiseError("Unsupported cipher");
+        } else {
+            m_db->setCipher(uuid);
+        }
+    }
+}
+
+void Kdbx4Reader::setCompressionFlags(const QByteArray& data)
+{
+    if (data.size() != 4) {
+        raiseError("Invalid compression flags length");
+    } else {
+        quint32 id = Endian::bytesToUInt32(data, KeePass2::BYTEORDER);
+
+        if (id > Database::CompressionAlgorithmMax) {
+            raiseError("Unsupported compression algorithm");
+        } else {
+            m_db->setCompressionAlgo(static_cast<Database::CompressionAlgorithm>(id));
+        }
+    }
+}
+
+void Kdbx4Reader::setMasterSeed(const QByteArray& data)
+{
+    if (data.size() != 32) {
+        raiseError("Invalid master seed size");
+    } else {
+        m_masterSeed = data;
+    }
+}
+
+void Kdbx4Reader::setEncryptionIV(const QByteArray& data)
+{
+    // the expected size depends on the cipher and is checked once the header is complete
+    if (data.isEmpty()) {
+        raiseError("Invalid encryption iv size");
+    } else {
+        m_encryptionIV = data;
+    }
+}
+
+void Kdbx4Reader::setKdfParameters(const QByteArray& data)
+{
+    QBuffer bufIoDevice;
+    bufIoDevice.setData(data);
+    bufIoDevice.open(QIODevice::ReadOnly);
+
+    QVariantMap kdfParams = readVariantMap(&bufIoDevice);
+    if (hasError()) {
+        return;
+    }
+
+    m_kdf = KeePass2::kdfFromParameters(kdfParams);
+    if (!m_kdf) {
+        if (Argon2Kdf::exceedsLimits(kdfParams)) {
+            raiseError(tr("The key derivation function of the database needs more than %1 MiB of memory "
+                          "or %2 threads, which isn't supported.")
+                           .arg(Argon2Kdf::MaxMemory / 1024)
+                           .arg(Argon2Kdf::MaxParallelism));
+        } else {
+            raiseError("Unsupported key derivation function or invalid parameters");
+        }
+    }
+}
+
+void Kdbx4Reader::setProtectedStreamKey(const QByteArray& data)
+{
+    if (data.isEmpty()) {
+        raiseError("Invalid stream key size");
+    } else {
+        m_protectedStreamKey = data;
+    }
+}
+
+void Kdbx4Reader::setInnerRandomStreamID(const QByteArray& data)
+{
+    if (data.size() != 4) {
+        raiseError("Invalid random stream id size");
+    } else {
+        quint32 id = Endian::bytesToUInt32(data, KeePass2::BYTEORDER);
+
+        if (id != KeePass2::Salsa20 && id != KeePass2::ChaCha20) {
+            raiseError("Unsupported random stream algorithm");
+        } else {
+            m_irsAlgo = static_cast<KeePass2::ProtectedStreamAlgo>(id);
+        }
+    }
+}
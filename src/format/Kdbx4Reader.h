@@ -0,0 +1,88 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_KDBX4READER_H
+#define KEEPASSX_KDBX4READER_H
+
+#include <QCoreApplication>
+#include <QHash>
+#include <QSharedPointer>
+#include <QVariantMap>
+
+#include "format/KeePass2.h"
+#include "format/KeePass2Reader.h"
+#include "keys/CompositeKey.h"
+
+class Database;
+class Kdf;
+class QIODevice;
+
+/**
+ * Reader for the KDBX 4 format, KeePass2Reader hands files of that
+ * version over to it.
+ */
+class Kdbx4Reader
+{
+    Q_DECLARE_TR_FUNCTIONS(Kdbx4Reader)
+
+public:
+    Kdbx4Reader();
+    Database* readDatabase(QIODevice* device, const CompositeKey& key, bool keepDatabase = false);
+    bool hasError();
+    QString errorString();
+    void setSaveXml(bool save);
+    void setProgressCallback(const KeePass2Reader::ProgressCallback& callback);
+    QByteArray xmlData();
+    QByteArray streamKey();
+
+private:
+    void raiseError(const QString& errorMessage);
+    void reportProgress(KeePass2Reader::Stage stage, int percent);
+    void reportParsingProgress();
+
+    bool readHeaderField();
+    bool readInnerHeaderField(QIODevice* device);
+    QVariantMap readVariantMap(QIODevice* device);
+
+    void setCipher(const QByteArray& data);
+    void setCompressionFlags(const QByteArray& data);
+    void setMasterSeed(const QByteArray& data);
+    void setEncryptionIV(const QByteArray& data);
+    void setKdfParameters(const QByteArray& data);
+    void setProtectedStreamKey(const QByteArray& data);
+    void setInnerRandomStreamID(const QByteArray& data);
+
+    QIODevice* m_device;
+    QIODevice* m_headerStream;
+    bool m_error;
+    QString m_errorStr;
+    bool m_headerEnd;
+    bool m_saveXml;
+    QByteArray m_xmlData;
+    KeePass2Reader::ProgressCallback m_progressCallback;
+    int m_lastProgress;
+
+    Database* m_db;
+    QByteArray m_masterSeed;
+    QByteArray m_encryptionIV;
+    QByteArray m_protectedStreamKey;
+    KeePass2::ProtectedStreamAlgo m_irsAlgo;
+    QSharedPointer<Kdf> m_kdf;
+    QHash<QString, QByteArray> m_binaryPool;
+};
+
+#endif // KEEPASSX_KDBX4READER_H
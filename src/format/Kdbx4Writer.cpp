@@ -0,0 +1,328 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Kdbx4Writer.h"
+
+#include <limits>
+
+#include <QBuffer>
+#include <QIODevice>
+#include <QSet>
+
+#include "core/Database.h"
+#include "core/Endian.h"
+#include "core/Entry.h"
+#include "core/Group.h"
+#include "crypto/CryptoHash.h"
+#include "crypto/Random.h"
+#include "crypto/kdf/Kdf.h"
+#include "format/KeePass2RandomStream.h"
+#include "format/KeePass2XmlWriter.h"
+#include "streams/HmacBlockStream.h"
+#include "streams/ParallelGzipStream.h"
+#include "streams/SymmetricCipherStream.h"
+
+#define CHECK_RETURN(x) if (!(x)) return;
+#define CHECK_RETURN_FALSE(x) if (!(x)) return false;
+
+Kdbx4Writer::Kdbx4Writer()
+    : m_device(nullptr)
+    , m_blockSize(1024 * 1024)
+    , m_error(false)
+{
+}
+
+void Kdbx4Writer::writeDatabase(QIODevice* device, Database* db)
+{
+    m_error = false;
+    m_errorStr.clear();
+
+    QByteArray masterSeed = randomGen()->randomArray(32);
+    SymmetricCipher::Algorithm cipher = SymmetricCipher::cipherToAlgorithm(db->cipher());
+    QByteArray encryptionIV = randomGen()->randomArray(SymmetricCipher::algorithmIvSize(cipher));
+    QByteArray protectedStreamKey = randomGen()->randomArray(64);
+    QByteArray endOfHeader = "\r\n\r\n";
+
+    if (db->challengeMasterSeed(masterSeed) == false) {
+        raiseError(tr("Unable to issue challenge-response."));
+        return;
+    }
+
+    if (!db->transformKeyWithSeed(randomGen()->randomArray(db->kdf()->seed().size()))) {
+        raiseError(tr("Unable to calculate master key"));
+        return;
+    }
+
+    CryptoHash hash(CryptoHash::Sha256);
+    hash.addData(masterSeed);
+    hash.addData(db->challengeResponseKey());
+    Q_ASSERT(!db->transformedMasterKey().isEmpty());
+    hash.addData(db->transformedMasterKey());
+    QByteArray finalKey = hash.result();
+
+    QByteArray kdfParamBytes;
+    if (!serializeVariantMap(KeePass2::kdfToParameters(db->kdf()), kdfParamBytes)) {
+        raiseError(tr("Failed to serialize KDF parameters variant map"));
+        return;
+    }
+
+    QBuffer header;
+    header.open(QIODevice::WriteOnly);
+    m_device = &header;
+
+    CHECK_RETURN(writeData(Endian::int32ToBytes(KeePass2::SIGNATURE_1, KeePass2::BYTEORDER)));
+    CHECK_RETURN(writeData(Endian::int32ToBytes(KeePass2::SIGNATURE_2, KeePass2::BYTEORDER)));
+    CHECK_RETURN(writeData(Endian::int32ToBytes(KeePass2::FILE_VERSION_4, KeePass2::BYTEORDER)));
+
+    CHECK_RETURN(writeHeaderField(KeePass2::CipherID, db->cipher().toByteArray()));
+    CHECK_RETURN(writeHeaderField(KeePass2::CompressionFlags,
+                                  Endian::int32ToBytes(db->compressionAlgo(),
+                                                       KeePass2::BYTEORDER)));
+    CHECK_RETURN(writeHeaderField(KeePass2::MasterSeed, masterSeed));
+    CHECK_RETURN(writeHeaderField(KeePass2::EncryptionIV, encryptionIV));
+    CHECK_RETURN(writeHeaderField(KeePass2::KdfParameters, kdfParamBytes));
+    CHECK_RETURN(writeHeaderField(KeePass2::EndOfHeader, endOfHeader));
+
+    header.close();
+    m_device = device;
+    QByteArray headerData = header.data();
+    CHECK_RETURN(writeData(headerData));
+
+    // header hash and HMAC, the latter keyed like a block with the highest index
+    QByteArray hmacKey = KeePass2::hmacKey(masterSeed, db->transformedMasterKey());
+    QByteArray headerHash = CryptoHash::hash(headerData, CryptoHash::Sha256);
+    QByteArray headerHmac = CryptoHash::hmac(headerData,
+                                             HmacBlockStream::getHmacKey(std::numeric_limits<quint64>::max(), hmacKey),
+                                             CryptoHash::Sha256);
+    CHECK_RETURN(writeData(headerHash));
+    CHECK_RETURN(writeData(headerHmac));
+
+    HmacBlockStream hmacStream(device, hmacKey, m_blockSize);
+    if (!hmacStream.open(QIODevice::WriteOnly)) {
+        raiseError(hmacStream.errorString());
+        return;
+    }
+
+    SymmetricCipherStream cipherStream(&hmacStream, cipher,
+                                       SymmetricCipher::algorithmMode(cipher), SymmetricCipher::Encrypt);
+    if (!cipherStream.init(finalKey, encryptionIV)) {
+        raiseError(cipherStream.errorString());
+        return;
+    }
+    if (!cipherStream.open(QIODevice::WriteOnly)) {
+        raiseError(cipherStream.errorString());
+        return;
+    }
+
+    QScopedPointer<ParallelGzipStream> ioCompressor;
+
+    if (db->compressionAlgo() == Database::CompressionNone) {
+        m_device = &cipherStream;
+    } else {
+        ioCompressor.reset(new ParallelGzipStream(&cipherStream, db->compressionLevel()));
+        if (!ioCompressor->open(QIODevice::WriteOnly)) {
+            raiseError(ioCompressor->errorString());
+            return;
+        }
+        m_device = ioCompressor.data();
+    }
+
+    CHECK_RETURN(writeInnerHeaderField(KeePass2::InnerHeaderFieldID::InnerRandomStreamID,
+                                       Endian::int32ToBytes(KeePass2::ChaCha20, KeePass2::BYTEORDER)));
+    CHECK_RETURN(writeInnerHeaderField(KeePass2::InnerHeaderFieldID::InnerRandomStreamKey,
+                                       protectedStreamKey));
+
+    // same order as the ids KeePass2XmlWriter assigns to the attachments
+    QSet<QByteArray> writtenBinaries;
+    const QList<Entry*> allEntries = db->rootGroup()->entriesRecursive(true);
+    for (Entry* entry : allEntries) {
+        const QList<QString> attachmentKeys = entry->attachments()->keys();
+        for (const QString& key : attachmentKeys) {
+            // KDBX 4 stores the raw data, which is lost for corrupted attachments
+            QSharedPointer<LazyAttachment> lazyAttachment = entry->attachments()->lazyValue(key);
+            if (lazyAttachment && !lazyAttachment->isValid()) {
+                raiseError(tr("Unable to decompress the attachment \"%1\" of the entry \"%2\".")
+                           .arg(key, entry->title()));
+                return;
+            }
+
+            QByteArray hash = entry->attachments()->hash(key);
+            if (!writtenBinaries.contains(hash)) {
+                writtenBinaries.insert(hash);
+                // flags byte, 0x01 asks KeePass to protect the attachment in memory
+                CHECK_RETURN(writeInnerHeaderField(KeePass2::InnerHeaderFieldID::Binary,
+                                                   QByteArray(1, '\x01') + entry->attachments()->value(key)));
+            }
+        }
+    }
+
+    CHECK_RETURN(writeInnerHeaderField(KeePass2::InnerHeaderFieldID::End, QByteArray()));
+
+    KeePass2RandomStream randomStream(KeePass2::ChaCha20);
+    if (!randomStream.init(protectedStreamKey)) {
+        raiseError(randomStream.errorString());
+        return;
+    }
+
+    KeePass2XmlWriter xmlWriter(KeePass2::FILE_VERSION_4);
+    xmlWriter.writeDatabase(m_device, db, &randomStream);
+
+    // Explicitly close/reset streams so they are flushed and we can detect
+    // errors. QIODevice::close() resets errorString() etc.
+    if (ioCompressor) {
+        ioCompressor->close();
+    }
+    if (!cipherStream.reset()) {
+        raiseError(cipherStream.errorString());
+        return;
+    }
+    if (!hmacStream.reset()) {
+        raiseError(hmacStream.errorString());
+        return;
+    }
+
+    if (xmlWriter.hasError()) {
+        raiseError(xmlWriter.errorString());
+    }
+}
+
+bool Kdbx4Writer::writeData(const QByteArray& data)
+{
+    if (m_device->write(data) != data.size()) {
+        raiseError(m_device->errorString());
+        return false;
+    } else {
+        return true;
+    }
+}
+
+bool Kdbx4Writer::writeHeaderField(KeePass2::HeaderFieldID fieldId, const QByteArray& data)
+{
+    QByteArray fieldIdArr;
+    fieldIdArr[0] = fieldId;
+    CHECK_RETURN_FALSE(writeData(fieldIdArr));
+    CHECK_RETURN_FALSE(writeData(Endian::int32ToBytes(data.size(), KeePass2::BYTEORDER)));
+    CHECK_RETURN_FALSE(writeData(data));
+
+    return true;
+}
+
+bool Kdbx4Writer::writeInnerHeaderField(KeePass2::InnerHeaderFieldID fieldId, const QByteArray& data)
+{
+    QByteArray fieldIdArr;
+    fieldIdArr[0] = static_cast<char>(fieldId);
+    CHECK_RETURN_FALSE(writeData(fieldIdArr));
+    CHECK_RETURN_FALSE(writeData(Endian::int32ToBytes(data.size(), KeePass2::BYTEORDER)));
+    CHECK_RETURN_FALSE(writeData(data));
+
+    return true;
+}
+
+bool Kdbx4Writer::serializeVariantMap(const QVariantMap& map, QByteArray& outputBytes)
+{
+    QBuffer buf(&outputBytes);
+    buf.open(QIODevice::WriteOnly);
+    buf.write(Endian::int16ToBytes(KeePass2::VARIANTMAP_VERSION, KeePass2::BYTEORDER));
+
+    bool ok;
+    QList<QString> keys = map.keys();
+    for (const QString& k : keys) {
+        KeePass2::VariantMapFieldType fieldType;
+        QByteArray data;
+        QVariant v = map.value(k);
+        switch (static_cast<QMetaType::Type>(v.type())) {
+        case QMetaType::Type::Int:
+            fieldType = KeePass2::VariantMapFieldType::Int32;
+            data = Endian::int32ToBytes(v.toInt(&ok), KeePass2::BYTEORDER);
+            break;
+        case QMetaType::Type::UInt:
+            fieldType = KeePass2::VariantMapFieldType::UInt32;
+            data = Endian::int32ToBytes(v.toUInt(&ok), KeePass2::BYTEORDER);
+            break;
+        case QMetaType::Type::LongLong:
+            fieldType = KeePass2::VariantMapFieldType::Int64;
+            data = Endian::int64ToBytes(v.toLongLong(&ok), KeePass2::BYTEORDER);
+            break;
+        case QMetaType::Type::ULongLong:
+            fieldType = KeePass2::VariantMapFieldType::UInt64;
+            data = Endian::int64ToBytes(v.toULongLong(&ok), KeePass2::BYTEORDER);
+            break;
+        case QMetaType::Type::QString:
+            fieldType = KeePass2::VariantMapFieldType::String;
+            data = v.toString().toUtf8();
+            ok = true;
+            break;
+        case QMetaType::Type::Bool:
+            fieldType = KeePass2::VariantMapFieldType::Bool;
+            data = QByteArray(1, v.toBool() ? '\x01' : '\x00');
+            ok = true;
+            break;
+        case QMetaType::Type::QByteArray:
+            fieldType = KeePass2::VariantMapFieldType::ByteArray;
+            data = v.toByteArray();
+            ok = true;
+            break;
+        default:
+            qWarning("Unknown object type %d in QVariantMap", static_cast<int>(v.type()));
+            return false;
+        }
+
+        if (!ok) {
+            return false;
+        }
+
+        QByteArray typeBytes;
+        typeBytes.append(static_cast<char>(fieldType));
+        QByteArray nameBytes = k.toUtf8();
+        QByteArray nameLenBytes = Endian::int32ToBytes(nameBytes.size(), KeePass2::BYTEORDER);
+        QByteArray dataLenBytes = Endian::int32ToBytes(data.size(), KeePass2::BYTEORDER);
+
+        buf.write(typeBytes);
+        buf.write(nameLenBytes);
+        buf.write(nameBytes);
+        buf.write(dataLenBytes);
+        buf.write(data);
+    }
+
+    QByteArray endBytes;
+    endBytes.append(static_cast<char>(KeePass2::VariantMapFieldType::End));
+    buf.write(endBytes);
+    return true;
+}
+
+bool Kdbx4Writer::hasError()
+{
+    return m_error;
+}
+
+QString Kdbx4Writer::errorString()
+{
+    return m_errorStr;
+}
+
+void Kdbx4Writer::setBlockSize(qint32 blockSize)
+{
+    Q_ASSERT(blockSize > 0);
+
+    m_blockSize = blockSize;
+}
+
+void Kdbx4Writer::raiseError(const QString& errorMessage)
+{
+    m_error = true;
+    m_errorStr = errorMessage;
+}
@@ -0,0 +1,57 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_KDBX4WRITER_H
+#define KEEPASSX_KDBX4WRITER_H
+
+#include <QCoreApplication>
+#include <QVariantMap>
+
+#include "format/KeePass2.h"
+
+class Database;
+class QIODevice;
+
+/**
+ * Writer for the KDBX 4 format, used by KeePass2Writer for databases
+ * whose key derivation function requires it.
+ */
+class Kdbx4Writer
+{
+    Q_DECLARE_TR_FUNCTIONS(Kdbx4Writer)
+
+public:
+    Kdbx4Writer();
+    void writeDatabase(QIODevice* device, Database* db);
+    bool hasError();
+    QString errorString();
+    void setBlockSize(qint32 blockSize);
+
+private:
+    bool writeData(const QByteArray& data);
+    bool writeHeaderField(KeePass2::HeaderFieldID fieldId, const QByteArray& data);
+    bool writeInnerHeaderField(KeePass2::InnerHeaderFieldID fieldId, const QByteArray& data);
+    bool serializeVariantMap(const QVariantMap& map, QByteArray& outputBytes);
+    void raiseError(const QString& errorMessage);
+
+    QIODevice* m_device;
+    qint32 m_blockSize;
+    bool m_error;
+    QString m_errorStr;
+};
+
+#endif // KEEPASSX_KDBX4WRITER_H
@@ -28,6 +28,7 @@
 #include "core/Metadata.h"
 #include "core/Tools.h"
 #include "crypto/CryptoHash.h"
+#include "crypto/kdf/AesKdf.h"
 #include "format/KeePass1.h"
 #include "keys/CompositeKey.h"
 #include "keys/FileKey.h"
@@ -397,12 +398,13 @@ QByteArray KeePass1Reader::key(const QByteArray& password, const QByteArray& key
     key.setPassword(password);
     key.setKeyfileData(keyfileData);
 
-    bool ok;
-    QString errorString;
-    QByteArray transformedKey = key.transform(m_transformSeed, m_transformRounds, &ok, &errorString);
+    AesKdf kdf;
+    kdf.setRounds(m_transformRounds);
+    kdf.setSeed(m_transformSeed);
 
-    if (!ok) {
-        raiseError(errorString);
+    QByteArray transformedKey;
+    if (!key.transform(kdf, transformedKey)) {
+        raiseError(tr("Unable to calculate master key"));
         return QByteArray();
     }
 
@@ -0,0 +1,60 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "KeePass2.h"
+
+#include "crypto/CryptoHash.h"
+#include "crypto/kdf/AesKdf.h"
+#include "crypto/kdf/Argon2Kdf.h"
+
+QByteArray KeePass2::hmacKey(const QByteArray& masterSeed, const QByteArray& transformedMasterKey)
+{
+    CryptoHash hmacKeyHash(CryptoHash::Sha512);
+    hmacKeyHash.addData(masterSeed);
+    hmacKeyHash.addData(transformedMasterKey);
+    hmacKeyHash.addData(QByteArray(1, '\x01'));
+    return hmacKeyHash.result();
+}
+
+QSharedPointer<Kdf> KeePass2::kdfFromParameters(const QVariantMap& p)
+{
+    QByteArray uuidBytes = p.value(KDFPARAM_UUID).toByteArray();
+    if (uuidBytes.size() != Uuid::Length) {
+        return QSharedPointer<Kdf>();
+    }
+
+    QSharedPointer<Kdf> kdf;
+    Uuid uuid(uuidBytes);
+    if (uuid == KDF_AES_KDBX3 || uuid == KDF_AES_KDBX4) {
+        kdf = QSharedPointer<AesKdf>::create();
+    } else if (uuid == KDF_ARGON2) {
+        kdf = QSharedPointer<Argon2Kdf>::create();
+    } else {
+        return QSharedPointer<Kdf>();
+    }
+
+    if (!kdf->processParameters(p)) {
+        return QSharedPointer<Kdf>();
+    }
+
+    return kdf;
+}
+
+QVariantMap KeePass2::kdfToParameters(QSharedPointer<Kdf> kdf)
+{
+    return kdf->writeParameters();
+}
@@ -18,25 +18,54 @@
 #ifndef KEEPASSX_KEEPASS2_H
 #define KEEPASSX_KEEPASS2_H
 
+#include <QSharedPointer>
+#include <QVariantMap>
 #include <QtGlobal>
 
 #include "core/Uuid.h"
 
+class Kdf;
+
 namespace KeePass2
 {
     const quint32 SIGNATURE_1 = 0x9AA2D903;
     const quint32 SIGNATURE_2 = 0xB54BFB67;
-    const quint32 FILE_VERSION = 0x00030001;
+    const quint32 FILE_VERSION_3 = 0x00030001;
+    const quint32 FILE_VERSION_4 = 0x00040000;
     const quint32 FILE_VERSION_MIN = 0x00020000;
     const quint32 FILE_VERSION_CRITICAL_MASK = 0xFFFF0000;
 
     const QSysInfo::Endian BYTEORDER = QSysInfo::LittleEndian;
 
+    // input buffer of the gzip decompressor, large enough to inflate whole blocks at once
+    const int INFLATE_BUFFER_SIZE = 1024 * 1024;
+
     const Uuid CIPHER_AES = Uuid(QByteArray::fromHex("31c1f2e6bf714350be5805216afc5aff"));
     const Uuid CIPHER_TWOFISH = Uuid(QByteArray::fromHex("ad68f29f576f4bb9a36ad47af965346c"));
+    const Uuid CIPHER_CHACHA20 = Uuid(QByteArray::fromHex("d6038a2b8b6f4cb5a524339a31dbb59a"));
+
+    const Uuid KDF_AES_KDBX3 = Uuid(QByteArray::fromHex("c9d9f39a628a4460bf740d08c18a4fea"));
+    const Uuid KDF_AES_KDBX4 = Uuid(QByteArray::fromHex("7c02bb8279a74ac0927d114a00648238"));
+    const Uuid KDF_ARGON2 = Uuid(QByteArray::fromHex("ef636ddf8c29444b91f7a9a403e30a0c"));
 
     const QByteArray INNER_STREAM_SALSA20_IV("\xE8\x30\x09\x4B\x97\x20\x5D\x2A");
 
+    const QString KDFPARAM_UUID("$UUID");
+    // AES parameters
+    const QString KDFPARAM_AES_ROUNDS("R");
+    const QString KDFPARAM_AES_SEED("S");
+    // Argon2 parameters
+    const QString KDFPARAM_ARGON2_SALT("S");
+    const QString KDFPARAM_ARGON2_PARALLELISM("P");
+    const QString KDFPARAM_ARGON2_MEMORY("M");
+    const QString KDFPARAM_ARGON2_ITERATIONS("I");
+    const QString KDFPARAM_ARGON2_VERSION("V");
+    const QString KDFPARAM_ARGON2_SECRET("K");
+    const QString KDFPARAM_ARGON2_ASSOCDATA("A");
+
+    const quint16 VARIANTMAP_VERSION = 0x0100;
+    const quint16 VARIANTMAP_CRITICAL_MASK = 0xFF00;
+
     enum HeaderFieldID
     {
         EndOfHeader = 0,
@@ -49,14 +78,44 @@ namespace KeePass2
         EncryptionIV = 7,
         ProtectedStreamKey = 8,
         StreamStartBytes = 9,
-        InnerRandomStreamID = 10
+        InnerRandomStreamID = 10,
+        KdfParameters = 11,
+        PublicCustomData = 12
+    };
+
+    enum class InnerHeaderFieldID : quint8
+    {
+        End = 0,
+        InnerRandomStreamID = 1,
+        InnerRandomStreamKey = 2,
+        Binary = 3
     };
 
     enum ProtectedStreamAlgo
     {
         ArcFourVariant = 1,
-        Salsa20 = 2
+        Salsa20 = 2,
+        ChaCha20 = 3
+    };
+
+    enum class VariantMapFieldType : quint8
+    {
+        End = 0,
+        UInt32 = 0x04,
+        UInt64 = 0x05,
+        Bool = 0x08,
+        Int32 = 0x0C,
+        Int64 = 0x0D,
+        String = 0x18,
+        ByteArray = 0x42
     };
+
+    /**
+     * Key for the HMAC-SHA256 of the KDBX 4 header and blocks.
+     */
+    QByteArray hmacKey(const QByteArray& masterSeed, const QByteArray& transformedMasterKey);
+    QSharedPointer<Kdf> kdfFromParameters(const QVariantMap& p);
+    QVariantMap kdfToParameters(QSharedPointer<Kdf> kdf);
 }
 
 #endif // KEEPASSX_KEEPASS2_H
@@ -20,14 +20,23 @@
 #include "crypto/CryptoHash.h"
 #include "format/KeePass2.h"
 
-KeePass2RandomStream::KeePass2RandomStream()
-    : m_cipher(SymmetricCipher::Salsa20, SymmetricCipher::Stream, SymmetricCipher::Encrypt)
+KeePass2RandomStream::KeePass2RandomStream(KeePass2::ProtectedStreamAlgo algo)
+    : m_algo(algo)
+    , m_cipher(algo == KeePass2::ChaCha20 ? SymmetricCipher::ChaCha20 : SymmetricCipher::Salsa20,
+               SymmetricCipher::Stream, SymmetricCipher::Encrypt)
     , m_offset(0)
 {
+    Q_ASSERT(algo == KeePass2::Salsa20 || algo == KeePass2::ChaCha20);
 }
 
 bool KeePass2RandomStream::init(const QByteArray& key)
 {
+    if (m_algo == KeePass2::ChaCha20) {
+        // key and nonce are taken from the SHA-512 hash of the stream key
+        QByteArray keyIv = CryptoHash::hash(key, CryptoHash::Sha512);
+        return m_cipher.init(keyIv.left(32), keyIv.mid(32, 12));
+    }
+
     return m_cipher.init(CryptoHash::hash(key, CryptoHash::Sha256),
                          KeePass2::INNER_STREAM_SALSA20_IV);
 }
@@ -21,11 +21,12 @@
 #include <QByteArray>
 
 #include "crypto/SymmetricCipher.h"
+#include "format/KeePass2.h"
 
 class KeePass2RandomStream
 {
 public:
-    KeePass2RandomStream();
+    explicit KeePass2RandomStream(KeePass2::ProtectedStreamAlgo algo = KeePass2::Salsa20);
     bool init(const QByteArray& key);
     QByteArray randomBytes(int size, bool* ok);
     QByteArray process(const QByteArray& data, bool* ok);
@@ -35,6 +36,7 @@ public:
 private:
     bool loadBlock();
 
+    const KeePass2::ProtectedStreamAlgo m_algo;
     SymmetricCipher m_cipher;
     QByteArray m_buffer;
     int m_offset;
@@ -17,6 +17,8 @@
 
 #include "KeePass2Reader.h"
 
+#include <limits>
+
 #include <QBuffer>
 #include <QFile>
 #include <QIODevice>
@@ -24,6 +26,7 @@
 #include "core/Database.h"
 #include "core/Endian.h"
 #include "crypto/CryptoHash.h"
+#include "format/Kdbx4Reader.h"
 #include "format/KeePass1.h"
 #include "format/KeePass2.h"
 #include "format/KeePass2RandomStream.h"
@@ -39,6 +42,10 @@ KeePass2Reader::KeePass2Reader()
     , m_error(false)
     , m_headerEnd(false)
     , m_saveXml(false)
+    , m_memoryMapped(false)
+    , m_deviceMapped(false)
+    , m_lazyAttachments(false)
+    , m_lastProgress(-1)
     , m_db(nullptr)
 {
 }
@@ -57,6 +64,20 @@ Database* KeePass2Reader::readDatabase(QIODevice* device, const CompositeKey& ke
     m_encryptionIV.clear();
     m_streamStartBytes.clear();
     m_protectedStreamKey.clear();
+    m_lastProgress = -1;
+
+    if (isKdbx4(m_device)) {
+        Kdbx4Reader reader;
+        reader.setSaveXml(m_saveXml);
+        reader.setProgressCallback(m_progressCallback);
+        Database* kdbx4Db = reader.readDatabase(m_device, key, keepDatabase);
+        if (reader.hasError()) {
+            raiseError(reader.errorString());
+        }
+        m_xmlData = reader.xmlData();
+        m_protectedStreamKey = reader.streamKey();
+        return kdbx4Db;
+    }
 
     StoreDataStream headerStream(m_device);
     headerStream.open(QIODevice::ReadOnly);
@@ -85,7 +106,7 @@ Database* KeePass2Reader::readDatabase(QIODevice* device, const CompositeKey& ke
 
     quint32 version = Endian::readUInt32(m_headerStream, KeePass2::BYTEORDER, &ok)
             & KeePass2::FILE_VERSION_CRITICAL_MASK;
-    quint32 maxVersion = KeePass2::FILE_VERSION & KeePass2::FILE_VERSION_CRITICAL_MASK;
+    quint32 maxVersion = KeePass2::FILE_VERSION_3 & KeePass2::FILE_VERSION_CRITICAL_MASK;
     if (!ok || (version < KeePass2::FILE_VERSION_MIN) || (version > maxVersion)) {
         raiseError(tr("Unsupported KeePass database version."));
         return nullptr;
@@ -108,6 +129,8 @@ Database* KeePass2Reader::readDatabase(QIODevice* device, const CompositeKey& ke
         return nullptr;
     }
 
+    reportProgress(KeyDerivationStage, 0);
+
     if (!m_db->setKey(key, m_transformSeed, false)) {
         raiseError(tr("Unable to calculate master key"));
         return nullptr;
@@ -118,6 +141,9 @@ Database* KeePass2Reader::readDatabase(QIODevice* device, const CompositeKey& ke
         return nullptr;
     }
 
+    reportProgress(KeyDerivationStage, 100);
+    reportProgress(ParsingStage, 0);
+
     CryptoHash hash(CryptoHash::Sha256);
     hash.addData(m_masterSeed);
     hash.addData(m_db->challengeResponseKey());
@@ -130,6 +156,7 @@ Database* KeePass2Reader::readDatabase(QIODevice* device, const CompositeKey& ke
         raiseError(cipherStream.errorString());
         return nullptr;
     }
+    cipherStream.setReadFromMemory(m_deviceMapped);
     if (!cipherStream.open(QIODevice::ReadOnly)) {
         raiseError(cipherStream.errorString());
         return nullptr;
@@ -155,7 +182,7 @@ Database* KeePass2Reader::readDatabase(QIODevice* device, const CompositeKey& ke
         xmlDevice = &hashedStream;
     }
     else {
-        ioCompressor.reset(new QtIOCompressor(&hashedStream));
+        ioCompressor.reset(new QtIOCompressor(&hashedStream, 6, KeePass2::INFLATE_BUFFER_SIZE));
         ioCompressor->setStreamFormat(QtIOCompressor::GzipFormat);
         if (!ioCompressor->open(QIODevice::ReadOnly)) {
             raiseError(ioCompressor->errorString());
@@ -170,18 +197,27 @@ Database* KeePass2Reader::readDatabase(QIODevice* device, const CompositeKey& ke
         return nullptr;
     }
 
-    QScopedPointer<QBuffer> buffer;
+    QScopedPointer<StoreDataStream> xmlStream;
 
     if (m_saveXml) {
-        m_xmlData = xmlDevice->readAll();
-        buffer.reset(new QBuffer(&m_xmlData));
-        buffer->open(QIODevice::ReadOnly);
-        xmlDevice = buffer.data();
+        // keep a copy of the XML while it is parsed instead of buffering it up front
+        xmlStream.reset(new StoreDataStream(xmlDevice));
+        xmlStream->open(QIODevice::ReadOnly);
+        xmlDevice = xmlStream.data();
     }
 
     KeePass2XmlReader xmlReader;
+    xmlReader.setLazyAttachments(m_lazyAttachments);
+    if (m_progressCallback) {
+        xmlReader.setProgressCallback([this]() { reportParsingProgress(); });
+    }
     xmlReader.readDatabase(xmlDevice, m_db, &randomStream);
 
+    if (m_saveXml) {
+        xmlStream->storeRemainingData();
+        m_xmlData = xmlStream->storedData();
+    }
+
     if (xmlReader.hasError()) {
         raiseError(xmlReader.errorString());
         if (keepDatabase) {
@@ -202,6 +238,9 @@ Database* KeePass2Reader::readDatabase(QIODevice* device, const CompositeKey& ke
         }
     }
 
+    reportProgress(ParsingStage, 100);
+    reportProgress(ModelBuildStage, 0);
+
     return db.take();
 }
 
@@ -213,7 +252,29 @@ Database* KeePass2Reader::readDatabase(const QString& filename, const CompositeK
         return nullptr;
     }
 
-    QScopedPointer<Database> db(readDatabase(&file, key));
+    QScopedPointer<Database> db;
+
+    uchar* mapped = nullptr;
+    if (m_memoryMapped && file.size() > 0 && file.size() <= std::numeric_limits<int>::max()) {
+        // falls back to reading the file if it can't be mapped
+        mapped = file.map(0, file.size());
+    }
+
+    if (mapped) {
+        // the KDBX 3.1 cipher layer decrypts straight out of the mapped pages,
+        // KDBX 4 reads them through its HMAC blocks like any other device
+        QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char*>(mapped),
+                                                  static_cast<int>(file.size()));
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        m_deviceMapped = true;
+        db.reset(readDatabase(&buffer, key));
+        m_deviceMapped = false;
+        buffer.close();
+        file.unmap(mapped);
+    } else {
+        db.reset(readDatabase(&file, key));
+    }
 
     if (file.error() != QFile::NoError) {
         raiseError(file.errorString());
@@ -238,6 +299,21 @@ void KeePass2Reader::setSaveXml(bool save)
     m_saveXml = save;
 }
 
+void KeePass2Reader::setMemoryMapped(bool mapped)
+{
+    m_memoryMapped = mapped;
+}
+
+void KeePass2Reader::setLazyAttachments(bool lazy)
+{
+    m_lazyAttachments = lazy;
+}
+
+void KeePass2Reader::setProgressCallback(const ProgressCallback& callback)
+{
+    m_progressCallback = callback;
+}
+
 QByteArray KeePass2Reader::xmlData()
 {
     return m_xmlData;
@@ -248,6 +324,49 @@ QByteArray KeePass2Reader::streamKey()
     return m_protectedStreamKey;
 }
 
+bool KeePass2Reader::isKdbx4(QIODevice* device)
+{
+    // peek so the header stays in place for whichever reader continues
+    QByteArray signature = device->peek(12);
+    if (signature.size() != 12) {
+        return false;
+    }
+
+    quint32 signature1 = Endian::bytesToUInt32(signature.mid(0, 4), KeePass2::BYTEORDER);
+    quint32 signature2 = Endian::bytesToUInt32(signature.mid(4, 4), KeePass2::BYTEORDER);
+    quint32 version = Endian::bytesToUInt32(signature.mid(8, 4), KeePass2::BYTEORDER)
+            & KeePass2::FILE_VERSION_CRITICAL_MASK;
+
+    return signature1 == KeePass2::SIGNATURE_1 && signature2 == KeePass2::SIGNATURE_2
+            && version == (KeePass2::FILE_VERSION_4 & KeePass2::FILE_VERSION_CRITICAL_MASK);
+}
+
+void KeePass2Reader::reportProgress(Stage stage, int percent)
+{
+    if (!m_progressCallback) {
+        return;
+    }
+
+    // only pass on actual changes, the parser ticks once per group and entry
+    int progress = stage * 1000 + percent;
+    if (progress != m_lastProgress) {
+        m_lastProgress = progress;
+        m_progressCallback(stage, percent);
+    }
+}
+
+void KeePass2Reader::reportParsingProgress()
+{
+    // the payload is decrypted and inflated while the parser pulls it, so the
+    // position in the file tracks the parser closely enough
+    qint64 size = m_device->size();
+    if (m_device->isSequential() || size <= 0) {
+        return;
+    }
+
+    reportProgress(ParsingStage, static_cast<int>(qMin(m_device->pos(), size) * 99 / size));
+}
+
 void KeePass2Reader::raiseError(const QString& errorMessage)
 {
     m_error = true;
@@ -18,6 +18,8 @@
 #ifndef KEEPASSX_KEEPASS2READER_H
 #define KEEPASSX_KEEPASS2READER_H
 
+#include <functional>
+
 #include <QCoreApplication>
 
 #include "keys/CompositeKey.h"
@@ -30,17 +32,47 @@ class KeePass2Reader
     Q_DECLARE_TR_FUNCTIONS(KeePass2Reader)
 
 public:
+    enum Stage
+    {
+        KeyDerivationStage,
+        // the payload is decrypted while the parser pulls it, so this covers both
+        ParsingStage,
+        ModelBuildStage
+    };
+
+    /**
+     * Receives the current stage and its completion in percent. It is called
+     * on the thread that reads the database.
+     */
+    typedef std::function<void(Stage stage, int percent)> ProgressCallback;
+
     KeePass2Reader();
     Database* readDatabase(QIODevice* device, const CompositeKey& key, bool keepDatabase = false);
     Database* readDatabase(const QString& filename, const CompositeKey& key);
     bool hasError();
     QString errorString();
     void setSaveXml(bool save);
+    /**
+     * Map the file into memory when reading by file name instead of reading it in pieces.
+     * Only the cipher layer of KDBX 3.1 decrypts straight out of the mapped pages. In
+     * KDBX 4 the HMAC blocks come first and are still copied one by one, and in both
+     * formats the layers above the cipher copy the block they're working on.
+     */
+    void setMemoryMapped(bool mapped);
+    /**
+     * Decode KDBX 3 attachments on first access instead of while reading.
+     * KDBX 4 stores them unencoded, so this has no effect there.
+     */
+    void setLazyAttachments(bool lazy);
+    void setProgressCallback(const ProgressCallback& callback);
     QByteArray xmlData();
     QByteArray streamKey();
 
 private:
     void raiseError(const QString& errorMessage);
+    static bool isKdbx4(QIODevice* device);
+    void reportProgress(Stage stage, int percent);
+    void reportParsingProgress();
 
     bool readHeaderField();
 
@@ -60,7 +92,13 @@ private:
     QString m_errorStr;
     bool m_headerEnd;
     bool m_saveXml;
+    bool m_memoryMapped;
+    // the device being read is a QBuffer over the mapped file
+    bool m_deviceMapped;
+    bool m_lazyAttachments;
     QByteArray m_xmlData;
+    ProgressCallback m_progressCallback;
+    int m_lastProgress;
 
     Database* m_db;
     QByteArray m_masterSeed;
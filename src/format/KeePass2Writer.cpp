@@ -25,10 +25,11 @@
 #include "core/Endian.h"
 #include "crypto/CryptoHash.h"
 #include "crypto/Random.h"
+#include "format/Kdbx4Writer.h"
 #include "format/KeePass2RandomStream.h"
 #include "format/KeePass2XmlWriter.h"
 #include "streams/HashedBlockStream.h"
-#include "streams/QtIOCompressor"
+#include "streams/ParallelGzipStream.h"
 #include "streams/SymmetricCipherStream.h"
 
 #define CHECK_RETURN(x) if (!(x)) return;
@@ -36,6 +37,7 @@
 
 KeePass2Writer::KeePass2Writer()
     : m_device(0)
+    , m_blockSize(HashedBlockStream::DefaultBlockSize)
     , m_error(false)
 {
 }
@@ -45,6 +47,19 @@ void KeePass2Writer::writeDatabase(QIODevice* device, Database* db)
     m_error = false;
     m_errorStr.clear();
 
+    // KDBX 3.1 can only describe AES-KDF and CBC ciphers, anything else needs KDBX 4,
+    // a database read from KDBX 4 isn't downgraded
+    if (db->formatVersion() >= KeePass2::FILE_VERSION_4 || db->kdf()->uuid() != KeePass2::KDF_AES_KDBX3
+            || db->cipher() == KeePass2::CIPHER_CHACHA20) {
+        Kdbx4Writer writer;
+        writer.setBlockSize(m_blockSize);
+        writer.writeDatabase(device, db);
+        if (writer.hasError()) {
+            raiseError(writer.errorString());
+        }
+        return;
+    }
+
     QByteArray transformSeed = randomGen()->randomArray(32);
     QByteArray masterSeed = randomGen()->randomArray(32);
     QByteArray encryptionIV = randomGen()->randomArray(16);
@@ -75,7 +90,7 @@ void KeePass2Writer::writeDatabase(QIODevice* device, Database* db)
 
     CHECK_RETURN(writeData(Endian::int32ToBytes(KeePass2::SIGNATURE_1, KeePass2::BYTEORDER)));
     CHECK_RETURN(writeData(Endian::int32ToBytes(KeePass2::SIGNATURE_2, KeePass2::BYTEORDER)));
-    CHECK_RETURN(writeData(Endian::int32ToBytes(KeePass2::FILE_VERSION, KeePass2::BYTEORDER)));
+    CHECK_RETURN(writeData(Endian::int32ToBytes(KeePass2::FILE_VERSION_3, KeePass2::BYTEORDER)));
 
     CHECK_RETURN(writeHeaderField(KeePass2::CipherID, db->cipher().toByteArray()));
     CHECK_RETURN(writeHeaderField(KeePass2::CompressionFlags,
@@ -109,20 +124,19 @@ void KeePass2Writer::writeDatabase(QIODevice* device, Database* db)
     m_device = &cipherStream;
     CHECK_RETURN(writeData(startBytes));
 
-    HashedBlockStream hashedStream(&cipherStream);
+    HashedBlockStream hashedStream(&cipherStream, m_blockSize);
     if (!hashedStream.open(QIODevice::WriteOnly)) {
         raiseError(hashedStream.errorString());
         return;
     }
 
-    QScopedPointer<QtIOCompressor> ioCompressor;
+    QScopedPointer<ParallelGzipStream> ioCompressor;
 
     if (db->compressionAlgo() == Database::CompressionNone) {
         m_device = &hashedStream;
     }
     else {
-        ioCompressor.reset(new QtIOCompressor(&hashedStream));
-        ioCompressor->setStreamFormat(QtIOCompressor::GzipFormat);
+        ioCompressor.reset(new ParallelGzipStream(&hashedStream, db->compressionLevel()));
         if (!ioCompressor->open(QIODevice::WriteOnly)) {
             raiseError(ioCompressor->errorString());
             return;
@@ -203,6 +217,13 @@ QString KeePass2Writer::errorString()
     return m_errorStr;
 }
 
+void KeePass2Writer::setBlockSize(qint32 blockSize)
+{
+    Q_ASSERT(blockSize > 0);
+
+    m_blockSize = blockSize;
+}
+
 void KeePass2Writer::raiseError(const QString& errorMessage)
 {
     m_error = true;
@@ -36,6 +36,11 @@ public:
     void writeDatabase(const QString& filename, Database* db);
     bool hasError();
     QString errorString();
+    /**
+     * Size of the hashed blocks of KDBX 3.1 and the HMAC blocks of KDBX 4,
+     * larger blocks mean fewer hashes. Readers accept any block size.
+     */
+    void setBlockSize(qint32 blockSize);
 
 private:
     bool writeData(const QByteArray& data);
@@ -43,6 +48,7 @@ private:
     void raiseError(const QString& errorMessage);
 
     QIODevice* m_device;
+    qint32 m_blockSize;
     bool m_error;
     QString m_errorStr;
 };
@@ -22,9 +22,12 @@
 
 #include "core/Database.h"
 #include "core/DatabaseIcons.h"
+#include "core/Endian.h"
 #include "core/Group.h"
+#include "core/LazyAttachment.h"
 #include "core/Metadata.h"
 #include "core/Tools.h"
+#include "format/KeePass2.h"
 #include "format/KeePass2RandomStream.h"
 #include "streams/QtIOCompressor"
 
@@ -37,6 +40,7 @@ KeePass2XmlReader::KeePass2XmlReader()
     , m_tmpParent(nullptr)
     , m_error(false)
     , m_strictMode(false)
+    , m_lazyAttachments(false)
 {
 }
 
@@ -45,6 +49,21 @@ void KeePass2XmlReader::setStrictMode(bool strictMode)
     m_strictMode = strictMode;
 }
 
+void KeePass2XmlReader::setBinaryPool(const QHash<QString, QByteArray>& binaryPool)
+{
+    m_binaryPool = binaryPool;
+}
+
+void KeePass2XmlReader::setLazyAttachments(bool lazy)
+{
+    m_lazyAttachments = lazy;
+}
+
+void KeePass2XmlReader::setProgressCallback(const std::function<void()>& callback)
+{
+    m_progressCallback = callback;
+}
+
 void KeePass2XmlReader::readDatabase(QIODevice* device, Database* db, KeePass2RandomStream* randomStream)
 {
     m_error = false;
@@ -86,7 +105,7 @@ void KeePass2XmlReader::readDatabase(QIODevice* device, Database* db, KeePass2Ra
         }
     }
 
-    const QSet<QString> poolKeys = m_binaryPool.keys().toSet();
+    const QSet<QString> poolKeys = m_binaryPool.keys().toSet() + m_lazyBinaryPool.keys().toSet();
     const QSet<QString> entryKeys = m_binaryMap.keys().toSet();
     const QSet<QString> unmappedKeys = entryKeys - poolKeys;
     const QSet<QString> unusedKeys = poolKeys - entryKeys;
@@ -104,7 +123,11 @@ void KeePass2XmlReader::readDatabase(QIODevice* device, Database* db, KeePass2Ra
     QHash<QString, QPair<Entry*, QString> >::const_iterator i;
     for (i = m_binaryMap.constBegin(); i != m_binaryMap.constEnd(); ++i) {
         const QPair<Entry*, QString>& target = i.value();
-        target.first->attachments()->set(target.second, m_binaryPool[i.key()]);
+        if (m_lazyBinaryPool.contains(i.key())) {
+            target.first->attachments()->setLazy(target.second, m_lazyBinaryPool.value(i.key()));
+        } else {
+            target.first->attachments()->set(target.second, m_binaryPool[i.key()]);
+        }
     }
 
     m_meta->setUpdateDatetime(true);
@@ -383,21 +406,23 @@ void KeePass2XmlReader::parseBinaries()
             QXmlStreamAttributes attr = m_xml.attributes();
 
             QString id = attr.value("ID").toString();
+            bool compressed = attr.value("Compressed").compare(QLatin1String("True"), Qt::CaseInsensitive) == 0;
 
-            QByteArray data;
-            if (attr.value("Compressed").compare(QLatin1String("True"), Qt::CaseInsensitive) == 0) {
-                data = readCompressedBinary();
-            }
-            else {
-                data = readBinary();
-            }
-
-            if (m_binaryPool.contains(id)) {
+            if (m_binaryPool.contains(id) || m_lazyBinaryPool.contains(id)) {
                 qWarning("KeePass2XmlReader::parseBinaries: overwriting binary item \"%s\"",
                          qPrintable(id));
+                m_binaryPool.remove(id);
+                m_lazyBinaryPool.remove(id);
             }
 
-            m_binaryPool.insert(id, data);
+            if (m_lazyAttachments) {
+                QSharedPointer<LazyAttachment> attachment(new LazyAttachment(readString().toLatin1(), compressed));
+                m_lazyBinaryPool.insert(id, attachment);
+            } else if (compressed) {
+                m_binaryPool.insert(id, readCompressedBinary());
+            } else {
+                m_binaryPool.insert(id, readBinary());
+            }
         }
         else {
             skipCurrentElement();
@@ -585,12 +610,18 @@ Group* KeePass2XmlReader::parseGroup()
             if (newGroup) {
                 children.append(newGroup);
             }
+            if (m_progressCallback) {
+                m_progressCallback();
+            }
         }
         else if (m_xml.name() == "Entry") {
             Entry* newEntry = parseEntry(false);
             if (newEntry) {
                 entries.append(newEntry);
             }
+            if (m_progressCallback) {
+                m_progressCallback();
+            }
         }
         else {
             skipCurrentElement();
@@ -1048,6 +1079,15 @@ QDateTime KeePass2XmlReader::readDateTime()
     QString str = readString();
     QDateTime dt = QDateTime::fromString(str, Qt::ISODate);
 
+    if (!dt.isValid()) {
+        // KDBX 4 stores seconds since 0001-01-01 as base64 encoded int64
+        QByteArray secsBytes = QByteArray::fromBase64(str.toLatin1());
+        if (secsBytes.size() == 8) {
+            qint64 secs = Endian::bytesToInt64(secsBytes, KeePass2::BYTEORDER);
+            dt = QDateTime(QDate(1, 1, 1), QTime(0, 0, 0, 0), Qt::UTC).addSecs(secs);
+        }
+    }
+
     if (!dt.isValid()) {
         if (m_strictMode) {
             raiseError("Invalid date time value");
@@ -18,11 +18,14 @@
 #ifndef KEEPASSX_KEEPASS2XMLREADER_H
 #define KEEPASSX_KEEPASS2XMLREADER_H
 
+#include <functional>
+
 #include <QColor>
 #include <QCoreApplication>
 #include <QDateTime>
 #include <QHash>
 #include <QPair>
+#include <QSharedPointer>
 #include <QXmlStreamReader>
 
 #include "core/TimeInfo.h"
@@ -31,6 +34,7 @@
 class Database;
 class Entry;
 class Group;
+class LazyAttachment;
 class KeePass2RandomStream;
 class Metadata;
 
@@ -48,6 +52,24 @@ public:
     QByteArray headerHash();
     void setStrictMode(bool strictMode);
 
+    /**
+     * Attachments that are stored outside the XML, e.g. in the KDBX 4
+     * inner header. Keys are the ids referenced by the entries.
+     */
+    void setBinaryPool(const QHash<QString, QByteArray>& binaryPool);
+
+    /**
+     * Keep the attachments of the XML binary pool encoded until they are
+     * first accessed, see LazyAttachment.
+     */
+    void setLazyAttachments(bool lazy);
+
+    /**
+     * Called after every parsed group and entry so the caller can report
+     * how far the document has been read.
+     */
+    void setProgressCallback(const std::function<void()>& callback);
+
 private:
     bool parseKeePassFile();
     void parseMeta();
@@ -91,11 +113,14 @@ private:
     QHash<Uuid, Group*> m_groups;
     QHash<Uuid, Entry*> m_entries;
     QHash<QString, QByteArray> m_binaryPool;
+    QHash<QString, QSharedPointer<LazyAttachment>> m_lazyBinaryPool;
     QHash<QString, QPair<Entry*, QString> > m_binaryMap;
     QByteArray m_headerHash;
     bool m_error;
     QString m_errorStr;
     bool m_strictMode;
+    bool m_lazyAttachments;
+    std::function<void()> m_progressCallback;
 };
 
 #endif // KEEPASSX_KEEPASS2XMLREADER_H
@@ -20,12 +20,21 @@
 #include <QBuffer>
 #include <QFile>
 
+#include "core/Endian.h"
+#include "core/LazyAttachment.h"
 #include "core/Metadata.h"
+#include "format/KeePass2.h"
 #include "format/KeePass2RandomStream.h"
 #include "streams/QtIOCompressor"
 
 KeePass2XmlWriter::KeePass2XmlWriter()
-    : m_db(nullptr)
+    : KeePass2XmlWriter(KeePass2::FILE_VERSION_3)
+{
+}
+
+KeePass2XmlWriter::KeePass2XmlWriter(quint32 version)
+    : m_kdbxVersion(version)
+    , m_db(nullptr)
     , m_meta(nullptr)
     , m_randomStream(nullptr)
     , m_error(false)
@@ -85,17 +94,61 @@ void KeePass2XmlWriter::generateIdMap()
     const QList<Entry*> allEntries = m_db->rootGroup()->entriesRecursive(true);
     int nextId = 0;
 
+    m_idMap.clear();
+    m_binaries.clear();
+    m_lazyIdMap.clear();
+
     for (Entry* entry : allEntries) {
         const QList<QString> attachmentKeys = entry->attachments()->keys();
         for (const QString& key : attachmentKeys) {
-            QByteArray data = entry->attachments()->value(key);
-            if (!m_idMap.contains(data)) {
-                m_idMap.insert(data, nextId++);
+            const LazyAttachment* attachment = passThroughAttachment(entry, key);
+            if (attachment) {
+                if (!m_lazyIdMap.contains(attachment)) {
+                    m_lazyIdMap.insert(attachment, nextId++);
+                }
+            } else {
+                QByteArray hash = entry->attachments()->hash(key);
+                if (!m_idMap.contains(hash)) {
+                    m_binaries.insert(nextId, entry->attachments()->value(key));
+                    m_idMap.insert(hash, nextId++);
+                }
             }
         }
     }
 }
 
+const LazyAttachment* KeePass2XmlWriter::passThroughAttachment(const Entry* entry, const QString& key) const
+{
+    // attachments that were never decoded can be copied as they were read,
+    // unless KDBX 4 needs the raw data or the compression setting changed
+    if (m_kdbxVersion >= KeePass2::FILE_VERSION_4) {
+        return nullptr;
+    }
+
+    QSharedPointer<LazyAttachment> attachment = entry->attachments()->lazyValue(key);
+    if (!attachment) {
+        return nullptr;
+    }
+
+    // a corrupted attachment keeps its original form, the Compressed flag is stored per binary
+    if (attachment->isCompressed() != (m_db->compressionAlgo() == Database::CompressionGZip)
+            && attachment->isValid()) {
+        return nullptr;
+    }
+
+    return attachment.data();
+}
+
+int KeePass2XmlWriter::attachmentId(const Entry* entry, const QString& key) const
+{
+    const LazyAttachment* attachment = passThroughAttachment(entry, key);
+    if (attachment) {
+        return m_lazyIdMap.value(attachment);
+    }
+
+    return m_idMap.value(entry->attachments()->hash(key));
+}
+
 void KeePass2XmlWriter::writeMetadata()
 {
     m_xml.writeStartElement("Meta");
@@ -126,7 +179,10 @@ void KeePass2XmlWriter::writeMetadata()
     writeUuid("LastTopVisibleGroup", m_meta->lastTopVisibleGroup());
     writeNumber("HistoryMaxItems", m_meta->historyMaxItems());
     writeNumber("HistoryMaxSize", m_meta->historyMaxSize());
-    writeBinaries();
+    // KDBX 4 keeps attachments in the binary inner header
+    if (m_kdbxVersion < KeePass2::FILE_VERSION_4) {
+        writeBinaries();
+    }
     writeCustomData();
 
     m_xml.writeEndElement();
@@ -178,11 +234,11 @@ void KeePass2XmlWriter::writeBinaries()
 {
     m_xml.writeStartElement("Binaries");
 
-    QHash<QByteArray, int>::const_iterator i;
-    for (i = m_idMap.constBegin(); i != m_idMap.constEnd(); ++i) {
+    QMap<int, QByteArray>::const_iterator i;
+    for (i = m_binaries.constBegin(); i != m_binaries.constEnd(); ++i) {
         m_xml.writeStartElement("Binary");
 
-        m_xml.writeAttribute("ID", QString::number(i.value()));
+        m_xml.writeAttribute("ID", QString::number(i.key()));
 
         QByteArray data;
         if (m_db->compressionAlgo() == Database::CompressionGZip) {
@@ -195,8 +251,8 @@ void KeePass2XmlWriter::writeBinaries()
             compressor.setStreamFormat(QtIOCompressor::GzipFormat);
             compressor.open(QIODevice::WriteOnly);
 
-            qint64 bytesWritten = compressor.write(i.key());
-            Q_ASSERT(bytesWritten == i.key().size());
+            qint64 bytesWritten = compressor.write(i.value());
+            Q_ASSERT(bytesWritten == i.value().size());
             Q_UNUSED(bytesWritten);
             compressor.close();
 
@@ -204,7 +260,7 @@ void KeePass2XmlWriter::writeBinaries()
             data = buffer.readAll();
         }
         else {
-            data = i.key();
+            data = i.value();
         }
 
         if (!data.isEmpty()) {
@@ -213,6 +269,22 @@ void KeePass2XmlWriter::writeBinaries()
         m_xml.writeEndElement();
     }
 
+    QHash<const LazyAttachment*, int>::const_iterator iLazy;
+    for (iLazy = m_lazyIdMap.constBegin(); iLazy != m_lazyIdMap.constEnd(); ++iLazy) {
+        m_xml.writeStartElement("Binary");
+
+        m_xml.writeAttribute("ID", QString::number(iLazy.value()));
+        if (iLazy.key()->isCompressed()) {
+            m_xml.writeAttribute("Compressed", "True");
+        }
+
+        QByteArray encoded = iLazy.key()->encoded();
+        if (!encoded.isEmpty()) {
+            m_xml.writeCharacters(QString::fromLatin1(encoded));
+        }
+        m_xml.writeEndElement();
+    }
+
     m_xml.writeEndElement();
 }
 
@@ -392,7 +464,7 @@ void KeePass2XmlWriter::writeEntry(const Entry* entry)
         writeString("Key", key);
 
         m_xml.writeStartElement("Value");
-        m_xml.writeAttribute("Ref", QString::number(m_idMap[entry->attachments()->value(key)]));
+        m_xml.writeAttribute("Ref", QString::number(attachmentId(entry, key)));
         m_xml.writeEndElement();
 
         m_xml.writeEndElement();
@@ -475,6 +547,13 @@ void KeePass2XmlWriter::writeDateTime(const QString& qualifiedName, const QDateT
     Q_ASSERT(dateTime.isValid());
     Q_ASSERT(dateTime.timeSpec() == Qt::UTC);
 
+    if (m_kdbxVersion >= KeePass2::FILE_VERSION_4) {
+        qint64 secs = QDateTime(QDate(1, 1, 1), QTime(0, 0, 0, 0), Qt::UTC).secsTo(dateTime);
+        QByteArray secsBytes = Endian::int64ToBytes(secs, KeePass2::BYTEORDER);
+        writeString(qualifiedName, QString::fromLatin1(secsBytes.toBase64()));
+        return;
+    }
+
     QString dateTimeStr = dateTime.toString(Qt::ISODate);
 
     // Qt < 4.8 doesn't append a 'Z' at the end
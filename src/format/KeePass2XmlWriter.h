@@ -30,12 +30,14 @@
 #include "core/Uuid.h"
 
 class KeePass2RandomStream;
+class LazyAttachment;
 class Metadata;
 
 class KeePass2XmlWriter
 {
 public:
     KeePass2XmlWriter();
+    explicit KeePass2XmlWriter(quint32 version);
     void writeDatabase(QIODevice* device, Database* db, KeePass2RandomStream* randomStream = nullptr,
                        const QByteArray& headerHash = QByteArray());
     void writeDatabase(const QString& filename, Database* db);
@@ -44,6 +46,8 @@ public:
 
 private:
     void generateIdMap();
+    const LazyAttachment* passThroughAttachment(const Entry* entry, const QString& key) const;
+    int attachmentId(const Entry* entry, const QString& key) const;
 
     void writeMetadata();
     void writeMemoryProtection();
@@ -77,12 +81,17 @@ private:
 
     void raiseError(const QString& errorMessage);
 
+    const quint32 m_kdbxVersion;
+
     QXmlStreamWriter m_xml;
     Database* m_db;
     Metadata* m_meta;
     KeePass2RandomStream* m_randomStream;
     QByteArray m_headerHash;
+    // ids by attachment hash, so the content is compared without hashing it on every save
     QHash<QByteArray, int> m_idMap;
+    QMap<int, QByteArray> m_binaries;
+    QHash<const LazyAttachment*, int> m_lazyIdMap;
     bool m_error;
     QString m_errorStr;
 };
@@ -21,6 +21,7 @@
 
 #include "core/Config.h"
 #include "core/Database.h"
+#include "core/DatabaseLoader.h"
 #include "core/FilePath.h"
 #include "gui/MainWindow.h"
 #include "gui/FileDialog.h"
@@ -41,10 +42,12 @@ DatabaseOpenWidget::DatabaseOpenWidget(QWidget* parent)
     : DialogyWidget(parent)
     , m_ui(new Ui::DatabaseOpenWidget())
     , m_db(nullptr)
+    , m_loader(new DatabaseLoader(this))
 {
     m_ui->setupUi(this);
 
     m_ui->messageWidget->setHidden(true);
+    m_ui->loadProgress->setVisible(false);
 
     QFont font = m_ui->labelHeadline->font();
     font.setBold(true);
@@ -62,6 +65,9 @@ DatabaseOpenWidget::DatabaseOpenWidget(QWidget* parent)
     connect(m_ui->buttonBox, SIGNAL(accepted()), SLOT(openDatabase()));
     connect(m_ui->buttonBox, SIGNAL(rejected()), SLOT(reject()));
 
+    connect(m_loader, SIGNAL(progress(int,int)), SLOT(loadProgress(int,int)));
+    connect(m_loader, SIGNAL(finished(Database*)), SLOT(loadFinished(Database*)));
+
 #ifdef WITH_XC_YUBIKEY
     m_ui->yubikeyProgress->setVisible(false);
     QSizePolicy sp = m_ui->yubikeyProgress->sizePolicy();
@@ -145,6 +151,11 @@ void DatabaseOpenWidget::clearForms()
     m_ui->checkChallengeResponse->setChecked(false);
     m_ui->buttonTogglePassword->setChecked(false);
     m_db = nullptr;
+
+    if (m_loader->isRunning()) {
+        m_loader->cancel();
+        setLoading(false);
+    }
 }
 
 
@@ -167,24 +178,46 @@ void DatabaseOpenWidget::enterKey(const QString& pw, const QString& keyFile)
 
 void DatabaseOpenWidget::openDatabase()
 {
-    KeePass2Reader reader;
-    QSharedPointer<CompositeKey> masterKey = databaseKey();
-    if (masterKey.isNull()) {
+    if (m_loader->isRunning()) {
         return;
     }
 
-    QFile file(m_filename);
-    if (!file.open(QIODevice::ReadOnly)) {
-        m_ui->messageWidget->showMessage(
-            tr("Unable to open the database.").append("\n").append(file.errorString()), MessageWidget::Error);
+    QSharedPointer<CompositeKey> masterKey = databaseKey();
+    if (masterKey.isNull()) {
         return;
     }
+
     if (m_db) {
         delete m_db;
+        m_db = nullptr;
+    }
+
+    // the key derivation and parsing run on a worker thread, see loadFinished()
+    setLoading(true);
+    m_loader->load(m_filename, *masterKey);
+}
+
+void DatabaseOpenWidget::loadProgress(int stage, int percent)
+{
+    switch (stage) {
+    case KeePass2Reader::KeyDerivationStage:
+        m_ui->loadProgress->setFormat(tr("Transforming key..."));
+        break;
+    case KeePass2Reader::ParsingStage:
+        m_ui->loadProgress->setFormat(tr("Reading database... %p%"));
+        break;
+    case KeePass2Reader::ModelBuildStage:
+        m_ui->loadProgress->setFormat(tr("Preparing database..."));
+        break;
     }
-    QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-    m_db = reader.readDatabase(&file, *masterKey);
-    QApplication::restoreOverrideCursor();
+
+    m_ui->loadProgress->setValue(percent);
+}
+
+void DatabaseOpenWidget::loadFinished(Database* db)
+{
+    setLoading(false);
+    m_db = db;
 
     if (m_db) {
         if (m_ui->messageWidget->isVisible()) {
@@ -192,9 +225,29 @@ void DatabaseOpenWidget::openDatabase()
         }
         emit editFinished(true);
     } else {
-        m_ui->messageWidget->showMessage(tr("Unable to open the database.").append("\n").append(reader.errorString()),
+        m_ui->messageWidget->showMessage(tr("Unable to open the database.").append("\n").append(m_loader->errorString()),
                                          MessageWidget::Error);
         m_ui->editPassword->clear();
+        m_ui->editPassword->setFocus();
+    }
+}
+
+void DatabaseOpenWidget::setLoading(bool loading)
+{
+    m_ui->editPassword->setEnabled(!loading);
+    m_ui->buttonTogglePassword->setEnabled(!loading);
+    m_ui->comboKeyFile->setEnabled(!loading);
+    m_ui->buttonBrowseFile->setEnabled(!loading);
+    m_ui->buttonBox->setEnabled(!loading);
+
+    m_ui->loadProgress->setValue(0);
+    m_ui->loadProgress->setFormat(QString());
+    m_ui->loadProgress->setVisible(loading);
+
+    if (loading) {
+        QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
+    } else {
+        QApplication::restoreOverrideCursor();
     }
 }
 
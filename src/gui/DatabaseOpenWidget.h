@@ -25,6 +25,7 @@
 #include "keys/CompositeKey.h"
 
 class Database;
+class DatabaseLoader;
 class QFile;
 
 namespace Ui {
@@ -66,6 +67,8 @@ private slots:
     void yubikeyDetected(int slot, bool blocking);
     void yubikeyDetectComplete();
     void noYubikeyFound();
+    void loadProgress(int stage, int percent);
+    void loadFinished(Database* db);
 
 protected:
     const QScopedPointer<Ui::DatabaseOpenWidget> m_ui;
@@ -73,6 +76,9 @@ protected:
     QString m_filename;
 
 private:
+    void setLoading(bool loading);
+
+    DatabaseLoader* const m_loader;
     bool m_yubiKeyBeingPolled = false;
     Q_DISABLE_COPY(DatabaseOpenWidget)
 };
@@ -21,8 +21,10 @@
 #include "core/Database.h"
 #include "core/Group.h"
 #include "core/Metadata.h"
-#include "crypto/SymmetricCipher.h"
+#include "crypto/kdf/AesKdf.h"
+#include "crypto/kdf/Argon2Kdf.h"
 #include "format/KeePass2.h"
+#include "gui/MessageBox.h"
 #include "keys/CompositeKey.h"
 
 DatabaseSettingsWidget::DatabaseSettingsWidget(QWidget* parent)
@@ -39,6 +41,21 @@ DatabaseSettingsWidget::DatabaseSettingsWidget(QWidget* parent)
     connect(m_ui->historyMaxSizeCheckBox, SIGNAL(toggled(bool)),
             m_ui->historyMaxSizeSpinBox, SLOT(setEnabled(bool)));
     connect(m_ui->transformBenchmarkButton, SIGNAL(clicked()), SLOT(transformRoundsBenchmark()));
+
+    m_ui->AlgorithmComboBox->addItem(tr("AES: 256 Bit (default)"), KeePass2::CIPHER_AES.toByteArray());
+    m_ui->AlgorithmComboBox->addItem(tr("Twofish: 256 Bit"), KeePass2::CIPHER_TWOFISH.toByteArray());
+    m_ui->AlgorithmComboBox->addItem(tr("ChaCha20: 256 Bit (KDBX 4)"), KeePass2::CIPHER_CHACHA20.toByteArray());
+
+    m_ui->kdfComboBox->addItem(tr("AES-KDF (KDBX 3.1)"), KeePass2::KDF_AES_KDBX3.toByteArray());
+    m_ui->kdfComboBox->addItem(tr("AES-KDF (KDBX 4)"), KeePass2::KDF_AES_KDBX4.toByteArray());
+    m_ui->kdfComboBox->addItem(tr("Argon2 (KDBX 4)"), KeePass2::KDF_ARGON2.toByteArray());
+    connect(m_ui->kdfComboBox, SIGNAL(currentIndexChanged(int)), SLOT(kdfChanged(int)));
+
+    // the item data is the zlib level, 0 disables compression
+    m_ui->compressionComboBox->addItem(tr("None"), 0);
+    m_ui->compressionComboBox->addItem(tr("Fast"), 1);
+    m_ui->compressionComboBox->addItem(tr("Default"), Database::DefaultCompressionLevel);
+    m_ui->compressionComboBox->addItem(tr("Best"), 9);
 }
 
 DatabaseSettingsWidget::~DatabaseSettingsWidget()
@@ -55,8 +72,25 @@ void DatabaseSettingsWidget::load(Database* db)
     m_ui->dbDescriptionEdit->setText(meta->description());
     m_ui->recycleBinEnabledCheckBox->setChecked(meta->recycleBinEnabled());
     m_ui->defaultUsernameEdit->setText(meta->defaultUserName());
-    m_ui->AlgorithmComboBox->setCurrentIndex(SymmetricCipher::cipherToAlgorithm(m_db->cipher()));
-    m_ui->transformRoundsSpinBox->setValue(m_db->transformRounds());
+    m_ui->AlgorithmComboBox->setCurrentIndex(m_ui->AlgorithmComboBox->findData(m_db->cipher().toByteArray()));
+    // AesKdf always has the KDBX 3.1 uuid, the file format tells the two choices apart
+    Uuid kdfUuid = m_db->kdf()->uuid();
+    if (kdfUuid == KeePass2::KDF_AES_KDBX3 && m_db->formatVersion() >= KeePass2::FILE_VERSION_4) {
+        kdfUuid = KeePass2::KDF_AES_KDBX4;
+    }
+    m_ui->kdfComboBox->blockSignals(true);
+    m_ui->kdfComboBox->setCurrentIndex(m_ui->kdfComboBox->findData(kdfUuid.toByteArray()));
+    m_ui->kdfComboBox->blockSignals(false);
+    loadKdfParameters(m_db->kdf());
+    int compressionLevel = 0;
+    if (m_db->compressionAlgo() == Database::CompressionGZip) {
+        compressionLevel = m_db->compressionLevel();
+    }
+    int compressionIndex = m_ui->compressionComboBox->findData(compressionLevel);
+    if (compressionIndex == -1) {
+        compressionIndex = m_ui->compressionComboBox->findData(Database::DefaultCompressionLevel);
+    }
+    m_ui->compressionComboBox->setCurrentIndex(compressionIndex);
     if (meta->historyMaxItems() > -1) {
         m_ui->historyMaxItemsSpinBox->setValue(meta->historyMaxItems());
         m_ui->historyMaxItemsCheckBox->setChecked(true);
@@ -80,18 +114,44 @@ void DatabaseSettingsWidget::load(Database* db)
 
 void DatabaseSettingsWidget::save()
 {
+    QSharedPointer<Kdf> kdf = createKdf();
+    if (!kdf) {
+        MessageBox::warning(this, tr("Error"), tr("Invalid key derivation function parameters"));
+        return;
+    }
+
     Metadata* meta = m_db->metadata();
 
     meta->setName(m_ui->dbNameEdit->text());
     meta->setDescription(m_ui->dbDescriptionEdit->text());
     meta->setDefaultUserName(m_ui->defaultUsernameEdit->text());
-    m_db->setCipher(SymmetricCipher::algorithmToCipher(static_cast<SymmetricCipher::Algorithm>
-                                                       (m_ui->AlgorithmComboBox->currentIndex())));
+    m_db->setCipher(Uuid(m_ui->AlgorithmComboBox->currentData().toByteArray()));
     meta->setRecycleBinEnabled(m_ui->recycleBinEnabledCheckBox->isChecked());
-    if (static_cast<quint64>(m_ui->transformRoundsSpinBox->value()) != m_db->transformRounds()) {
+
+    int compressionLevel = m_ui->compressionComboBox->currentData().toInt();
+    if (compressionLevel == 0) {
+        m_db->setCompressionAlgo(Database::CompressionNone);
+    } else {
+        m_db->setCompressionAlgo(Database::CompressionGZip);
+        m_db->setCompressionLevel(compressionLevel);
+    }
+
+    Uuid kdfChoice(m_ui->kdfComboBox->currentData().toByteArray());
+    m_db->setFormatVersion(kdfChoice == KeePass2::KDF_AES_KDBX4 ? KeePass2::FILE_VERSION_4
+                                                                : KeePass2::FILE_VERSION_3);
+
+    QVariantMap newParams = kdf->writeParameters();
+    QVariantMap oldParams = m_db->kdf()->writeParameters();
+    // AES-KDF and Argon2 both store the seed as "S", a fresh one is generated anyway
+    newParams.remove(KeePass2::KDFPARAM_AES_SEED);
+    oldParams.remove(KeePass2::KDFPARAM_AES_SEED);
+    if (newParams != oldParams) {
         QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-        m_db->setTransformRounds(m_ui->transformRoundsSpinBox->value());
+        bool ok = m_db->changeKdf(kdf);
         QApplication::restoreOverrideCursor();
+        if (!ok) {
+            MessageBox::warning(this, tr("Error"), tr("Unable to calculate master key"));
+        }
     }
 
     bool truncate = false;
@@ -134,14 +194,78 @@ void DatabaseSettingsWidget::reject()
 
 void DatabaseSettingsWidget::transformRoundsBenchmark()
 {
+    QSharedPointer<Kdf> kdf = createKdf();
+    if (!kdf) {
+        MessageBox::warning(this, tr("Error"), tr("Invalid key derivation function parameters"));
+        return;
+    }
+
     QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-    int rounds = CompositeKey::transformKeyBenchmark(1000);
+    int rounds = kdf->benchmark(1000);
     if (rounds != -1) {
         m_ui->transformRoundsSpinBox->setValue(rounds);
     }
     QApplication::restoreOverrideCursor();
 }
 
+void DatabaseSettingsWidget::kdfChanged(int index)
+{
+    Uuid uuid = kdfUuid(index);
+    if (m_db && uuid == m_db->kdf()->uuid()) {
+        loadKdfParameters(m_db->kdf());
+    } else if (uuid == KeePass2::KDF_ARGON2) {
+        loadKdfParameters(QSharedPointer<Argon2Kdf>::create());
+    } else {
+        loadKdfParameters(QSharedPointer<AesKdf>::create());
+    }
+}
+
+void DatabaseSettingsWidget::loadKdfParameters(QSharedPointer<Kdf> kdf)
+{
+    m_ui->transformRoundsSpinBox->setValue(static_cast<int>(kdf->rounds()));
+
+    QSharedPointer<Argon2Kdf> argon2Kdf = kdf.dynamicCast<Argon2Kdf>();
+    bool isArgon2 = !argon2Kdf.isNull();
+    if (isArgon2) {
+        m_ui->memorySpinBox->setValue(static_cast<int>(argon2Kdf->memory() / 1024));
+        m_ui->parallelismSpinBox->setValue(static_cast<int>(argon2Kdf->parallelism()));
+    }
+    m_ui->memoryUsageLabel->setEnabled(isArgon2);
+    m_ui->memorySpinBox->setEnabled(isArgon2);
+    m_ui->parallelismLabel->setEnabled(isArgon2);
+    m_ui->parallelismSpinBox->setEnabled(isArgon2);
+}
+
+QSharedPointer<Kdf> DatabaseSettingsWidget::createKdf() const
+{
+    Uuid uuid = kdfUuid(m_ui->kdfComboBox->currentIndex());
+
+    // keep parameters the dialog doesn't show, e.g. an Argon2 secret
+    QSharedPointer<Kdf> kdf;
+    if (uuid == m_db->kdf()->uuid()) {
+        kdf = m_db->kdf()->clone();
+    } else if (uuid == KeePass2::KDF_ARGON2) {
+        kdf = QSharedPointer<Argon2Kdf>::create();
+    } else {
+        kdf = QSharedPointer<AesKdf>::create();
+    }
+
+    if (!kdf->setRounds(m_ui->transformRoundsSpinBox->value())) {
+        return QSharedPointer<Kdf>();
+    }
+
+    // the memory limits depend on the parallelism, set it first
+    QSharedPointer<Argon2Kdf> argon2Kdf = kdf.dynamicCast<Argon2Kdf>();
+    if (argon2Kdf) {
+        if (!argon2Kdf->setParallelism(m_ui->parallelismSpinBox->value())
+            || !argon2Kdf->setMemory(static_cast<quint64>(m_ui->memorySpinBox->value()) * 1024)) {
+            return QSharedPointer<Kdf>();
+        }
+    }
+
+    return kdf;
+}
+
 void DatabaseSettingsWidget::truncateHistories()
 {
     const QList<Entry*> allEntries = m_db->rootGroup()->entriesRecursive(false);
@@ -149,3 +273,13 @@ void DatabaseSettingsWidget::truncateHistories()
         entry->truncateHistory();
     }
 }
+
+Uuid DatabaseSettingsWidget::kdfUuid(int index) const
+{
+    // both AES-KDF choices use the same function, they only differ in the file format
+    Uuid uuid(m_ui->kdfComboBox->itemData(index).toByteArray());
+    if (uuid == KeePass2::KDF_AES_KDBX4) {
+        return KeePass2::KDF_AES_KDBX3;
+    }
+    return uuid;
+}
@@ -19,10 +19,13 @@
 #define KEEPASSX_DATABASESETTINGSWIDGET_H
 
 #include <QScopedPointer>
+#include <QSharedPointer>
 
+#include "core/Uuid.h"
 #include "gui/DialogyWidget.h"
 
 class Database;
+class Kdf;
 
 namespace Ui {
     class DatabaseSettingsWidget;
@@ -45,9 +48,14 @@ private slots:
     void save();
     void reject();
     void transformRoundsBenchmark();
+    void kdfChanged(int index);
 
 private:
+    void loadKdfParameters(QSharedPointer<Kdf> kdf);
+    // returns a null pointer if the parameters are rejected by the KDF
+    QSharedPointer<Kdf> createKdf() const;
     void truncateHistories();
+    Uuid kdfUuid(int index) const;
 
     const QScopedPointer<Ui::DatabaseSettingsWidget> m_ui;
     Database* m_db;
@@ -26,6 +26,7 @@
 #include "core/Config.h"
 #include "core/Global.h"
 #include "core/Database.h"
+#include "core/DatabaseSaver.h"
 #include "core/Group.h"
 #include "core/Metadata.h"
 #include "format/CsvExporter.h"
@@ -41,6 +42,7 @@
 
 DatabaseManagerStruct::DatabaseManagerStruct()
     : dbWidget(nullptr)
+    , saver(nullptr)
     , modified(false)
     , readOnly(false)
 {
@@ -277,6 +279,9 @@ bool DatabaseTabWidget::closeDatabase(Database* db)
 
 void DatabaseTabWidget::deleteDatabase(Database* db)
 {
+    // finish autosaves before the database goes away
+    m_dbList.value(db).saver->waitForFinished();
+
     const DatabaseManagerStruct dbStruct = m_dbList.value(db);
     bool emitDatabaseWithFileClosed = dbStruct.fileInfo.exists() && !dbStruct.readOnly;
     QString filePath = dbStruct.fileInfo.absoluteFilePath();
@@ -286,6 +291,7 @@ void DatabaseTabWidget::deleteDatabase(Database* db)
     removeTab(index);
     toggleTabbar();
     m_dbList.remove(db);
+    delete dbStruct.saver;
     delete dbStruct.dbWidget;
     delete db;
 
@@ -322,29 +328,71 @@ bool DatabaseTabWidget::saveDatabase(Database* db, QString filePath)
         }
 
         dbStruct.dbWidget->blockAutoReload(true);
-        QString errorMessage = db->saveToFile(filePath);
+        QString errorMessage = dbStruct.saver->save(db, filePath);
         dbStruct.dbWidget->blockAutoReload(false);
 
-        if (errorMessage.isEmpty()) {
-            // successfully saved database file
-            dbStruct.modified = false;
-            dbStruct.fileInfo = QFileInfo(filePath);
-            dbStruct.dbWidget->databaseSaved();
-            updateTabName(db);
-            emit messageDismissTab();
-            return true;
-        } else {
-            dbStruct.modified = true;
-            updateTabName(db);
-            emit messageTab(tr("Writing the database failed.").append("\n").append(errorMessage),
-                            MessageWidget::Error);
-            return false;
-        }
+        return finishSave(db, filePath, errorMessage);
     } else {
         return saveDatabaseAs(db);
     }
 }
 
+void DatabaseTabWidget::saveDatabaseInBackground(Database* db)
+{
+    DatabaseManagerStruct& dbStruct = m_dbList[db];
+    QString filePath = dbStruct.fileInfo.canonicalFilePath();
+
+    if (dbStruct.dbWidget->currentMode() == DatabaseWidget::LockedMode || filePath.isEmpty()) {
+        saveDatabase(db);
+        return;
+    }
+
+    // the write runs on a worker thread, see databaseSaved()
+    dbStruct.dbWidget->blockAutoReload(true);
+    dbStruct.saver->saveInBackground(db, filePath);
+}
+
+bool DatabaseTabWidget::finishSave(Database* db, const QString& filePath, const QString& errorMessage)
+{
+    DatabaseManagerStruct& dbStruct = m_dbList[db];
+
+    if (errorMessage.isEmpty()) {
+        // successfully saved database file
+        dbStruct.modified = false;
+        dbStruct.fileInfo = QFileInfo(filePath);
+        dbStruct.dbWidget->databaseSaved();
+        updateTabName(db);
+        emit messageDismissTab();
+        return true;
+    } else {
+        dbStruct.modified = true;
+        updateTabName(db);
+        emit messageTab(tr("Writing the database failed.").append("\n").append(errorMessage),
+                        MessageWidget::Error);
+        return false;
+    }
+}
+
+void DatabaseTabWidget::databaseSaved(const QString& filePath, const QString& errorString)
+{
+    DatabaseSaver* saver = static_cast<DatabaseSaver*>(sender());
+
+    QHashIterator<Database*, DatabaseManagerStruct> i(m_dbList);
+    while (i.hasNext()) {
+        i.next();
+        if (i.value().saver == saver) {
+            if (!saver->isRunning()) {
+                i.value().dbWidget->blockAutoReload(false);
+                finishSave(i.key(), filePath, errorString);
+            } else if (!errorString.isEmpty()) {
+                // a newer state is still to be written, only the last write may clear the modified flag
+                finishSave(i.key(), filePath, errorString);
+            }
+            return;
+        }
+    }
+}
+
 bool DatabaseTabWidget::saveDatabaseAs(Database* db)
 {
     while (true) {
@@ -621,6 +669,8 @@ Database* DatabaseTabWidget::databaseFromDatabaseWidget(DatabaseWidget* dbWidget
 void DatabaseTabWidget::insertDatabase(Database* db, const DatabaseManagerStruct& dbStruct)
 {
     m_dbList.insert(db, dbStruct);
+    m_dbList[db].saver = new DatabaseSaver(this);
+    connect(m_dbList[db].saver, SIGNAL(saved(QString, QString)), SLOT(databaseSaved(QString, QString)));
 
     addTab(dbStruct.dbWidget, "");
     toggleTabbar();
@@ -707,6 +757,7 @@ void DatabaseTabWidget::lockDatabases()
             }
         }
 
+        m_dbList[db].saver->waitForFinished();
         dbWidget->lock();
         // database has changed so we can't use the db variable anymore
         updateTabName(dbWidget->database());
@@ -723,7 +774,7 @@ void DatabaseTabWidget::modified()
     DatabaseManagerStruct& dbStruct = m_dbList[db];
 
     if (config()->get("AutoSaveAfterEveryChange").toBool() && !dbStruct.readOnly) {
-        saveDatabase(db);
+        saveDatabaseInBackground(db);
         return;
     }
 
@@ -26,6 +26,7 @@
 #include "gui/DatabaseWidget.h"
 #include "gui/MessageWidget.h"
 
+class DatabaseSaver;
 class DatabaseWidget;
 class DatabaseWidgetStateSync;
 class DatabaseOpenWidget;
@@ -37,6 +38,7 @@ struct DatabaseManagerStruct
     DatabaseManagerStruct();
 
     DatabaseWidget* dbWidget;
+    DatabaseSaver* saver;
     QFileInfo fileInfo;
     bool modified;
     bool readOnly;
@@ -100,9 +102,12 @@ private slots:
     void changeDatabase(Database* newDb, bool unsavedChanges);
     void emitActivateDatabaseChanged();
     void emitDatabaseUnlockedFromDbWidgetSender();
+    void databaseSaved(const QString& filePath, const QString& errorString);
 
 private:
     bool saveDatabase(Database* db, QString filePath = "");
+    void saveDatabaseInBackground(Database* db);
+    bool finishSave(Database* db, const QString& filePath, const QString& errorMessage);
     bool saveDatabaseAs(Database* db);
     bool closeDatabase(Database* db);
     void deleteDatabase(Database* db);
@@ -464,9 +464,11 @@ void DatabaseWidget::deleteEntries()
         }
 
         if (result == QMessageBox::Yes) {
+            m_db->beginBulkChange();
             for (Entry* entry : asConst(selectedEntries)) {
                 delete entry;
             }
+            m_db->endBulkChange();
             refreshSearch();
         }
     }
@@ -491,9 +493,11 @@ void DatabaseWidget::deleteEntries()
             return;
         }
 
+        m_db->beginBulkChange();
         for (Entry* entry : asConst(selectedEntries)) {
             m_db->recycleEntry(entry);
         }
+        m_db->endBulkChange();
     }
 }
 
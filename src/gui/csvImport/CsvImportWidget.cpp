@@ -211,6 +211,7 @@ QString CsvImportWidget::formatStatusText() const {
 void CsvImportWidget::writeDatabase() {
 
     setRootGroup();
+    m_db->beginBulkChange();
     for (int r = 0; r < m_parserModel->rowCount(); ++r) {
         //use validity of second column as a GO/NOGO for all others fields
         if (not m_parserModel->data(m_parserModel->index(r, 1)).isValid())
@@ -224,6 +225,7 @@ void CsvImportWidget::writeDatabase() {
         entry->setUrl(m_parserModel->data(m_parserModel->index(r, 4)).toString());
         entry->setNotes(m_parserModel->data(m_parserModel->index(r, 5)).toString());
     }
+    m_db->endBulkChange();
     QBuffer buffer;
     buffer.open(QBuffer::ReadWrite);
 
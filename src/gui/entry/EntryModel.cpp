@@ -21,6 +21,7 @@
 #include <QMimeData>
 #include <QPalette>
 
+#include "core/Database.h"
 #include "core/DatabaseIcons.h"
 #include "core/Entry.h"
 #include "core/Global.h"
@@ -30,6 +31,7 @@
 EntryModel::EntryModel(QObject* parent)
     : QAbstractTableModel(parent)
     , m_group(nullptr)
+    , m_bulkChange(false)
 {
 }
 
@@ -52,29 +54,42 @@ void EntryModel::setGroup(Group* group)
         return;
     }
 
-    beginResetModel();
+    // switching finishes the reset of a pending bulk change
+    if (!m_bulkChange) {
+        beginResetModel();
+    }
 
     severConnections();
 
     m_group = group;
     m_allGroups.clear();
+    m_databases.clear();
     m_entries = group->entries();
     m_orgEntries.clear();
 
     makeConnections(group);
+    connect(group, SIGNAL(destroyed()), SLOT(groupDestroyed()));
+    if (group->database()) {
+        m_databases.append(group->database());
+        makeConnections(group->database());
+    }
 
+    m_bulkChange = false;
     endResetModel();
     emit switchedToGroupMode();
 }
 
 void EntryModel::setEntryList(const QList<Entry*>& entries)
 {
-    beginResetModel();
+    if (!m_bulkChange) {
+        beginResetModel();
+    }
 
     severConnections();
 
     m_group = nullptr;
     m_allGroups.clear();
+    m_databases.clear();
     m_entries = entries;
     m_orgEntries = entries;
 
@@ -94,12 +109,16 @@ void EntryModel::setEntryList(const QList<Entry*>& entries)
         if (db->metadata()->recycleBin()) {
             m_allGroups.removeOne(db->metadata()->recycleBin());
         }
+
+        m_databases.append(db);
+        makeConnections(db);
     }
 
     for (const Group* group : asConst(m_allGroups)) {
         makeConnections(group);
     }
 
+    m_bulkChange = false;
     endResetModel();
     emit switchedToEntryListMode();
 }
@@ -277,6 +296,14 @@ void EntryModel::entryAboutToAdd(Entry* entry)
         return;
     }
 
+    if (m_bulkChange) {
+        // the group is read again once the bulk change is finished
+        if (!m_group) {
+            m_entries.append(entry);
+        }
+        return;
+    }
+
     beginInsertRows(QModelIndex(), m_entries.size(), m_entries.size());
     if (!m_group) {
         m_entries.append(entry);
@@ -285,7 +312,7 @@ void EntryModel::entryAboutToAdd(Entry* entry)
 
 void EntryModel::entryAdded(Entry* entry)
 {
-    if (!m_group && !m_orgEntries.contains(entry)) {
+    if (m_bulkChange || (!m_group && !m_orgEntries.contains(entry))) {
         return;
     }
 
@@ -297,6 +324,12 @@ void EntryModel::entryAdded(Entry* entry)
 
 void EntryModel::entryAboutToRemove(Entry* entry)
 {
+    if (m_bulkChange) {
+        // entries may be deleted before the bulk change is finished
+        m_entries.removeAll(entry);
+        return;
+    }
+
     beginRemoveRows(QModelIndex(), m_entries.indexOf(entry), m_entries.indexOf(entry));
     if (!m_group) {
         m_entries.removeAll(entry);
@@ -305,6 +338,10 @@ void EntryModel::entryAboutToRemove(Entry* entry)
 
 void EntryModel::entryRemoved()
 {
+    if (m_bulkChange) {
+        return;
+    }
+
     if (m_group) {
         m_entries = m_group->entries();
     }
@@ -314,6 +351,10 @@ void EntryModel::entryRemoved()
 
 void EntryModel::entryDataChanged(Entry* entry)
 {
+    if (m_bulkChange) {
+        return;
+    }
+
     int row = m_entries.indexOf(entry);
     emit dataChanged(index(row, 0), index(row, columnCount()-1));
 }
@@ -327,6 +368,10 @@ void EntryModel::severConnections()
     for (const Group* group : asConst(m_allGroups)) {
         disconnect(group, nullptr, this, nullptr);
     }
+
+    for (const Database* db : asConst(m_databases)) {
+        disconnect(db, nullptr, this, nullptr);
+    }
 }
 
 void EntryModel::makeConnections(const Group* group)
@@ -337,3 +382,43 @@ void EntryModel::makeConnections(const Group* group)
     connect(group, SIGNAL(entryRemoved(Entry*)), SLOT(entryRemoved()));
     connect(group, SIGNAL(entryDataChanged(Entry*)), SLOT(entryDataChanged(Entry*)));
 }
+
+void EntryModel::makeConnections(const Database* db)
+{
+    connect(db, SIGNAL(bulkChangeStarted()), SLOT(bulkChangeStarted()));
+    connect(db, SIGNAL(bulkChangeFinished()), SLOT(bulkChangeFinished()));
+}
+
+void EntryModel::groupDestroyed()
+{
+    // usually the view switches to another group before, except during a bulk change
+    if (!m_bulkChange) {
+        beginResetModel();
+    }
+
+    m_group = nullptr;
+    m_entries.clear();
+
+    if (!m_bulkChange) {
+        endResetModel();
+    }
+}
+
+void EntryModel::bulkChangeStarted()
+{
+    if (!m_bulkChange) {
+        m_bulkChange = true;
+        beginResetModel();
+    }
+}
+
+void EntryModel::bulkChangeFinished()
+{
+    if (m_bulkChange) {
+        if (m_group) {
+            m_entries = m_group->entries();
+        }
+        m_bulkChange = false;
+        endResetModel();
+    }
+}
@@ -20,6 +20,7 @@
 
 #include <QAbstractTableModel>
 
+class Database;
 class Entry;
 class Group;
 
@@ -65,15 +66,22 @@ private slots:
     void entryAboutToRemove(Entry* entry);
     void entryRemoved();
     void entryDataChanged(Entry* entry);
+    void groupDestroyed();
+    void bulkChangeStarted();
+    void bulkChangeFinished();
 
 private:
     void severConnections();
     void makeConnections(const Group* group);
+    void makeConnections(const Database* db);
 
     Group* m_group;
     QList<Entry*> m_entries;
     QList<Entry*> m_orgEntries;
     QList<const Group*> m_allGroups;
+    QList<const Database*> m_databases;
+    // a model reset is in progress until the database finishes its bulk change
+    bool m_bulkChange;
 };
 
 #endif // KEEPASSX_ENTRYMODEL_H
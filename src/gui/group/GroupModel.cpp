@@ -50,6 +50,8 @@ void GroupModel::changeDatabase(Database* newDb)
     connect(m_db, SIGNAL(groupRemoved()), SLOT(groupRemoved()));
     connect(m_db, SIGNAL(groupAboutToMove(Group*,Group*,int)), SLOT(groupAboutToMove(Group*,Group*,int)));
     connect(m_db, SIGNAL(groupMoved()), SLOT(groupMoved()));
+    connect(m_db, SIGNAL(bulkChangeStarted()), SLOT(bulkChangeStarted()));
+    connect(m_db, SIGNAL(bulkChangeFinished()), SLOT(bulkChangeFinished()));
 
     endResetModel();
 }
@@ -278,6 +280,7 @@ bool GroupModel::dropMimeData(const QMimeData* data, Qt::DropAction action,
             return false;
         }
 
+        QList<Entry*> dragEntries;
         while (!stream.atEnd()) {
             Uuid dbUuid;
             Uuid entryUuid;
@@ -293,6 +296,17 @@ bool GroupModel::dropMimeData(const QMimeData* data, Qt::DropAction action,
                 continue;
             }
 
+            dragEntries.append(dragEntry);
+        }
+
+        // moving many entries resets the models once instead of once per entry
+        Database* targetDb = parentGroup->database();
+        bool bulkChange = dragEntries.size() > 1;
+        if (bulkChange) {
+            targetDb->beginBulkChange();
+        }
+
+        for (Entry* dragEntry : asConst(dragEntries)) {
             Entry* entry;
             if (action == Qt::MoveAction) {
                 entry = dragEntry;
@@ -302,7 +316,6 @@ bool GroupModel::dropMimeData(const QMimeData* data, Qt::DropAction action,
             }
 
             Database* sourceDb = dragEntry->group()->database();
-            Database* targetDb = parentGroup->database();
             Uuid customIcon = entry->iconUuid();
 
             if (sourceDb != targetDb && !customIcon.isNull()
@@ -313,6 +326,10 @@ bool GroupModel::dropMimeData(const QMimeData* data, Qt::DropAction action,
 
             entry->setGroup(parentGroup);
         }
+
+        if (bulkChange) {
+            targetDb->endBulkChange();
+        }
     }
 
     return true;
@@ -364,12 +381,20 @@ QMimeData* GroupModel::mimeData(const QModelIndexList& indexes) const
 
 void GroupModel::groupDataChanged(Group* group)
 {
+    if (m_db->isBulkChange()) {
+        return;
+    }
+
     QModelIndex ix = index(group);
     emit dataChanged(ix, ix);
 }
 
 void GroupModel::groupAboutToRemove(Group* group)
 {
+    if (m_db->isBulkChange()) {
+        return;
+    }
+
     Q_ASSERT(group->parentGroup());
 
     QModelIndex parentIndex = parent(group);
@@ -382,11 +407,19 @@ void GroupModel::groupAboutToRemove(Group* group)
 
 void GroupModel::groupRemoved()
 {
+    if (m_db->isBulkChange()) {
+        return;
+    }
+
     endRemoveRows();
 }
 
 void GroupModel::groupAboutToAdd(Group* group, int index)
 {
+    if (m_db->isBulkChange()) {
+        return;
+    }
+
     Q_ASSERT(group->parentGroup());
 
     QModelIndex parentIndex = parent(group);
@@ -396,11 +429,19 @@ void GroupModel::groupAboutToAdd(Group* group, int index)
 
 void GroupModel::groupAdded()
 {
+    if (m_db->isBulkChange()) {
+        return;
+    }
+
     endInsertRows();
 }
 
 void GroupModel::groupAboutToMove(Group* group, Group* toGroup, int pos)
 {
+    if (m_db->isBulkChange()) {
+        return;
+    }
+
     Q_ASSERT(group->parentGroup());
 
     QModelIndex oldParentIndex = parent(group);
@@ -419,5 +460,20 @@ void GroupModel::groupAboutToMove(Group* group, Group* toGroup, int pos)
 
 void GroupModel::groupMoved()
 {
+    if (m_db->isBulkChange()) {
+        return;
+    }
+
     endMoveRows();
 }
+
+void GroupModel::bulkChangeStarted()
+{
+    // the per group signals are ignored until the model is reset
+    beginResetModel();
+}
+
+void GroupModel::bulkChangeFinished()
+{
+    endResetModel();
+}
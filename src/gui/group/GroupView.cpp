@@ -37,6 +37,7 @@ GroupView::GroupView(Database* db, QWidget* parent)
     connect(this, SIGNAL(expanded(QModelIndex)), this, SLOT(expandedChanged(QModelIndex)));
     connect(this, SIGNAL(collapsed(QModelIndex)), this, SLOT(expandedChanged(QModelIndex)));
     connect(m_model, SIGNAL(rowsInserted(QModelIndex,int,int)), SLOT(syncExpandedState(QModelIndex,int,int)));
+    connect(m_model, SIGNAL(modelAboutToBeReset()), SLOT(modelAboutToBeReset()));
     connect(m_model, SIGNAL(modelReset()), SLOT(modelReset()));
 
     connect(selectionModel(), SIGNAL(currentChanged(QModelIndex,QModelIndex)), SLOT(emitGroupChanged()));
@@ -149,8 +150,22 @@ void GroupView::setCurrentGroup(Group* group)
         setCurrentIndex(m_model->index(group));
 }
 
+void GroupView::modelAboutToBeReset()
+{
+    Group* group = currentGroup();
+    m_currentGroupUuid = group ? group->uuid() : Uuid();
+}
+
 void GroupView::modelReset()
 {
-    recInitExpanded(m_model->groupFromIndex(m_model->index(0, 0)));
-    setCurrentIndex(m_model->index(0, 0));
+    Group* rootGroup = m_model->groupFromIndex(m_model->index(0, 0));
+    recInitExpanded(rootGroup);
+
+    // stay on the current group if it still exists, e.g. after a bulk change
+    Group* group = nullptr;
+    if (!m_currentGroupUuid.isNull()) {
+        group = rootGroup->findChildByUuid(m_currentGroupUuid);
+        m_currentGroupUuid = Uuid();
+    }
+    setCurrentIndex(group ? m_model->index(group) : m_model->index(0, 0));
 }
@@ -20,6 +20,8 @@
 
 #include <QTreeView>
 
+#include "core/Uuid.h"
+
 class Database;
 class Group;
 class GroupModel;
@@ -46,6 +48,7 @@ private slots:
     void emitGroupChanged();
     void emitGroupPressed(const QModelIndex& index);
     void syncExpandedState(const QModelIndex& parent, int start, int end);
+    void modelAboutToBeReset();
     void modelReset();
 
 protected:
@@ -56,6 +59,7 @@ private:
 
     GroupModel* const m_model;
     bool m_updatingExpanded;
+    Uuid m_currentGroupUuid;
 };
 
 #endif // KEEPASSX_GROUPVIEW_H
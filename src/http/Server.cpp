@@ -17,6 +17,7 @@
 */
 
 #include <QEventLoop>
+#include <QPointer>
 #include <QtCore/QHash>
 #include <QtCore/QCryptographicHash>
 #include <QtWidgets/QMessageBox>
@@ -143,11 +144,11 @@ void Server::generatePassword(const Request &r, Response *protocolResp)
     memset(password.data(), 0, password.length());
 }
 
-void Server::handleRequest(const QByteArray& data, QHttpResponse* response)
+QByteArray Server::handleRequest(const QByteArray& data)
 {
     Request r;
     if (!r.fromJson(data))
-        return;
+        return QByteArray();
 
     QByteArray hash = QCryptographicHash::hash(
         (getDatabaseRootUuid() + getDatabaseRecycleBinUuid()).toUtf8(),
@@ -182,9 +183,7 @@ void Server::handleRequest(const QByteArray& data, QHttpResponse* response)
         out.replace(pos2, 15, "\"Entries\":[],");
     }
 
-    response->setStatusCode(qhttp::ESTATUS_OK);
-    response->addHeader("Content-Type", "application/json");
-    response->end(out.toUtf8());
+    return out.toUtf8();
 }
 
 void Server::start(void)
@@ -212,6 +211,9 @@ void Server::stop(void)
     m_server->stopListening();
     m_server->deleteLater();
     m_started = false;
+
+    //Wait for the requests that are still running
+    m_executor.waitForDone();
 }
 
 void Server::onNewRequest(QHttpRequest* request, QHttpResponse* response)
@@ -224,9 +226,25 @@ void Server::onNewRequest(QHttpRequest* request, QHttpResponse* response)
         }
     }
 
+    //Requests are queued by response, drop them once it's gone
+    connect(response, &QObject::destroyed, this, [this, response]() {
+        m_executor.cancel(response);
+    });
+
     request->collectData(1024);
 
     request->onEnd([=]() {
-        this->handleRequest(request->collectedData(), response);
+        //Handle the request on a worker thread and reply from this one
+        const QByteArray data = request->collectedData();
+        QPointer<QHttpResponse> target(response);
+        m_executor.submit(response, [this, data]() {
+            return this->handleRequest(data);
+        }, [target](const QByteArray& reply) {
+            if (!target || reply.isNull())
+                return;
+            target->setStatusCode(qhttp::ESTATUS_OK);
+            target->addHeader("Content-Type", "application/json");
+            target->end(reply);
+        });
     });
 }
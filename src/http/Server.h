@@ -22,6 +22,8 @@
 #include <QtCore/QObject>
 #include <QtCore/QList>
 
+#include "core/RequestExecutor.h"
+
 namespace qhttp {
     namespace server {
         class QHttpServer;
@@ -63,9 +65,9 @@ public slots:
 
 private slots:
     void onNewRequest(QHttpRequest* request, QHttpResponse* response);
-    void handleRequest(const QByteArray& data, QHttpResponse* response);
 
 private:
+    QByteArray handleRequest(const QByteArray& data);
     void testAssociate(const KeepassHttpProtocol::Request &r, KeepassHttpProtocol::Response *protocolResp);
     void associate(const KeepassHttpProtocol::Request &r, KeepassHttpProtocol::Response *protocolResp);
     void getLogins(const KeepassHttpProtocol::Request &r, KeepassHttpProtocol::Response *protocolResp);
@@ -77,6 +79,8 @@ private:
     bool m_started;
 
     QHttpServer* m_server;
+    //Requests are handled on worker threads, see Service for what runs on the GUI thread
+    RequestExecutor m_executor;
 };
 
 }   /*namespace KeepassHttpProtocol*/
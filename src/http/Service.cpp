@@ -19,6 +19,8 @@
 #include <QInputDialog>
 #include <QMessageBox>
 #include <QProgressDialog>
+#include <QThread>
+#include <QtConcurrent>
 
 #include "Service.h"
 #include "Protocol.h"
@@ -30,7 +32,6 @@
 #include "core/Entry.h"
 #include "core/Global.h"
 #include "core/Group.h"
-#include "core/EntrySearcher.h"
 #include "core/Metadata.h"
 #include "core/Uuid.h"
 #include "core/PasswordGenerator.h"
@@ -56,25 +57,44 @@ Service::Service(DatabaseTabWidget* parent) :
         start();
 }
 
+Service::~Service()
+{
+    stop();
+}
+
 Entry* Service::getConfigEntry(bool create)
 {
     if (DatabaseWidget * dbWidget = m_dbTabWidget->currentDatabaseWidget())
-        if (Database * db = dbWidget->database()) {
-            Entry* entry = db->resolveEntry(KEEPASSHTTP_UUID);
-            if (!entry && create) {
-                entry = new Entry();
-                entry->setTitle(QLatin1String(KEEPASSHTTP_NAME));
-                entry->setUuid(KEEPASSHTTP_UUID);
-                entry->setAutoTypeEnabled(false);
+        return getConfigEntry(dbWidget->database(), create);
+    return NULL;
+}
+
+Entry* Service::getConfigEntry(Database* db, bool create)
+{
+    if (db) {
+        Entry* entry = db->resolveEntry(KEEPASSHTTP_UUID);
+        if (!entry && create) {
+            entry = new Entry();
+            entry->setTitle(QLatin1String(KEEPASSHTTP_NAME));
+            entry->setUuid(KEEPASSHTTP_UUID);
+            entry->setAutoTypeEnabled(false);
+            entry->setGroup(db->rootGroup());
+        } else if (entry && entry->group() == db->metadata()->recycleBin()) {
+            if (create)
                 entry->setGroup(db->rootGroup());
-            } else if (entry && entry->group() == db->metadata()->recycleBin()) {
-                if (create)
-                    entry->setGroup(db->rootGroup());
-                else
-                    entry = NULL;
-            }
-            return entry;
+            else
+                entry = NULL;
         }
+        return entry;
+    }
+    return NULL;
+}
+
+Entry* Service::getSourceEntry(Entry* entry)
+{
+    Database* snapshot = entry->group() ? entry->group()->database() : NULL;
+    if (Database* db = snapshot ? snapshot->snapshotSource() : NULL)
+        return db->resolveEntry(entry->uuid());
     return NULL;
 }
 
@@ -123,25 +143,24 @@ bool Service::openDatabase()
 
 QString Service::getDatabaseRootUuid()
 {
-    if (DatabaseWidget* dbWidget = m_dbTabWidget->currentDatabaseWidget())
-        if (Database* db = dbWidget->database())
-            if (Group* rootGroup = db->rootGroup())
-                return rootGroup->uuid().toHex();
+    if (QSharedPointer<Database> db = getDatabaseSnapshots(false).value(0))
+        if (Group* rootGroup = db->rootGroup())
+            return rootGroup->uuid().toHex();
     return QString();
 }
 
 QString Service::getDatabaseRecycleBinUuid()
 {
-    if (DatabaseWidget* dbWidget = m_dbTabWidget->currentDatabaseWidget())
-        if (Database* db = dbWidget->database())
-            if (Group* recycleBin = db->metadata()->recycleBin())
-                return recycleBin->uuid().toHex();
+    if (QSharedPointer<Database> db = getDatabaseSnapshots(false).value(0))
+        if (Group* recycleBin = db->metadata()->recycleBin())
+            return recycleBin->uuid().toHex();
     return QString();
 }
 
 QString Service::getKey(const QString &id)
 {
-    if (Entry* config = getConfigEntry())
+    QSharedPointer<Database> db = getDatabaseSnapshots(false).value(0);
+    if (Entry* config = getConfigEntry(db.data(), false))
         return config->attributes()->value(QLatin1String(ASSOCIATE_KEY_PREFIX) + id);
     return QString();
 }
@@ -149,6 +168,13 @@ QString Service::getKey(const QString &id)
 QString Service::storeKey(const QString &key)
 {
     QString id;
+    if (thread() != QThread::currentThread()) {
+        QMetaObject::invokeMethod(this, "storeKey", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(QString, id),
+                                  Q_ARG(const QString&, key));
+        return id;
+    }
+
     if (Entry* config = getConfigEntry(true)) {
 
         //ShowNotification("New key association requested")
@@ -178,69 +204,59 @@ QString Service::storeKey(const QString &key)
     return id;
 }
 
-bool Service::matchUrlScheme(const QString & url)
-{
-    QString str = url.left(8).toLower();
-    return str.startsWith("http://") ||
-           str.startsWith("https://") ||
-           str.startsWith("ftp://") ||
-           str.startsWith("ftps://");
-}
-
-bool Service::removeFirstDomain(QString & hostname)
+QList<Entry*> Service::searchEntries(Database* db, const QString& hostname)
 {
-    int pos = hostname.indexOf(".");
-    if (pos < 0)
-        return false;
-    hostname = hostname.mid(pos + 1);
-    return !hostname.isEmpty();
+    return db->entriesForHost(hostname);
 }
 
-QList<Entry*> Service::searchEntries(Database* db, const QString& hostname)
+QList<Entry*> Service::searchEntries(const QList<QSharedPointer<Database>>& databases, const QString& text)
 {
+    //Search entries matching the hostname, or the most specific parent domain with matches
+    const QStringList hostnames = UrlIndex::hostKeys(QUrl(text).host());
     QList<Entry*> entries;
-    if (Group* rootGroup = db->rootGroup()) {
-        const auto results = EntrySearcher().search(hostname, rootGroup, Qt::CaseInsensitive);
-        for (Entry* entry: results) {
-            QString title = entry->title();
-            QString url = entry->webUrl();
-
-            //Filter to match hostname in Title and Url fields
-            if (   (!title.isEmpty() && hostname.contains(title))
-                || (!url.isEmpty() && hostname.contains(url))
-                || (matchUrlScheme(title) && hostname.endsWith(QUrl(title).host()))
-                || (matchUrlScheme(url) && hostname.endsWith(QUrl(url).host())) )
-                entries.append(entry);
+    for (const QString& hostname : hostnames) {
+        //One task per database, the first lookup of each also builds its URL index.
+        //The results are collected in tab order
+        QList<QFuture<QList<Entry*>>> futures;
+        for (const QSharedPointer<Database>& db : databases) {
+            Database* database = db.data();
+            futures << QtConcurrent::run([this, database, hostname]() {
+                return searchEntries(database, hostname);
+            });
+        }
+        for (QFuture<QList<Entry*>>& future : futures) {
+            entries << future.result();
+        }
+        if (!entries.isEmpty()) {
+            break;
         }
     }
+
     return entries;
 }
 
-QList<Entry*> Service::searchEntries(const QString& text)
+QList<QSharedPointer<Database>> Service::getDatabaseSnapshots(bool allDatabases)
 {
+    QList<QSharedPointer<Database>> snapshots;
+    if (thread() != QThread::currentThread()) {
+        QMetaObject::invokeMethod(this, "getDatabaseSnapshots", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(QList<QSharedPointer<Database>>, snapshots),
+                                  Q_ARG(bool, allDatabases));
+        return snapshots;
+    }
+
     //Get the list of databases to search
-    QList<Database*> databases;
-    if (HttpSettings::searchInAllDatabases()) {
+    if (allDatabases) {
         for (int i = 0; i < m_dbTabWidget->count(); i++)
             if (DatabaseWidget* dbWidget = qobject_cast<DatabaseWidget*>(m_dbTabWidget->widget(i)))
                 if (Database* db = dbWidget->database())
-                    databases << db;
+                    snapshots << db->readSnapshot();
     }
     else if (DatabaseWidget* dbWidget = m_dbTabWidget->currentDatabaseWidget()) {
         if (Database* db = dbWidget->database())
-            databases << db;
+            snapshots << db->readSnapshot();
     }
-
-    //Search entries matching the hostname
-    QString hostname = QUrl(text).host();
-    QList<Entry*> entries;
-    do {
-        for (Database* db: asConst(databases)) {
-            entries << searchEntries(db, hostname);
-        }
-    } while(entries.isEmpty() && removeFirstDomain(hostname));
-
-    return entries;
+    return snapshots;
 }
 
 Service::Access Service::checkAccess(const Entry *entry, const QString & host, const QString & submitHost, const QString & realm)
@@ -277,11 +293,10 @@ KeepassHttpProtocol::Entry Service::prepareEntry(const Entry* entry)
 
 int Service::sortPriority(const Entry* entry, const QString& host, const QString& submitUrl, const QString& baseSubmitUrl) const
 {
-    QUrl url(entry->url());
-    if (url.scheme().isEmpty())
-        url.setScheme("http");
-    const QString entryURL = url.toString(QUrl::StripTrailingSlash);
-    const QString baseEntryURL = url.toString(QUrl::StripTrailingSlash | QUrl::RemovePath | QUrl::RemoveQuery | QUrl::RemoveFragment);
+    const Database* db = entry->group() ? entry->group()->database() : nullptr;
+    const UrlIndex::EntryUrl url = db ? db->indexedUrl(entry) : UrlIndex::parseUrl(entry->url());
+    const QString& entryURL = url.url;
+    const QString& baseEntryURL = url.baseUrl;
 
     if (submitUrl == entryURL)
         return 100;
@@ -334,10 +349,13 @@ QList<KeepassHttpProtocol::Entry> Service::findMatchingEntries(const QString& /*
     const QString host = QUrl(url).host();
     const QString submitHost = QUrl(submitUrl).host();
 
+    //Search snapshots of the databases, the GUI thread is only needed to confirm access
+    const QList<QSharedPointer<Database>> databases = getDatabaseSnapshots(HttpSettings::searchInAllDatabases());
+
     //Check entries for authorization
     QList<Entry*> pwEntriesToConfirm;
     QList<Entry*> pwEntries;
-    const auto entries = searchEntries(url);
+    const auto entries = searchEntries(databases, url);
     for (Entry* entry: entries) {
         switch(checkAccess(entry, host, submitHost, realm)) {
         case Denied:
@@ -363,35 +381,8 @@ QList<KeepassHttpProtocol::Entry> Service::findMatchingEntries(const QString& /*
     //                                 .arg(id).arg(submitHost.isEmpty() ? host : submithost));
     //    pwEntriesToConfirm.clear(); //timeout --> do not request confirmation
 
-    if (!pwEntriesToConfirm.isEmpty()) {
-
-        AccessControlDialog dlg;
-        dlg.setUrl(url);
-        dlg.setItems(pwEntriesToConfirm);
-        //dlg.setRemember();        //TODO: setting!
-
-        int res = dlg.exec();
-        if (dlg.remember()) {
-            for (Entry* entry: asConst(pwEntriesToConfirm)) {
-                EntryConfig config;
-                config.load(entry);
-                if (res == QDialog::Accepted) {
-                    config.allow(host);
-                    if (!submitHost.isEmpty() && host != submitHost)
-                        config.allow(submitHost);
-                } else if (res == QDialog::Rejected) {
-                    config.deny(host);
-                    if (!submitHost.isEmpty() && host != submitHost)
-                        config.deny(submitHost);
-                }
-                if (!realm.isEmpty())
-                    config.setRealm(realm);
-                config.save(entry);
-            }
-        }
-        if (res == QDialog::Accepted)
-            pwEntries.append(pwEntriesToConfirm);
-    }
+    if (!pwEntriesToConfirm.isEmpty() && confirmEntries(pwEntriesToConfirm, url, host, submitHost, realm))
+        pwEntries.append(pwEntriesToConfirm);
 
     //Sort results
     const bool sortSelection = true;
@@ -422,23 +413,67 @@ QList<KeepassHttpProtocol::Entry> Service::findMatchingEntries(const QString& /*
     return result;
 }
 
+bool Service::confirmEntries(const QList<Entry*>& pwEntriesToConfirm, const QString& url, const QString& host, const QString& submitHost, const QString& realm)
+{
+    if (thread() != QThread::currentThread()) {
+        bool result = false;
+        QMetaObject::invokeMethod(this, "confirmEntries", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, result),
+                                  Q_ARG(const QList<Entry*>&, pwEntriesToConfirm),
+                                  Q_ARG(const QString&, url),
+                                  Q_ARG(const QString&, host),
+                                  Q_ARG(const QString&, submitHost),
+                                  Q_ARG(const QString&, realm));
+        return result;
+    }
+
+    AccessControlDialog dlg;
+    dlg.setUrl(url);
+    dlg.setItems(pwEntriesToConfirm);
+    //dlg.setRemember();        //TODO: setting!
+
+    int res = dlg.exec();
+    if (dlg.remember()) {
+        for (Entry* snapshotEntry: pwEntriesToConfirm) {
+            //The permissions are stored in the database the entry was found in a snapshot of
+            Entry* entry = getSourceEntry(snapshotEntry);
+            if (!entry)
+                continue;
+
+            EntryConfig config;
+            config.load(entry);
+            if (res == QDialog::Accepted) {
+                config.allow(host);
+                if (!submitHost.isEmpty() && host != submitHost)
+                    config.allow(submitHost);
+            } else if (res == QDialog::Rejected) {
+                config.deny(host);
+                if (!submitHost.isEmpty() && host != submitHost)
+                    config.deny(submitHost);
+            }
+            if (!realm.isEmpty())
+                config.setRealm(realm);
+            config.save(entry);
+        }
+    }
+    return res == QDialog::Accepted;
+}
+
 int Service::countMatchingEntries(const QString &, const QString &url, const QString &, const QString &)
 {
-    return searchEntries(url).count();
+    return searchEntries(getDatabaseSnapshots(HttpSettings::searchInAllDatabases()), url).count();
 }
 
 QList<KeepassHttpProtocol::Entry> Service::searchAllEntries(const QString &)
 {
     QList<KeepassHttpProtocol::Entry> result;
-    if (DatabaseWidget* dbWidget = m_dbTabWidget->currentDatabaseWidget()) {
-        if (Database* db = dbWidget->database()) {
-            if (Group* rootGroup = db->rootGroup()) {
-                const auto entries = rootGroup->entriesRecursive();
-                for (Entry* entry: entries) {
-                    if (!entry->url().isEmpty() || QUrl(entry->title()).isValid()) {
-                        result << KeepassHttpProtocol::Entry(entry->title(), entry->username(),
-                                                             QString(), entry->uuid().toHex());
-                    }
+    if (QSharedPointer<Database> db = getDatabaseSnapshots(false).value(0)) {
+        if (Group* rootGroup = db->rootGroup()) {
+            const auto entries = rootGroup->entriesRecursive();
+            for (Entry* entry: entries) {
+                if (!entry->url().isEmpty() || QUrl(entry->title()).isValid()) {
+                    result << KeepassHttpProtocol::Entry(entry->title(), entry->username(),
+                                                         QString(), entry->uuid().toHex());
                 }
             }
         }
@@ -472,8 +507,19 @@ Group * Service::findCreateAddEntryGroup()
     return NULL;
 }
 
-void Service::addEntry(const QString &, const QString &login, const QString &password, const QString &url, const QString &submitUrl, const QString &realm)
+void Service::addEntry(const QString &id, const QString &login, const QString &password, const QString &url, const QString &submitUrl, const QString &realm)
 {
+    if (thread() != QThread::currentThread()) {
+        QMetaObject::invokeMethod(this, "addEntry", Qt::BlockingQueuedConnection,
+                                  Q_ARG(const QString&, id),
+                                  Q_ARG(const QString&, login),
+                                  Q_ARG(const QString&, password),
+                                  Q_ARG(const QString&, url),
+                                  Q_ARG(const QString&, submitUrl),
+                                  Q_ARG(const QString&, realm));
+        return;
+    }
+
     if (Group * group = findCreateAddEntryGroup()) {
         Entry * entry = new Entry();
         entry->setUuid(Uuid::random());
@@ -496,8 +542,18 @@ void Service::addEntry(const QString &, const QString &login, const QString &pas
     }
 }
 
-void Service::updateEntry(const QString &, const QString &uuid, const QString &login, const QString &password, const QString &url)
+void Service::updateEntry(const QString &id, const QString &uuid, const QString &login, const QString &password, const QString &url)
 {
+    if (thread() != QThread::currentThread()) {
+        QMetaObject::invokeMethod(this, "updateEntry", Qt::BlockingQueuedConnection,
+                                  Q_ARG(const QString&, id),
+                                  Q_ARG(const QString&, uuid),
+                                  Q_ARG(const QString&, login),
+                                  Q_ARG(const QString&, password),
+                                  Q_ARG(const QString&, url));
+        return;
+    }
+
     if (DatabaseWidget * dbWidget = m_dbTabWidget->currentDatabaseWidget())
         if (Database * db = dbWidget->database())
             if (Entry * entry = db->resolveEntry(Uuid::fromHex(uuid))) {
@@ -21,6 +21,7 @@
 
 #include <QObject>
 #include "gui/DatabaseTabWidget.h"
+#include "core/Database.h"
 #include "Server.h"
 
 class Service : public KeepassHttpProtocol::Server
@@ -29,36 +30,42 @@ class Service : public KeepassHttpProtocol::Server
 
 public:
     explicit Service(DatabaseTabWidget* parent = 0);
+    ~Service();
 
     virtual bool isDatabaseOpened() const;
     virtual bool openDatabase();
     virtual QString getDatabaseRootUuid();
     virtual QString getDatabaseRecycleBinUuid();
     virtual QString getKey(const QString& id);
-    virtual QString storeKey(const QString& key);
     virtual QList<KeepassHttpProtocol::Entry> findMatchingEntries(const QString& id, const QString& url, const QString&  submitUrl, const QString&  realm);
     virtual int countMatchingEntries(const QString& id, const QString& url, const QString&  submitUrl, const QString&  realm);
     virtual QList<KeepassHttpProtocol::Entry> searchAllEntries(const QString& id);
-    virtual void addEntry(const QString& id, const QString& login, const QString& password, const QString& url, const QString& submitUrl, const QString& realm);
-    virtual void updateEntry(const QString& id, const QString& uuid, const QString& login, const QString& password, const QString& url);
     virtual QString generatePassword();
 
 public slots:
+    //Dialogs and changes to the database are run on the GUI thread
+    virtual QString storeKey(const QString& key);
+    virtual void addEntry(const QString& id, const QString& login, const QString& password, const QString& url, const QString& submitUrl, const QString& realm);
+    virtual void updateEntry(const QString& id, const QString& uuid, const QString& login, const QString& password, const QString& url);
     void removeSharedEncryptionKeys();
     void removeStoredPermissions();
 
+private slots:
+    QList<QSharedPointer<Database>> getDatabaseSnapshots(bool allDatabases);
+    bool confirmEntries(const QList<Entry*>& pwEntriesToConfirm, const QString& url, const QString& host, const QString& submitHost, const QString& realm);
+
 private:
     enum Access { Denied, Unknown, Allowed};
     Entry* getConfigEntry(bool create = false);
-    bool matchUrlScheme(const QString& url);
+    Entry* getConfigEntry(Database* db, bool create);
+    Entry* getSourceEntry(Entry* entry);
     Access checkAccess(const Entry* entry, const QString&  host, const QString&  submitHost, const QString&  realm);
-    bool removeFirstDomain(QString& hostname);
     Group *findCreateAddEntryGroup();
     class SortEntries;
     int sortPriority(const Entry *entry, const QString &host, const QString &submitUrl, const QString &baseSubmitUrl) const;
     KeepassHttpProtocol::Entry prepareEntry(const Entry* entry);
     QList<Entry*> searchEntries(Database* db, const QString& hostname);
-    QList<Entry*> searchEntries(const QString& text);
+    QList<Entry*> searchEntries(const QList<QSharedPointer<Database>>& databases, const QString& text);
 
     DatabaseTabWidget * const m_dbTabWidget;
 };
@@ -23,6 +23,7 @@
 #include <QString>
 #include <QSharedPointer>
 
+#include "crypto/kdf/Kdf.h"
 #include "keys/Key.h"
 #include "keys/ChallengeResponseKey.h"
 
@@ -38,19 +39,13 @@ public:
     CompositeKey& operator=(const CompositeKey& key);
 
     QByteArray rawKey() const;
-    QByteArray transform(const QByteArray& seed, quint64 rounds,
-                         bool* ok, QString* errorString) const;
+    bool transform(const Kdf& kdf, QByteArray& result) const;
     bool challenge(const QByteArray& seed, QByteArray &result) const;
 
     void addKey(const Key& key);
     void addChallengeResponseKey(QSharedPointer<ChallengeResponseKey> key);
 
-    static int transformKeyBenchmark(int msec);
-
 private:
-    static QByteArray transformKeyRaw(const QByteArray& key, const QByteArray& seed,
-                                      quint64 rounds, bool* ok, QString* errorString);
-
     QList<Key*> m_keys;
     QList<QSharedPointer<ChallengeResponseKey>> m_challengeResponseKeys;
 };
@@ -38,32 +38,27 @@ NativeMessagingHost::~NativeMessagingHost()
 #endif
 }
 
-void NativeMessagingHost::readLength()
+void NativeMessagingHost::handleNativeMessage(const QByteArray& message)
 {
-    quint32 length = 0;
-    std::cin.read(reinterpret_cast<char*>(&length), 4);
-    if (!std::cin.eof() && length > 0) {
-        readStdIn(length);
+    // messages are read on a separate thread on Windows
+    QMetaObject::invokeMethod(this, "sendToLocalServer", Qt::QueuedConnection,
+                              Q_ARG(QByteArray, frameMessage(message)));
+}
+
+void NativeMessagingHost::sendToLocalServer(const QByteArray& frame)
+{
+    // requests arriving before the connection is established are sent afterwards
+    if (m_localSocket && m_localSocket->state() == QLocalSocket::ConnectedState) {
+        m_localSocket->write(frame);
+        m_localSocket->flush();
     } else {
-    	QCoreApplication::quit();
+        m_pendingMessages.append(frame);
     }
 }
 
-void NativeMessagingHost::readStdIn(const quint32 length)
+void NativeMessagingHost::nativeInputClosed()
 {
-    if (length > 0) {
-        QByteArray arr;
-        arr.reserve(length);
-
-        for (quint32 i = 0; i < length; ++i) {
-            arr.append(getchar());
-        }
-
-        if (arr.length() > 0 && m_localSocket && m_localSocket->state() == QLocalSocket::ConnectedState) {
-            m_localSocket->write(arr.constData(), arr.length());
-            m_localSocket->flush();
-        }
-    }
+    QMetaObject::invokeMethod(QCoreApplication::instance(), "quit", Qt::QueuedConnection);
 }
 
 void NativeMessagingHost::newLocalMessage()
@@ -72,9 +67,16 @@ void NativeMessagingHost::newLocalMessage()
         return;
     }
 
-    QByteArray arr = m_localSocket->readAll();
-    if (!arr.isEmpty()) {
-       sendReply(arr);
+    // a read may contain several replies or only part of one
+    m_socketBuffer.append(m_localSocket->readAll());
+
+    QList<QByteArray> messages;
+    if (!takeFramedMessages(m_socketBuffer, &messages)) {
+        m_localSocket->disconnectFromServer();
+    }
+
+    for (const QByteArray& message : messages) {
+        sendReply(message);
     }
 }
 
@@ -91,5 +93,11 @@ void NativeMessagingHost::socketStateChanged(QLocalSocket::LocalSocketState sock
 {
     if (socketState == QLocalSocket::UnconnectedState || socketState == QLocalSocket::ClosingState) {
         m_running.testAndSetOrdered(true, false);
+    } else if (socketState == QLocalSocket::ConnectedState && !m_pendingMessages.isEmpty()) {
+        for (const QByteArray& frame : m_pendingMessages) {
+            m_localSocket->write(frame);
+        }
+        m_pendingMessages.clear();
+        m_localSocket->flush();
     }
 }
@@ -32,12 +32,17 @@ public slots:
     void deleteSocket();
     void socketStateChanged(QLocalSocket::LocalSocketState socketState);
 
+private slots:
+    void sendToLocalServer(const QByteArray& frame);
+
 private:
-    void readLength();
-    void readStdIn(const quint32 length);
+    void handleNativeMessage(const QByteArray& message) override;
+    void nativeInputClosed() override;
 
 private:
     QLocalSocket*                           m_localSocket;
+    QByteArray                              m_socketBuffer;
+    QList<QByteArray>                       m_pendingMessages;
 };
 
 #endif // NATIVEMESSAGINGHOST_H
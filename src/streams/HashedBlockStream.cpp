@@ -19,14 +19,22 @@
 
 #include <cstring>
 
+#include <QtConcurrent>
+
 #include "core/Endian.h"
 #include "crypto/CryptoHash.h"
 
 const QSysInfo::Endian HashedBlockStream::ByteOrder = QSysInfo::LittleEndian;
 
+namespace {
+    // smaller blocks are hashed inline, a worker thread isn't worth it for them
+    const int MinAsyncHashSize = 64 * 1024;
+}
+
 HashedBlockStream::HashedBlockStream(QIODevice* baseDevice)
     : LayeredStream(baseDevice)
-    , m_blockSize(1024*1024)
+    , m_blockSize(DefaultBlockSize)
+    , m_nextHashRunning(false)
 {
     init();
 }
@@ -34,22 +42,44 @@ HashedBlockStream::HashedBlockStream(QIODevice* baseDevice)
 HashedBlockStream::HashedBlockStream(QIODevice* baseDevice, qint32 blockSize)
     : LayeredStream(baseDevice)
     , m_blockSize(blockSize)
+    , m_nextHashRunning(false)
 {
+    Q_ASSERT(blockSize > 0);
+
     init();
 }
 
 HashedBlockStream::~HashedBlockStream()
 {
     close();
+    waitForHash();
+}
+
+qint32 HashedBlockStream::blockSize() const
+{
+    return m_blockSize;
 }
 
 void HashedBlockStream::init()
 {
+    waitForHash();
+
     m_buffer.clear();
     m_bufferPos = 0;
     m_blockIndex = 0;
     m_eof = false;
     m_error = false;
+    m_nextBuffer.clear();
+    m_nextHash.clear();
+    m_finalBlockRead = false;
+}
+
+void HashedBlockStream::waitForHash()
+{
+    if (m_nextHashRunning) {
+        m_nextHashFuture.waitForFinished();
+        m_nextHashRunning = false;
+    }
 }
 
 bool HashedBlockStream::reset()
@@ -127,6 +157,46 @@ qint64 HashedBlockStream::readData(char* data, qint64 maxSize)
 }
 
 bool HashedBlockStream::readHashedBlock()
+{
+    if (m_nextBuffer.isEmpty() && !m_finalBlockRead) {
+        if (!readAhead()) {
+            return false;
+        }
+    }
+
+    if (m_nextBuffer.isEmpty()) {
+        m_eof = true;
+        return false;
+    }
+
+    QByteArray block = m_nextBuffer;
+    QByteArray expectedHash = m_nextHash;
+    QFuture<QByteArray> hashFuture = m_nextHashFuture;
+    bool hashRunning = m_nextHashRunning;
+    m_nextBuffer.clear();
+    m_nextHashRunning = false;
+
+    // read (and thereby decrypt) the following block while this one is hashed
+    bool ok = m_finalBlockRead || readAhead();
+
+    QByteArray hash = hashRunning ? hashFuture.result() : CryptoHash::hash(block, CryptoHash::Sha256);
+    if (!ok) {
+        return false;
+    }
+
+    if (hash != expectedHash) {
+        m_error = true;
+        setErrorString("Mismatch between hash and data.");
+        return false;
+    }
+
+    m_buffer = block;
+    m_bufferPos = 0;
+
+    return true;
+}
+
+bool HashedBlockStream::readAhead()
 {
     bool ok;
 
@@ -144,38 +214,39 @@ bool HashedBlockStream::readHashedBlock()
         return false;
     }
 
-    m_blockSize = Endian::readInt32(m_baseDevice, ByteOrder, &ok);
-    if (!ok || m_blockSize < 0) {
+    qint32 blockSize = Endian::readInt32(m_baseDevice, ByteOrder, &ok);
+    if (!ok || blockSize < 0) {
         m_error = true;
         setErrorString("Invalid block size.");
         return false;
     }
 
-    if (m_blockSize == 0) {
+    if (blockSize == 0) {
         if (hash.count('\0') != 32) {
             m_error = true;
             setErrorString("Invalid hash of final block.");
             return false;
         }
 
-        m_eof = true;
-        return false;
+        m_finalBlockRead = true;
+        return true;
     }
 
-    m_buffer = m_baseDevice->read(m_blockSize);
-    if (m_buffer.size() != m_blockSize) {
+    QByteArray block = m_baseDevice->read(blockSize);
+    if (block.size() != blockSize) {
         m_error = true;
         setErrorString("Block too short.");
         return false;
     }
 
-    if (hash != CryptoHash::hash(m_buffer, CryptoHash::Sha256)) {
-        m_error = true;
-        setErrorString("Mismatch between hash and data.");
-        return false;
+    m_nextBuffer = block;
+    m_nextHash = hash;
+    if (block.size() >= MinAsyncHashSize) {
+        m_nextHashFuture = QtConcurrent::run([block]() {
+            return CryptoHash::hash(block, CryptoHash::Sha256);
+        });
+        m_nextHashRunning = true;
     }
-
-    m_bufferPos = 0;
     m_blockIndex++;
 
     return true;
@@ -18,6 +18,7 @@
 #ifndef KEEPASSX_HASHEDBLOCKSTREAM_H
 #define KEEPASSX_HASHEDBLOCKSTREAM_H
 
+#include <QFuture>
 #include <QSysInfo>
 
 #include "streams/LayeredStream.h"
@@ -27,10 +28,17 @@ class HashedBlockStream : public LayeredStream
     Q_OBJECT
 
 public:
+    static const qint32 DefaultBlockSize = 1024 * 1024;
+
     explicit HashedBlockStream(QIODevice* baseDevice);
     HashedBlockStream(QIODevice* baseDevice, qint32 blockSize);
     ~HashedBlockStream();
 
+    /**
+     * Size of the blocks that are written, readers accept any block size.
+     */
+    qint32 blockSize() const;
+
     bool reset() override;
     void close() override;
 
@@ -41,6 +49,8 @@ protected:
 private:
     void init();
     bool readHashedBlock();
+    bool readAhead();
+    void waitForHash();
     bool writeHashedBlock();
 
     static const QSysInfo::Endian ByteOrder;
@@ -50,6 +60,13 @@ private:
     quint32 m_blockIndex;
     bool m_eof;
     bool m_error;
+
+    // next block, read while the current one is being consumed
+    QByteArray m_nextBuffer;
+    QByteArray m_nextHash;
+    QFuture<QByteArray> m_nextHashFuture;
+    bool m_nextHashRunning;
+    bool m_finalBlockRead;
 };
 
 #endif // KEEPASSX_HASHEDBLOCKSTREAM_H
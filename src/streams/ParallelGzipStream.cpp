@@ -0,0 +1,212 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ParallelGzipStream.h"
+
+#include <cstring>
+
+#include <QThread>
+#include <QtConcurrent>
+
+#include <zlib.h>
+
+#include "core/Endian.h"
+
+namespace {
+    // deflate can only refer back this far, a longer dictionary is useless
+    const int DictionarySize = 32 * 1024;
+
+    // magic, deflate method, no flags, no mtime, no extra flags, OS unix
+    const char GzipHeader[] = { '\x1f', '\x8b', '\x08', '\x00', '\x00', '\x00', '\x00', '\x00', '\x00', '\x03' };
+}
+
+ParallelGzipStream::ParallelGzipStream(QIODevice* baseDevice, int compressionLevel)
+    : LayeredStream(baseDevice)
+    , m_compressionLevel(compressionLevel)
+    , m_maxChunks(2 * qMax(1, QThread::idealThreadCount()))
+    , m_crc(0)
+    , m_size(0)
+    , m_error(false)
+{
+    Q_ASSERT(compressionLevel >= 1 && compressionLevel <= 9);
+}
+
+ParallelGzipStream::~ParallelGzipStream()
+{
+    close();
+}
+
+bool ParallelGzipStream::open(QIODevice::OpenMode mode)
+{
+    if (mode & QIODevice::ReadOnly) {
+        qWarning("ParallelGzipStream::open: Only writing is supported.");
+        return false;
+    }
+
+    if (!LayeredStream::open(mode)) {
+        return false;
+    }
+
+    m_buffer.clear();
+    m_dictionary.clear();
+    m_crc = crc32(0L, Z_NULL, 0);
+    m_size = 0;
+    m_error = false;
+
+    return writeBase(QByteArray::fromRawData(GzipHeader, sizeof(GzipHeader)));
+}
+
+void ParallelGzipStream::close()
+{
+    if (isWritable() && !m_error) {
+        // the last chunk carries the final block even if it's empty
+        startChunk(true);
+        while (!m_chunks.isEmpty() && writeChunk()) {
+        }
+
+        if (!m_error) {
+            writeBase(Endian::int32ToBytes(static_cast<qint32>(m_crc), QSysInfo::LittleEndian)
+                      + Endian::int32ToBytes(static_cast<qint32>(m_size), QSysInfo::LittleEndian));
+        }
+    }
+
+    for (QFuture<Chunk>& chunk : m_chunks) {
+        chunk.waitForFinished();
+    }
+    m_chunks.clear();
+
+    LayeredStream::close();
+}
+
+qint64 ParallelGzipStream::readData(char* data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+
+    return -1;
+}
+
+qint64 ParallelGzipStream::writeData(const char* data, qint64 maxSize)
+{
+    Q_ASSERT(maxSize >= 0);
+
+    if (m_error) {
+        return -1;
+    }
+
+    qint64 offset = 0;
+
+    while (offset < maxSize) {
+        int bytesToCopy = static_cast<int>(qMin(maxSize - offset, static_cast<qint64>(ChunkSize - m_buffer.size())));
+        m_buffer.append(data + offset, bytesToCopy);
+        offset += bytesToCopy;
+
+        if (m_buffer.size() == ChunkSize) {
+            startChunk(false);
+
+            if (m_chunks.size() >= m_maxChunks && !writeChunk()) {
+                return -1;
+            }
+        }
+    }
+
+    return maxSize;
+}
+
+void ParallelGzipStream::startChunk(bool last)
+{
+    QByteArray data = m_buffer;
+    QByteArray dictionary = m_dictionary;
+    int level = m_compressionLevel;
+
+    m_chunks.enqueue(QtConcurrent::run([data, dictionary, level, last]() {
+        return compressChunk(data, dictionary, level, last);
+    }));
+
+    m_dictionary = m_buffer.right(DictionarySize);
+    m_buffer.clear();
+}
+
+bool ParallelGzipStream::writeChunk()
+{
+    Chunk chunk = m_chunks.dequeue().result();
+
+    if (!chunk.ok) {
+        m_error = true;
+        setErrorString(tr("Compression failed"));
+        return false;
+    }
+
+    m_crc = static_cast<quint32>(crc32_combine(m_crc, chunk.crc, chunk.size));
+    m_size += static_cast<quint32>(chunk.size);
+
+    return writeBase(chunk.data);
+}
+
+bool ParallelGzipStream::writeBase(const QByteArray& data)
+{
+    if (m_baseDevice->write(data) != data.size()) {
+        m_error = true;
+        setErrorString(m_baseDevice->errorString());
+        return false;
+    }
+
+    return true;
+}
+
+ParallelGzipStream::Chunk ParallelGzipStream::compressChunk(const QByteArray& data, const QByteArray& dictionary,
+                                                            int level, bool last)
+{
+    Chunk chunk;
+    chunk.size = data.size();
+    chunk.crc = static_cast<quint32>(crc32(crc32(0L, Z_NULL, 0),
+                                           reinterpret_cast<const Bytef*>(data.constData()), data.size()));
+    chunk.ok = false;
+
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+
+    // raw deflate, the gzip framing is written by the stream itself
+    if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return chunk;
+    }
+
+    if (!dictionary.isEmpty()) {
+        deflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(dictionary.constData()), dictionary.size());
+    }
+
+    // a sync flush adds a few bytes on top of the bound for a finished stream
+    chunk.data.resize(static_cast<int>(deflateBound(&stream, data.size())) + 16);
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    stream.avail_in = data.size();
+    stream.next_out = reinterpret_cast<Bytef*>(chunk.data.data());
+    stream.avail_out = chunk.data.size();
+
+    // non-final chunks end on a byte boundary so the next one can simply be appended
+    int result = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    if (last) {
+        chunk.ok = (result == Z_STREAM_END);
+    } else {
+        chunk.ok = (result == Z_OK && stream.avail_in == 0 && stream.avail_out > 0);
+    }
+
+    chunk.data.resize(chunk.data.size() - stream.avail_out);
+    deflateEnd(&stream);
+
+    return chunk;
+}
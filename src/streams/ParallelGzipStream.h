@@ -0,0 +1,76 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_PARALLELGZIPSTREAM_H
+#define KEEPASSX_PARALLELGZIPSTREAM_H
+
+#include <QFuture>
+#include <QQueue>
+
+#include "streams/LayeredStream.h"
+
+/**
+ * Write-only gzip stream that deflates independent chunks on worker threads.
+ * Every chunk is primed with the end of the previous one and flushed to a
+ * byte boundary, so the output is a single regular gzip member any inflater
+ * can read.
+ */
+class ParallelGzipStream : public LayeredStream
+{
+    Q_OBJECT
+
+public:
+    static const int ChunkSize = 128 * 1024;
+
+    /**
+     * @param compressionLevel zlib level, 1 is the fastest and 9 the best
+     */
+    explicit ParallelGzipStream(QIODevice* baseDevice, int compressionLevel = 6);
+    ~ParallelGzipStream();
+
+    bool open(QIODevice::OpenMode mode) override;
+    void close() override;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    struct Chunk
+    {
+        QByteArray data;
+        quint32 crc;
+        int size;
+        bool ok;
+    };
+
+    static Chunk compressChunk(const QByteArray& data, const QByteArray& dictionary, int level, bool last);
+    void startChunk(bool last);
+    bool writeChunk();
+    bool writeBase(const QByteArray& data);
+
+    const int m_compressionLevel;
+    const int m_maxChunks;
+    QByteArray m_buffer;
+    QByteArray m_dictionary;
+    QQueue<QFuture<Chunk>> m_chunks;
+    quint32 m_crc;
+    quint32 m_size;
+    bool m_error;
+};
+
+#endif // KEEPASSX_PARALLELGZIPSTREAM_H
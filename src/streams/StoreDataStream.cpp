@@ -38,6 +38,19 @@ QByteArray StoreDataStream::storedData() const
     return m_storedData;
 }
 
+bool StoreDataStream::storeRemainingData()
+{
+    // consumers may stop reading early, e.g. on a parse error
+    char buffer[16384];
+    qint64 bytesRead;
+
+    do {
+        bytesRead = read(buffer, sizeof(buffer));
+    } while (bytesRead > 0);
+
+    return bytesRead == 0;
+}
+
 qint64 StoreDataStream::readData(char* data, qint64 maxSize)
 {
     qint64 bytesRead = LayeredStream::readData(data, maxSize);
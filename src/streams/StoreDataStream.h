@@ -28,6 +28,7 @@ public:
     explicit StoreDataStream(QIODevice* baseDevice);
     bool open(QIODevice::OpenMode mode) override;
     QByteArray storedData() const;
+    bool storeRemainingData();
 
 protected:
     qint64 readData(char* data, qint64 maxSize) override;
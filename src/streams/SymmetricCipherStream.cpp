@@ -17,12 +17,22 @@
 
 #include "SymmetricCipherStream.h"
 
+#include <QBuffer>
+
+namespace {
+    // amount of data that is read from the base device and decrypted at once,
+    // a multiple of every supported block size
+    const int ChunkSize = 64 * 1024;
+}
+
 SymmetricCipherStream::SymmetricCipherStream(QIODevice* baseDevice, SymmetricCipher::Algorithm algo,
                                              SymmetricCipher::Mode mode, SymmetricCipher::Direction direction)
     : LayeredStream(baseDevice)
     , m_cipher(new SymmetricCipher(algo, mode, direction))
+    , m_streamCipher(mode == SymmetricCipher::Stream)
+    , m_memoryDevice(nullptr)
     , m_bufferPos(0)
-    , m_bufferFilling(false)
+    , m_eof(false)
     , m_error(false)
     , m_isInitalized(false)
     , m_dataWritten(false)
@@ -44,11 +54,18 @@ bool SymmetricCipherStream::init(const QByteArray& key, const QByteArray& iv)
     return m_isInitalized;
 }
 
+void SymmetricCipherStream::setReadFromMemory(bool enabled)
+{
+    m_memoryDevice = enabled ? qobject_cast<QBuffer*>(m_baseDevice) : nullptr;
+    Q_ASSERT(!enabled || m_memoryDevice);
+}
+
 void SymmetricCipherStream::resetInternalState()
 {
     m_buffer.clear();
+    m_pending.clear();
     m_bufferPos = 0;
-    m_bufferFilling = false;
+    m_eof = false;
     m_error = false;
     m_dataWritten = false;
     m_cipher->reset();
@@ -99,7 +116,7 @@ qint64 SymmetricCipherStream::readData(char* data, qint64 maxSize)
     qint64 offset = 0;
 
     while (bytesRemaining > 0) {
-        if ((m_bufferPos == m_buffer.size()) || m_bufferFilling) {
+        if (m_bufferPos == m_buffer.size()) {
             if (!readBlock()) {
                 if (m_error) {
                     return -1;
@@ -124,67 +141,115 @@ qint64 SymmetricCipherStream::readData(char* data, qint64 maxSize)
 
 bool SymmetricCipherStream::readBlock()
 {
-    QByteArray newData;
+    m_buffer.clear();
+    m_bufferPos = 0;
 
-    if (m_bufferFilling) {
-        newData.resize(m_cipher->blockSize() - m_buffer.size());
+    if (m_eof) {
+        return false;
     }
-    else {
-        m_buffer.clear();
-        newData.resize(m_cipher->blockSize());
+
+    if (m_memoryDevice && m_pending.isEmpty()) {
+        return readBlockFromMemory();
     }
 
-    int readResult = m_baseDevice->read(newData.data(), newData.size());
+    int blockSize = m_cipher->blockSize();
+
+    while (true) {
+        int pendingSize = m_pending.size();
+        m_pending.resize(pendingSize + ChunkSize);
 
-    if (readResult == -1) {
+        qint64 readResult = m_baseDevice->read(m_pending.data() + pendingSize, ChunkSize);
+
+        if (readResult == -1) {
+            m_pending.resize(pendingSize);
+            m_error = true;
+            setErrorString(m_baseDevice->errorString());
+            return false;
+        }
+
+        m_pending.resize(pendingSize + static_cast<int>(readResult));
+
+        if (readResult == 0) {
+            m_eof = true;
+
+            // a trailing incomplete block can't be decrypted, drop it
+            int size = m_streamCipher ? m_pending.size() : m_pending.size() - (m_pending.size() % blockSize);
+            bool result = size > 0 && decryptChunk(m_pending.constData(), size, true);
+            m_pending.clear();
+            return result;
+        }
+
+        int size;
+        if (m_streamCipher) {
+            size = m_pending.size();
+        }
+        else {
+            // hold back the last complete block until the end of the data is reached,
+            // it may be the one carrying the padding
+            int remainder = m_pending.size() % blockSize;
+            size = m_pending.size() - (remainder == 0 ? blockSize : remainder);
+        }
+
+        if (size > 0) {
+            bool result = decryptChunk(m_pending.constData(), size, false);
+            m_pending.remove(0, size);
+            return result;
+        }
+    }
+}
+
+bool SymmetricCipherStream::readBlockFromMemory()
+{
+    QBuffer* device = m_memoryDevice;
+    // the whole ciphertext is already in memory (e.g. a memory-mapped file),
+    // decrypt straight out of it instead of copying it chunk by chunk first
+    const QByteArray& data = device->data();
+    qint64 pos = device->pos();
+    qint64 available = data.size() - pos;
+
+    // a trailing incomplete block can't be decrypted, drop it
+    qint64 usable = m_streamCipher ? available : available - (available % m_cipher->blockSize());
+    bool finalChunk = usable <= ChunkSize;
+    int size = finalChunk ? static_cast<int>(usable) : ChunkSize;
+
+    if (!device->seek(finalChunk ? data.size() : pos + size)) {
         m_error = true;
-        setErrorString(m_baseDevice->errorString());
+        setErrorString(device->errorString());
         return false;
     }
-    else {
-        m_buffer.append(newData.left(readResult));
-    }
 
-    if (m_buffer.size() != m_cipher->blockSize()) {
-        m_bufferFilling = true;
+    m_eof = finalChunk;
+
+    return size > 0 && decryptChunk(data.constData() + pos, size, finalChunk);
+}
+
+bool SymmetricCipherStream::decryptChunk(const char* data, int size, bool finalChunk)
+{
+    bool ok;
+    m_buffer = m_cipher->process(QByteArray::fromRawData(data, size), &ok);
+    if (!ok) {
+        m_error = true;
+        setErrorString(m_cipher->errorString());
         return false;
     }
-    else {
-        if (!m_cipher->processInPlace(m_buffer)) {
+
+    if (finalChunk && !m_streamCipher) {
+        // PKCS7 padding
+        quint8 padLength = m_buffer.at(m_buffer.size() - 1);
+
+        if (padLength > m_cipher->blockSize()) {
+            // invalid padding
             m_error = true;
-            setErrorString(m_cipher->errorString());
+            setErrorString("Invalid padding.");
             return false;
         }
-        m_bufferPos = 0;
-        m_bufferFilling = false;
-
-        if (m_baseDevice->atEnd()) {
-            // PKCS7 padding
-            quint8 padLength = m_buffer.at(m_buffer.size() - 1);
-
-            if (padLength == m_cipher->blockSize()) {
-                Q_ASSERT(m_buffer == QByteArray(m_cipher->blockSize(), m_cipher->blockSize()));
-                // full block with just padding: discard
-                m_buffer.clear();
-                return false;
-            }
-            else if (padLength > m_cipher->blockSize()) {
-                // invalid padding
-                m_error = true;
-                setErrorString("Invalid padding.");
-                return false;
-            }
-            else {
-                Q_ASSERT(m_buffer.right(padLength) == QByteArray(padLength, padLength));
-                // resize buffer to strip padding
-                m_buffer.resize(m_cipher->blockSize() - padLength);
-                return true;
-            }
-        }
-        else {
-            return true;
-        }
+
+        Q_ASSERT(m_buffer.right(padLength) == QByteArray(padLength, padLength));
+        // resize buffer to strip padding
+        m_buffer.resize(m_buffer.size() - padLength);
     }
+
+    return !m_buffer.isEmpty();
 }
 
 qint64 SymmetricCipherStream::writeData(const char* data, qint64 maxSize)
@@ -200,22 +265,15 @@ qint64 SymmetricCipherStream::writeData(const char* data, qint64 maxSize)
     qint64 offset = 0;
 
     while (bytesRemaining > 0) {
-        int bytesToCopy = qMin(bytesRemaining, static_cast<qint64>(m_cipher->blockSize() - m_buffer.size()));
+        int bytesToCopy = qMin(bytesRemaining, static_cast<qint64>(ChunkSize - m_buffer.size()));
 
         m_buffer.append(data + offset, bytesToCopy);
 
         offset += bytesToCopy;
         bytesRemaining -= bytesToCopy;
 
-        if (m_buffer.size() == m_cipher->blockSize()) {
-            if (!writeBlock(false)) {
-                if (m_error) {
-                    return -1;
-                }
-                else {
-                    return maxSize - bytesRemaining;
-                }
-            }
+        if (!writeBlock(false)) {
+            return -1;
         }
     }
 
@@ -224,14 +282,26 @@ qint64 SymmetricCipherStream::writeData(const char* data, qint64 maxSize)
 
 bool SymmetricCipherStream::writeBlock(bool lastBlock)
 {
-    Q_ASSERT(lastBlock || (m_buffer.size() == m_cipher->blockSize()));
+    QByteArray remainder;
 
-    if (lastBlock) {
+    if (m_streamCipher) {
+        // stream ciphers need neither complete blocks nor padding
+    } else if (lastBlock) {
         // PKCS7 padding
-        int padLen = m_cipher->blockSize() - m_buffer.size();
+        int padLen = m_cipher->blockSize() - (m_buffer.size() % m_cipher->blockSize());
         for (int i = 0; i < padLen; i++) {
             m_buffer.append(static_cast<char>(padLen));
         }
+    } else {
+        // encrypt all complete blocks, keep the rest until more data arrives
+        int size = m_buffer.size() - (m_buffer.size() % m_cipher->blockSize());
+        remainder = m_buffer.mid(size);
+        m_buffer.resize(size);
+    }
+
+    if (m_buffer.isEmpty()) {
+        m_buffer = remainder;
+        return true;
     }
 
     if (!m_cipher->processInPlace(m_buffer)) {
@@ -246,7 +316,7 @@ bool SymmetricCipherStream::writeBlock(bool lastBlock)
         return false;
     }
     else {
-        m_buffer.clear();
+        m_buffer = remainder;
         return true;
     }
 }
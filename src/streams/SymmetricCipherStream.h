@@ -24,6 +24,8 @@
 #include "crypto/SymmetricCipher.h"
 #include "streams/LayeredStream.h"
 
+class QBuffer;
+
 class SymmetricCipherStream : public LayeredStream
 {
     Q_OBJECT
@@ -33,6 +35,12 @@ public:
                           SymmetricCipher::Mode mode, SymmetricCipher::Direction direction);
     ~SymmetricCipherStream();
     bool init(const QByteArray& key, const QByteArray& iv);
+    /**
+     * Decrypt straight out of the data of the base device instead of reading
+     * it in chunks. The base device has to be a QBuffer whose data doesn't
+     * change while reading, e.g. a memory-mapped file.
+     */
+    void setReadFromMemory(bool enabled);
     bool open(QIODevice::OpenMode mode) override;
     bool reset() override;
     void close() override;
@@ -46,10 +54,16 @@ private:
     bool readBlock();
     bool writeBlock(bool lastBlock);
 
+    bool readBlockFromMemory();
+    bool decryptChunk(const char* data, int size, bool finalChunk);
+
     const QScopedPointer<SymmetricCipher> m_cipher;
+    const bool m_streamCipher;
+    QBuffer* m_memoryDevice;
     QByteArray m_buffer;
+    QByteArray m_pending;
     int m_bufferPos;
-    bool m_bufferFilling;
+    bool m_eof;
     bool m_error;
     bool m_isInitalized;
     bool m_dataWritten;
@@ -283,6 +283,58 @@ void TestAutoType::testGlobalAutoTypeRegExp()
     m_test->clearActions();
 }
 
+void TestAutoType::testGlobalAutoTypeWildcardMatch()
+{
+    Entry* entry = new Entry();
+    entry->setGroup(m_group);
+    entry->setPassword("wildcard");
+    AutoTypeAssociations::Association association;
+    association.window = "Login - *";
+    association.sequence = "prefix";
+    entry->autoTypeAssociations()->add(association);
+    association.window = "*- Mail Client";
+    association.sequence = "suffix";
+    entry->autoTypeAssociations()->add(association);
+    association.window = "*Banking*";
+    association.sequence = "floating";
+    entry->autoTypeAssociations()->add(association);
+
+    m_test->setActiveWindowTitle("login - example.com");
+    m_autoType->performGlobalAutoType(m_dbList);
+    QCOMPARE(m_test->actionChars(), QString("prefix"));
+    m_test->clearActions();
+
+    m_test->setActiveWindowTitle("Inbox - mail client");
+    m_autoType->performGlobalAutoType(m_dbList);
+    QCOMPARE(m_test->actionChars(), QString("suffix"));
+    m_test->clearActions();
+
+    m_test->setActiveWindowTitle("My BANKING App");
+    m_autoType->performGlobalAutoType(m_dbList);
+    QCOMPARE(m_test->actionChars(), QString("floating"));
+    m_test->clearActions();
+
+    // changed patterns are matched on the next hotkey press
+    association.window = "Sign in - *";
+    association.sequence = "changed";
+    entry->autoTypeAssociations()->update(0, association);
+
+    m_test->setActiveWindowTitle("Login - example.com");
+    MessageBox::setNextAnswer(QMessageBox::Ok);
+    m_autoType->performGlobalAutoType(m_dbList);
+    QCOMPARE(m_test->actionChars(), QString());
+
+    m_test->setActiveWindowTitle("Sign in - example.com");
+    m_autoType->performGlobalAutoType(m_dbList);
+    QCOMPARE(m_test->actionChars(), QString("changed"));
+    m_test->clearActions();
+
+    entry->setAutoTypeEnabled(false);
+    MessageBox::setNextAnswer(QMessageBox::Ok);
+    m_autoType->performGlobalAutoType(m_dbList);
+    QCOMPARE(m_test->actionChars(), QString());
+}
+
 void TestAutoType::testAutoTypeSyntaxChecks()
 {
     // Huge sequence
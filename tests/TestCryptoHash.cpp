@@ -44,4 +44,11 @@ void TestCryptoHash::test()
     cryptoHash3.addData(QString("ssX").toLatin1());
     QCOMPARE(cryptoHash3.result(),
              QByteArray::fromHex("0b56e5f65263e747af4a833bd7dd7ad26a64d7a4de7c68e52364893dca0766b4"));
+
+    QByteArray result4 = CryptoHash::hash(source2, CryptoHash::Sha512);
+    QCOMPARE(result4, QByteArray::fromHex("0d41b612584ed39ff72944c29494573e40f4bb95283455fae2e0be1e3565aa9f"
+                                          "48057d59e6ffd777970e282871c25a549a2763e5b724794f312c97021c42f91d"));
+
+    QByteArray result5 = CryptoHash::hmac(source2, QString("KeePassXC").toLatin1(), CryptoHash::Sha256);
+    QCOMPARE(result5, QByteArray::fromHex("85e45299c9ffa6a17b6fd7107cf64c38df631e0c7744efd7219fd9f304086385"));
 }
@@ -24,6 +24,8 @@
 
 #include "config-keepassx-tests.h"
 #include "core/Database.h"
+#include "core/DatabaseSaver.h"
+#include "core/Entry.h"
 #include "crypto/Crypto.h"
 #include "keys/PasswordKey.h"
 #include "core/Metadata.h"
@@ -111,3 +113,415 @@ void TestDatabase::testEmptyRecycleBinWithHierarchicalData()
 
     delete db;
 }
+
+void TestDatabase::testSnapshot()
+{
+    QString filename = QString(KEEPASSX_TEST_DATA_DIR).append("/RecycleBinWithData.kdbx");
+    CompositeKey key;
+    key.addKey(PasswordKey("123"));
+    QScopedPointer<Database> db(Database::openDatabaseFile(filename, key));
+    QVERIFY(db);
+
+    QScopedPointer<Database> snapshot(db->snapshot());
+    QVERIFY(snapshot->uuid() != db->uuid());
+    QCOMPARE(snapshot->transformedMasterKey(), db->transformedMasterKey());
+    QVERIFY(snapshot->kdf() != db->kdf());
+
+    // the metadata points into the snapshot's own tree
+    QVERIFY(snapshot->metadata()->recycleBin());
+    QCOMPARE(snapshot->metadata()->recycleBin()->uuid(), db->metadata()->recycleBin()->uuid());
+    QCOMPARE(snapshot->metadata()->recycleBin()->database(), snapshot.data());
+
+    const QList<Entry*> entries = db->rootGroup()->entriesRecursive(true);
+    const QList<Entry*> snapshotEntries = snapshot->rootGroup()->entriesRecursive(true);
+    QCOMPARE(snapshotEntries.size(), entries.size());
+    for (int i = 0; i < entries.size(); ++i) {
+        QVERIFY(snapshotEntries[i] != entries[i]);
+        QCOMPARE(snapshotEntries[i]->uuid(), entries[i]->uuid());
+        QCOMPARE(snapshotEntries[i]->title(), entries[i]->title());
+        QCOMPARE(snapshotEntries[i]->timeInfo().locationChanged(), entries[i]->timeInfo().locationChanged());
+    }
+
+    // later edits don't show up in the snapshot
+    QString title = snapshotEntries.first()->title();
+    entries.first()->setTitle("changed");
+    QCOMPARE(snapshotEntries.first()->title(), title);
+}
+
+void TestDatabase::testReadSnapshot()
+{
+    QScopedPointer<Database> db(new Database());
+    Entry* entry = new Entry();
+    entry->setUuid(Uuid::random());
+    entry->setTitle("title");
+    entry->setGroup(db->rootGroup());
+
+    // readers share one snapshot until the database changes
+    QSharedPointer<Database> snapshot = db->readSnapshot();
+    QVERIFY(db->readSnapshot() == snapshot);
+    QCOMPARE(snapshot->snapshotSource(), db.data());
+    QVERIFY(!db->snapshotSource());
+
+    Entry* snapshotEntry = snapshot->resolveEntry(entry->uuid());
+    QVERIFY(snapshotEntry);
+    QVERIFY(snapshotEntry != entry);
+
+    entry->setTitle("changed");
+    QCOMPARE(snapshotEntry->title(), QString("title"));
+    QSharedPointer<Database> changed = db->readSnapshot();
+    QVERIFY(changed != snapshot);
+    QCOMPARE(changed->resolveEntry(entry->uuid())->title(), QString("changed"));
+
+    // snapshots held by readers outlive the database
+    db.reset();
+    QVERIFY(!changed->snapshotSource());
+    QCOMPARE(changed->resolveEntry(snapshotEntry->uuid())->title(), QString("changed"));
+}
+
+void TestDatabase::testSaveInBackground()
+{
+    QString filename = QString(KEEPASSX_TEST_DATA_DIR).append("/RecycleBinWithData.kdbx");
+    CompositeKey key;
+    key.addKey(PasswordKey("123"));
+    QScopedPointer<Database> db(Database::openDatabaseFile(filename, key));
+    QVERIFY(db);
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.close();
+
+    DatabaseSaver saver;
+    QSignalSpy spySaved(&saver, SIGNAL(saved(QString, QString)));
+    // only the last write reports a saver that is done, the tabs rely on it
+    QList<bool> runningWhenSaved;
+    connect(&saver, &DatabaseSaver::saved, [&saver, &runningWhenSaved]() {
+        runningWhenSaved.append(saver.isRunning());
+    });
+
+    saver.saveInBackground(db.data(), file.fileName());
+    QVERIFY(saver.isRunning());
+
+    // both requests are merged into one write of the latest state
+    db->metadata()->setName("first");
+    saver.saveInBackground(db.data(), file.fileName());
+    db->metadata()->setName("second");
+    saver.saveInBackground(db.data(), file.fileName());
+
+    QTRY_VERIFY(!saver.isRunning());
+    QCOMPARE(spySaved.count(), 2);
+    QCOMPARE(spySaved.at(1).at(1).toString(), QString());
+    QCOMPARE(runningWhenSaved, QList<bool>() << true << false);
+
+    QScopedPointer<Database> saved(Database::openDatabaseFile(file.fileName(), key));
+    QVERIFY(saved);
+    QCOMPARE(saved->metadata()->name(), QString("second"));
+}
+
+void TestDatabase::testUuidIndexMoves()
+{
+    QScopedPointer<Database> db(new Database());
+    Group* root = db->rootGroup();
+    QCOMPARE(db->resolveGroup(root->uuid()), root);
+
+    Group* group1 = new Group();
+    group1->setUuid(Uuid::random());
+    Group* group2 = new Group();
+    group2->setUuid(Uuid::random());
+    group2->setParent(group1);
+
+    Entry* entry = new Entry();
+    entry->setUuid(Uuid::random());
+    entry->setGroup(group2);
+
+    // a detached subtree becomes visible once it's added to the database
+    QVERIFY(!db->resolveGroup(group1->uuid()));
+    group1->setParent(root);
+    QCOMPARE(db->resolveGroup(group1->uuid()), group1);
+    QCOMPARE(db->resolveGroup(group2->uuid()), group2);
+    QCOMPARE(db->resolveEntry(entry->uuid()), entry);
+    QCOMPARE(root->findEntryByUuid(entry->uuid()), entry);
+    QCOMPARE(root->findChildByUuid(group2->uuid()), group2);
+
+    // moves within the database
+    group2->setParent(root);
+    entry->setGroup(group1);
+    QCOMPARE(db->resolveGroup(group2->uuid()), group2);
+    QCOMPARE(db->resolveEntry(entry->uuid()), entry);
+    QCOMPARE(group1->findEntryByUuid(entry->uuid()), entry);
+    QVERIFY(!group2->findEntryByUuid(entry->uuid()));
+    QVERIFY(!group1->findChildByUuid(group2->uuid()));
+
+    // changed uuids
+    Uuid oldUuid = entry->uuid();
+    entry->setUuid(Uuid::random());
+    QVERIFY(!db->resolveEntry(oldUuid));
+    QCOMPARE(db->resolveEntry(entry->uuid()), entry);
+    oldUuid = group1->uuid();
+    group1->setUuid(Uuid::random());
+    QVERIFY(!db->resolveGroup(oldUuid));
+    QCOMPARE(db->resolveGroup(group1->uuid()), group1);
+
+    // moves to another database
+    QScopedPointer<Database> otherDb(new Database());
+    group1->setParent(otherDb->rootGroup());
+    QVERIFY(!db->resolveGroup(group1->uuid()));
+    QVERIFY(!db->resolveEntry(entry->uuid()));
+    QCOMPARE(otherDb->resolveGroup(group1->uuid()), group1);
+    QCOMPARE(otherDb->resolveEntry(entry->uuid()), entry);
+
+    entry->setGroup(group2);
+    QVERIFY(!otherDb->resolveEntry(entry->uuid()));
+    QCOMPARE(db->resolveEntry(entry->uuid()), entry);
+
+    // deletions
+    Uuid entryUuid = entry->uuid();
+    delete entry;
+    QVERIFY(!db->resolveEntry(entryUuid));
+    Uuid groupUuid = group1->uuid();
+    delete group1;
+    QVERIFY(!otherDb->resolveGroup(groupUuid));
+}
+
+void TestDatabase::testUuidIndexRecycleBin()
+{
+    QScopedPointer<Database> db(new Database());
+    db->metadata()->setRecycleBinEnabled(true);
+
+    Group* group = new Group();
+    group->setUuid(Uuid::random());
+    group->setParent(db->rootGroup());
+    Entry* entry = new Entry();
+    entry->setUuid(Uuid::random());
+    entry->setGroup(group);
+    Entry* recycledEntry = new Entry();
+    recycledEntry->setUuid(Uuid::random());
+    recycledEntry->setGroup(db->rootGroup());
+
+    db->recycleEntry(recycledEntry);
+    Group* recycleBin = db->metadata()->recycleBin();
+    QVERIFY(recycleBin);
+    QCOMPARE(db->resolveGroup(recycleBin->uuid()), recycleBin);
+    QCOMPARE(db->resolveEntry(recycledEntry->uuid()), recycledEntry);
+    QCOMPARE(recycleBin->findEntryByUuid(recycledEntry->uuid()), recycledEntry);
+
+    db->recycleGroup(group);
+    QCOMPARE(db->resolveGroup(group->uuid()), group);
+    QCOMPARE(recycleBin->findChildByUuid(group->uuid()), group);
+    QCOMPARE(db->resolveEntry(entry->uuid()), entry);
+
+    Uuid groupUuid = group->uuid();
+    Uuid entryUuid = entry->uuid();
+    Uuid recycledEntryUuid = recycledEntry->uuid();
+    db->emptyRecycleBin();
+    QVERIFY(!db->resolveGroup(groupUuid));
+    QVERIFY(!db->resolveEntry(entryUuid));
+    QVERIFY(!db->resolveEntry(recycledEntryUuid));
+    QCOMPARE(db->resolveGroup(recycleBin->uuid()), recycleBin);
+}
+
+void TestDatabase::testUuidIndexClones()
+{
+    QScopedPointer<Database> db(new Database());
+    Group* group = new Group();
+    group->setUuid(Uuid::random());
+    group->setParent(db->rootGroup());
+    Entry* entry = new Entry();
+    entry->setUuid(Uuid::random());
+    entry->setGroup(group);
+
+    Entry* entryClone = entry->clone(Entry::CloneNewUuid);
+    QVERIFY(!db->resolveEntry(entryClone->uuid()));
+    entryClone->setGroup(db->rootGroup());
+    QCOMPARE(db->resolveEntry(entryClone->uuid()), entryClone);
+    QCOMPARE(db->resolveEntry(entry->uuid()), entry);
+
+    Group* groupClone = group->clone(Entry::CloneNewUuid, Group::CloneNewUuid | Group::CloneIncludeEntries);
+    groupClone->setParent(db->rootGroup());
+    QCOMPARE(db->resolveGroup(groupClone->uuid()), groupClone);
+    QCOMPARE(groupClone->entries().size(), 1);
+    Entry* clonedEntry = groupClone->entries().first();
+    QCOMPARE(db->resolveEntry(clonedEntry->uuid()), clonedEntry);
+    QCOMPARE(db->resolveEntry(entry->uuid()), entry);
+
+    // a snapshot gets an index of its own
+    QScopedPointer<Database> snapshot(db->snapshot());
+    Entry* snapshotEntry = snapshot->resolveEntry(entry->uuid());
+    QVERIFY(snapshotEntry);
+    QVERIFY(snapshotEntry != entry);
+    QCOMPARE(snapshot->resolveGroup(groupClone->uuid())->entries().size(), 1);
+
+    // an identical copy in the same database must not hide the original
+    Entry* sameUuid = entry->clone(Entry::CloneNoFlags);
+    sameUuid->setGroup(db->rootGroup());
+    delete sameUuid;
+    QCOMPARE(db->resolveEntry(entry->uuid()), entry);
+}
+
+void TestDatabase::testUuidIndexDuplicates()
+{
+    QScopedPointer<Database> db(new Database());
+    Group* root = db->rootGroup();
+    Group* group1 = new Group();
+    group1->setUuid(Uuid::random());
+    group1->setParent(root);
+    Group* group2 = new Group();
+    group2->setUuid(Uuid::random());
+    group2->setParent(root);
+
+    // broken files can contain the same uuid twice, the first one in tree
+    // order wins no matter which one was added last
+    Entry* entry = new Entry();
+    entry->setUuid(Uuid::random());
+    entry->setGroup(group2);
+    Entry* duplicate = entry->clone(Entry::CloneNoFlags);
+    duplicate->setGroup(group1);
+    QCOMPARE(db->resolveEntry(entry->uuid()), duplicate);
+    QCOMPARE(root->findEntryByUuid(entry->uuid()), duplicate);
+    QCOMPARE(group1->findEntryByUuid(entry->uuid()), duplicate);
+    QCOMPARE(group2->findEntryByUuid(entry->uuid()), entry);
+
+    // the entries of a group come before the ones of its children
+    Entry* rootDuplicate = entry->clone(Entry::CloneNoFlags);
+    rootDuplicate->setGroup(root);
+    QCOMPARE(db->resolveEntry(entry->uuid()), rootDuplicate);
+    QCOMPARE(group1->findEntryByUuid(entry->uuid()), duplicate);
+    delete rootDuplicate;
+
+    // within a group the stored order counts
+    Entry* sibling = entry->clone(Entry::CloneNoFlags);
+    sibling->setGroup(group2);
+    QCOMPARE(group2->findEntryByUuid(entry->uuid()), entry);
+    delete duplicate;
+    QCOMPARE(db->resolveEntry(entry->uuid()), entry);
+    delete entry;
+    QCOMPARE(db->resolveEntry(sibling->uuid()), sibling);
+
+    // a group comes before its children, siblings go by their index
+    Group* child = new Group();
+    child->setUuid(group1->uuid());
+    child->setParent(group2);
+    QCOMPARE(db->resolveGroup(group1->uuid()), group1);
+    QCOMPARE(group2->findChildByUuid(group1->uuid()), child);
+    group1->setParent(root);
+    QCOMPARE(db->resolveGroup(group1->uuid()), child);
+    Group* parent = new Group();
+    parent->setUuid(group1->uuid());
+    parent->setParent(root, 0);
+    QCOMPARE(db->resolveGroup(group1->uuid()), parent);
+    QCOMPARE(group2->findChildByUuid(group1->uuid()), child);
+}
+
+void TestDatabase::testAttachmentPool()
+{
+    Database db;
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+    QVERIFY(db.setKey(key));
+
+    // separately allocated copies of the same data
+    Entry* entry1 = new Entry();
+    entry1->setGroup(db.rootGroup());
+    entry1->attachments()->set("a", QByteArray(1000, 'x'));
+    Entry* entry2 = new Entry();
+    entry2->attachments()->set("b", QByteArray(1000, 'x'));
+    entry2->attachments()->set("c", QByteArray(1000, 'y'));
+    QVERIFY(entry1->attachments()->value("a").constData() != entry2->attachments()->value("b").constData());
+
+    // entries are pooled when they are added to the database ...
+    entry2->setGroup(db.rootGroup());
+    QVERIFY(entry1->attachments()->value("a").constData() == entry2->attachments()->value("b").constData());
+
+    // ... and when their attachments change
+    entry1->attachments()->set("d", QByteArray(1000, 'y'));
+    QVERIFY(entry1->attachments()->value("d").constData() == entry2->attachments()->value("c").constData());
+
+    Entry* historyItem = new Entry();
+    historyItem->setUuid(entry1->uuid());
+    historyItem->attachments()->set("other", QByteArray(1000, 'x'));
+    entry1->addHistoryItem(historyItem);
+    QVERIFY(historyItem->attachments()->value("other").constData() == entry1->attachments()->value("a").constData());
+
+    // every attachment content is written once
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.close();
+    QCOMPARE(db.saveToFile(file.fileName()), QString());
+
+    QScopedPointer<Database> saved(Database::openDatabaseFile(file.fileName(), key));
+    QVERIFY(saved);
+    Entry* savedEntry1 = saved->resolveEntry(entry1->uuid());
+    Entry* savedEntry2 = saved->resolveEntry(entry2->uuid());
+    QVERIFY(savedEntry1);
+    QVERIFY(savedEntry2);
+    QCOMPARE(savedEntry1->attachments()->value("a"), QByteArray(1000, 'x'));
+    QCOMPARE(savedEntry1->attachments()->value("d"), QByteArray(1000, 'y'));
+    QCOMPARE(savedEntry2->attachments()->value("b"), QByteArray(1000, 'x'));
+    QCOMPARE(savedEntry2->attachments()->value("c"), QByteArray(1000, 'y'));
+    QCOMPARE(savedEntry1->historyItems().size(), 1);
+    QCOMPARE(savedEntry1->historyItems().first()->attachments()->value("other"), QByteArray(1000, 'x'));
+}
+
+void TestDatabase::testEntriesForHost()
+{
+    Database db;
+
+    Entry* entryUrl = new Entry();
+    entryUrl->setGroup(db.rootGroup());
+    entryUrl->setUrl("https://example.com/login");
+    Entry* entryBareUrl = new Entry();
+    entryBareUrl->setGroup(db.rootGroup());
+    entryBareUrl->setUrl("Mail.Example.com");
+    Entry* entryTitle = new Entry();
+    entryTitle->setGroup(db.rootGroup());
+    entryTitle->setTitle("https://other.org");
+    Entry* entryNoUrl = new Entry();
+    entryNoUrl->setGroup(db.rootGroup());
+    entryNoUrl->setTitle("example.com account");
+
+    QCOMPARE(db.entriesForHost("example.com"), QList<Entry*>() << entryUrl);
+    QCOMPARE(db.entriesForHost("Mail.Example.com"), QList<Entry*>() << entryBareUrl);
+    QCOMPARE(db.entriesForHost("other.org"), QList<Entry*>() << entryTitle);
+    // parent domains are only looked up by the callers
+    QVERIFY(db.entriesForHost("www.example.com").isEmpty());
+    QVERIFY(db.entriesForHost("ample.com").isEmpty());
+    QVERIFY(db.entriesForHost("com").isEmpty());
+
+    QCOMPARE(UrlIndex::hostKeys("Login.Mail.Example.com"),
+             QStringList() << "login.mail.example.com" << "mail.example.com" << "example.com");
+    QCOMPARE(UrlIndex::hostKeys("example.com"), QStringList() << "example.com");
+    // co.uk is a public suffix, not a domain shared by its subdomains
+    QCOMPARE(UrlIndex::hostKeys("www.example.co.uk"), QStringList() << "www.example.co.uk" << "example.co.uk");
+    QCOMPARE(UrlIndex::hostKeys("example.co.uk"), QStringList() << "example.co.uk");
+    QCOMPARE(UrlIndex::hostKeys("www.example.de"), QStringList() << "www.example.de" << "example.de");
+    QCOMPARE(UrlIndex::hostKeys("192.168.0.1"), QStringList() << "192.168.0.1");
+    QVERIFY(UrlIndex::hostKeys("").isEmpty());
+
+    // entries of the same host are returned in the order they were indexed
+    Entry* entrySecondUrl = new Entry();
+    entrySecondUrl->setGroup(db.rootGroup());
+    entrySecondUrl->setUrl("https://example.com/signup");
+    Entry* entryThirdUrl = new Entry();
+    entryThirdUrl->setGroup(db.rootGroup());
+    entryThirdUrl->setUrl("example.com");
+    QCOMPARE(db.entriesForHost("example.com"), QList<Entry*>() << entryUrl << entrySecondUrl << entryThirdUrl);
+    delete entrySecondUrl;
+    delete entryThirdUrl;
+
+    UrlIndex::EntryUrl url = db.indexedUrl(entryUrl);
+    QCOMPARE(url.url, QString("https://example.com/login"));
+    QCOMPARE(url.baseUrl, QString("https://example.com"));
+
+    // changes are picked up
+    entryUrl->setUrl("https://example.net");
+    QVERIFY(db.entriesForHost("www.example.com").isEmpty());
+    QCOMPARE(db.entriesForHost("example.net"), QList<Entry*>() << entryUrl);
+    QCOMPARE(db.indexedUrl(entryUrl).url, QString("https://example.net"));
+
+    // the recycle bin is excluded from searches
+    db.metadata()->setRecycleBinEnabled(true);
+    db.recycleEntry(entryUrl);
+    QVERIFY(db.entriesForHost("example.net").isEmpty());
+
+    delete entryTitle;
+    QVERIFY(db.entriesForHost("other.org").isEmpty());
+}
@@ -31,6 +31,15 @@ private slots:
     void testEmptyRecycleBinOnNotCreated();
     void testEmptyRecycleBinOnEmpty();
     void testEmptyRecycleBinWithHierarchicalData();
+    void testSnapshot();
+    void testReadSnapshot();
+    void testSaveInBackground();
+    void testUuidIndexMoves();
+    void testUuidIndexRecycleBin();
+    void testUuidIndexClones();
+    void testUuidIndexDuplicates();
+    void testAttachmentPool();
+    void testEntriesForHost();
 };
 
 #endif // KEEPASSX_TESTDATABASE_H
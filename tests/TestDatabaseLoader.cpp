@@ -0,0 +1,115 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestDatabaseLoader.h"
+
+#include <QSignalSpy>
+#include <QTest>
+#include <QThread>
+
+#include "config-keepassx-tests.h"
+#include "core/Database.h"
+#include "core/DatabaseLoader.h"
+#include "core/Entry.h"
+#include "core/Group.h"
+#include "crypto/Crypto.h"
+#include "format/KeePass2Reader.h"
+#include "keys/PasswordKey.h"
+
+QTEST_GUILESS_MAIN(TestDatabaseLoader)
+
+void TestDatabaseLoader::initTestCase()
+{
+    QVERIFY(Crypto::init());
+    qRegisterMetaType<Database*>();
+}
+
+void TestDatabaseLoader::testLoad()
+{
+    QString filename = QString(KEEPASSX_TEST_DATA_DIR).append("/NewDatabase.kdbx");
+    CompositeKey key;
+    key.addKey(PasswordKey("a"));
+
+    DatabaseLoader loader;
+    QSignalSpy spyFinished(&loader, SIGNAL(finished(Database*)));
+
+    // progress is emitted on the worker thread, collect it on this one
+    QList<int> stages;
+    int lastPercent = -1;
+    connect(&loader, &DatabaseLoader::progress, this, [&](int stage, int percent) {
+        if (stages.isEmpty() || stages.last() != stage) {
+            stages.append(stage);
+        }
+        lastPercent = percent;
+    });
+
+    loader.load(filename, key);
+    QVERIFY(loader.isRunning());
+    QVERIFY(spyFinished.wait(10000));
+    QVERIFY(!loader.isRunning());
+
+    QScopedPointer<Database> db(spyFinished.at(0).at(0).value<Database*>());
+    QVERIFY(db);
+    QVERIFY(loader.errorString().isEmpty());
+    QCOMPARE(db->rootGroup()->name(), QString("NewDatabase"));
+
+    // the whole object tree has to live on the thread that started the load
+    QCOMPARE(db->thread(), QThread::currentThread());
+    QCOMPARE(db->rootGroup()->thread(), QThread::currentThread());
+    for (Entry* entry : db->rootGroup()->entriesRecursive(true)) {
+        QCOMPARE(entry->thread(), QThread::currentThread());
+    }
+
+    QList<int> expectedStages;
+    expectedStages << KeePass2Reader::KeyDerivationStage << KeePass2Reader::ParsingStage
+                   << KeePass2Reader::ModelBuildStage;
+    QCOMPARE(stages, expectedStages);
+    QCOMPARE(lastPercent, 100);
+}
+
+void TestDatabaseLoader::testWrongKey()
+{
+    QString filename = QString(KEEPASSX_TEST_DATA_DIR).append("/NewDatabase.kdbx");
+    CompositeKey key;
+    key.addKey(PasswordKey("wrong"));
+
+    DatabaseLoader loader;
+    QSignalSpy spyFinished(&loader, SIGNAL(finished(Database*)));
+
+    loader.load(filename, key);
+    QVERIFY(spyFinished.wait(10000));
+
+    QVERIFY(!spyFinished.at(0).at(0).value<Database*>());
+    QVERIFY(!loader.errorString().isEmpty());
+}
+
+void TestDatabaseLoader::testCancel()
+{
+    QString filename = QString(KEEPASSX_TEST_DATA_DIR).append("/NewDatabase.kdbx");
+    CompositeKey key;
+    key.addKey(PasswordKey("a"));
+
+    DatabaseLoader loader;
+    QSignalSpy spyFinished(&loader, SIGNAL(finished(Database*)));
+
+    loader.load(filename, key);
+    loader.cancel();
+
+    QTRY_VERIFY(!loader.isRunning());
+    QTest::qWait(100);
+    QCOMPARE(spyFinished.count(), 0);
+}
@@ -23,6 +23,7 @@
 #include "core/Database.h"
 #include "core/Entry.h"
 #include "core/Group.h"
+#include "core/Metadata.h"
 #include "crypto/Crypto.h"
 
 QTEST_GUILESS_MAIN(TestEntry)
@@ -48,6 +49,43 @@ void TestEntry::testHistoryItemDeletion()
 
     delete entry;
 }
+void TestEntry::testHistorySharing()
+{
+    Database db;
+    db.metadata()->setHistoryMaxItems(-1);
+    db.metadata()->setHistoryMaxSize(-1);
+
+    Entry* entry = new Entry();
+    entry->setGroup(db.rootGroup());
+    entry->setTitle("new");
+    entry->setNotes(QString(1000, 'n'));
+    entry->attachments()->set("a", QByteArray(1000, 'x'));
+
+    // separately allocated copies of the same data, like the ones of a parsed database
+    Entry* historyItem = new Entry();
+    historyItem->setTitle("old");
+    historyItem->setNotes(QString(1000, 'n'));
+    historyItem->attachments()->set("a", QByteArray(1000, 'x'));
+    QVERIFY(historyItem->notes().constData() != entry->notes().constData());
+
+    entry->addHistoryItem(historyItem);
+    QCOMPARE(historyItem->title(), QString("old"));
+    QCOMPARE(historyItem->notes(), entry->notes());
+    QVERIFY(historyItem->notes().constData() == entry->notes().constData());
+    QVERIFY(historyItem->attachments()->value("a").constData()
+            == entry->attachments()->value("a").constData());
+    QCOMPARE(historyItem->attachments()->hash("a"), entry->attachments()->hash("a"));
+
+    // the attachment is also part of the entry, so it doesn't add to the history size
+    db.metadata()->setHistoryMaxSize(historyItem->attributes()->attributesSize());
+    entry->truncateHistory();
+    QCOMPARE(entry->historyItems().size(), 1);
+
+    db.metadata()->setHistoryMaxSize(historyItem->attributes()->attributesSize() - 1);
+    entry->truncateHistory();
+    QCOMPARE(entry->historyItems().size(), 0);
+}
+
 void TestEntry::testCopyDataFrom()
 {
     Entry* entry = new Entry();
@@ -356,6 +394,99 @@ void TestEntry::testResolveReferencePlaceholders()
     QCOMPARE(tstEntry->resolveMultiplePlaceholders(QString("{REF:n@i:%1}").arg(entry3->uuid().toHex().toLower())), entry3->attributes()->value("AttributeNotes"));
 }
 
+void TestEntry::testResolveReferenceAfterChanges()
+{
+    Database db;
+    Group* root = db.rootGroup();
+
+    Entry* entry1 = new Entry();
+    entry1->setGroup(root);
+    entry1->setUuid(Uuid::random());
+    entry1->setTitle("Title1");
+    entry1->setUsername("Username1");
+    entry1->setPassword("Password1");
+
+    Entry* tstEntry = new Entry();
+    tstEntry->setGroup(root);
+    tstEntry->setUuid(Uuid::random());
+
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders("{REF:P@T:Title1}"), QString("Password1"));
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders("{REF:P@U:Username1}"), QString("Password1"));
+
+    // the lookup tables follow field changes
+    entry1->setTitle("Renamed");
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders("{REF:P@T:Title1}"), QString());
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders("{REF:P@T:Renamed}"), QString("Password1"));
+
+    // the first entry in tree order wins, like with a linear search
+    Group* group = new Group();
+    group->setParent(root);
+    Entry* entry2 = new Entry();
+    entry2->setGroup(group);
+    entry2->setUuid(Uuid::random());
+    entry2->setTitle("Renamed");
+    entry2->setPassword("Password2");
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders("{REF:P@T:Renamed}"), QString("Password1"));
+
+    delete entry1;
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders("{REF:P@T:Renamed}"), QString("Password2"));
+
+    entry2->setGroup(tstEntry->group());
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders(QString("{REF:P@I:%1}").arg(entry2->uuid().toHex())),
+             QString("Password2"));
+}
+
+void TestEntry::testResolveCachedPlaceholders()
+{
+    Database db;
+    Group* root = db.rootGroup();
+
+    Entry* entry1 = new Entry();
+    entry1->setGroup(root);
+    entry1->setUuid(Uuid::random());
+    entry1->setTitle("Title1");
+    entry1->setPassword("Password1");
+
+    Entry* entry2 = new Entry();
+    entry2->setGroup(root);
+    entry2->setUuid(Uuid::random());
+    entry2->setPassword(QString("{REF:P@I:%1}").arg(entry1->uuid().toHex()));
+
+    Entry* tstEntry = new Entry();
+    tstEntry->setGroup(root);
+    tstEntry->setUuid(Uuid::random());
+    tstEntry->setTitle("Test");
+
+    const QString byUuid = QString("{REF:P@I:%1}").arg(entry2->uuid().toHex());
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders(byUuid), QString("Password1"));
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders("{TITLE}"), QString("Test"));
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders("{REF:P@T:Title2}"), QString());
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders("no placeholder"), QString("no placeholder"));
+
+    // changes to the entry itself and to every entry along the reference chain
+    tstEntry->setTitle("Changed");
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders("{TITLE}"), QString("Changed"));
+    entry1->setPassword("Password2");
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders(byUuid), QString("Password2"));
+    entry2->setPassword("Direct");
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders(byUuid), QString("Direct"));
+
+    // lookups by field value may find another entry after any change
+    Entry* entry3 = new Entry();
+    entry3->setGroup(root);
+    entry3->setUuid(Uuid::random());
+    entry3->setTitle("Title2");
+    entry3->setPassword("Password3");
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders("{REF:P@T:Title2}"), QString("Password3"));
+
+    delete entry2;
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders(byUuid), QString());
+
+    Database db2;
+    entry3->setGroup(db2.rootGroup());
+    QCOMPARE(tstEntry->resolveMultiplePlaceholders("{REF:P@T:Title2}"), QString());
+}
+
 void TestEntry::testResolveNonIdPlaceholdersToUuid()
 {
     Database db;
@@ -29,12 +29,15 @@ class TestEntry : public QObject
 private slots:
     void initTestCase();
     void testHistoryItemDeletion();
+    void testHistorySharing();
     void testCopyDataFrom();
     void testClone();
     void testResolveUrl();
     void testResolveUrlPlaceholders();
     void testResolveRecursivePlaceholders();
     void testResolveReferencePlaceholders();
+    void testResolveReferenceAfterChanges();
+    void testResolveCachedPlaceholders();
     void testResolveNonIdPlaceholdersToUuid();
     void testResolveClonedEntry();
 };
@@ -21,6 +21,7 @@
 #include <QTest>
 
 #include "modeltest.h"
+#include "core/Database.h"
 #include "core/DatabaseIcons.h"
 #include "core/Entry.h"
 #include "core/Group.h"
@@ -349,3 +350,56 @@ void TestEntryModel::testDatabaseDelete()
     delete modelTest;
     delete model;
 }
+
+void TestEntryModel::testBulkChange()
+{
+    Database* db = new Database();
+    Group* group = new Group();
+    group->setParent(db->rootGroup());
+
+    EntryModel* model = new EntryModel(this);
+    ModelTest* modelTest = new ModelTest(model, this);
+    model->setGroup(group);
+
+    QSignalSpy spyReset(model, SIGNAL(modelReset()));
+    QSignalSpy spyInsert(model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+    QSignalSpy spyRemove(model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+    QSignalSpy spyDataChanged(model, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+
+    db->beginBulkChange();
+    QVERIFY(db->isBulkChange());
+
+    for (int i = 0; i < 10; i++) {
+        Entry* entry = new Entry();
+        entry->setGroup(group);
+        entry->setTitle(QString("entry%1").arg(i));
+    }
+
+    // nested transactions only finish with the outermost one
+    db->beginBulkChange();
+    delete group->entries().first();
+    db->endBulkChange();
+    QVERIFY(db->isBulkChange());
+    QCOMPARE(spyReset.count(), 0);
+
+    db->endBulkChange();
+    QVERIFY(!db->isBulkChange());
+
+    QCOMPARE(spyReset.count(), 1);
+    QCOMPARE(spyInsert.count(), 0);
+    QCOMPARE(spyRemove.count(), 0);
+    QCOMPARE(spyDataChanged.count(), 0);
+    QCOMPARE(model->rowCount(), 9);
+    QCOMPARE(model->data(model->index(0, 1)).toString(), QString("entry1"));
+
+    // deleting the displayed group during a bulk change leaves an empty model
+    db->beginBulkChange();
+    delete group;
+    db->endBulkChange();
+    QCOMPARE(spyReset.count(), 2);
+    QCOMPARE(model->rowCount(), 0);
+
+    delete modelTest;
+    delete model;
+    delete db;
+}
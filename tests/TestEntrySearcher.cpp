@@ -19,6 +19,9 @@
 
 #include <QTest>
 
+#include "core/Database.h"
+#include "core/SearchIndex.h"
+
 QTEST_GUILESS_MAIN(TestEntrySearcher)
 
 void TestEntrySearcher::initTestCase()
@@ -140,3 +143,246 @@ void TestEntrySearcher::testAllAttributesAreSearched()
     m_searchResult = m_entrySearcher.search("testTitle testUsername testUrl testNote", m_groupRoot, Qt::CaseInsensitive);
     QCOMPARE(m_searchResult.count(), 1);
 }
+
+void TestEntrySearcher::testIndexedSearch()
+{
+    Database db;
+    Group* root = db.rootGroup();
+    Group* group = new Group();
+    group->setParent(root);
+
+    Entry* entry1 = new Entry();
+    entry1->setGroup(root);
+    entry1->setTitle("Mail Account");
+    entry1->setUrl("https://mail.example.com");
+
+    Entry* entry2 = new Entry();
+    entry2->setGroup(group);
+    entry2->setUuid(Uuid::random());
+    entry2->setTitle("Bank");
+    entry2->setUsername("Jürgen");
+
+    Entry* entry3 = new Entry();
+    entry3->setGroup(group);
+    entry3->setTitle(QString("{REF:T@I:%1}").arg(entry2->uuid().toHex()));
+
+    m_searchResult = m_entrySearcher.search("EXAMPLE mail", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry1);
+    m_searchResult = m_entrySearcher.search("EXAMPLE", root, Qt::CaseSensitive);
+    QCOMPARE(m_searchResult.count(), 0);
+    m_searchResult = m_entrySearcher.search("jÜR", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry2);
+
+    // references resolve to the text of another entry
+    m_searchResult = m_entrySearcher.search("ank", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry2 << entry3);
+
+    // words too short for a trigram
+    m_searchResult = m_entrySearcher.search("ma", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry1);
+
+    // the index follows changes, additions and removals
+    entry1->setNotes("savings");
+    entry2->setTitle("Credit Union");
+    m_searchResult = m_entrySearcher.search("savings", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry1);
+    m_searchResult = m_entrySearcher.search("bank", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult.count(), 0);
+    m_searchResult = m_entrySearcher.search("union", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry2 << entry3);
+
+    Entry* entry4 = new Entry();
+    entry4->setGroup(group);
+    entry4->setNotes("savings plan");
+    m_searchResult = m_entrySearcher.search("savings", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry1 << entry4);
+
+    entry4->setGroup(root);
+    delete entry1;
+    m_searchResult = m_entrySearcher.search("savings", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry4);
+
+    Database db2;
+    entry4->setGroup(db2.rootGroup());
+    m_searchResult = m_entrySearcher.search("savings", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult.count(), 0);
+    m_searchResult = m_entrySearcher.search("savings", db2.rootGroup(), Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry4);
+
+    // matching group names still bring along all entries
+    group->setName("Finance");
+    m_searchResult = m_entrySearcher.search("finance", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry2 << entry3);
+}
+
+void TestEntrySearcher::testQueryLanguage()
+{
+    Database db;
+    Group* root = db.rootGroup();
+    Group* group = new Group();
+    group->setName("Work");
+    group->setParent(root);
+
+    Entry* entry1 = new Entry();
+    entry1->setGroup(root);
+    entry1->setTitle("Old mail");
+    entry1->setUsername("alice");
+    entry1->setUrl("https://mail.example.corp");
+    entry1->setNotes("the exact phrase");
+
+    Entry* entry2 = new Entry();
+    entry2->setGroup(group);
+    entry2->setTitle("New mail");
+    entry2->setUsername("alice");
+    entry2->setUrl("https://intranet.corp");
+    entry2->setTags("office");
+    entry2->attributes()->set("otp", "otpauth://totp/Example?secret=JBSWY3DPEHPK3PXP");
+
+    Entry* entry3 = new Entry();
+    entry3->setGroup(group);
+    entry3->setTitle("Bob");
+    entry3->setUsername("bob");
+    entry3->setPassword("alice");
+    TimeInfo timeInfo = entry3->timeInfo();
+    timeInfo.setExpires(true);
+    timeInfo.setExpiryTime(QDateTime::currentDateTimeUtc().addDays(-1));
+    entry3->setTimeInfo(timeInfo);
+
+    m_searchResult = m_entrySearcher.search("alice", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry1 << entry2);
+    m_searchResult = m_entrySearcher.search("user:alice -title:old", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry2);
+    m_searchResult = m_entrySearcher.search("pw:alice", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry3);
+    m_searchResult = m_entrySearcher.search("url:*.corp", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry1 << entry2);
+    m_searchResult = m_entrySearcher.search("url:https://mail*", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry1);
+    m_searchResult = m_entrySearcher.search("\"exact phrase\"", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry1);
+    m_searchResult = m_entrySearcher.search("\"phrase exact\"", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult.count(), 0);
+    m_searchResult = m_entrySearcher.search("is:expired", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry3);
+    m_searchResult = m_entrySearcher.search("has:totp mail", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry2);
+    m_searchResult = m_entrySearcher.search("tags:office", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry2);
+    m_searchResult = m_entrySearcher.search("group:work -is:expired", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry2);
+
+    // plain words still match groups, qualified terms don't
+    m_searchResult = m_entrySearcher.search("work", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry2 << entry3);
+    m_searchResult = m_entrySearcher.search("title:work", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult.count(), 0);
+
+    // unknown fields are searched for literally
+    m_searchResult = m_entrySearcher.search("https://intranet", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << entry2);
+    m_searchResult = m_entrySearcher.search("URL:HTTPS://MAIL", root, Qt::CaseSensitive);
+    QCOMPARE(m_searchResult.count(), 0);
+}
+
+void TestEntrySearcher::testParallelSearch()
+{
+    Database db;
+    QList<Group*> groups;
+    for (int i = 0; i < 10; ++i) {
+        Group* group = new Group();
+        group->setName(i == 5 ? "Evening" : QString("Group %1").arg(i));
+        group->setParent(db.rootGroup());
+        groups.append(group);
+    }
+
+    // large enough to be split into several chunks
+    QList<Entry*> expected;
+    for (int i = 0; i < 20000; ++i) {
+        Entry* entry = new Entry();
+        entry->setTitle(QString("Entry %1").arg(i));
+        entry->setNotes(i % 2 == 0 ? "even" : "odd");
+        entry->setGroup(groups.at(i / 2000));
+        if (i % 2 == 0 || i / 2000 == 5) {
+            expected.append(entry);
+        }
+    }
+
+    m_searchResult = m_entrySearcher.search("even", db.rootGroup(), Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, expected);
+
+    m_searchResult = m_entrySearcher.search("title:\"Entry 1999\"", db.rootGroup(), Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult.count(), 11);
+    QCOMPARE(m_searchResult.first()->title(), QString("Entry 1999"));
+    QCOMPARE(m_searchResult.last()->title(), QString("Entry 19999"));
+}
+
+void TestEntrySearcher::benchmarkIndexBuild()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    Database db;
+    populateBenchmarkDatabase(&db);
+    const QList<Entry*> entries = db.rootGroup()->entriesRecursive();
+
+    QBENCHMARK {
+        SearchIndex index;
+        index.build(entries);
+    }
+}
+
+void TestEntrySearcher::benchmarkIndexedSearch_data()
+{
+    QTest::addColumn<QString>("term");
+
+    QTest::newRow("username") << "user12345";
+    QTest::newRow("two words") << "account 4242";
+    QTest::newRow("url") << "host7.example";
+    QTest::newRow("no match") << "nomatch";
+}
+
+void TestEntrySearcher::benchmarkIndexedSearch()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QFETCH(QString, term);
+
+    Database db;
+    populateBenchmarkDatabase(&db);
+    // the first search builds the index
+    m_entrySearcher.search(term, db.rootGroup(), Qt::CaseInsensitive);
+
+    QBENCHMARK {
+        m_entrySearcher.search(term, db.rootGroup(), Qt::CaseInsensitive);
+    }
+}
+
+void TestEntrySearcher::populateBenchmarkDatabase(Database* db)
+{
+    const int entryCount = 100000;
+    const int groupCount = 200;
+
+    QList<Group*> groups;
+    for (int i = 0; i < groupCount; ++i) {
+        Group* group = new Group();
+        group->setName(QString("Group %1").arg(i));
+        group->setParent(db->rootGroup());
+        groups.append(group);
+    }
+
+    for (int i = 0; i < entryCount; ++i) {
+        Entry* entry = new Entry();
+        entry->setTitle(QString("Account %1").arg(i));
+        entry->setUsername(QString("user%1@example.com").arg(i));
+        entry->setUrl(QString("https://host%1.example.org/login").arg(i));
+        entry->setNotes(QString("Notes for entry number %1 in a synthetic database").arg(i));
+        entry->setGroup(groups.at(i % groupCount));
+    }
+}
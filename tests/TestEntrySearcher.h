@@ -24,6 +24,8 @@
 #include "core/EntrySearcher.h"
 #include "core/Group.h"
 
+class Database;
+
 class TestEntrySearcher : public QObject
 {
     Q_OBJECT
@@ -35,8 +37,16 @@ private slots:
     void testAndConcatenationInSearch();
     void testSearch();
     void testAllAttributesAreSearched();
+    void testIndexedSearch();
+    void testQueryLanguage();
+    void testParallelSearch();
+    void benchmarkIndexBuild();
+    void benchmarkIndexedSearch_data();
+    void benchmarkIndexedSearch();
 
 private:
+    static void populateBenchmarkDatabase(Database* db);
+
     Group* m_groupRoot;
     EntrySearcher m_entrySearcher;
     QList<Entry*> m_searchResult;
@@ -18,6 +18,7 @@
 #include "TestHashedBlockStream.h"
 
 #include <QBuffer>
+#include <QElapsedTimer>
 #include <QTest>
 
 #include "FailDevice.h"
@@ -102,3 +103,106 @@ void TestHashedBlockStream::testWriteFailure()
     QVERIFY(!writer.reset());
     QCOMPARE(writer.errorString(), QString("FAILDEVICE"));
 }
+
+void TestHashedBlockStream::testLargeBlocks()
+{
+    // blocks big enough to be verified on a worker thread
+    const int blockSize = 256 * 1024;
+    QByteArray data(blockSize * 3 + 1000, '\0');
+    for (int i = 0; i < data.size(); i++) {
+        data[i] = static_cast<char>(i % 251);
+    }
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::ReadWrite));
+
+    HashedBlockStream writer(&buffer, blockSize);
+    QCOMPARE(writer.blockSize(), blockSize);
+    QVERIFY(writer.open(QIODevice::WriteOnly));
+    QCOMPARE(writer.write(data), qint64(data.size()));
+    writer.close();
+
+    buffer.reset();
+    HashedBlockStream reader(&buffer);
+    QVERIFY(reader.open(QIODevice::ReadOnly));
+    QCOMPARE(reader.read(1000), data.left(1000));
+    QCOMPARE(reader.readAll(), data.mid(1000));
+    QVERIFY(reader.atEnd());
+}
+
+void TestHashedBlockStream::testCorruptedBlock()
+{
+    const int blockSize = 128 * 1024;
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::ReadWrite));
+
+    HashedBlockStream writer(&buffer, blockSize);
+    QVERIFY(writer.open(QIODevice::WriteOnly));
+    QCOMPARE(writer.write(QByteArray(blockSize * 2, 'Z')), qint64(blockSize * 2));
+    writer.close();
+
+    // flip a byte in the data of the second block
+    QByteArray& raw = buffer.buffer();
+    int offset = (4 + 32 + 4) * 2 + blockSize + 10;
+    raw[offset] = static_cast<char>(raw[offset] ^ 1);
+
+    buffer.reset();
+    HashedBlockStream reader(&buffer);
+    QVERIFY(reader.open(QIODevice::ReadOnly));
+    QCOMPARE(reader.read(blockSize).size(), blockSize);
+    QCOMPARE(reader.read(1).size(), 0);
+    QCOMPARE(reader.errorString(), QString("Mismatch between hash and data."));
+}
+
+void TestHashedBlockStream::benchmarkRead_data()
+{
+    QTest::addColumn<int>("blockSize");
+
+    QTest::newRow("1 MiB") << 1024 * 1024;
+    QTest::newRow("8 MiB") << 8 * 1024 * 1024;
+}
+
+void TestHashedBlockStream::benchmarkRead()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QFETCH(int, blockSize);
+
+    const int dataSize = 64 * 1024 * 1024;
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::ReadWrite));
+    HashedBlockStream writer(&buffer, blockSize);
+    QVERIFY(writer.open(QIODevice::WriteOnly));
+    QCOMPARE(writer.write(QByteArray(dataSize, '\x55')), qint64(dataSize));
+    writer.close();
+
+    QByteArray data(16384, '\0');
+    qint64 total = 0;
+    qint64 readResult = 0;
+    qint64 iterations = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+        buffer.reset();
+        HashedBlockStream reader(&buffer);
+        QVERIFY(reader.open(QIODevice::ReadOnly));
+        total = 0;
+        while ((readResult = reader.read(data.data(), data.size())) > 0) {
+            total += readResult;
+        }
+        ++iterations;
+    }
+    qint64 nsecs = qMax(timer.nsecsElapsed(), qint64(1));
+
+    QCOMPARE(readResult, qint64(0));
+    QCOMPARE(total, qint64(dataSize));
+
+    // report throughput (MB/s) rather than time per iteration
+    QTest::setBenchmarkResult(iterations * dataSize * 1e9 / nsecs, QTest::BytesPerSecond);
+}
@@ -29,6 +29,10 @@ private slots:
     void testWriteRead();
     void testReset();
     void testWriteFailure();
+    void testLargeBlocks();
+    void testCorruptedBlock();
+    void benchmarkRead_data();
+    void benchmarkRead();
 };
 
 #endif // KEEPASSX_TESTHASHEDBLOCKSTREAM_H
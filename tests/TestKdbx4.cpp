@@ -0,0 +1,341 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestKdbx4.h"
+
+#include <QBuffer>
+#include <QTest>
+
+#include "config-keepassx-tests.h"
+#include "core/Database.h"
+#include "core/Endian.h"
+#include "core/Group.h"
+#include "core/Metadata.h"
+#include "crypto/Crypto.h"
+#include "crypto/kdf/AesKdf.h"
+#include "crypto/kdf/Argon2Kdf.h"
+#include "format/KeePass2.h"
+#include "format/KeePass2Reader.h"
+#include "format/KeePass2Writer.h"
+#include "keys/PasswordKey.h"
+
+QTEST_GUILESS_MAIN(TestKdbx4)
+
+namespace
+{
+    quint32 fileVersion(const QByteArray& data)
+    {
+        return Endian::bytesToUInt32(data.mid(8, 4), KeePass2::BYTEORDER);
+    }
+}
+
+void TestKdbx4::initTestCase()
+{
+    QVERIFY(Crypto::init());
+
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+
+    m_dbOrg = new Database();
+    QVERIFY(m_dbOrg->setKey(key));
+
+    // keep the KDF cheap, the parameters only need to survive the round trip
+    QSharedPointer<Argon2Kdf> kdf = QSharedPointer<Argon2Kdf>::create();
+    QVERIFY(kdf->setParallelism(2));
+    QVERIFY(kdf->setMemory(1024));
+    QVERIFY(kdf->setRounds(2));
+    QVERIFY(m_dbOrg->changeKdf(kdf));
+
+    m_dbOrg->metadata()->setName("TESTDB");
+    Group* group = m_dbOrg->rootGroup();
+    group->setUuid(Uuid::random());
+    group->setNotes("I'm a note!");
+    Entry* entry = new Entry();
+    entry->setPassword(QString::fromUtf8("\xc3\xa4\xa3\xb6\xc3\xbc\xe9\x9b\xbb\xe7\xb4\x85"));
+    entry->setUuid(Uuid::random());
+    entry->attributes()->set("test", "protectedTest", true);
+    entry->attachments()->set("myattach.txt", QByteArray("this is an attachment"));
+    entry->attachments()->set("aaa.txt", QByteArray("also an attachment"));
+    entry->setGroup(group);
+    Entry* entry2 = new Entry();
+    entry2->setUuid(Uuid::random());
+    entry2->attachments()->set("copy.txt", QByteArray("this is an attachment"));
+    entry2->setGroup(group);
+    Group* groupNew = new Group();
+    groupNew->setUuid(Uuid::random());
+    groupNew->setName("TESTGROUP");
+    groupNew->setNotes("I'm a sub group note!");
+    groupNew->setParent(group);
+
+    QBuffer buffer(&m_data);
+    buffer.open(QBuffer::ReadWrite);
+
+    KeePass2Writer writer;
+    writer.writeDatabase(&buffer, m_dbOrg);
+    QVERIFY(!writer.hasError());
+    buffer.seek(0);
+    KeePass2Reader reader;
+    m_dbTest = reader.readDatabase(&buffer, key);
+    QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+    QVERIFY(m_dbTest);
+}
+
+void TestKdbx4::testFormatVersion()
+{
+    QCOMPARE(fileVersion(m_data), KeePass2::FILE_VERSION_4);
+}
+
+void TestKdbx4::testKdfParameters()
+{
+    QSharedPointer<Argon2Kdf> kdf = m_dbTest->kdf().dynamicCast<Argon2Kdf>();
+    QVERIFY(kdf);
+    QCOMPARE(kdf->parallelism(), 2U);
+    QCOMPARE(kdf->memory(), Q_UINT64_C(1024));
+    QCOMPARE(kdf->rounds(), Q_UINT64_C(2));
+    QCOMPARE(kdf->seed(), m_dbOrg->kdf()->seed());
+    QCOMPARE(m_dbTest->transformedMasterKey(), m_dbOrg->transformedMasterKey());
+}
+
+void TestKdbx4::testBasic()
+{
+    QCOMPARE(m_dbTest->metadata()->name(), m_dbOrg->metadata()->name());
+    QVERIFY(m_dbTest->rootGroup());
+    QCOMPARE(m_dbTest->rootGroup()->children()[0]->name(), m_dbOrg->rootGroup()->children()[0]->name());
+    QCOMPARE(m_dbTest->rootGroup()->notes(), m_dbOrg->rootGroup()->notes());
+    QCOMPARE(m_dbTest->rootGroup()->children()[0]->notes(), m_dbOrg->rootGroup()->children()[0]->notes());
+}
+
+void TestKdbx4::testProtectedAttributes()
+{
+    QCOMPARE(m_dbTest->rootGroup()->entries().size(), 2);
+    Entry* entry = m_dbTest->rootGroup()->entries().at(0);
+    QCOMPARE(entry->attributes()->value("test"), QString("protectedTest"));
+    QCOMPARE(entry->attributes()->isProtected("test"), true);
+    QCOMPARE(entry->password(), m_dbOrg->rootGroup()->entries().at(0)->password());
+}
+
+void TestKdbx4::testAttachments()
+{
+    Entry* entry = m_dbTest->rootGroup()->entries().at(0);
+    QCOMPARE(entry->attachments()->keys().size(), 2);
+    QCOMPARE(entry->attachments()->value("myattach.txt"), QByteArray("this is an attachment"));
+    QCOMPARE(entry->attachments()->value("aaa.txt"), QByteArray("also an attachment"));
+
+    // identical attachments share one binary in the inner header
+    Entry* entry2 = m_dbTest->rootGroup()->entries().at(1);
+    QCOMPARE(entry2->attachments()->value("copy.txt"), QByteArray("this is an attachment"));
+}
+
+void TestKdbx4::testTimes()
+{
+    const TimeInfo orgTimes = m_dbOrg->rootGroup()->entries().at(0)->timeInfo();
+    const TimeInfo testTimes = m_dbTest->rootGroup()->entries().at(0)->timeInfo();
+
+    // KDBX 4 stores whole seconds
+    QCOMPARE(testTimes.creationTime().toTime_t(), orgTimes.creationTime().toTime_t());
+    QCOMPARE(testTimes.lastModificationTime().toTime_t(), orgTimes.lastModificationTime().toTime_t());
+    QCOMPARE(testTimes.expiryTime().toTime_t(), orgTimes.expiryTime().toTime_t());
+    QCOMPARE(testTimes.creationTime().timeSpec(), Qt::UTC);
+}
+
+void TestKdbx4::testWrongKey()
+{
+    CompositeKey key;
+    key.addKey(PasswordKey("wrong"));
+
+    QBuffer buffer(&m_data);
+    buffer.open(QBuffer::ReadOnly);
+    KeePass2Reader reader;
+    QScopedPointer<Database> db(reader.readDatabase(&buffer, key));
+    QVERIFY(!db);
+    QVERIFY(reader.hasError());
+}
+
+void TestKdbx4::testTamperedData()
+{
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+
+    QByteArray data = m_data;
+    // flip a bit inside the HMAC protected blocks
+    data[data.size() - 100] = data[data.size() - 100] ^ 0x01;
+
+    QBuffer buffer(&data);
+    buffer.open(QBuffer::ReadOnly);
+    KeePass2Reader reader;
+    QScopedPointer<Database> db(reader.readDatabase(&buffer, key));
+    QVERIFY(!db);
+    QVERIFY(reader.hasError());
+}
+
+void TestKdbx4::testKdfLimits()
+{
+    Argon2Kdf kdf;
+    QVERIFY(kdf.setParallelism(128));
+    QVERIFY(!kdf.setParallelism(129));
+    QVERIFY(kdf.setMemory(Q_UINT64_C(4) * 1024 * 1024));
+    QVERIFY(!kdf.setMemory(Q_UINT64_C(4) * 1024 * 1024 + 1));
+
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+
+    // the KDF parameters are checked while reading the header, before its hash
+    const QByteArray lanesField("\x04\x01\x00\x00\x00P\x04\x00\x00\x00", 10);
+    int pos = m_data.indexOf(lanesField);
+    QVERIFY(pos > 0);
+    QByteArray data = m_data;
+    data.replace(pos + lanesField.size(), 4, Endian::int32ToBytes(65536, KeePass2::BYTEORDER));
+
+    QBuffer buffer(&data);
+    buffer.open(QBuffer::ReadOnly);
+    KeePass2Reader reader;
+    QScopedPointer<Database> db(reader.readDatabase(&buffer, key));
+    QVERIFY(!db);
+    QVERIFY(reader.hasError());
+    QVERIFY(reader.errorString().contains("isn't supported"));
+
+    const QByteArray memoryField("\x05\x01\x00\x00\x00M\x08\x00\x00\x00", 10);
+    pos = m_data.indexOf(memoryField);
+    QVERIFY(pos > 0);
+    data = m_data;
+    data.replace(pos + memoryField.size(), 8, Endian::int64ToBytes(Q_INT64_C(64) << 30, KeePass2::BYTEORDER));
+
+    QBuffer buffer2(&data);
+    buffer2.open(QBuffer::ReadOnly);
+    KeePass2Reader reader2;
+    db.reset(reader2.readDatabase(&buffer2, key));
+    QVERIFY(!db);
+    QVERIFY(reader2.hasError());
+    QVERIFY(reader2.errorString().contains("isn't supported"));
+}
+
+void TestKdbx4::testAesKdfStaysKdbx3()
+{
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+
+    Database db;
+    QVERIFY(db.setKey(key));
+    QVERIFY(db.changeKdf(QSharedPointer<AesKdf>::create()));
+    QVERIFY(db.setTransformRounds(1000));
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QBuffer::ReadWrite);
+
+    KeePass2Writer writer;
+    writer.writeDatabase(&buffer, &db);
+    QVERIFY(!writer.hasError());
+    QCOMPARE(fileVersion(data), KeePass2::FILE_VERSION_3);
+
+    buffer.seek(0);
+    KeePass2Reader reader;
+    QScopedPointer<Database> dbRead(reader.readDatabase(&buffer, key));
+    QVERIFY(dbRead);
+    QCOMPARE(dbRead->kdf()->uuid(), KeePass2::KDF_AES_KDBX3);
+    QCOMPARE(dbRead->transformRounds(), Q_UINT64_C(1000));
+}
+
+void TestKdbx4::testAesKdfKdbx4StaysKdbx4()
+{
+    // the file uses AES-KDF, it was still KDBX 4 and must not be downgraded on save
+    QString filename = QString(KEEPASSX_TEST_DATA_DIR).append("/Kdbx4ChaCha20.kdbx");
+    CompositeKey key;
+    key.addKey(PasswordKey("keepass"));
+    KeePass2Reader reader;
+    QScopedPointer<Database> db(reader.readDatabase(filename, key));
+    QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+    QVERIFY(db);
+    QCOMPARE(db->kdf()->uuid(), KeePass2::KDF_AES_KDBX3);
+    QCOMPARE(db->formatVersion(), KeePass2::FILE_VERSION_4);
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QBuffer::ReadWrite);
+
+    KeePass2Writer writer;
+    writer.writeDatabase(&buffer, db.data());
+    QVERIFY(!writer.hasError());
+    QCOMPARE(fileVersion(data), KeePass2::FILE_VERSION_4);
+
+    buffer.seek(0);
+    KeePass2Reader reader2;
+    QScopedPointer<Database> dbRead(reader2.readDatabase(&buffer, key));
+    QVERIFY2(!reader2.hasError(), qPrintable(reader2.errorString()));
+    QVERIFY(dbRead);
+    QCOMPARE(dbRead->kdf()->uuid(), KeePass2::KDF_AES_KDBX3);
+    QCOMPARE(dbRead->transformRounds(), db->transformRounds());
+    QCOMPARE(dbRead->metadata()->name(), QString("ChaCha20InnerStream"));
+}
+
+void TestKdbx4::testChaCha20Cipher()
+{
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+
+    Database db;
+    QVERIFY(db.setKey(key));
+    QVERIFY(db.changeKdf(QSharedPointer<AesKdf>::create()));
+    QVERIFY(db.setTransformRounds(1000));
+    db.setCipher(KeePass2::CIPHER_CHACHA20);
+    db.metadata()->setName("CHACHA");
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QBuffer::ReadWrite);
+
+    // ChaCha20 can't be described by KDBX 3.1, even with AES-KDF
+    KeePass2Writer writer;
+    writer.writeDatabase(&buffer, &db);
+    QVERIFY(!writer.hasError());
+    QCOMPARE(fileVersion(data), KeePass2::FILE_VERSION_4);
+
+    buffer.seek(0);
+    KeePass2Reader reader;
+    QScopedPointer<Database> dbRead(reader.readDatabase(&buffer, key));
+    QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+    QVERIFY(dbRead);
+    QCOMPARE(dbRead->cipher(), KeePass2::CIPHER_CHACHA20);
+    QCOMPARE(dbRead->metadata()->name(), QString("CHACHA"));
+}
+
+void TestKdbx4::testChaCha20InnerStream()
+{
+    // KDBX 4 file with the ChaCha20 inner random stream KeePass uses for protected values
+    QString filename = QString(KEEPASSX_TEST_DATA_DIR).append("/Kdbx4ChaCha20.kdbx");
+    CompositeKey key;
+    key.addKey(PasswordKey("keepass"));
+    KeePass2Reader reader;
+    QScopedPointer<Database> db(reader.readDatabase(filename, key));
+    QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+    QVERIFY(db);
+    QCOMPARE(db->metadata()->name(), QString("ChaCha20InnerStream"));
+
+    QCOMPARE(db->rootGroup()->entries().size(), 1);
+    Entry* entry = db->rootGroup()->entries().first();
+    QCOMPARE(entry->title(), QString("Sample Entry"));
+    QCOMPARE(entry->username(), QString("User Name"));
+    QCOMPARE(entry->password(), QString("Password"));
+    QCOMPARE(entry->attributes()->value("PIN"), QString("1234"));
+    QVERIFY(entry->attributes()->isProtected("PIN"));
+}
+
+void TestKdbx4::cleanupTestCase()
+{
+    delete m_dbOrg;
+    delete m_dbTest;
+}
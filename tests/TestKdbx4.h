@@ -0,0 +1,52 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_TESTKDBX4_H
+#define KEEPASSX_TESTKDBX4_H
+
+#include <QObject>
+
+class Database;
+
+class TestKdbx4 : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testFormatVersion();
+    void testKdfParameters();
+    void testBasic();
+    void testProtectedAttributes();
+    void testAttachments();
+    void testTimes();
+    void testWrongKey();
+    void testTamperedData();
+    void testKdfLimits();
+    void testAesKdfStaysKdbx3();
+    void testAesKdfKdbx4StaysKdbx4();
+    void testChaCha20Cipher();
+    void testChaCha20InnerStream();
+    void cleanupTestCase();
+
+private:
+    Database* m_dbOrg;
+    Database* m_dbTest;
+    QByteArray m_data;
+};
+
+#endif // KEEPASSX_TESTKDBX4_H
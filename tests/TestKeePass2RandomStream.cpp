@@ -85,3 +85,29 @@ void TestKeePass2RandomStream::test()
     QCOMPARE(cipherData, cipherDataEncrypt);
     QCOMPARE(randomStreamData, cipherData);
 }
+
+void TestKeePass2RandomStream::testChaCha20()
+{
+    const QByteArray key("\x11\x22\x33\x44\x55\x66\x77\x88");
+
+    // ChaCha20 keyed with the first 32 bytes of SHA-512(key) and the next 12 as nonce
+    const QByteArray keyStream(QByteArray::fromHex("7d6635e09950d8cea2f24467bcf6a33f3fb27205d1c10e22a42b0ded73899bcd"
+                                                   "92f9594d0c09ab7df3fa8eb22f6aee53c9c6042ee6fee80a0c8db4e0b6d6623b"
+                                                   "3c8a8c1cb2e1be864b92639e4673f65bc250e139d398163399e5b4ba36118611"
+                                                   "1b687bca85366a90af3888fd39e074d64538404522f00eebc83bd3c9abe04353"));
+
+    KeePass2RandomStream randomStream(KeePass2::ChaCha20);
+    QVERIFY(randomStream.init(key));
+
+    bool ok;
+    QByteArray randomStreamData;
+    randomStreamData.append(randomStream.process(QByteArray(7, '\0'), &ok));
+    QVERIFY(ok);
+    QByteArray tmpData(57, '\0');
+    QVERIFY(randomStream.processInPlace(tmpData));
+    randomStreamData.append(tmpData);
+    randomStreamData.append(randomStream.randomBytes(64, &ok));
+    QVERIFY(ok);
+
+    QCOMPARE(randomStreamData, keyStream);
+}
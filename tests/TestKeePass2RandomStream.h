@@ -27,6 +27,7 @@ class TestKeePass2RandomStream : public QObject
 private slots:
     void initTestCase();
     void test();
+    void testChaCha20();
 };
 
 #endif // KEEPASSX_TESTKEEPASS2RANDOMSTREAM_H
@@ -155,3 +155,55 @@ void TestKeePass2Reader::testFormat300()
 
     delete db;
 }
+
+void TestKeePass2Reader::testMemoryMapped()
+{
+    QString filename = QString(KEEPASSX_TEST_DATA_DIR).append("/ProtectedStrings.kdbx");
+    CompositeKey key;
+    key.addKey(PasswordKey("masterpw"));
+    KeePass2Reader reader;
+    reader.setMemoryMapped(true);
+    Database* db = reader.readDatabase(filename, key);
+    QVERIFY(db);
+    QVERIFY(!reader.hasError());
+    QCOMPARE(db->metadata()->name(), QString("Protected Strings Test"));
+
+    Entry* entry = db->rootGroup()->entries().at(0);
+    QCOMPARE(entry->password(), QString("ProtectedPassword"));
+    QCOMPARE(entry->attributes()->value("TestProtected"), QString("ABC"));
+
+    delete db;
+
+    // header and header hash checks apply the same way
+    filename = QString(KEEPASSX_TEST_DATA_DIR).append("/BrokenHeaderHash.kdbx");
+    key.clear();
+    key.addKey(PasswordKey(""));
+    db = reader.readDatabase(filename, key);
+    QVERIFY(!db);
+    QVERIFY(reader.hasError());
+
+    filename = QString(KEEPASSX_TEST_DATA_DIR).append("/DoesNotExist.kdbx");
+    db = reader.readDatabase(filename, key);
+    QVERIFY(!db);
+    QVERIFY(reader.hasError());
+}
+
+void TestKeePass2Reader::testSaveXml()
+{
+    QString filename = QString(KEEPASSX_TEST_DATA_DIR).append("/Compressed.kdbx");
+    CompositeKey key;
+    key.addKey(PasswordKey(""));
+    KeePass2Reader reader;
+    reader.setSaveXml(true);
+    Database* db = reader.readDatabase(filename, key);
+    QVERIFY(db);
+    QVERIFY(!reader.hasError());
+    QCOMPARE(db->metadata()->name(), QString("Compressed"));
+
+    // the XML is captured while it is parsed and must still be complete
+    QByteArray xmlData = reader.xmlData();
+    QVERIFY(xmlData.startsWith("<?xml"));
+    QVERIFY(xmlData.trimmed().endsWith("</KeePassFile>"));
+
+    delete db;
+}
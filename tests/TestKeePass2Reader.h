@@ -32,6 +32,8 @@ private slots:
     void testBrokenHeaderHash();
     void testFormat200();
     void testFormat300();
+    void testMemoryMapped();
+    void testSaveXml();
 };
 
 #endif // KEEPASSX_TESTKEEPASS2READER_H
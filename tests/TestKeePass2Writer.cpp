@@ -27,6 +27,7 @@
 #include "core/Group.h"
 #include "core/Metadata.h"
 #include "crypto/Crypto.h"
+#include "format/KeePass2.h"
 #include "format/KeePass2Reader.h"
 #include "format/KeePass2Repair.h"
 #include "format/KeePass2Writer.h"
@@ -100,11 +101,194 @@ void TestKeePass2Writer::testAttachments()
     QCOMPARE(entry->attachments()->value("aaa.txt"), QByteArray("also an attachment"));
 }
 
+void TestKeePass2Writer::testLazyAttachments()
+{
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+
+    QBuffer buffer;
+    buffer.open(QBuffer::ReadWrite);
+    KeePass2Writer writer;
+    writer.writeDatabase(&buffer, m_dbOrg);
+    QVERIFY(!writer.hasError());
+
+    buffer.seek(0);
+    KeePass2Reader reader;
+    reader.setLazyAttachments(true);
+    QScopedPointer<Database> db(reader.readDatabase(&buffer, key));
+    QVERIFY(db);
+    QVERIFY(!reader.hasError());
+
+    Entry* entry = db->rootGroup()->entries().at(0);
+    QSharedPointer<LazyAttachment> attachment = entry->attachments()->lazyValue("myattach.txt");
+    QVERIFY(attachment);
+    QVERIFY(attachment->isCompressed());
+    QVERIFY(!attachment->isDecoded());
+
+    // an unchanged attachment is written as it was read
+    QBuffer resaved;
+    resaved.open(QBuffer::ReadWrite);
+    writer.writeDatabase(&resaved, db.data());
+    QVERIFY(!writer.hasError());
+    QVERIFY(!attachment->isDecoded());
+
+    resaved.seek(0);
+    QScopedPointer<Database> dbResaved(reader.readDatabase(&resaved, key));
+    QVERIFY(dbResaved);
+    Entry* entryResaved = dbResaved->rootGroup()->entries().at(0);
+    QCOMPARE(entryResaved->attachments()->value("myattach.txt"), QByteArray("this is an attachment"));
+    QCOMPARE(entryResaved->attachments()->value("aaa.txt"), QByteArray("also an attachment"));
+
+    QCOMPARE(entry->attachments()->value("myattach.txt"), QByteArray("this is an attachment"));
+    QVERIFY(attachment->isDecoded());
+
+    // replacing an attachment drops the encoded data
+    entry->attachments()->set("aaa.txt", QByteArray("replaced"));
+    QVERIFY(!entry->attachments()->lazyValue("aaa.txt"));
+    QCOMPARE(entry->attachments()->value("aaa.txt"), QByteArray("replaced"));
+
+    // a different compression setting can't reuse the encoded data
+    db->setCompressionAlgo(Database::CompressionNone);
+    resaved.buffer().clear();
+    resaved.seek(0);
+    writer.writeDatabase(&resaved, db.data());
+    QVERIFY(!writer.hasError());
+
+    resaved.seek(0);
+    dbResaved.reset(reader.readDatabase(&resaved, key));
+    QVERIFY(dbResaved);
+    entryResaved = dbResaved->rootGroup()->entries().at(0);
+    QCOMPARE(entryResaved->attachments()->value("myattach.txt"), QByteArray("this is an attachment"));
+    QCOMPARE(entryResaved->attachments()->value("aaa.txt"), QByteArray("replaced"));
+}
+
+void TestKeePass2Writer::testCorruptLazyAttachment()
+{
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+
+    Database db;
+    QVERIFY(db.setKey(key));
+    Entry* entry = new Entry();
+    entry->setUuid(Uuid::random());
+    entry->setGroup(db.rootGroup());
+    // base64 of data that isn't gzip compressed
+    const QByteArray encoded("bm90IGNvbXByZXNzZWQ=");
+    entry->attachments()->setLazy("corrupt.bin", QSharedPointer<LazyAttachment>::create(encoded, true));
+    QVERIFY(!entry->attachments()->lazyValue("corrupt.bin")->isValid());
+
+    // KDBX 3.1 keeps the original form, even when the compression setting changed
+    db.setCompressionAlgo(Database::CompressionNone);
+    QBuffer buffer;
+    buffer.open(QBuffer::ReadWrite);
+    KeePass2Writer writer;
+    writer.writeDatabase(&buffer, &db);
+    QVERIFY2(!writer.hasError(), qPrintable(writer.errorString()));
+
+    buffer.seek(0);
+    KeePass2Reader reader;
+    reader.setLazyAttachments(true);
+    QScopedPointer<Database> dbRead(reader.readDatabase(&buffer, key));
+    QVERIFY(dbRead);
+    QSharedPointer<LazyAttachment> attachment =
+        dbRead->rootGroup()->entries().at(0)->attachments()->lazyValue("corrupt.bin");
+    QVERIFY(attachment);
+    QVERIFY(attachment->isCompressed());
+    QCOMPARE(attachment->encoded(), encoded);
+
+    // KDBX 4 would have to write the decoded data, the save fails instead
+    db.setCipher(KeePass2::CIPHER_CHACHA20);
+    QBuffer buffer4;
+    buffer4.open(QBuffer::ReadWrite);
+    writer.writeDatabase(&buffer4, &db);
+    QVERIFY(writer.hasError());
+}
+
 void TestKeePass2Writer::testNonAsciiPasswords()
 {
     QCOMPARE(m_dbTest->rootGroup()->entries()[0]->password(), m_dbOrg->rootGroup()->entries()[0]->password());
 }
 
+void TestKeePass2Writer::testCompressionLevel()
+{
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+
+    Database db;
+    QVERIFY(db.setKey(key));
+    QVERIFY(db.setTransformRounds(1000));
+    QCOMPARE(db.compressionLevel(), static_cast<int>(Database::DefaultCompressionLevel));
+    db.setCompressionLevel(9);
+    QCOMPARE(db.compressionLevel(), 9);
+
+    // both KDBX 3.1 and KDBX 4 keep the level across a reopen
+    const Uuid ciphers[] = { KeePass2::CIPHER_AES, KeePass2::CIPHER_CHACHA20 };
+    for (const Uuid& cipher : ciphers) {
+        db.setCipher(cipher);
+
+        QBuffer buffer;
+        buffer.open(QBuffer::ReadWrite);
+        KeePass2Writer writer;
+        writer.writeDatabase(&buffer, &db);
+        QVERIFY2(!writer.hasError(), qPrintable(writer.errorString()));
+
+        buffer.seek(0);
+        KeePass2Reader reader;
+        QScopedPointer<Database> dbRead(reader.readDatabase(&buffer, key));
+        QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+        QVERIFY(dbRead);
+        QCOMPARE(dbRead->compressionLevel(), 9);
+    }
+
+    // the default level leaves no trace in the custom data
+    db.setCompressionLevel(Database::DefaultCompressionLevel);
+    QCOMPARE(db.compressionLevel(), static_cast<int>(Database::DefaultCompressionLevel));
+    QVERIFY(db.metadata()->customFields().isEmpty());
+}
+
+void TestKeePass2Writer::testBlockSize()
+{
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+
+    Database db;
+    QVERIFY(db.setKey(key));
+    QVERIFY(db.setTransformRounds(1000));
+    // uncompressed, so the payload spans several blocks of either size
+    db.setCompressionAlgo(Database::CompressionNone);
+    QByteArray attachment;
+    for (int i = 0; attachment.size() < 9 * 1024 * 1024; ++i) {
+        attachment.append(QByteArray::number(i));
+    }
+    Entry* entry = new Entry();
+    entry->setUuid(Uuid::random());
+    entry->attachments()->set("large.bin", attachment);
+    entry->setGroup(db.rootGroup());
+
+    const qint32 blockSizes[] = { 8 * 1024 * 1024, 1000 };
+    const Uuid ciphers[] = { KeePass2::CIPHER_AES, KeePass2::CIPHER_CHACHA20 };
+    for (qint32 blockSize : blockSizes) {
+        for (const Uuid& cipher : ciphers) {
+            db.setCipher(cipher);
+
+            QBuffer buffer;
+            buffer.open(QBuffer::ReadWrite);
+            KeePass2Writer writer;
+            writer.setBlockSize(blockSize);
+            writer.writeDatabase(&buffer, &db);
+            QVERIFY2(!writer.hasError(), qPrintable(writer.errorString()));
+
+            buffer.seek(0);
+            KeePass2Reader reader;
+            QScopedPointer<Database> dbRead(reader.readDatabase(&buffer, key));
+            QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+            QVERIFY(dbRead);
+            QCOMPARE(dbRead->rootGroup()->entries().size(), 1);
+            QVERIFY(dbRead->rootGroup()->entries().first()->attachments()->value("large.bin") == attachment);
+        }
+    }
+}
+
 void TestKeePass2Writer::testDeviceFailure()
 {
     CompositeKey key;
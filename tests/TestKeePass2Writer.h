@@ -31,7 +31,11 @@ private slots:
     void testBasic();
     void testProtectedAttributes();
     void testAttachments();
+    void testLazyAttachments();
+    void testCorruptLazyAttachment();
     void testNonAsciiPasswords();
+    void testCompressionLevel();
+    void testBlockSize();
     void testDeviceFailure();
     void testRepair();
     void cleanupTestCase();
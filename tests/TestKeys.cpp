@@ -28,6 +28,7 @@
 #include "core/Tools.h"
 #include "crypto/Crypto.h"
 #include "crypto/CryptoHash.h"
+#include "crypto/kdf/AesKdf.h"
 #include "format/KeePass2Reader.h"
 #include "format/KeePass2Writer.h"
 #include "keys/FileKey.h"
@@ -45,21 +46,23 @@ void TestKeys::testComposite()
     QScopedPointer<CompositeKey> compositeKey1(new CompositeKey());
     QScopedPointer<PasswordKey> passwordKey1(new PasswordKey());
     QScopedPointer<PasswordKey> passwordKey2(new PasswordKey("test"));
-    bool ok;
-    QString errorString;
 
     // make sure that addKey() creates a copy of the keys
     compositeKey1->addKey(*passwordKey1);
     compositeKey1->addKey(*passwordKey2);
 
-    QByteArray transformed = compositeKey1->transform(QByteArray(32, '\0'), 1, &ok, &errorString);
-    QVERIFY(ok);
-    QCOMPARE(transformed.size(), 32);
+    AesKdf kdf;
+    kdf.setRounds(1);
+    QByteArray transformed1;
+    QVERIFY(compositeKey1->transform(kdf, transformed1));
+    QCOMPARE(transformed1.size(), 32);
 
     // make sure the subkeys are copied
     QScopedPointer<CompositeKey> compositeKey2(compositeKey1->clone());
-    QCOMPARE(compositeKey2->transform(QByteArray(32, '\0'), 1, &ok, &errorString), transformed);
-    QVERIFY(ok);
+    QByteArray transformed2;
+    QVERIFY(compositeKey2->transform(kdf, transformed2));
+    QCOMPARE(transformed2.size(), 32);
+    QCOMPARE(transformed1, transformed2);
 
     QScopedPointer<CompositeKey> compositeKey3(new CompositeKey());
     QScopedPointer<CompositeKey> compositeKey4(new CompositeKey());
@@ -79,6 +82,22 @@ void TestKeys::testComposite()
     QCOMPARE(compositeKey3->rawKey(), compositeKey4->rawKey());
 }
 
+void TestKeys::testCompositeTransform()
+{
+    CompositeKey compositeKey;
+    compositeKey.addKey(PasswordKey("password"));
+
+    AesKdf kdf;
+    QVERIFY(kdf.setRounds(6000));
+    QVERIFY(kdf.setSeed(QByteArray(32, '\x4B')));
+
+    // known result of the AES-KDF, independent of how the rounds are scheduled
+    QByteArray transformed;
+    QVERIFY(compositeKey.transform(kdf, transformed));
+    QCOMPARE(transformed.toHex(),
+             QByteArray("99ab359940d44e5644935d8d26b8f52067642223314b2f5b6a21bae3598067d4"));
+}
+
 void TestKeys::testFileKey()
 {
     QFETCH(QString, type);
@@ -206,12 +225,13 @@ void TestKeys::benchmarkTransformKey()
     CompositeKey compositeKey;
     compositeKey.addKey(pwKey);
 
-    QByteArray seed(32, '\x4B');
+    AesKdf kdf;
+    kdf.setSeed(QByteArray(32, '\x4B'));
+    kdf.setRounds(1e6);
 
-    bool ok;
-    QString errorString;
+    QByteArray result;
 
     QBENCHMARK {
-        compositeKey.transform(seed, 1e6, &ok, &errorString);
+        compositeKey.transform(kdf, result);
     }
 }
@@ -564,6 +564,52 @@ void TestMerge::testResolveGroupConflictOlder()
     delete dbSource;
 }
 
+void TestMerge::testMergeManyEntries()
+{
+    Database* dbDestination = createTestDatabase();
+    Group* destinationGroup = dbDestination->rootGroup()->findChildByName("group2");
+    for (int i = 0; i < 1000; ++i) {
+        Entry* entry = new Entry();
+        entry->setUuid(Uuid::random());
+        entry->setTitle(QString("entry %1").arg(i));
+        entry->setGroup(destinationGroup);
+    }
+
+    Database* dbSource = new Database();
+    dbSource->setRootGroup(dbDestination->rootGroup()->clone(Entry::CloneNoFlags, Group::CloneIncludeEntries));
+
+    // new entries in a new group, one of them with a newer version of an existing entry
+    Group* newGroup = new Group();
+    newGroup->setName("new group");
+    newGroup->setUuid(Uuid::random());
+    newGroup->setParent(dbSource->rootGroup());
+    for (int i = 0; i < 1000; ++i) {
+        Entry* entry = new Entry();
+        entry->setUuid(Uuid::random());
+        entry->setTitle(QString("new entry %1").arg(i));
+        entry->setGroup(newGroup);
+    }
+
+    Entry* updatedEntry = dbSource->rootGroup()->findChildByName("group2")->entries().first();
+    QTest::qSleep(1);
+    updatedEntry->setTitle("updated entry");
+
+    dbDestination->merge(dbSource);
+
+    QCOMPARE(dbDestination->rootGroup()->entriesRecursive().size(), 2002);
+    QVERIFY(dbDestination->rootGroup()->findChildByName("new group"));
+    QCOMPARE(dbDestination->rootGroup()->findChildByName("new group")->entries().size(), 1000);
+    Entry* mergedEntry = dbDestination->resolveEntry(updatedEntry->uuid());
+    QVERIFY(mergedEntry);
+    QCOMPARE(mergedEntry->title(), QString("updated entry"));
+
+    dbDestination->merge(dbSource);
+
+    QCOMPARE(dbDestination->rootGroup()->entriesRecursive().size(), 2002);
+
+    delete dbDestination;
+    delete dbSource;
+}
 
 Database* TestMerge::createTestDatabase()
 {
@@ -0,0 +1,67 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestNativeMessaging.h"
+
+#include <QTest>
+
+#include "browser/NativeMessagingBase.h"
+
+QTEST_GUILESS_MAIN(TestNativeMessaging)
+
+void TestNativeMessaging::testFraming()
+{
+    QByteArray frame = NativeMessagingBase::frameMessage("{\"action\":\"test\"}");
+    QCOMPARE(frame.size(), 4 + 17);
+
+    // several messages arriving in one read
+    QByteArray buffer = frame + NativeMessagingBase::frameMessage("{}") + NativeMessagingBase::frameMessage("");
+    QList<QByteArray> messages;
+    QVERIFY(NativeMessagingBase::takeFramedMessages(buffer, &messages));
+    QCOMPARE(messages, QList<QByteArray>() << "{\"action\":\"test\"}" << "{}");
+    QVERIFY(buffer.isEmpty());
+}
+
+void TestNativeMessaging::testPartialMessages()
+{
+    QByteArray data = NativeMessagingBase::frameMessage("first") + NativeMessagingBase::frameMessage("second");
+
+    // feed the data in small pieces, which also splits the length prefix
+    QByteArray buffer;
+    QList<QByteArray> messages;
+    for (int i = 0; i < data.size(); i += 3) {
+        buffer.append(data.mid(i, 3));
+        QVERIFY(NativeMessagingBase::takeFramedMessages(buffer, &messages));
+        if (i + 3 < 9) {
+            QVERIFY(messages.isEmpty());
+        }
+    }
+
+    QCOMPARE(messages, QList<QByteArray>() << "first" << "second");
+    QVERIFY(buffer.isEmpty());
+}
+
+void TestNativeMessaging::testInvalidLength()
+{
+    QByteArray buffer = NativeMessagingBase::frameMessage("valid");
+    quint32 length = NativeMessagingBase::MaxMessageLength + 1;
+    buffer.append(reinterpret_cast<const char*>(&length), sizeof(length));
+
+    QList<QByteArray> messages;
+    QVERIFY(!NativeMessagingBase::takeFramedMessages(buffer, &messages));
+    QVERIFY(buffer.isEmpty());
+}
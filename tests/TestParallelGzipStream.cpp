@@ -0,0 +1,168 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestParallelGzipStream.h"
+
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QTest>
+
+#include "streams/ParallelGzipStream.h"
+#include "streams/QtIOCompressor"
+
+QTEST_GUILESS_MAIN(TestParallelGzipStream)
+
+namespace {
+    QByteArray compress(const QByteArray& data, int level)
+    {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+
+        ParallelGzipStream writer(&buffer, level);
+        if (!writer.open(QIODevice::WriteOnly) || writer.write(data) != data.size()) {
+            return QByteArray();
+        }
+        writer.close();
+
+        return buffer.buffer();
+    }
+
+    QByteArray decompress(const QByteArray& data)
+    {
+        QBuffer buffer;
+        buffer.setData(data);
+        buffer.open(QIODevice::ReadOnly);
+
+        QtIOCompressor reader(&buffer);
+        reader.setStreamFormat(QtIOCompressor::GzipFormat);
+        if (!reader.open(QIODevice::ReadOnly)) {
+            return QByteArray();
+        }
+
+        return reader.readAll();
+    }
+
+    QByteArray textData(int size)
+    {
+        QByteArray data;
+        data.reserve(size);
+        int i = 0;
+        while (data.size() < size) {
+            data.append("<Entry><String><Key>Title</Key><Value>Entry ");
+            data.append(QByteArray::number(i++));
+            data.append("</Value></String></Entry>\n");
+        }
+        data.resize(size);
+        return data;
+    }
+}
+
+void TestParallelGzipStream::testWriteRead_data()
+{
+    QTest::addColumn<int>("size");
+
+    QTest::newRow("empty") << 0;
+    QTest::newRow("small") << 1000;
+    QTest::newRow("one chunk") << int(ParallelGzipStream::ChunkSize);
+    QTest::newRow("many chunks") << ParallelGzipStream::ChunkSize * 40 + 1234;
+}
+
+void TestParallelGzipStream::testWriteRead()
+{
+    QFETCH(int, size);
+
+    QByteArray data = textData(size);
+    QByteArray compressed = compress(data, 6);
+
+    // header and trailer
+    QVERIFY(compressed.size() >= 18);
+    QCOMPARE(compressed.left(3), QByteArray::fromHex("1f8b08"));
+    QCOMPARE(decompress(compressed), data);
+}
+
+void TestParallelGzipStream::testCompressionLevel()
+{
+    QByteArray data = textData(ParallelGzipStream::ChunkSize * 4);
+
+    QByteArray fast = compress(data, 1);
+    QByteArray best = compress(data, 9);
+
+    QVERIFY(!fast.isEmpty());
+    QVERIFY(best.size() <= fast.size());
+    QCOMPARE(decompress(fast), data);
+    QCOMPARE(decompress(best), data);
+}
+
+void TestParallelGzipStream::testReadOnly()
+{
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    ParallelGzipStream stream(&buffer);
+    QTest::ignoreMessage(QtWarningMsg, "ParallelGzipStream::open: Only writing is supported.");
+    QVERIFY(!stream.open(QIODevice::ReadOnly));
+}
+
+void TestParallelGzipStream::benchmarkWrite_data()
+{
+    QTest::addColumn<bool>("parallel");
+
+    QTest::newRow("QtIOCompressor") << false;
+    QTest::newRow("ParallelGzipStream") << true;
+}
+
+void TestParallelGzipStream::benchmarkWrite()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QFETCH(bool, parallel);
+
+    const int dataSize = 64 * 1024 * 1024;
+    QByteArray data = textData(dataSize);
+
+    qint64 iterations = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+        QBuffer buffer;
+        QVERIFY(buffer.open(QIODevice::WriteOnly));
+
+        if (parallel) {
+            ParallelGzipStream writer(&buffer);
+            QVERIFY(writer.open(QIODevice::WriteOnly));
+            QCOMPARE(writer.write(data), qint64(dataSize));
+            writer.close();
+        } else {
+            QtIOCompressor writer(&buffer);
+            writer.setStreamFormat(QtIOCompressor::GzipFormat);
+            QVERIFY(writer.open(QIODevice::WriteOnly));
+            QCOMPARE(writer.write(data), qint64(dataSize));
+            writer.close();
+        }
+
+        QVERIFY(!buffer.buffer().isEmpty());
+        ++iterations;
+    }
+    qint64 nsecs = qMax(timer.nsecsElapsed(), qint64(1));
+
+    // report throughput (MB/s) of the uncompressed data rather than time per iteration
+    QTest::setBenchmarkResult(iterations * dataSize * 1e9 / nsecs, QTest::BytesPerSecond);
+}
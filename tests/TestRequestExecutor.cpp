@@ -0,0 +1,136 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestRequestExecutor.h"
+
+#include <QAtomicInt>
+#include <QSemaphore>
+#include <QTest>
+#include <QThread>
+#include <QTimer>
+
+#include "core/RequestExecutor.h"
+
+QTEST_GUILESS_MAIN(TestRequestExecutor)
+
+void TestRequestExecutor::testClientRequestsInOrder()
+{
+    RequestExecutor executor;
+    executor.setMaxThreadCount(3);
+
+    // the requests of a client run one at a time, even with idle threads
+    QAtomicInt running;
+    QAtomicInt overlapped;
+    QList<QByteArray> replies;
+    int client;
+    for (int i = 1; i <= 3; ++i) {
+        executor.submit(&client, [&running, &overlapped, i]() {
+            if (running.fetchAndAddOrdered(1) != 0) {
+                overlapped.fetchAndStoreOrdered(1);
+            }
+            // the first request takes longest
+            QThread::msleep(i == 1 ? 100 : 10);
+            running.fetchAndAddOrdered(-1);
+            return QByteArray::number(i);
+        }, [&replies](const QByteArray& reply) {
+            replies.append(reply);
+        });
+    }
+
+    executor.waitForDone();
+    QCOMPARE(replies, QList<QByteArray>() << "1" << "2" << "3");
+    QCOMPARE(overlapped.load(), 0);
+}
+
+void TestRequestExecutor::testParallelClients()
+{
+    RequestExecutor executor;
+    executor.setMaxThreadCount(2);
+
+    // the first request only finishes once the one of the other client runs
+    QSemaphore semaphore;
+    QList<QByteArray> replies;
+    int client1;
+    int client2;
+    executor.submit(&client1, [&semaphore]() {
+        return QByteArray(semaphore.tryAcquire(1, 5000) ? "waited" : "timeout");
+    }, [&replies](const QByteArray& reply) {
+        replies.append(reply);
+    });
+    executor.submit(&client2, [&semaphore]() {
+        semaphore.release();
+        return QByteArray("released");
+    }, [&replies](const QByteArray& reply) {
+        replies.append(reply);
+    });
+
+    executor.waitForDone();
+    QCOMPARE(replies.size(), 2);
+    QVERIFY(replies.contains("waited"));
+    QVERIFY(replies.contains("released"));
+}
+
+void TestRequestExecutor::testCancel()
+{
+    RequestExecutor executor;
+
+    QSemaphore semaphore;
+    QList<QByteArray> replies;
+    int client1;
+    int client2;
+    executor.submit(&client1, [&semaphore]() {
+        semaphore.acquire();
+        return QByteArray("cancelled");
+    }, [&replies](const QByteArray& reply) {
+        replies.append(reply);
+    });
+    // queued behind the running request, it never runs
+    executor.submit(&client1, []() {
+        return QByteArray("queued");
+    }, [&replies](const QByteArray& reply) {
+        replies.append(reply);
+    });
+    executor.submit(&client2, []() {
+        return QByteArray("delivered");
+    }, [&replies](const QByteArray& reply) {
+        replies.append(reply);
+    });
+
+    executor.cancel(&client1);
+    semaphore.release();
+    executor.waitForDone();
+    QCOMPARE(replies, QList<QByteArray>() << "delivered");
+}
+
+void TestRequestExecutor::testCallsToExecutorThread()
+{
+    RequestExecutor executor;
+    QTimer timer;
+
+    // requests may wait for this thread, e.g. for a dialog, while it waits for them
+    QByteArray result;
+    executor.submit(&timer, [&timer]() {
+        bool ok = QMetaObject::invokeMethod(&timer, "start", Qt::BlockingQueuedConnection, Q_ARG(int, 60000));
+        return QByteArray(ok ? "started" : "failed");
+    }, [&result](const QByteArray& reply) {
+        result = reply;
+    });
+
+    executor.waitForDone();
+    QCOMPARE(result, QByteArray("started"));
+    QVERIFY(timer.isActive());
+}
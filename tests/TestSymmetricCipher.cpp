@@ -19,6 +19,8 @@
 #include "TestSymmetricCipher.h"
 
 #include <QBuffer>
+#include <QElapsedTimer>
+#include <QTemporaryFile>
 #include <QTest>
 
 #include "crypto/Crypto.h"
@@ -164,6 +166,34 @@ void TestSymmetricCipher::testAes256CtrDecryption()
     QVERIFY(ok);
 }
 
+void TestSymmetricCipher::testAes256EcbRounds()
+{
+    QByteArray key = QByteArray::fromHex("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4");
+    QByteArray iv(16, 0);
+    QByteArray plainText;
+    for (int i = 0; i < 7 * 16; ++i) {
+        plainText.append(static_cast<char>(i));
+    }
+
+    // multiple blocks are encrypted in one interleaved loop, make sure
+    // every block still ends up as if it had been encrypted on its own
+    SymmetricCipher encrypt(SymmetricCipher::Aes256, SymmetricCipher::Ecb, SymmetricCipher::Encrypt);
+    QVERIFY(encrypt.init(key, iv));
+    QByteArray cipherText = plainText;
+    QVERIFY(encrypt.processInPlace(cipherText, 1000));
+
+    for (int i = 0; i < 7; ++i) {
+        QByteArray block = plainText.mid(i * 16, 16);
+        QVERIFY(encrypt.processInPlace(block, 1000));
+        QCOMPARE(block, cipherText.mid(i * 16, 16));
+    }
+
+    SymmetricCipher decrypt(SymmetricCipher::Aes256, SymmetricCipher::Ecb, SymmetricCipher::Decrypt);
+    QVERIFY(decrypt.init(key, iv));
+    QVERIFY(decrypt.processInPlace(cipherText, 1000));
+    QCOMPARE(cipherText, plainText);
+}
+
 void TestSymmetricCipher::testTwofish256CbcEncryption()
 {
     // NIST MCT Known-Answer Tests (cbc_e_m.txt)
@@ -342,6 +372,53 @@ void TestSymmetricCipher::testSalsa20()
     QCOMPARE(cipherTextB.mid(448, 64), expectedCipherText4);
 }
 
+void TestSymmetricCipher::testChaCha20()
+{
+    // https://tools.ietf.org/html/rfc7539#appendix-A.2
+
+    QByteArray key(32, '\0');
+    QByteArray iv(12, '\0');
+    bool ok;
+
+    SymmetricCipher cipher(SymmetricCipher::ChaCha20, SymmetricCipher::Stream, SymmetricCipher::Encrypt);
+    QVERIFY(cipher.init(key, iv));
+
+    QByteArray expectedCipherText;
+    expectedCipherText.append(QByteArray::fromHex("76b8e0ada0f13d90405d6ae55386bd28"));
+    expectedCipherText.append(QByteArray::fromHex("bdd219b8a08ded1aa836efcc8b770dc7"));
+    expectedCipherText.append(QByteArray::fromHex("da41597c5157488d7724e03fb8d84a37"));
+    expectedCipherText.append(QByteArray::fromHex("6a43b8f41518a11cc387b669b2ee6586"));
+
+    QCOMPARE(cipher.process(QByteArray(64, '\0'), &ok), expectedCipherText);
+    QVERIFY(ok);
+
+    QCOMPARE(SymmetricCipher::cipherToAlgorithm(KeePass2::CIPHER_CHACHA20), SymmetricCipher::ChaCha20);
+    QCOMPARE(SymmetricCipher::algorithmToCipher(SymmetricCipher::ChaCha20), KeePass2::CIPHER_CHACHA20);
+    QCOMPARE(SymmetricCipher::algorithmIvSize(SymmetricCipher::ChaCha20), 12);
+    QCOMPARE(SymmetricCipher::algorithmMode(SymmetricCipher::ChaCha20), SymmetricCipher::Stream);
+
+    // stream ciphers are neither padded nor buffered
+    QByteArray plainText = QByteArray::fromHex("6bc1bee22e409f96e93d");
+    QBuffer buffer;
+    buffer.open(QIODevice::ReadWrite);
+
+    SymmetricCipherStream streamEnc(&buffer, SymmetricCipher::ChaCha20, SymmetricCipher::Stream,
+                                    SymmetricCipher::Encrypt);
+    QVERIFY(streamEnc.init(key, iv));
+    QVERIFY(streamEnc.open(QIODevice::WriteOnly));
+    QCOMPARE(streamEnc.write(plainText), qint64(plainText.size()));
+    QCOMPARE(buffer.data().size(), plainText.size());
+    streamEnc.close();
+    QCOMPARE(buffer.data().size(), plainText.size());
+
+    buffer.reset();
+    SymmetricCipherStream streamDec(&buffer, SymmetricCipher::ChaCha20, SymmetricCipher::Stream,
+                                    SymmetricCipher::Decrypt);
+    QVERIFY(streamDec.init(key, iv));
+    QVERIFY(streamDec.open(QIODevice::ReadOnly));
+    QCOMPARE(streamDec.readAll(), plainText);
+}
+
 void TestSymmetricCipher::testPadding()
 {
     QByteArray key = QByteArray::fromHex("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4");
@@ -387,3 +464,148 @@ void TestSymmetricCipher::testStreamReset()
     writer.close();
     QCOMPARE(buffer.buffer().size(), 16);
 }
+
+void TestSymmetricCipher::testStreamBulkRead()
+{
+    QByteArray key = QByteArray::fromHex("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4");
+    QByteArray iv = QByteArray::fromHex("000102030405060708090a0b0c0d0e0f");
+
+    // sizes around the internal chunk size and the padding block
+    const QList<int> sizes = {0, 15, 16, 17, 65535, 65536, 65537, 200000};
+
+    for (int size : sizes) {
+        QByteArray plainText(size, '\0');
+        for (int i = 0; i < size; i++) {
+            plainText[i] = static_cast<char>(i * 7);
+        }
+
+        QBuffer buffer;
+        buffer.open(QIODevice::ReadWrite);
+
+        SymmetricCipherStream streamEnc(&buffer, SymmetricCipher::Aes256, SymmetricCipher::Cbc,
+                                        SymmetricCipher::Encrypt);
+        QVERIFY(streamEnc.init(key, iv));
+        QVERIFY(streamEnc.open(QIODevice::WriteOnly));
+        // uneven writes must not change the output
+        QCOMPARE(streamEnc.write(plainText.left(size / 3)), qint64(size / 3));
+        QCOMPARE(streamEnc.write(plainText.mid(size / 3)), qint64(size - size / 3));
+        streamEnc.close();
+        QCOMPARE(buffer.data().size(), (size / 16 + 1) * 16);
+
+        // chunked reads and decrypting straight out of the buffer
+        for (bool fromMemory : {false, true}) {
+            for (int readSize : {1, 13, 16, 4096, 100000}) {
+                buffer.reset();
+                SymmetricCipherStream streamDec(&buffer, SymmetricCipher::Aes256, SymmetricCipher::Cbc,
+                                                SymmetricCipher::Decrypt);
+                QVERIFY(streamDec.init(key, iv));
+                streamDec.setReadFromMemory(fromMemory);
+                QVERIFY(streamDec.open(QIODevice::ReadOnly));
+
+                QByteArray decrypted;
+                QByteArray part;
+                do {
+                    part = streamDec.read(readSize);
+                    decrypted.append(part);
+                } while (!part.isEmpty());
+
+                QCOMPARE(decrypted.size(), plainText.size());
+                QCOMPARE(decrypted, plainText);
+            }
+        }
+    }
+}
+
+void TestSymmetricCipher::testStreamReadFromFile()
+{
+    QByteArray key = QByteArray::fromHex("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4");
+    QByteArray iv = QByteArray::fromHex("000102030405060708090a0b0c0d0e0f");
+
+    // more than one chunk, the file is read piece by piece
+    QByteArray plainText(150000, '\0');
+    for (int i = 0; i < plainText.size(); i++) {
+        plainText[i] = static_cast<char>(i * 13);
+    }
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    SymmetricCipherStream streamEnc(&file, SymmetricCipher::Aes256, SymmetricCipher::Cbc,
+                                    SymmetricCipher::Encrypt);
+    QVERIFY(streamEnc.init(key, iv));
+    QVERIFY(streamEnc.open(QIODevice::WriteOnly));
+    QCOMPARE(streamEnc.write(plainText), qint64(plainText.size()));
+    streamEnc.close();
+    QCOMPARE(file.size(), qint64((plainText.size() / 16 + 1) * 16));
+
+    QVERIFY(file.seek(0));
+    SymmetricCipherStream streamDec(&file, SymmetricCipher::Aes256, SymmetricCipher::Cbc,
+                                    SymmetricCipher::Decrypt);
+    QVERIFY(streamDec.init(key, iv));
+    QVERIFY(streamDec.open(QIODevice::ReadOnly));
+
+    QByteArray decrypted;
+    QByteArray part;
+    do {
+        part = streamDec.read(5000);
+        decrypted.append(part);
+    } while (!part.isEmpty());
+
+    QCOMPARE(decrypted, plainText);
+}
+
+void TestSymmetricCipher::benchmarkStreamDecrypt_data()
+{
+    QTest::addColumn<int>("algorithmId");
+    QTest::addColumn<QByteArray>("iv");
+
+    QTest::newRow("AES-256") << static_cast<int>(SymmetricCipher::Aes256) << QByteArray(16, '\x2A');
+    QTest::newRow("Twofish") << static_cast<int>(SymmetricCipher::Twofish) << QByteArray(16, '\x2A');
+    QTest::newRow("ChaCha20") << static_cast<int>(SymmetricCipher::ChaCha20) << QByteArray(12, '\x2A');
+}
+
+void TestSymmetricCipher::benchmarkStreamDecrypt()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QFETCH(int, algorithmId);
+    QFETCH(QByteArray, iv);
+    SymmetricCipher::Algorithm algorithm = static_cast<SymmetricCipher::Algorithm>(algorithmId);
+
+    const int dataSize = 32 * 1024 * 1024;
+    QByteArray key(32, '\x7E');
+    SymmetricCipher::Mode mode = SymmetricCipher::algorithmMode(algorithm);
+
+    QBuffer buffer;
+    buffer.open(QIODevice::ReadWrite);
+    SymmetricCipherStream streamEnc(&buffer, algorithm, mode, SymmetricCipher::Encrypt);
+    QVERIFY(streamEnc.init(key, iv));
+    QVERIFY(streamEnc.open(QIODevice::WriteOnly));
+    QCOMPARE(streamEnc.write(QByteArray(dataSize, '\x55')), qint64(dataSize));
+    streamEnc.close();
+
+    QByteArray decrypted(dataSize, '\0');
+    qint64 iterations = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+        buffer.reset();
+        SymmetricCipherStream streamDec(&buffer, algorithm, mode, SymmetricCipher::Decrypt);
+        QVERIFY(streamDec.init(key, iv));
+        QVERIFY(streamDec.open(QIODevice::ReadOnly));
+        // read in pieces like the XML parser does
+        for (int offset = 0; offset < dataSize; offset += 16384) {
+            QCOMPARE(streamDec.read(decrypted.data() + offset, 16384), qint64(16384));
+        }
+        ++iterations;
+    }
+    qint64 nsecs = qMax(timer.nsecsElapsed(), qint64(1));
+
+    QCOMPARE(decrypted, QByteArray(dataSize, '\x55'));
+
+    // report throughput (MB/s) rather than time per iteration
+    QTest::setBenchmarkResult(iterations * dataSize * 1e9 / nsecs, QTest::BytesPerSecond);
+}
@@ -31,11 +31,17 @@ private slots:
     void testAes256CbcDecryption();
     void testAes256CtrEncryption();
     void testAes256CtrDecryption();
+    void testAes256EcbRounds();
     void testTwofish256CbcEncryption();
     void testTwofish256CbcDecryption();
     void testSalsa20();
+    void testChaCha20();
     void testPadding();
     void testStreamReset();
+    void testStreamBulkRead();
+    void testStreamReadFromFile();
+    void benchmarkStreamDecrypt_data();
+    void benchmarkStreamDecrypt();
 };
 
 #endif // KEEPASSX_TESTSYMMETRICCIPHER_H
@@ -0,0 +1,290 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestBrowser.h"
+
+#include <QApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QListWidget>
+#include <QTest>
+#include <QTimer>
+
+#include "sodium.h"
+
+#include "config-keepassx-tests.h"
+#include "browser/BrowserAccessControlDialog.h"
+#include "browser/BrowserAction.h"
+#include "browser/BrowserService.h"
+#include "browser/BrowserSettings.h"
+#include "core/Config.h"
+#include "core/Database.h"
+#include "core/Entry.h"
+#include "core/Group.h"
+#include "core/Tools.h"
+#include "core/Uuid.h"
+#include "crypto/Crypto.h"
+#include "gui/DatabaseTabWidget.h"
+#include "gui/DatabaseWidget.h"
+#include "gui/MessageBox.h"
+
+QTEST_MAIN(TestBrowser)
+
+namespace
+{
+    QJsonObject loginKey(const QString& url, const QString& submitUrl = QString())
+    {
+        QJsonObject key;
+        key["url"] = url;
+        if (!submitUrl.isEmpty()) {
+            key["submitUrl"] = submitUrl;
+        }
+        return key;
+    }
+
+    QStringList logins(const QJsonValue& result)
+    {
+        QStringList list;
+        const QJsonArray entries = result.toObject().value("entries").toArray();
+        for (const QJsonValue& entry : entries) {
+            list << entry.toObject().value("login").toString();
+        }
+        list.sort();
+        return list;
+    }
+}
+
+void TestBrowser::initTestCase()
+{
+    QVERIFY(Crypto::init());
+    QVERIFY(sodium_init() >= 0);
+    Config::createTempFileInstance();
+    BrowserSettings::setAlwaysAllowAccess(false);
+
+    m_tabWidget = new DatabaseTabWidget();
+    m_service = new BrowserService(m_tabWidget);
+    m_action = new BrowserAction(*m_service);
+
+    QByteArray dbData;
+    QFile sourceDbFile(QString(KEEPASSX_TEST_DATA_DIR).append("/NewDatabase.kdbx"));
+    QVERIFY(sourceDbFile.open(QIODevice::ReadOnly));
+    QVERIFY(Tools::readAllFromDevice(&sourceDbFile, dbData));
+    QVERIFY(m_dbFile.open());
+    QCOMPARE(m_dbFile.write(dbData), static_cast<qint64>(dbData.size()));
+    m_dbFile.close();
+
+    m_tabWidget->openDatabase(m_dbFile.filePath(), "a");
+    QVERIFY(m_tabWidget->currentDatabaseWidget());
+    // the database is loaded on a worker thread
+    QTRY_COMPARE(m_tabWidget->currentDatabaseWidget()->currentMode(), DatabaseWidget::ViewMode);
+    m_db = m_tabWidget->currentDatabaseWidget()->database();
+
+    addEntry("Login 1", "user1", "https://login.example.com");
+    addEntry("Login 2", "user2", "https://login.example.com/signin");
+    addEntry("Other", "user3", "https://other.org");
+
+    // the key the association dialog would have stored
+    Entry* config = m_service->getConfigEntry(true);
+    QVERIFY(config);
+    config->attributes()->set("Public Key: test", "associationkey", true);
+
+    m_clientPublicKey.resize(crypto_box_PUBLICKEYBYTES);
+    m_clientSecretKey.resize(crypto_box_SECRETKEYBYTES);
+    crypto_box_keypair(reinterpret_cast<unsigned char*>(m_clientPublicKey.data()),
+                       reinterpret_cast<unsigned char*>(m_clientSecretKey.data()));
+
+    QByteArray nonce(crypto_box_NONCEBYTES, '\0');
+    randombytes_buf(nonce.data(), static_cast<size_t>(nonce.size()));
+    QJsonObject keys;
+    keys["action"] = QString("change-public-keys");
+    keys["publicKey"] = QString(m_clientPublicKey.toBase64());
+    keys["nonce"] = QString(nonce.toBase64());
+    QJsonObject reply = m_action->readResponse(keys);
+    m_serverPublicKey = QByteArray::fromBase64(reply.value("publicKey").toString().toLatin1());
+    QCOMPARE(m_serverPublicKey.size(), static_cast<int>(crypto_box_PUBLICKEYBYTES));
+
+    QJsonObject associate;
+    associate["action"] = QString("test-associate");
+    associate["id"] = QString("test");
+    associate["key"] = QString("associationkey");
+    reply = request(associate);
+    QCOMPARE(reply.value("id").toString(), QString("test"));
+}
+
+void TestBrowser::testGetLoginsBatch()
+{
+    // every entry needing a confirmation is listed in a single dialog
+    int dialogs = 0;
+    int confirmedEntries = 0;
+    QTimer timer;
+    timer.setInterval(50);
+    connect(&timer, &QTimer::timeout, [&dialogs, &confirmedEntries]() {
+        BrowserAccessControlDialog* dialog = qobject_cast<BrowserAccessControlDialog*>(
+            QApplication::activeModalWidget());
+        if (dialog) {
+            ++dialogs;
+            confirmedEntries = dialog->findChild<QListWidget*>("itemsList")->count();
+            dialog->setRemember(true);
+            dialog->accept();
+        }
+    });
+    timer.start();
+
+    // a repeated key and two urls of the same host that share its search
+    QJsonArray keys;
+    keys << loginKey("https://login.example.com/signin", "https://login.example.com/post")
+         << loginKey("https://other.org/")
+         << loginKey("https://login.example.com/signin", "https://login.example.com/post")
+         << loginKey("https://login.example.com/account");
+
+    QJsonObject batch;
+    batch["action"] = QString("get-logins-batch");
+    batch["id"] = QString("test");
+    batch["keys"] = keys;
+
+    QJsonObject reply = request(batch);
+    QCOMPARE(dialogs, 1);
+    QCOMPARE(confirmedEntries, 3);
+
+    // one result per key, in the order of the keys
+    QJsonArray results = reply.value("results").toArray();
+    QCOMPARE(results.size(), keys.size());
+    for (int i = 0; i < keys.size(); ++i) {
+        QCOMPARE(results.at(i).toObject().value("url").toString(), keys.at(i).toObject().value("url").toString());
+    }
+    QCOMPARE(logins(results.at(0)), QStringList() << "user1" << "user2");
+    QCOMPARE(logins(results.at(1)), QStringList() << "user3");
+    QCOMPARE(results.at(2), results.at(0));
+    QCOMPARE(logins(results.at(3)), QStringList() << "user1" << "user2");
+    QCOMPARE(results.at(3).toObject().value("count").toInt(), 2);
+
+    // the remembered decision covers all hosts of the batch
+    reply = request(batch);
+    QCOMPARE(dialogs, 1);
+    results = reply.value("results").toArray();
+    QCOMPARE(results.size(), keys.size());
+    QCOMPARE(logins(results.at(0)), QStringList() << "user1" << "user2");
+    QCOMPARE(logins(results.at(1)), QStringList() << "user3");
+    QCOMPARE(logins(results.at(3)), QStringList() << "user1" << "user2");
+}
+
+void TestBrowser::testGetLoginsBatchMissingUrl()
+{
+    QJsonArray keys;
+    keys << loginKey("https://other.org/");
+    QJsonObject key;
+    key["submitUrl"] = QString("https://other.org/post");
+    keys << key;
+
+    QJsonObject batch;
+    batch["action"] = QString("get-logins-batch");
+    batch["id"] = QString("test");
+    batch["keys"] = keys;
+
+    QJsonObject reply = request(batch);
+    QCOMPARE(reply.value("errorCode").toString(), QString("14"));
+    QVERIFY(!reply.contains("results"));
+}
+
+void TestBrowser::testGetLoginsParentDomain()
+{
+    BrowserSettings::setAlwaysAllowAccess(true);
+    addEntry("Example", "user4", "https://example.com");
+
+    // the entries of a subdomain hide the ones of its parent domains
+    QJsonArray keys;
+    keys << loginKey("https://login.example.com/")
+         << loginKey("https://www.example.com/")
+         << loginKey("https://example.com/");
+
+    QJsonObject batch;
+    batch["action"] = QString("get-logins-batch");
+    batch["id"] = QString("test");
+    batch["keys"] = keys;
+
+    QJsonObject reply = request(batch);
+    BrowserSettings::setAlwaysAllowAccess(false);
+
+    QJsonArray results = reply.value("results").toArray();
+    QCOMPARE(results.size(), keys.size());
+    QCOMPARE(logins(results.at(0)), QStringList() << "user1" << "user2");
+    QCOMPARE(logins(results.at(1)), QStringList() << "user4");
+    QCOMPARE(logins(results.at(2)), QStringList() << "user4");
+}
+
+void TestBrowser::cleanupTestCase()
+{
+    delete m_action;
+    delete m_service;
+
+    // DO NOT save the database
+    MessageBox::setNextAnswer(QMessageBox::No);
+    m_tabWidget->closeAllDatabases();
+    delete m_tabWidget;
+}
+
+void TestBrowser::addEntry(const QString& title, const QString& username, const QString& url)
+{
+    Entry* entry = new Entry();
+    entry->setUuid(Uuid::random());
+    entry->setTitle(title);
+    entry->setUsername(username);
+    entry->setUrl(url);
+    entry->setGroup(m_db->rootGroup());
+}
+
+QJsonObject TestBrowser::request(const QJsonObject& message)
+{
+    QByteArray nonce(crypto_box_NONCEBYTES, '\0');
+    randombytes_buf(nonce.data(), static_cast<size_t>(nonce.size()));
+
+    const QByteArray plain = QJsonDocument(message).toJson();
+    QByteArray encrypted(plain.size() + crypto_box_MACBYTES, '\0');
+    crypto_box_easy(reinterpret_cast<unsigned char*>(encrypted.data()),
+                    reinterpret_cast<const unsigned char*>(plain.constData()),
+                    static_cast<unsigned long long>(plain.size()),
+                    reinterpret_cast<const unsigned char*>(nonce.constData()),
+                    reinterpret_cast<const unsigned char*>(m_serverPublicKey.constData()),
+                    reinterpret_cast<const unsigned char*>(m_clientSecretKey.constData()));
+
+    QJsonObject json;
+    json["action"] = message.value("action");
+    json["message"] = QString(encrypted.toBase64());
+    json["nonce"] = QString(nonce.toBase64());
+    const QJsonObject reply = m_action->readResponse(json);
+    if (!reply.contains("message")) {
+        // errors aren't encrypted
+        return reply;
+    }
+
+    const QByteArray replyNonce = QByteArray::fromBase64(reply.value("nonce").toString().toLatin1());
+    const QByteArray replyMessage = QByteArray::fromBase64(reply.value("message").toString().toLatin1());
+    if (replyMessage.size() < static_cast<int>(crypto_box_MACBYTES)) {
+        return QJsonObject();
+    }
+    QByteArray decrypted(replyMessage.size() - crypto_box_MACBYTES, '\0');
+    if (crypto_box_open_easy(reinterpret_cast<unsigned char*>(decrypted.data()),
+                             reinterpret_cast<const unsigned char*>(replyMessage.constData()),
+                             static_cast<unsigned long long>(replyMessage.size()),
+                             reinterpret_cast<const unsigned char*>(replyNonce.constData()),
+                             reinterpret_cast<const unsigned char*>(m_serverPublicKey.constData()),
+                             reinterpret_cast<const unsigned char*>(m_clientSecretKey.constData())) != 0) {
+        return QJsonObject();
+    }
+
+    return QJsonDocument::fromJson(decrypted).object();
+}
@@ -0,0 +1,56 @@
+/*
+ *  Copyright (C) 2017 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_TESTBROWSER_H
+#define KEEPASSX_TESTBROWSER_H
+
+#include "TemporaryFile.h"
+
+#include <QJsonObject>
+#include <QObject>
+
+class BrowserAction;
+class BrowserService;
+class Database;
+class DatabaseTabWidget;
+
+class TestBrowser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testGetLoginsBatch();
+    void testGetLoginsBatchMissingUrl();
+    void testGetLoginsParentDomain();
+    void cleanupTestCase();
+
+private:
+    void addEntry(const QString& title, const QString& username, const QString& url);
+    QJsonObject request(const QJsonObject& message);
+
+    DatabaseTabWidget* m_tabWidget;
+    BrowserService* m_service;
+    BrowserAction* m_action;
+    Database* m_db;
+    TemporaryFile m_dbFile;
+    QByteArray m_clientPublicKey;
+    QByteArray m_clientSecretKey;
+    QByteArray m_serverPublicKey;
+};
+
+#endif // KEEPASSX_TESTBROWSER_H
@@ -100,11 +100,12 @@ void TestGui::init()
 
     QTest::keyClicks(editPassword, "a");
     QTest::keyClick(editPassword, Qt::Key_Enter);
-    Tools::wait(100);
 
     QVERIFY(m_tabWidget->currentDatabaseWidget());
 
     m_dbWidget = m_tabWidget->currentDatabaseWidget();
+    // the database is loaded on a worker thread
+    QTRY_COMPARE(m_dbWidget->currentMode(), DatabaseWidget::ViewMode);
     m_db = m_dbWidget->database();
 }
 
@@ -949,7 +950,7 @@ void TestGui::testDatabaseLocking()
     QTest::keyClicks(editPassword, "a");
     QTest::keyClick(editPassword, Qt::Key_Enter);
 
-    QCOMPARE(m_tabWidget->tabText(0).remove('&'), origDbName);
+    QTRY_COMPARE(m_tabWidget->tabText(0).remove('&'), origDbName);
 }
 
 void TestGui::testDragAndDropKdbxFiles()